@@ -16,12 +16,27 @@
  * along with crun.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/* Multiplexed console receiver.
+ *
+ * One process accepts any number of terminal fds sent with SCM_RIGHTS over
+ * the console socket (the protocol used by src/libcrun/terminal.c) and
+ * relays all of them through a single epoll loop.  Each session is spliced
+ * into a bounded per-session ring file under the output directory, and an
+ * index file lists the live sessions so that tooling can attach to any of
+ * them through /proc/PID/fd/FD.
+ *
+ * Usage: terminal-receiver [-o DIR] [-s RING_SIZE] PATH
+ */
+
 #define _GNU_SOURCE
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/un.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -29,6 +44,7 @@
 #include <termios.h>
 #include <signal.h>
 #include <stdio.h>
+#include <limits.h>
 
 #define error(status, errno, fmt, ...) do {                             \
     if (!errno)                                                          \
@@ -39,15 +55,30 @@
       exit (status);                                                    \
   } while(0)
 
-struct termios tset;
-int fd;
+#define DEFAULT_RING_SIZE (4 * 1024 * 1024)
+
+struct session
+{
+  struct session *next;
+  int id;
+  int pty_fd;
+  int log_fd;
+  off_t log_off;
+  char log_path[PATH_MAX];
+};
+
+static struct session *sessions;
+static const char *output_dir = ".";
+static off_t ring_size = DEFAULT_RING_SIZE;
+static int next_session_id = 1;
+static int splice_pipe[2] = { -1, -1 };
 
 int
 open_unix_domain_socket (const char *path)
 {
   struct sockaddr_un addr = {};
   int ret;
-  int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
   if (fd < 0)
     error (EXIT_FAILURE, errno, "error creating UNIX socket");
 
@@ -57,7 +88,7 @@ open_unix_domain_socket (const char *path)
   if (ret < 0)
     error (EXIT_FAILURE, errno, "error binding UNIX socket");
 
-  ret = listen (fd, 1);
+  ret = listen (fd, SOMAXCONN);
   if (ret < 0)
     error (EXIT_FAILURE, errno, "listen");
 
@@ -106,118 +137,250 @@ receive_fd_from_socket (int from)
   return fd;
 }
 
-void
-sigint_handler (int s)
+/* Rewrite the session index.  Tooling can attach to a live session by
+   opening /proc/PID/fd/FD from its line.  */
+static void
+write_index (void)
 {
-  const char ctrlc = 3;
-  write(fd, &ctrlc, 1);
+  char tmp_path[PATH_MAX];
+  char path[PATH_MAX];
+  struct session *s;
+  FILE *f;
+
+  snprintf (tmp_path, sizeof (tmp_path), "%s/index.tmp", output_dir);
+  snprintf (path, sizeof (path), "%s/index", output_dir);
+
+  f = fopen (tmp_path, "we");
+  if (f == NULL)
+    {
+      error (0, errno, "cannot write index file\n");
+      return;
+    }
+
+  fprintf (f, "# ID PID FD LOG\n");
+  for (s = sessions; s; s = s->next)
+    fprintf (f, "%d %d %d %s\n", s->id, getpid (), s->pty_fd, s->log_path);
+
+  fclose (f);
+  if (rename (tmp_path, path) < 0)
+    error (0, errno, "cannot rename index file\n");
 }
 
-void
-register_handler (struct sigaction* handler)
+static void
+configure_terminal (int fd)
 {
-  handler->sa_handler = sigint_handler;
-  sigemptyset(&handler->sa_mask);
-  handler->sa_flags = 0;
-  sigaction(SIGINT, handler, NULL);
+  struct termios tset;
+
+  if (tcgetattr (fd, &tset) == -1)
+    {
+      error (0, errno, "failed to get console terminal settings\n");
+      return;
+    }
+
+  tset.c_oflag |= ONLCR;
+  tset.c_lflag &= ~ECHO;
+
+  if (tcsetattr (fd, TCSANOW, &tset) == -1)
+    error (0, errno, "failed to set console terminal settings\n");
 }
 
-int
-main (int argc, char **argv)
+static void
+add_session (int epollfd, int pty_fd)
+{
+  struct epoll_event ev = {};
+  struct session *s;
+  int flags;
+
+  s = calloc (1, sizeof (*s));
+  if (s == NULL)
+    error (EXIT_FAILURE, 0, "OOM");
+
+  s->id = next_session_id++;
+  s->pty_fd = pty_fd;
+  snprintf (s->log_path, sizeof (s->log_path), "%s/session-%d.log", output_dir, s->id);
+
+  s->log_fd = open (s->log_path, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0600);
+  if (s->log_fd < 0)
+    error (EXIT_FAILURE, errno, "cannot open `%s`", s->log_path);
+
+  configure_terminal (pty_fd);
+
+  flags = fcntl (pty_fd, F_GETFL);
+  if (flags < 0 || fcntl (pty_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    error (EXIT_FAILURE, errno, "failed to set terminal to non-blocking");
+
+  ev.events = EPOLLIN;
+  ev.data.ptr = s;
+  if (epoll_ctl (epollfd, EPOLL_CTL_ADD, pty_fd, &ev) < 0)
+    error (EXIT_FAILURE, errno, "epoll_ctl");
+
+  s->next = sessions;
+  sessions = s;
+
+  write_index ();
+}
+
+static void
+del_session (int epollfd, struct session *s)
 {
-  char buf[8192];
-  int ret, socket;
-  struct sigaction ctrl_c_handler;
-  if (argc < 2)
-    error (EXIT_FAILURE, 0, "usage %s PATH\n", argv[0]);
+  struct session **it;
+
+  epoll_ctl (epollfd, EPOLL_CTL_DEL, s->pty_fd, NULL);
+  close (s->pty_fd);
+  close (s->log_fd);
 
-  unlink (argv[1]);
+  for (it = &sessions; *it; it = &(*it)->next)
+    if (*it == s)
+      {
+        *it = s->next;
+        break;
+      }
+  free (s);
 
-  register_handler(&ctrl_c_handler);
+  write_index ();
+}
 
-  socket = open_unix_domain_socket (argv[1]);
+/* Move data from the pty into the session ring file without copying it
+   through userspace.  Returns 0 on EOF, a negative value on fatal errors.  */
+static int
+drain_session (struct session *s)
+{
   while (1)
     {
-      int conn;
-      int stdin_flags, term_flags;
-      int data;
-
-      printf("Press 'Ctrl \\' to exit.\nWaiting for connection ...\n");
-      do
-        conn = accept (socket, NULL, NULL);
-      while (conn < 0 && errno == EINTR);
-      if (conn < 0)
-        error (EXIT_FAILURE, errno, "accept");
-
-      fd = receive_fd_from_socket (conn);
-      if (fd < 0)
+      ssize_t n, w;
+
+      if (s->log_off >= ring_size)
+        s->log_off = 0;
+
+      n = splice (s->pty_fd, NULL, splice_pipe[1], NULL, ring_size - s->log_off,
+                  SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (n == 0)
+        return 0;
+      if (n < 0)
+        {
+          if (errno == EAGAIN)
+            return 1;
+          if (errno == EINTR)
+            continue;
+          /* EIO is how a pty reports that the other side went away.  */
+          return errno == EIO ? 0 : -1;
+        }
+
+      while (n > 0)
         {
-          close (conn);
-          continue;
+          w = splice (splice_pipe[0], NULL, s->log_fd, &s->log_off, n, SPLICE_F_MOVE);
+          if (w < 0)
+            {
+              if (errno == EINTR)
+                continue;
+              return -1;
+            }
+          n -= w;
         }
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  struct epoll_event ev = {};
+  struct epoll_event events[64];
+  int epollfd, sockfd;
+  int opt, ret;
+
+  while ((opt = getopt (argc, argv, "o:s:")) != -1)
+    switch (opt)
+      {
+      case 'o':
+        output_dir = optarg;
+        break;
+
+      case 's':
+        ring_size = atol (optarg);
+        if (ring_size <= 0)
+          error (EXIT_FAILURE, 0, "invalid ring size `%s`\n", optarg);
+        break;
+
+      default:
+        error (EXIT_FAILURE, 0, "usage %s [-o DIR] [-s RING_SIZE] PATH\n", argv[0]);
+      }
 
-      if (tcgetattr(fd, &tset) == -1)
-        error (0, errno, "failed to get console terminal settings");
+  if (optind >= argc)
+    error (EXIT_FAILURE, 0, "usage %s [-o DIR] [-s RING_SIZE] PATH\n", argv[0]);
 
-      tset.c_oflag |= ONLCR;
-      tset.c_lflag &= ~ECHO;
+  if (mkdir (output_dir, 0700) < 0 && errno != EEXIST)
+    error (EXIT_FAILURE, errno, "cannot create `%s`", output_dir);
 
-      if (tcsetattr (fd, TCSANOW, &tset) == -1)
-        error (0, errno, "failed to set console terminal settings");
+  if (pipe2 (splice_pipe, O_CLOEXEC) < 0)
+    error (EXIT_FAILURE, errno, "pipe2");
 
-      stdin_flags = fcntl(STDIN_FILENO, F_GETFL);
-      if (stdin_flags == -1)
-        error (EXIT_FAILURE, errno, "failed to obtain STDIN flags");
+  signal (SIGPIPE, SIG_IGN);
 
-      ret = fcntl(STDIN_FILENO, F_SETFL, stdin_flags | O_NONBLOCK);
-      if (ret == -1)
-        error (EXIT_FAILURE, errno, "failed to set STDIN to non-blocking");
+  unlink (argv[optind]);
+  sockfd = open_unix_domain_socket (argv[optind]);
 
-      term_flags = fcntl(fd, F_GETFL);
-      if (term_flags == -1)
-        error (EXIT_FAILURE, errno, "failed to obtain terminal flags");
+  epollfd = epoll_create1 (EPOLL_CLOEXEC);
+  if (epollfd < 0)
+    error (EXIT_FAILURE, errno, "epoll_create1");
 
-      ret = fcntl(fd, F_SETFL, term_flags | O_NONBLOCK);
-      if (ret == -1)
-        error (EXIT_FAILURE, errno, "failed to set terminal to non-blocking");
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (epoll_ctl (epollfd, EPOLL_CTL_ADD, sockfd, &ev) < 0)
+    error (EXIT_FAILURE, errno, "epoll_ctl");
 
-      while (1)
+  write_index ();
+  printf ("Waiting for connections on %s, sessions logged under %s\n", argv[optind], output_dir);
+
+  while (1)
+    {
+      int i, n;
+
+      n = epoll_wait (epollfd, events, sizeof (events) / sizeof (events[0]), -1);
+      if (n < 0)
         {
-          data = 0;
-          ret = read (fd, buf, sizeof (buf));
-          if (ret == 0)
-            break;
-          if (ret < 0 && errno != EAGAIN && errno != EINTR)
-            {
-              error (0, errno, "read\n");
-              break;
-            }
-          if (ret > 0)
-            {
-              write (STDOUT_FILENO, buf, ret);
-              data = 1;
-            }
+          if (errno == EINTR)
+            continue;
+          error (EXIT_FAILURE, errno, "epoll_wait");
+        }
+
+      for (i = 0; i < n; i++)
+        {
+          struct session *s = events[i].data.ptr;
 
-          ret = read (STDIN_FILENO, buf, sizeof(buf));
-          if (ret > 0)
+          if (s == NULL)
             {
-              ret = write (fd, buf, ret);
-              if (ret < 0 && errno != EAGAIN && errno != EINTR)
+              /* New console connection: the peer sends one terminal fd and
+                 does not need the connection afterwards.  */
+              int conn, fd;
+
+              do
+                conn = accept (sockfd, NULL, NULL);
+              while (conn < 0 && errno == EINTR);
+              if (conn < 0)
                 {
-                  error (0, errno, "write\n");
-                  break;
+                  error (0, errno, "accept\n");
+                  continue;
                 }
-              data = 1;
+
+              fd = receive_fd_from_socket (conn);
+              close (conn);
+              if (fd >= 0)
+                add_session (epollfd, fd);
+              continue;
             }
-          if (!data) usleep(10000);
+
+          if (events[i].events & EPOLLIN)
+            {
+              ret = drain_session (s);
+              if (ret > 0)
+                continue;
+              if (ret < 0)
+                error (0, errno, "error draining session %d\n", s->id);
+            }
+
+          /* EOF, error or hang-up: the session is gone.  */
+          del_session (epollfd, s);
         }
-      close (conn);
-      ret = fcntl(STDIN_FILENO, F_SETFL, stdin_flags);
-      if (ret == -1)
-        error (EXIT_FAILURE, errno, "failed to reset STDIN to original setting");
-      ret = fcntl(fd, F_SETFL, term_flags);
-      if (ret == -1)
-        error (EXIT_FAILURE, errno, "failed to reset terminal to original setting");
     }
 
   return 0;
@@ -21,11 +21,17 @@
  * There are some problems still and the API is a subject to change.
  */
 
+#define _GNU_SOURCE
+
 #include <config.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/wait.h>
 #include <lua.h>
 #include <lauxlib.h>
 #include <libcrun/container.h>
@@ -36,6 +42,7 @@
 static const char *LUA_CRUN_TAG_CTX = "crun-ctx";
 static const char *LUA_CRUN_TAG_CONT = "crun-container";
 static const char *LUA_CRUN_TAG_CONTS_ITER = "crun-containers-iterator";
+static const char *LUA_CRUN_TAG_ASYNC = "crun-async-op";
 
 #define luacrunL_optboolean(L, n, d) luaL_opt (S, lua_toboolean, n, d)
 
@@ -424,6 +431,244 @@ luacrun_ctx_delete_container (lua_State *S)
   return 1;
 }
 
+/* Asynchronous variants of the long-running operations.
+ *
+ * The blocking calls stall the whole Lua VM, so event loop based hosts
+ * (OpenResty and friends) cannot overlap container operations with other
+ * work.  The `_async` variants fork a worker that performs the operation and
+ * reports the outcome over a pipe; they return immediately with an operation
+ * handle.  `op:fd()` exposes the read side of the pipe, which becomes
+ * readable when the operation finished, so a coroutine can yield on it in
+ * any event loop.  `op:result()` then collects the outcome and returns the
+ * same values as the blocking call would.
+ */
+
+enum
+{
+  LUACRUN_ASYNC_RUN = 0,
+  LUACRUN_ASYNC_DELETE,
+};
+
+struct luacrun_async_op
+{
+  int fd;    /* read side of the completion pipe, pollable */
+  pid_t pid; /* worker performing the operation */
+  int kind;
+  bool done;
+};
+
+/* Serialize the outcome of an operation into BUF: the return value on the
+ * first line, the formatted error message (if any) after it. */
+static int
+luacrun_async_format_result (char *buf, size_t size, int ret, libcrun_error_t *err)
+{
+  if (ret >= 0 || *err == NULL)
+    return snprintf (buf, size, "%d\n", ret);
+  if ((*err)->status == 0)
+    return snprintf (buf, size, "%d\ncrun: %s", ret, (*err)->msg);
+  return snprintf (buf, size, "%d\ncrun: %s(%s)", ret, (*err)->msg, strerror ((*err)->status));
+}
+
+/* Push a new async op handle wrapping PID and FD onto the stack. */
+static void
+luacrun_async_push (lua_State *S, pid_t pid, int fd, int kind)
+{
+  struct luacrun_async_op *op = lua_newuserdata (S, sizeof (struct luacrun_async_op));
+  op->fd = fd;
+  op->pid = pid;
+  op->kind = kind;
+  op->done = false;
+  luaL_setmetatable (S, LUA_CRUN_TAG_ASYNC);
+}
+
+LUA_API int
+luacrun_ctx_run_async (lua_State *S)
+{
+  libcrun_context_t *ctx = luaL_checkudata (S, 1, LUA_CRUN_TAG_CTX);
+  libcrun_container_t **cont = luaL_checkudata (S, 2, LUA_CRUN_TAG_CONT);
+  unsigned int flags = luaL_opt (S, luacrun_build_run_flags, 3, 0);
+  int fds[2];
+  pid_t pid;
+
+  luaL_checkstack (S, 1, NULL);
+  if (pipe2 (fds, O_CLOEXEC) < 0)
+    return luaL_error (S, "pipe2: %s", strerror (errno));
+
+  pid = fork ();
+  if (pid < 0)
+    {
+      int saved_errno = errno;
+      close (fds[0]);
+      close (fds[1]);
+      return luaL_error (S, "fork: %s", strerror (saved_errno));
+    }
+  if (pid == 0)
+    {
+      libcrun_error_t crun_err = NULL;
+      char buf[8192];
+      int ret, len;
+
+      close (fds[0]);
+      ret = libcrun_container_run (ctx, *cont, flags, &crun_err);
+      len = luacrun_async_format_result (buf, sizeof (buf), ret, &crun_err);
+      TEMP_FAILURE_RETRY (write (fds[1], buf, len));
+      _exit (ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+  close (fds[1]);
+  luacrun_async_push (S, pid, fds[0], LUACRUN_ASYNC_RUN);
+  return 1;
+}
+
+LUA_API int
+luacrun_ctx_delete_container_async (lua_State *S)
+{
+  libcrun_context_t *ctx = luaL_checkudata (S, 1, LUA_CRUN_TAG_CTX);
+  const char *id = luaL_checkstring (S, 2);
+  bool force = luaL_opt (S, lua_toboolean, 3, false);
+  int fds[2];
+  pid_t pid;
+
+  luaL_checkstack (S, 1, NULL);
+  if (pipe2 (fds, O_CLOEXEC) < 0)
+    return luaL_error (S, "pipe2: %s", strerror (errno));
+
+  pid = fork ();
+  if (pid < 0)
+    {
+      int saved_errno = errno;
+      close (fds[0]);
+      close (fds[1]);
+      return luaL_error (S, "fork: %s", strerror (saved_errno));
+    }
+  if (pid == 0)
+    {
+      libcrun_error_t crun_err = NULL;
+      char buf[8192];
+      int ret, len;
+
+      close (fds[0]);
+      ret = libcrun_container_delete (ctx, NULL, id, force, &crun_err);
+      len = luacrun_async_format_result (buf, sizeof (buf), ret, &crun_err);
+      TEMP_FAILURE_RETRY (write (fds[1], buf, len));
+      _exit (ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+  close (fds[1]);
+  luacrun_async_push (S, pid, fds[0], LUACRUN_ASYNC_DELETE);
+  return 1;
+}
+
+/* Return the pollable descriptor of the operation. */
+LUA_API int
+luacrun_async_fd (lua_State *S)
+{
+  struct luacrun_async_op *op = luaL_checkudata (S, 1, LUA_CRUN_TAG_ASYNC);
+  luaL_checkstack (S, 1, NULL);
+  if (op->done)
+    return luaL_error (S, "the async operation is already collected");
+  lua_pushinteger (S, op->fd);
+  return 1;
+}
+
+/* Collect the outcome of the operation.  Expected to be called once the fd
+ * polled readable; it reaps the worker and returns the same values the
+ * blocking variant would. */
+LUA_API int
+luacrun_async_result (lua_State *S)
+{
+  struct luacrun_async_op *op = luaL_checkudata (S, 1, LUA_CRUN_TAG_ASYNC);
+  char buf[8192];
+  ssize_t n, total = 0;
+  char *msg;
+  int ret;
+
+  luaL_checkstack (S, 2, NULL);
+  if (op->done)
+    return luaL_error (S, "the async operation is already collected");
+
+  while (total < (ssize_t) sizeof (buf) - 1)
+    {
+      n = TEMP_FAILURE_RETRY (read (op->fd, buf + total, sizeof (buf) - 1 - total));
+      if (n < 0)
+        return luaL_error (S, "read: %s", strerror (errno));
+      if (n == 0)
+        break;
+      total += n;
+    }
+  buf[total] = '\0';
+
+  close (op->fd);
+  op->fd = -1;
+  TEMP_FAILURE_RETRY (waitpid (op->pid, NULL, 0));
+  op->done = true;
+
+  msg = strchr (buf, '\n');
+  if (msg != NULL)
+    *msg++ = '\0';
+  ret = (int) strtol (buf, NULL, 10);
+
+  if (op->kind == LUACRUN_ASYNC_DELETE)
+    {
+      lua_pushboolean (S, ret >= 0);
+      if (ret < 0 && msg != NULL && *msg != '\0')
+        {
+          lua_pushstring (S, msg);
+          return 2;
+        }
+      return 1;
+    }
+
+  if (ret < 0)
+    {
+      lua_pushnil (S);
+      lua_pushstring (S, msg != NULL && *msg != '\0' ? msg : "the async operation failed");
+      return 2;
+    }
+  lua_pushinteger (S, ret);
+  return 1;
+}
+
+static int
+luacrun_async_finalizer (lua_State *S)
+{
+  struct luacrun_async_op *op = luaL_checkudata (S, 1, LUA_CRUN_TAG_ASYNC);
+  if (op->fd >= 0)
+    {
+      close (op->fd);
+      op->fd = -1;
+    }
+  /* Never block the GC on a still-running worker; an unreaped worker is
+   * collected by the host once it handles SIGCHLD. */
+  if (! op->done)
+    {
+      waitpid (op->pid, NULL, WNOHANG);
+      op->done = true;
+    }
+  return 0;
+}
+
+static const luaL_Reg luacrun_async_index[] = {
+  { "fd", &luacrun_async_fd },
+  { "result", &luacrun_async_result },
+  { NULL, NULL },
+};
+
+static int
+luacrun_setup_async_metatable (lua_State *S)
+{
+  luaL_checkstack (S, 3, NULL);
+  luaL_newmetatable (S, LUA_CRUN_TAG_ASYNC);
+  int mtab_idx = lua_gettop (S);
+  lua_newtable (S);
+  luaL_setfuncs (S, luacrun_async_index, 0);
+  lua_setfield (S, mtab_idx, "__index");
+  lua_pushcfunction (S, &luacrun_async_finalizer);
+  lua_setfield (S, mtab_idx, "__gc");
+  lua_pop (S, 1);
+  return 0;
+}
+
 LUA_API int
 luacrun_ctx_kill_container (lua_State *S)
 {
@@ -761,8 +1006,10 @@ luacrun_CtxBoolAccessor (systemd_cgroup);
 static const luaL_Reg luacrun_ctx_index[]
     = {
         { "run", &luacrun_ctx_run },
+        { "run_async", &luacrun_ctx_run_async },
         { "create", &luacrun_ctx_create_container },
         { "delete", &luacrun_ctx_delete_container },
+        { "delete_async", &luacrun_ctx_delete_container_async },
         { "kill", &luacrun_ctx_kill_container },
         { "start", &luacrun_ctx_start_container },
         { "status", &luacrun_ctx_status_container },
@@ -815,8 +1062,10 @@ static const luaL_Reg luacrun_library_reg[] = {
   { .name = "get_verbosity", .func = &luacrun_get_verbosity },
   { .name = "set_verbosity", .func = &luacrun_set_verbosity },
   { .name = "run", .func = &luacrun_ctx_run },
+  { .name = "run_async", .func = &luacrun_ctx_run_async },
   { .name = "create_container", .func = &luacrun_ctx_create_container },
   { .name = "delete_container", .func = &luacrun_ctx_delete_container },
+  { .name = "delete_container_async", .func = &luacrun_ctx_delete_container_async },
   { .name = "kill_container", .func = &luacrun_ctx_kill_container },
   { .name = "start_container", .func = &luacrun_ctx_start_container },
   { .name = "status_container", .func = &luacrun_ctx_status_container },
@@ -840,5 +1089,6 @@ luaopen_luacrun (lua_State *S)
   luacrun_setup_ctx_metatable (S);
   luacrun_setup_cont_metatable (S);
   luacrun_setup_ctx_iter_metatable (S);
+  luacrun_setup_async_metatable (S);
   return 1;
 }
@@ -103,6 +103,21 @@ insulate("luacrun", function()
         end)
     end)
 
+    describe("delete_container_async", function()
+        it("returns a pollable handle and reports the outcome", function()
+            local temproot = stdlib.mkdtemp("/tmp/luacrun-test-XXXXXX")
+            local ctx = luacrun.new_ctx {state_root = temproot}
+            local op = luacrun.delete_container_async(ctx, "no-such-container")
+            assert.are.equals("userdata", type(op))
+            assert.are.equals("number", type(op:fd()))
+            -- the fd becomes readable when the worker is done; result()
+            -- blocks until then, which is fine for the test
+            local stat, err = op:result()
+            assert.are.equals(false, stat)
+            assert.are.equals("string", type(err))
+        end)
+    end)
+
     it("can create container and delete container", function()
         local temproot = mktestenv()
         local ctx = luacrun.new_ctx {state_root = temproot, id = "luacrun-test"}
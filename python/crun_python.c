@@ -65,7 +65,7 @@ static void
 free_container (PyObject *ptr)
 {
   libcrun_container_t *ctr = PyCapsule_GetPointer (ptr, CONTAINER_OBJ_TAG);
-  free_runtime_spec_schema_config_schema (ctr->container_def);
+  libcrun_container_free (ctr);
 }
 
 static PyObject *
@@ -142,16 +142,19 @@ make_context (PyObject *self arg_unused, PyObject *args, PyObject *kwargs)
 }
 
 static PyObject *
-container_run (PyObject *self arg_unused, PyObject *args)
+container_run (PyObject *self arg_unused, PyObject *args, PyObject *kwargs)
 {
+  static char *kwlist[] = { "context", "container", "id", NULL };
   libcrun_error_t err;
   PyObject *ctx_obj = NULL;
   PyObject *ctr_obj = NULL;
   libcrun_container_t *ctr;
   libcrun_context_t *ctx;
+  libcrun_context_t run_ctx;
+  char *id = NULL;
   int ret;
 
-  if (!PyArg_ParseTuple (args, "OO", &ctx_obj, &ctr_obj))
+  if (!PyArg_ParseTupleAndKeywords (args, kwargs, "OO|s", kwlist, &ctx_obj, &ctr_obj, &id))
     return NULL;
 
   ctx = PyCapsule_GetPointer (ctx_obj, CONTEXT_OBJ_TAG);
@@ -162,8 +165,15 @@ container_run (PyObject *self arg_unused, PyObject *args)
   if (ctr == NULL)
     return NULL;
 
+  /* With an id override, work on a private copy of the context so that the
+     same context and the same parsed container can drive concurrent runs
+     from different threads.  */
+  run_ctx = *ctx;
+  if (id)
+    run_ctx.id = id;
+
   Py_BEGIN_ALLOW_THREADS;
-  ret = libcrun_container_run (ctx, ctr, 0, &err);
+  ret = libcrun_container_run (&run_ctx, ctr, 0, &err);
   Py_END_ALLOW_THREADS;
   if (ret < 0)
     return set_error (&err);
@@ -172,16 +182,19 @@ container_run (PyObject *self arg_unused, PyObject *args)
 }
 
 static PyObject *
-container_create (PyObject *self arg_unused, PyObject *args)
+container_create (PyObject *self arg_unused, PyObject *args, PyObject *kwargs)
 {
+  static char *kwlist[] = { "context", "container", "id", NULL };
   libcrun_error_t err;
   PyObject *ctx_obj = NULL;
   PyObject *ctr_obj = NULL;
   libcrun_container_t *ctr;
   libcrun_context_t *ctx;
+  libcrun_context_t create_ctx;
+  char *id = NULL;
   int ret;
 
-  if (!PyArg_ParseTuple (args, "OO", &ctx_obj, &ctr_obj))
+  if (!PyArg_ParseTupleAndKeywords (args, kwargs, "OO|s", kwlist, &ctx_obj, &ctr_obj, &id))
     return NULL;
 
   ctx = PyCapsule_GetPointer (ctx_obj, CONTEXT_OBJ_TAG);
@@ -192,8 +205,12 @@ container_create (PyObject *self arg_unused, PyObject *args)
   if (ctr == NULL)
     return NULL;
 
+  create_ctx = *ctx;
+  if (id)
+    create_ctx.id = id;
+
   Py_BEGIN_ALLOW_THREADS;
-  ret = libcrun_container_create (ctx, ctr, LIBCRUN_RUN_OPTIONS_PREFORK, &err);
+  ret = libcrun_container_create (&create_ctx, ctr, LIBCRUN_RUN_OPTIONS_PREFORK, &err);
   Py_END_ALLOW_THREADS;
   if (ret < 0)
     return set_error (&err);
@@ -481,8 +498,12 @@ static PyMethodDef CrunMethods[] = {
    "Load an OCI container from file."},
   {"load_from_memory", container_load_from_memory, METH_VARARGS,
    "Load an OCI container from memory."},
-  {"run", container_run, METH_VARARGS, "Run a container."},
-  {"create", container_create, METH_VARARGS, "Create a container."},
+  {"run", (PyCFunction) container_run, METH_VARARGS | METH_KEYWORDS,
+   "Run a container.  The parsed container can be reused for multiple runs, "
+   "an optional id overrides the one from the context for this run only."},
+  {"create", (PyCFunction) container_create, METH_VARARGS | METH_KEYWORDS,
+   "Create a container.  The parsed container can be reused, an optional id "
+   "overrides the one from the context for this call only."},
   {"delete", container_delete, METH_VARARGS, "Delete a container."},
   {"kill", container_kill, METH_VARARGS, "Kill a container."},
   {"list", containers_list, METH_VARARGS, "List the containers."},
@@ -47,6 +47,10 @@ enum
   OPTION_PARENT_PATH,
   OPTION_PRE_DUMP,
   OPTION_MANAGE_CGROUPS_MODE,
+  OPTION_LAZY_PAGES,
+  OPTION_PAGE_SERVER_ADDRESS,
+  OPTION_PAGE_SERVER_PORT,
+  OPTION_COMPRESS,
 };
 
 static char doc[] = "OCI runtime";
@@ -66,6 +70,10 @@ static struct argp_option options[]
         { "pre-dump", OPTION_PRE_DUMP, 0, 0, "dump container's memory information only, leave the container running after this", 0 },
 #endif
         { "manage-cgroups-mode", OPTION_MANAGE_CGROUPS_MODE, "MODE", 0, "cgroups mode: 'soft' (default), 'ignore', 'full' and 'strict'", 0 },
+        { "lazy-pages", OPTION_LAZY_PAGES, 0, 0, "leave the memory pages behind, served on demand by a page server", 0 },
+        { "page-server-address", OPTION_PAGE_SERVER_ADDRESS, "ADDRESS", 0, "address the page server listens on", 0 },
+        { "page-server-port", OPTION_PAGE_SERVER_PORT, "PORT", 0, "port the page server listens on", 0 },
+        { "compress", OPTION_COMPRESS, 0, 0, "compress the checkpoint images with zstd while dumping", 0 },
         {
             0,
         } };
@@ -139,6 +147,31 @@ parse_opt (int key, char *arg, struct argp_state *state)
       cr_options.manage_cgroups_mode = crun_parse_manage_cgroups_mode (argp_mandatory_argument (arg, state));
       break;
 
+    case OPTION_LAZY_PAGES:
+      cr_options.lazy_pages = true;
+      break;
+
+    case OPTION_COMPRESS:
+      cr_options.compress = true;
+      break;
+
+    case OPTION_PAGE_SERVER_ADDRESS:
+      cr_options.page_server_address = argp_mandatory_argument (arg, state);
+      break;
+
+    case OPTION_PAGE_SERVER_PORT:
+      {
+        char *endptr = NULL;
+        long port;
+
+        errno = 0;
+        port = strtol (argp_mandatory_argument (arg, state), &endptr, 10);
+        if (errno != 0 || (endptr && *endptr != '\0') || port <= 0 || port > 65535)
+          libcrun_fail_with_error (0, "invalid page server port specified");
+        cr_options.page_server_port = (int) port;
+      }
+      break;
+
     default:
       return ARGP_ERR_UNKNOWN;
     }
@@ -47,8 +47,13 @@
 #include "unpause.h"
 #include "oci_features.h"
 #include "ps.h"
+#include "stats.h"
+#include "events.h"
 #include "checkpoint.h"
 #include "restore.h"
+#include "daemon.h"
+#include "ns_pool.h"
+#include "supervisor.h"
 
 static struct crun_global_arguments arguments;
 
@@ -99,6 +104,7 @@ init_libcrun_context (libcrun_context_t *con, const char *id, struct crun_global
   con->force_no_cgroup = glob->option_force_no_cgroup;
   con->notify_socket = getenv ("NOTIFY_SOCKET");
   con->fifo_exec_wait_fd = -1;
+  con->eventfd_exec_wait_fd = -1;
   con->argc = glob->argc;
   con->argv = glob->argv;
 
@@ -140,20 +146,30 @@ enum
   COMMAND_UNPAUSE,
   COMMAND_FEATURES,
   COMMAND_PS,
+  COMMAND_STATS,
+  COMMAND_EVENTS,
   COMMAND_CHECKPOINT,
   COMMAND_RESTORE,
+  COMMAND_DAEMON,
+  COMMAND_NS_POOL,
+  COMMAND_SUPERVISOR,
 };
 
 struct commands_s commands[] = { { COMMAND_CREATE, "create", crun_command_create },
+                                 { COMMAND_DAEMON, "daemon", crun_command_daemon },
                                  { COMMAND_DELETE, "delete", crun_command_delete },
+                                 { COMMAND_EVENTS, "events", crun_command_events },
                                  { COMMAND_EXEC, "exec", crun_command_exec },
                                  { COMMAND_LIST, "list", crun_command_list },
+                                 { COMMAND_NS_POOL, "ns-pool", crun_command_ns_pool },
                                  { COMMAND_KILL, "kill", crun_command_kill },
                                  { COMMAND_PS, "ps", crun_command_ps },
                                  { COMMAND_RUN, "run", crun_command_run },
                                  { COMMAND_SPEC, "spec", crun_command_spec },
                                  { COMMAND_START, "start", crun_command_start },
                                  { COMMAND_STATE, "state", crun_command_state },
+                                 { COMMAND_STATS, "stats", crun_command_stats },
+                                 { COMMAND_SUPERVISOR, "supervisor", crun_command_supervisor },
                                  { COMMAND_UPDATE, "update", crun_command_update },
                                  { COMMAND_PAUSE, "pause", crun_command_pause },
                                  { COMMAND_UNPAUSE, "resume", crun_command_unpause },
@@ -171,11 +187,14 @@ static char doc[] = "\nCOMMANDS:\n"
                     "\tcheckpoint  - checkpoint a container\n"
 #endif
                     "\tcreate      - create a container\n"
+                    "\tdaemon      - serve container operations over a socket\n"
                     "\tdelete      - remove definition for a container\n"
+                    "\tevents      - stream cgroup notifications for a container\n"
                     "\texec        - exec a command in a running container\n"
                     "\tfeatures    - show the enabled features\n"
                     "\tlist        - list known containers\n"
                     "\tkill        - send a signal to the container init process\n"
+                    "\tns-pool     - refill a pool of pre-warmed namespace sets\n"
                     "\tps          - show the processes in the container\n"
 #if HAVE_CRIU && HAVE_DLOPEN
                     "\trestore     - restore a container\n"
@@ -184,6 +203,8 @@ static char doc[] = "\nCOMMANDS:\n"
                     "\tspec        - generate a configuration file\n"
                     "\tstart       - start a container\n"
                     "\tstate       - output the state of a container\n"
+                    "\tstats       - show resource usage statistics for a container\n"
+                    "\tsupervisor  - supervise many detached containers from one process\n"
                     "\tpause       - pause all the processes in the container\n"
                     "\tresume      - unpause the processes in the container\n"
                     "\tupdate      - update container resource constraints\n";
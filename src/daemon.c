@@ -0,0 +1,336 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "crun.h"
+#include "daemon.h"
+#include "libcrun/container.h"
+#include "libcrun/status.h"
+#include "libcrun/utils.h"
+
+/* Long running server mode: a single crun process listens on a unix socket and
+   serves container operations, so clients do not pay process startup (dynamic
+   linking, argp parsing, context setup) for every operation.
+
+   The protocol is one request per connection.  A request is a sequence of NUL
+   terminated fields, terminated by an empty field:
+
+     OPERATION \0 ID \0 [ARG \0]... \0
+
+   where OPERATION is one of "create", "start", "delete", "kill", "state".
+   "create" takes the bundle directory as ARG, "kill" the signal name and
+   "delete" an optional "force" flag.  Up to three file descriptors can be
+   attached to the first message with SCM_RIGHTS and are installed as the
+   stdio of the operation.  The reply is the operation status formatted as
+
+     STATUS \0 [ERROR MESSAGE \0]
+
+   with STATUS "0" on success.  Every request is served by a forked worker, so
+   the warm parent never execs nor alters its own process state.  */
+
+static char doc[] = "OCI runtime";
+
+#define DAEMON_MAX_REQUEST_LEN 8192
+#define DAEMON_MAX_REQUEST_FDS 3
+#define DAEMON_MAX_REQUEST_FIELDS 8
+
+struct daemon_options_s
+{
+  const char *listen_path;
+};
+
+static struct daemon_options_s daemon_options;
+
+enum
+{
+  OPTION_LISTEN = 1000,
+};
+
+static struct argp_option options[] = { { "listen", OPTION_LISTEN, "SOCKET", 0, "listen on the specified socket", 0 },
+                                        {
+                                            0,
+                                        } };
+
+static char args_doc[] = "daemon --listen SOCKET";
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state arg_unused)
+{
+  switch (key)
+    {
+    case OPTION_LISTEN:
+      daemon_options.listen_path = arg;
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+static void
+reap_workers (int sig arg_unused)
+{
+  int saved_errno = errno;
+
+  while (waitpid (-1, NULL, WNOHANG) > 0)
+    ;
+
+  errno = saved_errno;
+}
+
+static int
+send_reply (int fd, int status, const char *msg)
+{
+  char buf[DAEMON_MAX_REQUEST_LEN];
+  size_t len;
+
+  len = snprintf (buf, sizeof (buf) - 1, "%d%c%s", status, '\0', msg ? msg : "");
+  /* snprintf reports the untruncated length: clamp it so a long error
+     message cannot push the terminator out of the buffer.  */
+  if (len > sizeof (buf) - 1)
+    len = sizeof (buf) - 1;
+  buf[len++] = '\0';
+
+  return TEMP_FAILURE_RETRY (write (fd, buf, len));
+}
+
+/* Read one request from FD.  BUF must be DAEMON_MAX_REQUEST_LEN long, FDS an
+   array of DAEMON_MAX_REQUEST_FDS elements initialized to -1.  On success the
+   fields are split into FIELDS and their number returned.  */
+static int
+read_request (int fd, char *buf, char **fields, int *fds, libcrun_error_t *err)
+{
+  char fd_buffer[CMSG_SPACE (DAEMON_MAX_REQUEST_FDS * sizeof (int))];
+  struct msghdr msg = {};
+  struct cmsghdr *cmsg;
+  struct iovec iov;
+  size_t used = 0;
+  int n_fields = 0;
+  ssize_t ret;
+  size_t i;
+
+  iov.iov_base = buf;
+  iov.iov_len = DAEMON_MAX_REQUEST_LEN - 1;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = fd_buffer;
+  msg.msg_controllen = sizeof (fd_buffer);
+
+  ret = TEMP_FAILURE_RETRY (recvmsg (fd, &msg, 0));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "recvmsg");
+  used = ret;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+          size_t n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+          if (n > DAEMON_MAX_REQUEST_FDS)
+            return crun_make_error (err, 0, "too many fds in the request");
+          memcpy (fds, CMSG_DATA (cmsg), n * sizeof (int));
+        }
+    }
+
+  /* Keep reading until the terminating empty field is seen.  */
+  while (used < 2 || buf[used - 1] != '\0' || buf[used - 2] != '\0')
+    {
+      if (used >= DAEMON_MAX_REQUEST_LEN - 1)
+        return crun_make_error (err, 0, "request too big");
+
+      ret = TEMP_FAILURE_RETRY (read (fd, buf + used, DAEMON_MAX_REQUEST_LEN - 1 - used));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "read request");
+      if (ret == 0)
+        return crun_make_error (err, 0, "truncated request");
+      used += ret;
+    }
+
+  for (i = 0; i < used - 1 && n_fields < DAEMON_MAX_REQUEST_FIELDS; i += strlen (buf + i) + 1)
+    {
+      if (buf[i] == '\0')
+        break;
+      fields[n_fields++] = buf + i;
+    }
+
+  if (n_fields < 2)
+    return crun_make_error (err, 0, "invalid request");
+
+  return n_fields;
+}
+
+static int
+serve_request (struct crun_global_arguments *global_args, char **fields, int n_fields, libcrun_error_t *err)
+{
+  libcrun_context_t crun_context = {
+    0,
+  };
+  const char *operation = fields[0];
+  const char *id = fields[1];
+  int ret;
+
+  ret = init_libcrun_context (&crun_context, id, global_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (strcmp (operation, "create") == 0)
+    {
+      cleanup_container libcrun_container_t *container = NULL;
+      const char *bundle;
+
+      if (n_fields < 3)
+        return crun_make_error (err, 0, "`create` requires the bundle directory");
+      bundle = fields[2];
+
+      if (chdir (bundle) < 0)
+        return crun_make_error (err, errno, "chdir `%s`", bundle);
+
+      container = libcrun_container_load_from_file ("config.json", err);
+      if (container == NULL)
+        return crun_make_error (err, 0, "error loading config.json");
+
+      crun_context.bundle = bundle;
+
+      return libcrun_container_create (&crun_context, container, 0, err);
+    }
+  if (strcmp (operation, "start") == 0)
+    return libcrun_container_start (&crun_context, id, err);
+  if (strcmp (operation, "delete") == 0)
+    {
+      bool force = n_fields > 2 && strcmp (fields[2], "1") == 0;
+      return libcrun_container_delete (&crun_context, NULL, id, force, err);
+    }
+  if (strcmp (operation, "kill") == 0)
+    {
+      if (n_fields < 3)
+        return crun_make_error (err, 0, "`kill` requires a signal");
+      return libcrun_container_kill (&crun_context, id, fields[2], err);
+    }
+  if (strcmp (operation, "state") == 0)
+    return libcrun_container_state (&crun_context, id, stdout, err);
+
+  return crun_make_error (err, 0, "unknown operation `%s`", operation);
+}
+
+static void
+serve_connection (struct crun_global_arguments *global_args, int fd)
+{
+  char buf[DAEMON_MAX_REQUEST_LEN];
+  char *fields[DAEMON_MAX_REQUEST_FIELDS];
+  int fds[DAEMON_MAX_REQUEST_FDS] = { -1, -1, -1 };
+  libcrun_error_t err = NULL;
+  int n_fields;
+  int ret = 0;
+  int i;
+
+  n_fields = read_request (fd, buf, fields, fds, &err);
+  if (UNLIKELY (n_fields < 0))
+    goto out;
+
+  for (i = 0; i < DAEMON_MAX_REQUEST_FDS; i++)
+    if (fds[i] >= 0)
+      {
+        ret = dup2 (fds[i], i);
+        if (UNLIKELY (ret < 0))
+          {
+            crun_make_error (&err, errno, "dup2");
+            goto out;
+          }
+        close (fds[i]);
+        fds[i] = -1;
+      }
+
+  ret = serve_request (global_args, fields, n_fields, &err);
+
+out:
+  if (err)
+    {
+      send_reply (fd, err->status ? err->status : 1, err->msg);
+      crun_error_release (&err);
+      _exit (EXIT_FAILURE);
+    }
+  fflush (stdout);
+  send_reply (fd, ret < 0 ? 1 : 0, NULL);
+  _exit (ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+int
+crun_command_daemon (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
+{
+  cleanup_close int listen_fd = -1;
+  struct sigaction act = {};
+  int first_arg = 0;
+  int ret;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &daemon_options);
+
+  if (daemon_options.listen_path == NULL)
+    libcrun_fail_with_error (0, "please specify a socket with --listen");
+
+  /* Remove a stale socket left by a previous instance.  */
+  unlink (daemon_options.listen_path);
+
+  listen_fd = open_unix_domain_socket (daemon_options.listen_path, 0, err);
+  if (UNLIKELY (listen_fd < 0))
+    return listen_fd;
+
+  act.sa_handler = reap_workers;
+  act.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  ret = sigaction (SIGCHLD, &act, NULL);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "sigaction");
+
+  for (;;)
+    {
+      cleanup_close int conn_fd = -1;
+      pid_t pid;
+
+      conn_fd = TEMP_FAILURE_RETRY (accept4 (listen_fd, NULL, NULL, SOCK_CLOEXEC));
+      if (UNLIKELY (conn_fd < 0))
+        return crun_make_error (err, errno, "accept");
+
+      /* Serve the request from a worker so that the warm parent process state
+         is never touched by the operation.  */
+      pid = fork ();
+      if (UNLIKELY (pid < 0))
+        return crun_make_error (err, errno, "fork");
+      if (pid == 0)
+        {
+          close (listen_fd);
+          listen_fd = -1;
+          serve_connection (global_args, conn_fd);
+          _exit (EXIT_FAILURE);
+        }
+    }
+
+  return 0;
+}
@@ -45,6 +45,7 @@ struct delete_options_s
 {
   int regex;
   bool force;
+  bool all;
 };
 
 static struct delete_options_s delete_options;
@@ -52,11 +53,12 @@ static struct delete_options_s delete_options;
 static struct argp_option options[]
     = { { "force", 'f', 0, 0, "delete the container even if it is still running", 0 },
         { "regex", 'r', 0, 0, "the specified CONTAINER is a regular expression (delete multiple containers)", 0 },
+        { "all", 'a', 0, 0, "delete all the containers", 0 },
         {
             0,
         } };
 
-static char args_doc[] = "delete CONTAINER";
+static char args_doc[] = "delete [CONTAINER...]";
 
 static error_t
 parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
@@ -71,7 +73,13 @@ parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
       delete_options.regex = true;
       break;
 
+    case 'a':
+      delete_options.all = true;
+      break;
+
     case ARGP_KEY_NO_ARGS:
+      if (delete_options.all)
+        break;
       libcrun_fail_with_error (0, "please specify a ID for the container");
 
     default:
@@ -93,37 +101,51 @@ crun_command_delete (struct crun_global_arguments *global_args, int argc, char *
   };
 
   argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &delete_options);
-  crun_assert_n_args (argc - first_arg, 1, 1);
+  crun_assert_n_args (argc - first_arg, delete_options.all ? 0 : 1, delete_options.regex ? 1 : -1);
 
-  ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
+  ret = init_libcrun_context (&crun_context, argc > first_arg ? argv[first_arg] : "delete", global_args, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  if (delete_options.regex)
+  if (delete_options.all || delete_options.regex)
     {
-      regex_t re;
       libcrun_container_list_t *list, *it;
+      const char **ids = NULL;
+      size_t n_ids = 0;
+      regex_t re;
 
-      ret = regcomp (&re, argv[first_arg], REG_EXTENDED | REG_NOSUB);
-      if (UNLIKELY (ret < 0))
-        libcrun_fail_with_error (0, "invalid regular expression %s", argv[first_arg]);
+      if (delete_options.regex)
+        {
+          ret = regcomp (&re, argv[first_arg], REG_EXTENDED | REG_NOSUB);
+          if (UNLIKELY (ret < 0))
+            libcrun_fail_with_error (0, "invalid regular expression %s", argv[first_arg]);
+        }
 
       ret = libcrun_get_containers_list (&list, crun_context.state_root, err);
       if (UNLIKELY (ret < 0))
         libcrun_fail_with_error (0, "cannot read containers list");
 
       for (it = list; it; it = it->next)
-        if (regexec (&re, it->name, 0, NULL, 0) == 0)
+        if (! delete_options.regex || regexec (&re, it->name, 0, NULL, 0) == 0)
           {
-            ret = libcrun_container_delete (&crun_context, NULL, it->name, delete_options.force, err);
-            if (UNLIKELY (ret < 0))
-              libcrun_error_write_warning_and_release (stderr, &err);
+            ids = xrealloc (ids, sizeof (const char *) * (n_ids + 1));
+            ids[n_ids++] = it->name;
           }
 
+      ret = libcrun_container_delete_many (&crun_context, ids, n_ids, delete_options.force, err);
+      if (UNLIKELY (ret < 0))
+        libcrun_error_write_warning_and_release (stderr, &err);
+
+      free (ids);
       libcrun_free_containers_list (list);
-      regfree (&re);
+      if (delete_options.regex)
+        regfree (&re);
       return 0;
     }
 
+  if (argc - first_arg > 1)
+    return libcrun_container_delete_many (&crun_context, (const char *const *) (argv + first_arg),
+                                          (size_t) (argc - first_arg), delete_options.force, err);
+
   return libcrun_container_delete (&crun_context, NULL, argv[first_arg], delete_options.force, err);
 }
@@ -0,0 +1,453 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Stream cgroup v2 notifications for a set of containers as line-delimited
+   JSON.  memory.events and pids.events are watched through inotify, the PSI
+   pressure files through a pressure trigger, and everything is multiplexed
+   on a single epoll descriptor, so one process can follow hundreds of
+   containers without polling.  */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+
+#include "crun.h"
+#include "libcrun/container.h"
+#include "libcrun/status.h"
+#include "libcrun/utils.h"
+#include "libcrun/cgroup.h"
+#include "libcrun/cgroup-utils.h"
+
+#include <yajl/yajl_gen.h>
+
+#define YAJL_STR(x) ((const unsigned char *) (x))
+
+static char doc[] = "OCI runtime";
+
+/* Default PSI trigger: 100ms of "some" stall time in a 1s window.  */
+#define DEFAULT_PSI_TRIGGER "some 100000 1000000"
+
+struct events_options_s
+{
+  const char *psi_trigger;
+};
+
+static struct events_options_s events_options;
+
+static struct argp_option options[]
+    = { { "psi-trigger", 't', "TRIGGER", 0, "PSI trigger to register on the pressure files", 0 },
+        {
+            0,
+        } };
+
+static char args_doc[] = "events CONTAINER [CONTAINER...]";
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state arg_unused)
+{
+  switch (key)
+    {
+    case 't':
+      events_options.psi_trigger = arg;
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+struct event_source_s
+{
+  struct event_source_s *next;
+
+  char *id;
+  const char *file;
+  char *path;
+
+  /* inotify watch descriptor, or -1.  */
+  int wd;
+  /* PSI trigger file descriptor, or -1.  */
+  int fd;
+};
+
+static struct event_source_s *
+add_event_source (struct event_source_s **sources, const char *id, const char *file, char *path)
+{
+  struct event_source_s *source = xmalloc0 (sizeof (struct event_source_s));
+
+  source->id = xstrdup (id);
+  source->file = file;
+  source->path = path;
+  source->wd = -1;
+  source->fd = -1;
+
+  source->next = *sources;
+  *sources = source;
+  return source;
+}
+
+static int
+gen_check (int ret, libcrun_error_t *err)
+{
+  if (UNLIKELY (ret != yajl_gen_status_ok))
+    return crun_make_error (err, 0, "error generating JSON (status=%d)", ret);
+  return 0;
+}
+
+/* Emit the content of an events file (`KEY VALUE` lines) or of a PSI file
+   (`some|full avg10=F avg60=F avg300=F total=I` lines) as a JSON object.  */
+static int
+generate_data (yajl_gen gen, const char *content, libcrun_error_t *err)
+{
+  cleanup_free char *copy = xstrdup (content);
+  char *line, *end = copy;
+  int ret;
+
+  ret = gen_check (yajl_gen_map_open (gen), err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  while ((line = strsep (&end, "\n")))
+    {
+      char *sep;
+
+      if (line[0] == '\0')
+        continue;
+
+      sep = strchr (line, ' ');
+      if (sep == NULL)
+        continue;
+      *sep++ = '\0';
+
+      ret = gen_check (yajl_gen_string (gen, (const unsigned char *) line, strlen (line)), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      if (strchr (sep, '=') == NULL)
+        {
+          /* A single counter, as in memory.events.  */
+          ret = gen_check (yajl_gen_integer (gen, strtoll (sep, NULL, 10)), err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+          continue;
+        }
+
+      /* PSI `KEY=VALUE` tokens.  */
+      ret = gen_check (yajl_gen_map_open (gen), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      while (sep && *sep)
+        {
+          char *next = strchr (sep, ' ');
+          char *value;
+
+          if (next)
+            *next++ = '\0';
+
+          value = strchr (sep, '=');
+          if (value == NULL)
+            break;
+          *value++ = '\0';
+
+          ret = gen_check (yajl_gen_string (gen, (const unsigned char *) sep, strlen (sep)), err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+
+          if (strchr (value, '.'))
+            ret = gen_check (yajl_gen_double (gen, strtod (value, NULL)), err);
+          else
+            ret = gen_check (yajl_gen_integer (gen, strtoll (value, NULL, 10)), err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+
+          sep = next;
+        }
+
+      ret = gen_check (yajl_gen_map_close (gen), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  return gen_check (yajl_gen_map_close (gen), err);
+}
+
+static int
+emit_event (struct event_source_s *source, libcrun_error_t *err)
+{
+  cleanup_free char *content = NULL;
+  const unsigned char *buf = NULL;
+  yajl_gen gen = NULL;
+  size_t len;
+  int ret;
+
+  if (source->fd >= 0)
+    {
+      char psi_buf[512];
+      ssize_t n;
+
+      n = TEMP_FAILURE_RETRY (pread (source->fd, psi_buf, sizeof (psi_buf) - 1, 0));
+      if (UNLIKELY (n < 0))
+        return crun_make_error (err, errno, "read `%s`", source->path);
+      psi_buf[n] = '\0';
+      content = xstrdup (psi_buf);
+    }
+  else
+    {
+      ret = read_all_file (source->path, &content, NULL, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  gen = yajl_gen_alloc (NULL);
+  if (gen == NULL)
+    return crun_make_error (err, 0, "cannot allocate json generator");
+
+  ret = gen_check (yajl_gen_map_open (gen), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+
+  ret = gen_check (yajl_gen_string (gen, YAJL_STR ("id"), strlen ("id")), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+  ret = gen_check (yajl_gen_string (gen, (const unsigned char *) source->id, strlen (source->id)), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+
+  ret = gen_check (yajl_gen_string (gen, YAJL_STR ("file"), strlen ("file")), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+  ret = gen_check (yajl_gen_string (gen, (const unsigned char *) source->file, strlen (source->file)), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+
+  ret = gen_check (yajl_gen_string (gen, YAJL_STR ("data"), strlen ("data")), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+  ret = generate_data (gen, content, err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+
+  ret = gen_check (yajl_gen_map_close (gen), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+
+  ret = gen_check (yajl_gen_get_buf (gen, &buf, &len), err);
+  if (UNLIKELY (ret < 0))
+    goto exit;
+
+  printf ("%.*s\n", (int) len, buf);
+  fflush (stdout);
+  ret = 0;
+
+exit:
+  yajl_gen_free (gen);
+  return ret;
+}
+
+static int
+watch_container (struct event_source_s **sources, int epollfd, int inotifyfd, const char *state_root, const char *id,
+                 libcrun_error_t *err)
+{
+  static const char *inotify_files[] = { "memory.events", "pids.events", NULL };
+  static const char *psi_files[] = { "memory.pressure", "cpu.pressure", "io.pressure", NULL };
+  cleanup_container_status libcrun_container_status_t status = {};
+  size_t i;
+  int ret;
+
+  ret = libcrun_read_container_status (&status, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (status.cgroup_path == NULL || status.cgroup_path[0] == '\0')
+    return crun_make_error (err, 0, "the container `%s` is not using cgroups", id);
+
+  for (i = 0; inotify_files[i]; i++)
+    {
+      struct event_source_s *source;
+      cleanup_free char *path = NULL;
+
+      ret = append_paths (&path, err, CGROUP_ROOT, status.cgroup_path, inotify_files[i], NULL);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      source = add_event_source (sources, id, inotify_files[i], path);
+      path = NULL;
+
+      source->wd = inotify_add_watch (inotifyfd, source->path, IN_MODIFY);
+      if (UNLIKELY (source->wd < 0))
+        return crun_make_error (err, errno, "inotify watch `%s`", source->path);
+    }
+
+  for (i = 0; psi_files[i]; i++)
+    {
+      struct event_source_s *source;
+      cleanup_free char *path = NULL;
+      struct epoll_event ev = {};
+
+      ret = append_paths (&path, err, CGROUP_ROOT, status.cgroup_path, psi_files[i], NULL);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      source = add_event_source (sources, id, psi_files[i], path);
+      path = NULL;
+
+      source->fd = open (source->path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+      if (UNLIKELY (source->fd < 0))
+        {
+          /* PSI is optional in the kernel.  */
+          if (errno == ENOENT)
+            continue;
+          return crun_make_error (err, errno, "open `%s`", source->path);
+        }
+
+      ret = TEMP_FAILURE_RETRY (write (source->fd, events_options.psi_trigger, strlen (events_options.psi_trigger)));
+      if (UNLIKELY (ret < 0))
+        {
+          /* No trigger support: skip the pressure file instead of polling it.  */
+          fprintf (stderr, "cannot register PSI trigger on `%s`, skipping\n", source->path);
+          close (source->fd);
+          source->fd = -1;
+          continue;
+        }
+
+      ev.events = EPOLLPRI;
+      ev.data.ptr = source;
+      ret = epoll_ctl (epollfd, EPOLL_CTL_ADD, source->fd, &ev);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "epoll_ctl `%s`", source->path);
+    }
+
+  return 0;
+}
+
+static int
+handle_inotify (struct event_source_s *sources, int inotifyfd, libcrun_error_t *err)
+{
+  char buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  const struct inotify_event *event;
+  ssize_t len;
+  char *it;
+  int ret;
+
+  len = TEMP_FAILURE_RETRY (read (inotifyfd, buf, sizeof (buf)));
+  if (UNLIKELY (len < 0))
+    return crun_make_error (err, errno, "read from inotify");
+
+  for (it = buf; it < buf + len; it += sizeof (struct inotify_event) + event->len)
+    {
+      struct event_source_s *source;
+
+      event = (const struct inotify_event *) it;
+
+      for (source = sources; source; source = source->next)
+        if (source->wd == event->wd)
+          {
+            ret = emit_event (source, err);
+            if (UNLIKELY (ret < 0))
+              return ret;
+            break;
+          }
+    }
+
+  return 0;
+}
+
+int
+crun_command_events (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
+{
+  struct event_source_s *sources = NULL;
+  cleanup_close int inotifyfd = -1;
+  cleanup_close int epollfd = -1;
+  struct epoll_event ev = {};
+  libcrun_context_t crun_context = {
+    0,
+  };
+  int first_arg;
+  int mode;
+  int ret;
+  int i;
+
+  events_options.psi_trigger = DEFAULT_PSI_TRIGGER;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &events_options);
+  crun_assert_n_args (argc - first_arg, 1, -1);
+
+  ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (mode < 0))
+    return mode;
+  if (mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, ENOTSUP, "events are supported only on cgroup v2");
+
+  epollfd = epoll_create1 (EPOLL_CLOEXEC);
+  if (UNLIKELY (epollfd < 0))
+    return crun_make_error (err, errno, "epoll_create1");
+
+  inotifyfd = inotify_init1 (IN_CLOEXEC);
+  if (UNLIKELY (inotifyfd < 0))
+    return crun_make_error (err, errno, "inotify_init1");
+
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  ret = epoll_ctl (epollfd, EPOLL_CTL_ADD, inotifyfd, &ev);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "epoll_ctl inotify");
+
+  for (i = first_arg; i < argc; i++)
+    {
+      ret = watch_container (&sources, epollfd, inotifyfd, crun_context.state_root, argv[i], err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  for (;;)
+    {
+      struct epoll_event events[16];
+      int n, j;
+
+      n = TEMP_FAILURE_RETRY (epoll_wait (epollfd, events, 16, -1));
+      if (UNLIKELY (n < 0))
+        return crun_make_error (err, errno, "epoll_wait");
+
+      for (j = 0; j < n; j++)
+        {
+          if (events[j].data.ptr == NULL)
+            ret = handle_inotify (sources, inotifyfd, err);
+          else
+            ret = emit_event (events[j].data.ptr, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+        }
+    }
+
+  return 0;
+}
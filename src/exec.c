@@ -37,7 +37,8 @@ struct exec_options_s
   bool detach;
   bool no_new_privs;
   int preserve_fds;
-  const char *process;
+  const char **process_files;
+  size_t process_files_size;
   const char *console_socket;
   const char *pid_file;
   char *process_label;
@@ -69,7 +70,7 @@ static struct argp_option options[]
     = { { "console-socket", OPTION_CONSOLE_SOCKET, "SOCKET", 0,
           "path to a socket that will receive the ptmx end of the tty", 0 },
         { "tty", 't', "TTY", OPTION_ARG_OPTIONAL, "allocate a pseudo-TTY", 0 },
-        { "process", 'p', "FILE", 0, "path to the process.json", 0 },
+        { "process", 'p', "FILE", 0, "path to the process.json, can be repeated to run every process from a single namespace join", 0 },
         { "cwd", OPTION_CWD, "CWD", 0, "current working directory", 0 },
         { "cgroup", OPTION_CGROUP, "PATH", 0, "sub-cgroup in the container", 0 },
         { "detach", 'd', 0, 0, "detach the command in the background", 0 },
@@ -98,6 +99,17 @@ append_env (const char *arg)
   exec_options.env_size++;
 }
 
+static void
+append_process_file (const char *arg)
+{
+  exec_options.process_files = realloc (exec_options.process_files, (exec_options.process_files_size + 2) * sizeof (*exec_options.process_files));
+  if (exec_options.process_files == NULL)
+    error (EXIT_FAILURE, errno, "cannot allocate memory");
+  exec_options.process_files[exec_options.process_files_size + 1] = NULL;
+  exec_options.process_files[exec_options.process_files_size] = arg;
+  exec_options.process_files_size++;
+}
+
 static void
 append_cap (const char *arg)
 {
@@ -163,7 +175,7 @@ parse_opt (int key, char *arg, struct argp_state *state)
       break;
 
     case 'p':
-      exec_options.process = arg;
+      append_process_file (arg);
       break;
 
     case 't':
@@ -258,7 +270,7 @@ crun_command_exec (struct crun_global_arguments *global_args, int argc, char **a
   crun_context.listen_fds = 0;
 
   argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &exec_options);
-  crun_assert_n_args (argc - first_arg, exec_options.process ? 1 : 2, -1);
+  crun_assert_n_args (argc - first_arg, exec_options.process_files_size > 0 ? 1 : 2, -1);
 
   ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
   if (UNLIKELY (ret < 0))
@@ -275,8 +287,17 @@ crun_command_exec (struct crun_global_arguments *global_args, int argc, char **a
       crun_context.preserve_fds += crun_context.listen_fds;
     }
 
-  if (exec_options.process)
-    exec_opts.path = exec_options.process;
+  if (exec_options.process_files_size > 1)
+    {
+      if (exec_options.detach)
+        libcrun_fail_with_error (0, "--detach is not supported with multiple process files");
+
+      exec_opts.batch_paths = exec_options.process_files;
+      exec_opts.batch_paths_len = exec_options.process_files_size;
+      exec_opts.batch_exit_codes = xmalloc0 (exec_options.process_files_size * sizeof (*exec_opts.batch_exit_codes));
+    }
+  else if (exec_options.process_files_size == 1)
+    exec_opts.path = exec_options.process_files[0];
   else
     {
       process = xmalloc0 (sizeof (*process));
@@ -333,5 +354,25 @@ crun_command_exec (struct crun_global_arguments *global_args, int argc, char **a
 
   exec_opts.cgroup = exec_options.cgroup;
 
-  return libcrun_container_exec_with_options (&crun_context, argv[first_arg], &exec_opts, err);
+  ret = libcrun_container_exec_with_options (&crun_context, argv[first_arg], &exec_opts, err);
+
+  if (exec_opts.batch_paths_len > 0)
+    {
+      cleanup_free int *exit_codes = exec_opts.batch_exit_codes;
+      size_t i;
+
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      /* One line per process, in the order they were specified; the command
+         exits with the first non-zero code.  */
+      for (i = 0; i < exec_opts.batch_paths_len; i++)
+        {
+          printf ("%d\n", exit_codes[i]);
+          if (ret == 0 && exit_codes[i] != 0)
+            ret = exit_codes[i];
+        }
+    }
+
+  return ret;
 }
@@ -0,0 +1,158 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Build-time helper: compile the seccomp profile from each OCI configuration
+   given on the command line and emit src/libcrun/seccomp-embedded.h on
+   stdout.  Programs are keyed by the portable checksum so the generated
+   header is valid on any host.  Run it through the
+   `make generate-embedded-seccomp` target, never as part of the default
+   build, so that cross compilation is not affected.  */
+
+#include <config.h>
+
+#include <libcrun/container.h>
+#include <libcrun/seccomp.h>
+#include <libcrun/utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static int
+emit_profile (const char *path, size_t index, FILE *table, libcrun_error_t *err)
+{
+  cleanup_container libcrun_container_t *container = NULL;
+  struct libcrun_seccomp_gen_ctx_s gen_ctx;
+  seccomp_checksum_t checksum;
+  cleanup_free char *content = NULL;
+  cleanup_close int fd = -1;
+  FILE *tmp;
+  size_t len, i;
+  off_t offset;
+  int ret;
+
+  container = libcrun_container_load_from_file (path, err);
+  if (container == NULL)
+    return -1;
+
+  ret = libcrun_seccomp_compute_portable_checksum (container, 0, checksum, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  if (ret == 0)
+    return crun_make_error (err, 0, "no seccomp profile or no checksum support for `%s`", path);
+
+  tmp = tmpfile ();
+  if (tmp == NULL)
+    return crun_make_error (err, errno, "tmpfile");
+
+  fd = dup (fileno (tmp));
+  fclose (tmp);
+  if (UNLIKELY (fd < 0))
+    return crun_make_error (err, errno, "dup");
+
+  libcrun_seccomp_gen_ctx_init (&gen_ctx, container, true, LIBCRUN_SECCOMP_SKIP_CACHE);
+  gen_ctx.fd = fd;
+
+  ret = libcrun_generate_seccomp (&gen_ctx, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  offset = lseek (fd, 0, SEEK_SET);
+  if (UNLIKELY (offset < 0))
+    return crun_make_error (err, errno, "lseek");
+
+  ret = read_all_fd (fd, path, &content, &len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (len == 0)
+    return crun_make_error (err, 0, "empty seccomp program generated from `%s`", path);
+
+  printf ("/* %s */\n", path);
+  printf ("static const unsigned char embedded_seccomp_bpf_%zu[] = {", index);
+  for (i = 0; i < len; i++)
+    printf ("%s0x%02x,", (i % 12) == 0 ? "\n  " : " ", (unsigned char) content[i]);
+  printf ("\n};\n\n");
+
+  fprintf (table, "  { \"%s\", embedded_seccomp_bpf_%zu, sizeof (embedded_seccomp_bpf_%zu) },\n",
+           checksum, index, index);
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  libcrun_error_t err = NULL;
+  cleanup_free char *table = NULL;
+  size_t table_len = 0;
+  FILE *table_stream;
+  int i, ret;
+
+  if (argc < 2)
+    {
+      fprintf (stderr, "usage: %s CONFIG.JSON...\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  printf ("/* Autogenerated by `make generate-embedded-seccomp`, do not edit by hand.\n"
+          " *\n"
+          " * Seccomp programs precompiled at build time, keyed by the portable profile\n"
+          " * checksum (the profile content and generation options only, no host\n"
+          " * specific inputs).  The table ends with a NULL sentinel; it is empty\n"
+          " * unless a profile was embedded with:\n"
+          " *\n"
+          " *   make generate-embedded-seccomp SECCOMP_PROFILES=/path/to/config.json\n"
+          " */\n"
+          "#ifndef SECCOMP_EMBEDDED_H\n"
+          "#define SECCOMP_EMBEDDED_H\n"
+          "\n"
+          "#include <stddef.h>\n"
+          "\n"
+          "struct embedded_seccomp_profile_s\n"
+          "{\n"
+          "  const char *checksum;\n"
+          "  const unsigned char *bpf;\n"
+          "  size_t len;\n"
+          "};\n"
+          "\n");
+
+  /* The byte arrays must all be emitted before the table that references
+     them, so collect the table rows on a memory stream.  */
+  table_stream = open_memstream (&table, &table_len);
+  if (table_stream == NULL)
+    libcrun_fail_with_error (errno, "open_memstream");
+
+  for (i = 1; i < argc; i++)
+    {
+      ret = emit_profile (argv[i], (size_t) (i - 1), table_stream, &err);
+      if (UNLIKELY (ret < 0))
+        libcrun_fail_with_error (err->status, "%s", err->msg);
+    }
+
+  fclose (table_stream);
+
+  printf ("static const struct embedded_seccomp_profile_s embedded_seccomp_profiles[] = {\n");
+  fwrite (table, 1, table_len, stdout);
+  printf ("  { NULL, NULL, 0 },\n"
+          "};\n"
+          "\n"
+          "#endif\n");
+
+  return EXIT_SUCCESS;
+}
@@ -39,28 +39,31 @@ enum
   OPTION_PID_FILE,
   OPTION_NO_SUBREAPER,
   OPTION_NO_NEW_KEYRING,
-  OPTION_PRESERVE_FDS
+  OPTION_PRESERVE_FDS,
+  OPTION_TIMEOUT
 };
 
 struct kill_options_s
 {
   bool all;
   bool regex;
+  int timeout_ms;
 };
 
-static struct kill_options_s kill_options;
+static struct kill_options_s kill_options = { .timeout_ms = -1 };
 
 static struct argp_option options[]
     = { { "all", 'a', 0, 0, "kill all the processes", 0 },
         { "regex", 'r', 0, 0, "the specified CONTAINER is a regular expression (kill multiple containers)", 0 },
+        { "timeout", OPTION_TIMEOUT, "MILLISECONDS", 0, "wait for the container to exit and escalate to SIGKILL after the timeout", 0 },
         {
             0,
         } };
 
-static char args_doc[] = "kill CONTAINER [SIGNAL]";
+static char args_doc[] = "kill CONTAINER... [SIGNAL]";
 
 static error_t
-parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
+parse_opt (int key, char *arg, struct argp_state *state arg_unused)
 {
   switch (key)
     {
@@ -72,6 +75,17 @@ parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
       kill_options.regex = true;
       break;
 
+    case OPTION_TIMEOUT:
+      {
+        char *endptr = NULL;
+
+        errno = 0;
+        kill_options.timeout_ms = strtol (arg, &endptr, 10);
+        if (errno != 0 || endptr == arg || *endptr != '\0' || kill_options.timeout_ms < 0)
+          libcrun_fail_with_error (0, "invalid timeout `%s`", arg);
+      }
+      break;
+
     case ARGP_KEY_NO_ARGS:
       libcrun_fail_with_error (0, "please specify a ID for the container");
 
@@ -84,10 +98,30 @@ parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
 
 static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
 
+static int
+do_kill (libcrun_context_t *context, const char *id, const char *signal, libcrun_error_t *err)
+{
+  int ret;
+
+  if (kill_options.timeout_ms >= 0)
+    {
+      /* A positive return only reports that the escalation was needed.  */
+      ret = libcrun_container_kill_with_timeout (context, id, signal, kill_options.timeout_ms, err);
+      return ret < 0 ? ret : 0;
+    }
+
+  if (kill_options.all)
+    return libcrun_container_killall (context, id, signal, err);
+
+  return libcrun_container_kill (context, id, signal, err);
+}
+
 int
 crun_command_kill (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
 {
   int first_arg = 0, ret;
+  int n_ids, i;
+  size_t failures = 0;
   const char *signal;
 
   libcrun_context_t crun_context = {
@@ -95,15 +129,34 @@ crun_command_kill (struct crun_global_arguments *global_args, int argc, char **a
   };
 
   argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &kill_options);
-  crun_assert_n_args (argc - first_arg, 1, 2);
+  crun_assert_n_args (argc - first_arg, 1, -1);
+
+  /* --all signals every process directly while the escalation kills the
+     whole cgroup anyway, combining them is not meaningful.  */
+  if (kill_options.all && kill_options.timeout_ms >= 0)
+    libcrun_fail_with_error (0, "--timeout cannot be used with --all");
 
   ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
+  /* More than one container can be given, so that an eviction path can kill
+     hundreds of containers with a single invocation instead of one process
+     spawn per container.  With exactly two arguments the second one is the
+     signal as it always was; with more, the last argument is taken as the
+     signal only when it parses as one, otherwise it is another container.  */
+  n_ids = argc - first_arg;
   signal = "SIGTERM";
-  if (argc - first_arg > 1)
-    signal = argv[first_arg + 1];
+  if (n_ids == 2)
+    {
+      signal = argv[first_arg + 1];
+      n_ids = 1;
+    }
+  else if (n_ids > 2 && str2sig (argv[first_arg + n_ids - 1]) >= 0)
+    {
+      signal = argv[first_arg + n_ids - 1];
+      n_ids--;
+    }
 
   if (kill_options.regex)
     {
@@ -121,7 +174,7 @@ crun_command_kill (struct crun_global_arguments *global_args, int argc, char **a
       for (it = list; it; it = it->next)
         if (regexec (&re, it->name, 0, NULL, 0) == 0)
           {
-            ret = libcrun_container_kill (&crun_context, it->name, signal, err);
+            ret = do_kill (&crun_context, it->name, signal, err);
             if (UNLIKELY (ret < 0))
               libcrun_error_write_warning_and_release (stderr, &err);
           }
@@ -131,8 +184,23 @@ crun_command_kill (struct crun_global_arguments *global_args, int argc, char **a
       return 0;
     }
 
-  if (kill_options.all)
-    return libcrun_container_killall (&crun_context, argv[first_arg], signal, err);
+  if (n_ids == 1)
+    return do_kill (&crun_context, argv[first_arg], signal, err);
+
+  for (i = 0; i < n_ids; i++)
+    {
+      const char *id = argv[first_arg + i];
 
-  return libcrun_container_kill (&crun_context, argv[first_arg], signal, err);
+      ret = do_kill (&crun_context, id, signal, err);
+      if (UNLIKELY (ret < 0))
+        {
+          libcrun_error_write_warning_and_release (stderr, &err);
+          failures++;
+        }
+    }
+
+  if (failures)
+    return crun_make_error (err, 0, "could not kill %zu container%s", failures, failures > 1 ? "s" : "");
+
+  return 0;
 }
@@ -0,0 +1,249 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "bundle-cache.h"
+#include "utils.h"
+#include "status.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if HAVE_GCRYPT
+#  include <gcrypt.h>
+#endif
+
+#if HAVE_STDATOMIC_H
+#  include <stdatomic.h>
+#  ifndef HAVE_ATOMIC_BOOL
+#    define atomic_bool volatile int
+#  endif
+#endif
+
+#define BUNDLE_CACHE_DIR ".cache/bundle"
+
+/* Same heuristic as the seccomp cache: bound the directory inode size instead
+   of iterating the cache on every insertion.  */
+#define MIN_BUNDLE_CACHE_DIR_INODE_SIZE (20 + 32 * 20)
+
+typedef char bundle_checksum_t[65];
+
+#if HAVE_GCRYPT
+static int
+calculate_bundle_checksum (const char *content, size_t len, bundle_checksum_t out, libcrun_error_t *err)
+{
+  static atomic_bool initialized = false;
+  gcry_error_t gcrypt_err;
+  unsigned char *res;
+  gcry_md_hd_t hd;
+  size_t i;
+
+  if (! initialized && ! gcry_control (GCRYCTL_INITIALIZATION_FINISHED_P))
+    {
+      const char *needed_version = "1.0.0";
+      if (! gcry_check_version (needed_version))
+        {
+          return libcrun_make_error (err, 0, "libgcrypt is too old (need `%s`, have `%s`)",
+                                     needed_version, gcry_check_version (NULL));
+        }
+      gcry_control (GCRYCTL_DISABLE_SECMEM, 0);
+      gcry_control (GCRYCTL_INITIALIZATION_FINISHED, 0);
+      initialized = true;
+    }
+
+  gcrypt_err = gcry_md_open (&hd, GCRY_MD_SHA256, 0);
+  if (gcrypt_err)
+    return crun_make_error (err, EINVAL, "internal libgcrypt error: %s", gcry_strerror (gcrypt_err));
+
+  gcry_md_write (hd, content, len);
+
+  res = gcry_md_read (hd, GCRY_MD_SHA256);
+  for (i = 0; i < 32; i++)
+    sprintf (&out[i * 2], "%02x", res[i]);
+  out[64] = '\0';
+
+  gcry_md_close (hd);
+
+  return 1;
+}
+#endif
+
+struct bundle_cache_entry
+{
+  bundle_checksum_t checksum;
+  struct timespec atime;
+};
+
+static int
+compare_bundle_entries_by_atime (const void *a, const void *b)
+{
+  const struct bundle_cache_entry *entry_a = a;
+  const struct bundle_cache_entry *entry_b = b;
+
+  if (entry_a->atime.tv_sec != entry_b->atime.tv_sec)
+    return entry_a->atime.tv_sec - entry_b->atime.tv_sec;
+  return entry_a->atime.tv_nsec - entry_b->atime.tv_nsec;
+}
+
+static int
+evict_bundle_cache (int root_dfd, libcrun_error_t *err)
+{
+  cleanup_close int cache_dir_fd = -1;
+  off_t cache_dir_inode_max_size;
+  struct stat st;
+  int ret;
+
+  ret = TEMP_FAILURE_RETRY (fstat (root_dfd, &st));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "fstat rundir");
+
+  cache_dir_inode_max_size = st.st_size * 3 + MIN_BUNDLE_CACHE_DIR_INODE_SIZE;
+
+  cache_dir_fd = TEMP_FAILURE_RETRY (openat (root_dfd, BUNDLE_CACHE_DIR, O_DIRECTORY | O_CLOEXEC));
+  if (UNLIKELY (cache_dir_fd < 0))
+    {
+      if (errno == ENOENT)
+        return 0;
+      return crun_make_error (err, errno, "open `%s`", BUNDLE_CACHE_DIR);
+    }
+
+  ret = TEMP_FAILURE_RETRY (fstat (cache_dir_fd, &st));
+  if (ret == 0 && st.st_size > cache_dir_inode_max_size)
+    {
+      cleanup_free struct bundle_cache_entry *entries = NULL;
+      size_t i, n_entries = 0;
+      struct dirent *de;
+      cleanup_dir DIR *d = NULL;
+      int dfd;
+
+      d = fdopendir (cache_dir_fd);
+      if (UNLIKELY (d == NULL))
+        return crun_make_error (err, errno, "cannot open bundle cache directory");
+      /* the fd is owned by the DIR * now.  */
+      cache_dir_fd = -1;
+      dfd = dirfd (d);
+
+      for (de = readdir (d); de; de = readdir (d))
+        {
+          if (strlen (de->d_name) != sizeof (bundle_checksum_t) - 1)
+            continue;
+
+          ret = fstatat (dfd, de->d_name, &st, AT_SYMLINK_NOFOLLOW);
+          if (UNLIKELY (ret < 0))
+            continue;
+
+          /* The cache file is still linked from a container state directory,
+             it is pointless to free it.  */
+          if (st.st_nlink > 1)
+            continue;
+
+          entries = xrealloc (entries, sizeof (struct bundle_cache_entry) * (n_entries + 1));
+          memcpy (entries[n_entries].checksum, de->d_name, sizeof (bundle_checksum_t));
+          entries[n_entries].atime = st.st_atim;
+          n_entries++;
+        }
+
+      if (n_entries == 0)
+        return 0;
+
+      qsort (entries, n_entries, sizeof (struct bundle_cache_entry), compare_bundle_entries_by_atime);
+
+      /* Drop the oldest half.  */
+      for (i = 0; i < (n_entries == 1 ? 1 : n_entries / 2); i++)
+        unlinkat (dfd, entries[i].checksum, 0);
+    }
+  return 0;
+}
+
+int
+libcrun_bundle_cache_store_config (const char *state_root, const char *dest_path, const char *content,
+                                   size_t len, libcrun_error_t *err)
+{
+#if HAVE_GCRYPT
+  cleanup_free char *cache_file_path = NULL;
+  cleanup_free char *tmp_path = NULL;
+  cleanup_free char *rundir = NULL;
+  cleanup_close int dirfd = -1;
+  bundle_checksum_t checksum;
+  int ret;
+
+  ret = calculate_bundle_checksum (content, len, checksum, err);
+  if (UNLIKELY (ret <= 0))
+    return ret < 0 ? ret : 1;
+
+  rundir = libcrun_get_state_directory (state_root, NULL);
+  if (UNLIKELY (rundir == NULL))
+    return crun_make_error (err, 0, "cannot get state directory");
+
+  dirfd = TEMP_FAILURE_RETRY (open (rundir, O_PATH | O_DIRECTORY | O_CLOEXEC));
+  if (UNLIKELY (dirfd < 0))
+    return crun_make_error (err, errno, "open `%s`", rundir);
+
+  ret = crun_ensure_directory_at (dirfd, BUNDLE_CACHE_DIR, 0700, true, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = append_paths (&cache_file_path, err, BUNDLE_CACHE_DIR, checksum, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = TEMP_FAILURE_RETRY (linkat (dirfd, cache_file_path, AT_FDCWD, dest_path, 0));
+  if (ret == 0)
+    return 0;
+  if (UNLIKELY (errno != ENOENT))
+    /* e.g. the state root lives on a different file system.  Not an error,
+       the caller falls back to a plain copy.  */
+    return 1;
+
+  /* Miss: insert the configuration with an atomic rename so that concurrent
+     readers never observe a partially written entry.  */
+  xasprintf (&tmp_path, "%s/.tmp-%d", BUNDLE_CACHE_DIR, getpid ());
+
+  ret = write_file_at_with_flags (dirfd, O_CREAT | O_TRUNC, 0600, tmp_path, content, len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = evict_bundle_cache (dirfd, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = renameat (dirfd, tmp_path, dirfd, cache_file_path);
+  if (UNLIKELY (ret < 0))
+    {
+      unlinkat (dirfd, tmp_path, 0);
+      return crun_make_error (err, errno, "rename `%s` to `%s`", tmp_path, cache_file_path);
+    }
+
+  ret = TEMP_FAILURE_RETRY (linkat (dirfd, cache_file_path, AT_FDCWD, dest_path, 0));
+  if (UNLIKELY (ret < 0))
+    return 1;
+
+  return 0;
+#else
+  (void) state_root;
+  (void) dest_path;
+  (void) content;
+  (void) len;
+  (void) err;
+  return 1;
+#endif
+}
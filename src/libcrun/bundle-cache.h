@@ -0,0 +1,37 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BUNDLE_CACHE_H
+#define BUNDLE_CACHE_H
+#include <config.h>
+#include "error.h"
+
+/* Store the container configuration CONTENT (LEN bytes) at DEST_PATH going
+   through the bundle cache under the run directory.  Configurations are
+   deduplicated by checksum, so containers sharing the same config get a hard
+   link to a single cached copy instead of a fresh read+write copy, and the
+   shared inode stays hot in the page cache across runs.
+
+   Returns:
+   < 0 in case of errors
+     0 on success, DEST_PATH links to the cached configuration
+   > 0 the cache is not usable, the caller must write DEST_PATH itself.
+ */
+int libcrun_bundle_cache_store_config (const char *state_root, const char *dest_path, const char *content,
+                                       size_t len, libcrun_error_t *err);
+
+#endif
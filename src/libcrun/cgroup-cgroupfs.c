@@ -79,9 +79,18 @@ libcrun_precreate_cgroup_cgroupfs (struct libcrun_cgroup_args *args, int *dirfd,
   if (UNLIKELY (ret < 0))
     return ret;
 
-  *dirfd = open (cgroup_path, O_CLOEXEC | O_NOFOLLOW | O_DIRECTORY | O_RDONLY);
-  if (UNLIKELY (*dirfd < 0))
-    return crun_make_error (err, errno, "open `%s`", cgroup_path);
+  {
+    const char *rel_path = consume_slashes (sub_path);
+    int root_dirfd;
+
+    root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+    if (UNLIKELY (root_dirfd < 0))
+      return root_dirfd;
+
+    *dirfd = openat (root_dirfd, rel_path, O_CLOEXEC | O_NOFOLLOW | O_DIRECTORY | O_RDONLY);
+    if (UNLIKELY (*dirfd < 0))
+      return crun_make_error (err, errno, "open `%s`", cgroup_path);
+  }
 
   return 0;
 }
@@ -115,6 +124,12 @@ libcrun_cgroup_enter_cgroupfs (struct libcrun_cgroup_args *args, struct libcrun_
 
   out->path = make_cgroup_path (args->cgroup_path, args->id);
 
+  /* The child was cloned directly into the cgroup (CLONE_INTO_CGROUP): the
+     precreate step already created the cgroup and enabled the controllers on
+     the path, so there is no migration nor any other work left to do.  */
+  if (args->joined)
+    return 0;
+
   if (cgroup_mode == CGROUP_MODE_UNIFIED)
     {
       int ret;
@@ -147,10 +162,6 @@ libcrun_cgroup_enter_cgroupfs (struct libcrun_cgroup_args *args, struct libcrun_
         }
     }
 
-  /* The cgroup was already joined, nothing more left to do.  */
-  if (args->joined)
-    return 0;
-
   return enter_cgroup (cgroup_mode, pid, 0, out->path, true, err);
 }
 
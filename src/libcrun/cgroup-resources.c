@@ -38,9 +38,87 @@
 #include <fcntl.h>
 #include <libgen.h>
 
+/* Compiled write-plan: the sequence of (file, value) pairs produced from the
+   resources.  While a plan is being recorded, every write is appended to
+   CURRENT_PLAN, and writes whose value already appears in PREVIOUS_PLAN (the
+   plan persisted by the last apply) are skipped, so repeated updates only
+   touch the files that actually changed.  */
+struct write_plan_entry_s
+{
+  char *file;
+  char *value;
+  size_t value_len;
+};
+
+struct write_plan_s
+{
+  struct write_plan_entry_s *entries;
+  size_t len;
+  size_t allocated;
+};
+
+static struct write_plan_s *current_plan;
+static struct write_plan_s *previous_plan;
+
+static void
+write_plan_free (struct write_plan_s *plan)
+{
+  size_t i;
+
+  for (i = 0; i < plan->len; i++)
+    {
+      free (plan->entries[i].file);
+      free (plan->entries[i].value);
+    }
+  free (plan->entries);
+  plan->entries = NULL;
+  plan->len = plan->allocated = 0;
+}
+
+static void
+write_plan_add (struct write_plan_s *plan, const char *file, const void *value, size_t len)
+{
+  struct write_plan_entry_s *entry;
+
+  if (plan->len == plan->allocated)
+    {
+      plan->allocated = plan->allocated ? plan->allocated * 2 : 16;
+      plan->entries = xrealloc (plan->entries, sizeof (*plan->entries) * plan->allocated);
+    }
+
+  entry = &plan->entries[plan->len++];
+  entry->file = xstrdup (file);
+  entry->value = xmalloc (len + 1);
+  memcpy (entry->value, value, len);
+  entry->value[len] = '\0';
+  entry->value_len = len;
+}
+
+static bool
+write_plan_contains (struct write_plan_s *plan, const char *file, const void *value, size_t len)
+{
+  size_t i;
+
+  if (plan == NULL)
+    return false;
+
+  for (i = 0; i < plan->len; i++)
+    if (plan->entries[i].value_len == len && strcmp (plan->entries[i].file, file) == 0
+        && memcmp (plan->entries[i].value, value, len) == 0)
+      return true;
+
+  return false;
+}
+
 static inline int
 write_cgroup_file (int dirfd, const char *name, const void *data, size_t len, libcrun_error_t *err)
 {
+  if (current_plan)
+    {
+      write_plan_add (current_plan, name, data, len);
+      if (write_plan_contains (previous_plan, name, data, len))
+        return 0;
+    }
   return write_file_at_with_flags (dirfd, O_WRONLY | O_CLOEXEC, 0, name, data, len, err);
 }
 
@@ -49,6 +127,13 @@ write_cgroup_file_or_alias (int dirfd, const char *name, const char *alias, cons
 {
   int ret;
 
+  if (current_plan)
+    {
+      write_plan_add (current_plan, name, data, len);
+      if (write_plan_contains (previous_plan, name, data, len))
+        return 0;
+    }
+
   ret = write_file_at_with_flags (dirfd, O_WRONLY | O_CLOEXEC, 0, name, data, len, err);
   if (UNLIKELY (alias != NULL && ret < 0 && crun_error_get_errno (err) == ENOENT))
     {
@@ -207,26 +292,81 @@ write_blkio_v1_resources_throttling (int dirfd, const char *name, throttling_s *
   return 0;
 }
 
+/* All the io.max limits configured for one device.  The kernel accepts
+   multiple key=value tokens on a single line, so the limits for a device
+   can be applied with one write.  */
+struct throttling_device_s
+{
+  uint64_t major;
+  uint64_t minor;
+  bool set[4];
+  uint64_t rate[4];
+};
+
+static const char *const throttling_key[4] = { "rbps", "wbps", "riops", "wiops" };
+
+static void
+collect_blkio_v2_throttling (struct throttling_device_s *devices, size_t *devices_len, int key,
+                             throttling_s **throttling, size_t throttling_len)
+{
+  size_t i, j;
+
+  for (i = 0; i < throttling_len; i++)
+    {
+      for (j = 0; j < *devices_len; j++)
+        if (devices[j].major == throttling[i]->major && devices[j].minor == throttling[i]->minor)
+          break;
+      if (j == *devices_len)
+        {
+          devices[j].major = throttling[i]->major;
+          devices[j].minor = throttling[i]->minor;
+          (*devices_len)++;
+        }
+      devices[j].set[key] = true;
+      devices[j].rate[key] = throttling[i]->rate;
+    }
+}
+
 static int
-write_blkio_v2_resources_throttling (int fd, const char *name, throttling_s **throttling, size_t throttling_len,
+write_blkio_v2_resources_throttling (int fd, runtime_spec_schema_config_linux_resources_block_io *blkio,
                                      libcrun_error_t *err)
 {
-  char fmt_buf[128];
-  size_t i;
+  cleanup_free struct throttling_device_s *devices = NULL;
+  size_t devices_len = 0;
+  size_t total_len;
+  size_t i, k;
+  int ret;
 
-  if (throttling == NULL)
+  total_len = blkio->throttle_read_bps_device_len + blkio->throttle_write_bps_device_len
+              + blkio->throttle_read_iops_device_len + blkio->throttle_write_iops_device_len;
+  if (total_len == 0)
     return 0;
 
-  for (i = 0; i < throttling_len; i++)
+  devices = xmalloc0 (total_len * sizeof (struct throttling_device_s));
+
+  collect_blkio_v2_throttling (devices, &devices_len, 0, (throttling_s **) blkio->throttle_read_bps_device,
+                               blkio->throttle_read_bps_device_len);
+  collect_blkio_v2_throttling (devices, &devices_len, 1, (throttling_s **) blkio->throttle_write_bps_device,
+                               blkio->throttle_write_bps_device_len);
+  collect_blkio_v2_throttling (devices, &devices_len, 2, (throttling_s **) blkio->throttle_read_iops_device,
+                               blkio->throttle_read_iops_device_len);
+  collect_blkio_v2_throttling (devices, &devices_len, 3, (throttling_s **) blkio->throttle_write_iops_device,
+                               blkio->throttle_write_iops_device_len);
+
+  for (i = 0; i < devices_len; i++)
     {
-      int ret;
+      char fmt_buf[256];
       size_t len;
-      len = sprintf (fmt_buf, "%" PRIu64 ":%" PRIu64 " %s=%" PRIu64 "\n", throttling[i]->major, throttling[i]->minor,
-                     name, throttling[i]->rate);
+
+      len = sprintf (fmt_buf, "%" PRIu64 ":%" PRIu64, devices[i].major, devices[i].minor);
+      for (k = 0; k < 4; k++)
+        if (devices[i].set[k])
+          len += sprintf (fmt_buf + len, " %s=%" PRIu64, throttling_key[k], devices[i].rate[k]);
+      fmt_buf[len++] = '\n';
 
       ret = TEMP_FAILURE_RETRY (write (fd, fmt_buf, len));
       if (UNLIKELY (ret < 0))
-        return crun_make_error (err, errno, "write `%s`", name);
+        return crun_make_error (err, errno, "write `io.max`");
     }
   return 0;
 }
@@ -356,23 +496,7 @@ write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux
           return check_cgroup_v2_controller_available_wrapper (ret, dirfd, name, err);
         }
 
-      ret = write_blkio_v2_resources_throttling (wfd, "rbps", (throttling_s **) blkio->throttle_read_bps_device,
-                                                 blkio->throttle_read_bps_device_len, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
-      ret = write_blkio_v2_resources_throttling (wfd, "wbps", (throttling_s **) blkio->throttle_write_bps_device,
-                                                 blkio->throttle_write_bps_device_len, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
-      ret = write_blkio_v2_resources_throttling (wfd, "riops", (throttling_s **) blkio->throttle_read_iops_device,
-                                                 blkio->throttle_read_iops_device_len, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
-      ret = write_blkio_v2_resources_throttling (wfd, "wiops", (throttling_s **) blkio->throttle_write_iops_device,
-                                                 blkio->throttle_write_iops_device_len, err);
+      ret = write_blkio_v2_resources_throttling (wfd, blkio, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -405,6 +529,254 @@ write_blkio_resources (int dirfd, bool cgroup2, runtime_spec_schema_config_linux
   return 0;
 }
 
+/* Write each `;` separated entry of VALUE as one line to the cgroup file
+   NAME.  io.latency, io.cost.qos and io.cost.model all take one device
+   configuration per write.  */
+static int
+write_io_annotation_lines (int dirfd, const char *name, const char *value, libcrun_error_t *err)
+{
+  cleanup_free char *copy = xstrdup (value);
+  char *saveptr = NULL;
+  char *entry;
+  int ret;
+
+  for (entry = strtok_r (copy, ";", &saveptr); entry; entry = strtok_r (NULL, ";", &saveptr))
+    {
+      while (*entry == ' ')
+        entry++;
+      if (*entry == '\0')
+        continue;
+
+      ret = write_cgroup_file (dirfd, name, entry, strlen (entry), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+  return 0;
+}
+
+/* Turn the container cgroup into a cpuset partition, as requested with the
+   run.oci.cgroup.cpuset.partition annotation.  The partition CPUs come from
+   resources.cpu.cpus.  The sequence follows what the kernel requires: mark
+   the CPUs exclusive along the whole ancestor chain (cpuset.cpus.exclusive,
+   ignored on kernels predating it), then flip cpuset.cpus.partition on the
+   container cgroup and read it back, since an invalid setup does not fail
+   the write but parks the partition in an `invalid` state.  */
+int
+write_cpuset_partition (int cgroup_dirfd, const char *path, json_map_string_string *annotations,
+                        runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err)
+{
+  cleanup_close int opened_dirfd = -1;
+  cleanup_free char *content = NULL;
+  const char *partition;
+  const char *cpus;
+  int cgroup_mode;
+  int root_dirfd;
+  size_t len;
+  int ret;
+
+  partition = find_annotation_map (annotations, "run.oci.cgroup.cpuset.partition");
+  if (partition == NULL)
+    return 0;
+
+  if (strcmp (partition, "member") && strcmp (partition, "root") && strcmp (partition, "isolated"))
+    return crun_make_error (err, 0, "invalid cpuset partition type `%s`", partition);
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, 0, "cpuset partitions are supported only on cgroup v2");
+
+  cpus = resources && resources->cpu ? resources->cpu->cpus : NULL;
+  if (cpus == NULL && strcmp (partition, "member"))
+    return crun_make_error (err, 0, "a cpuset partition requires resources.cpu.cpus");
+
+  root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+  if (UNLIKELY (root_dirfd < 0))
+    return root_dirfd;
+
+  if (cpus)
+    {
+      cleanup_free char *copy = xstrdup (consume_slashes (path));
+      char *it = copy;
+
+      /* Walk the ancestors from the top down to the container cgroup itself
+         and mark the partition CPUs as exclusive at every level.  */
+      while (it)
+        {
+          cleanup_close int fd = -1;
+          char *slash;
+
+          slash = strchr (it, '/');
+          if (slash)
+            *slash = '\0';
+
+          fd = openat (root_dirfd, *copy ? copy : ".", O_DIRECTORY | O_CLOEXEC);
+          if (UNLIKELY (fd < 0))
+            return crun_make_error (err, errno, "open cgroup `%s`", copy);
+
+          ret = write_cgroup_file (fd, "cpuset.cpus.exclusive", cpus, strlen (cpus), err);
+          if (UNLIKELY (ret < 0))
+            {
+              /* The file appeared in Linux 6.7; without it the direct parent
+                 rules decide whether the partition below is valid.  */
+              if (crun_error_get_errno (err) != ENOENT)
+                return ret;
+              crun_error_release (err);
+            }
+
+          if (slash == NULL)
+            break;
+          *slash = '/';
+          it = slash + 1;
+        }
+    }
+
+  if (cgroup_dirfd < 0)
+    {
+      const char *rel_path = consume_slashes (path);
+
+      opened_dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_CLOEXEC);
+      if (UNLIKELY (opened_dirfd < 0))
+        return crun_make_error (err, errno, "open `%s`", path);
+
+      cgroup_dirfd = opened_dirfd;
+    }
+
+  ret = write_cgroup_file (cgroup_dirfd, "cpuset.cpus.partition", partition, strlen (partition), err);
+  if (UNLIKELY (ret < 0))
+    return check_cgroup_v2_controller_available_wrapper (ret, cgroup_dirfd, "cpuset.cpus.partition", err);
+
+  ret = read_all_file_at (cgroup_dirfd, "cpuset.cpus.partition", &content, &len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  if (len > 0 && content[len - 1] == '\n')
+    content[len - 1] = '\0';
+  if (strstr (content, "invalid"))
+    return crun_make_error (err, 0, "cpuset partition not effective: `%s`", content);
+
+  return 0;
+}
+
+/* Apply the io.latency and io.cost annotations.  io.latency targets go to
+   the container cgroup; io.cost.qos and io.cost.model only exist in the root
+   cgroup, so they configure the device globally and are written there.  All
+   three accept multiple device entries separated by `;`.  */
+int
+write_io_annotations (int cgroup_dirfd, const char *path, json_map_string_string *annotations, libcrun_error_t *err)
+{
+  cleanup_close int opened_dirfd = -1;
+  const char *latency, *qos, *model;
+  int cgroup_mode;
+  int root_dirfd;
+  int ret;
+
+  latency = find_annotation_map (annotations, "run.oci.cgroup.io.latency");
+  qos = find_annotation_map (annotations, "run.oci.cgroup.io.cost.qos");
+  model = find_annotation_map (annotations, "run.oci.cgroup.io.cost.model");
+
+  if (latency == NULL && qos == NULL && model == NULL)
+    return 0;
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, 0, "io.latency and io.cost are supported only on cgroup v2");
+
+  root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+  if (UNLIKELY (root_dirfd < 0))
+    return root_dirfd;
+
+  if (qos)
+    {
+      ret = write_io_annotation_lines (root_dirfd, "io.cost.qos", qos, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+  if (model)
+    {
+      ret = write_io_annotation_lines (root_dirfd, "io.cost.model", model, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  if (latency)
+    {
+      if (cgroup_dirfd < 0)
+        {
+          const char *rel_path = consume_slashes (path);
+
+          opened_dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_CLOEXEC);
+          if (UNLIKELY (opened_dirfd < 0))
+            return crun_make_error (err, errno, "open `%s`", path);
+
+          cgroup_dirfd = opened_dirfd;
+        }
+
+      ret = write_io_annotation_lines (cgroup_dirfd, "io.latency", latency, err);
+      if (UNLIKELY (ret < 0))
+        return check_cgroup_v2_controller_available_wrapper (ret, cgroup_dirfd, "io.latency", err);
+    }
+
+  return 0;
+}
+
+/* Apply the run.oci.cgroup.cpu.burst annotation: a CFS burst for containers
+   whose resources block does not carry one, so burst can be enabled
+   fleet-wide from the engine configuration without touching every spec.  An
+   explicit resources.cpu.burst wins over the annotation.  */
+int
+write_cpu_burst_annotation (int cgroup_dirfd, const char *path, json_map_string_string *annotations,
+                            runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err)
+{
+  cleanup_close int opened_dirfd = -1;
+  const char *burst;
+  char *endptr = NULL;
+  int cgroup_mode;
+  int root_dirfd;
+  int ret;
+
+  burst = find_annotation_map (annotations, "run.oci.cgroup.cpu.burst");
+  if (burst == NULL)
+    return 0;
+
+  if (resources && resources->cpu && resources->cpu->burst_present)
+    return 0;
+
+  errno = 0;
+  strtoll (burst, &endptr, 10);
+  if (errno != 0 || endptr == burst || *endptr != '\0')
+    return crun_make_error (err, 0, "invalid cpu burst `%s`", burst);
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, 0, "the cpu burst annotation is supported only on cgroup v2");
+
+  if (cgroup_dirfd < 0)
+    {
+      const char *rel_path = consume_slashes (path);
+
+      root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+      if (UNLIKELY (root_dirfd < 0))
+        return root_dirfd;
+
+      opened_dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_CLOEXEC);
+      if (UNLIKELY (opened_dirfd < 0))
+        return crun_make_error (err, errno, "open `%s`", path);
+
+      cgroup_dirfd = opened_dirfd;
+    }
+
+  ret = write_cgroup_file (cgroup_dirfd, "cpu.max.burst", burst, strlen (burst), err);
+  if (UNLIKELY (ret < 0))
+    return check_cgroup_v2_controller_available_wrapper (ret, cgroup_dirfd, "cpu.max.burst", err);
+
+  return 0;
+}
+
 static int
 write_network_resources (int dirfd_netclass, int dirfd_netprio, runtime_spec_schema_config_linux_resources_network *net,
                          libcrun_error_t *err)
@@ -1247,22 +1619,33 @@ write_unified_resources (int cgroup_dirfd, runtime_spec_schema_config_linux_reso
 }
 
 static int
-update_cgroup_v2_resources (runtime_spec_schema_config_linux_resources *resources, const char *path, libcrun_error_t *err)
+update_cgroup_v2_resources (int dirfd, runtime_spec_schema_config_linux_resources *resources, const char *path,
+                            libcrun_error_t *err)
 {
-  cleanup_free char *cgroup_path = NULL;
-  cleanup_close int cgroup_dirfd = -1;
+  cleanup_close int opened_dirfd = -1;
+  int cgroup_dirfd;
   int ret;
 
   if (resources->network)
     return crun_make_error (err, 0, "network limits not supported on cgroupv2");
 
-  ret = append_paths (&cgroup_path, err, CGROUP_ROOT, path, NULL);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  if (dirfd >= 0)
+    cgroup_dirfd = dirfd;
+  else
+    {
+      const char *rel_path = consume_slashes (path);
+      int root_dirfd;
 
-  cgroup_dirfd = open (cgroup_path, O_DIRECTORY | O_CLOEXEC);
-  if (UNLIKELY (cgroup_dirfd < 0))
-    return crun_make_error (err, errno, "open `%s`", cgroup_path);
+      root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+      if (UNLIKELY (root_dirfd < 0))
+        return root_dirfd;
+
+      opened_dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_CLOEXEC);
+      if (UNLIKELY (opened_dirfd < 0))
+        return crun_make_error (err, errno, "open `%s`", path);
+
+      cgroup_dirfd = opened_dirfd;
+    }
 
   if (resources->devices_len)
     {
@@ -1319,8 +1702,11 @@ update_cgroup_v2_resources (runtime_spec_schema_config_linux_resources *resource
   return 0;
 }
 
+/* Apply RESOURCES to the cgroup at PATH.  On cgroup v2, CGROUP_DIRFD can be
+   an already open descriptor for the container cgroup to avoid resolving PATH
+   again; pass -1 to open it from PATH.  The descriptor is not consumed.  */
 int
-update_cgroup_resources (const char *path,
+update_cgroup_resources (int cgroup_dirfd, const char *path,
                          runtime_spec_schema_config_linux_resources *resources,
                          libcrun_error_t *err)
 {
@@ -1355,7 +1741,7 @@ update_cgroup_resources (const char *path,
   switch (cgroup_mode)
     {
     case CGROUP_MODE_UNIFIED:
-      return update_cgroup_v2_resources (resources, path, err);
+      return update_cgroup_v2_resources (cgroup_dirfd, resources, path, err);
 
     case CGROUP_MODE_LEGACY:
     case CGROUP_MODE_HYBRID:
@@ -1365,3 +1751,161 @@ update_cgroup_resources (const char *path,
       return crun_make_error (err, 0, "invalid cgroup mode `%d`", cgroup_mode);
     }
 }
+
+/* The persisted plan format is a sequence of records:
+   FILE '\n' VALUE_LEN '\n' VALUE '\n'.  */
+static int
+write_plan_load (const char *path, struct write_plan_s *plan, libcrun_error_t *err)
+{
+  cleanup_free char *content = NULL;
+  size_t len;
+  char *it;
+  int ret;
+
+  ret = read_all_file (path, &content, &len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  it = content;
+  while (it < content + len)
+    {
+      char *file, *value_len_str, *end;
+      unsigned long long value_len;
+
+      file = it;
+      it = memchr (it, '\n', content + len - it);
+      if (it == NULL)
+        break;
+      *it++ = '\0';
+
+      value_len_str = it;
+      it = memchr (it, '\n', content + len - it);
+      if (it == NULL)
+        break;
+      *it++ = '\0';
+
+      errno = 0;
+      value_len = strtoull (value_len_str, &end, 10);
+      if (errno != 0 || *end != '\0' || value_len > (unsigned long long) (content + len - it))
+        break;
+
+      write_plan_add (plan, file, it, value_len);
+      it += value_len + 1;
+    }
+
+  return 0;
+}
+
+static int
+write_plan_store (const char *path, struct write_plan_s *plan, libcrun_error_t *err)
+{
+  cleanup_free char *buffer = NULL;
+  size_t i, size = 0;
+  char *it;
+
+  for (i = 0; i < plan->len; i++)
+    size += strlen (plan->entries[i].file) + 1 + 21 + plan->entries[i].value_len + 1;
+
+  buffer = xmalloc (size + 1);
+  it = buffer;
+  for (i = 0; i < plan->len; i++)
+    {
+      it += sprintf (it, "%s\n%zu\n", plan->entries[i].file, plan->entries[i].value_len);
+      memcpy (it, plan->entries[i].value, plan->entries[i].value_len);
+      it += plan->entries[i].value_len;
+      *it++ = '\n';
+    }
+
+  return write_file (path, buffer, it - buffer, err);
+}
+
+/* Like update_cgroup_resources, but record the sequence of writes into
+   PLAN_FILE and skip the writes whose value did not change since the plan
+   persisted by the previous apply.  */
+int
+update_cgroup_resources_with_plan (int cgroup_dirfd, const char *path,
+                                   runtime_spec_schema_config_linux_resources *resources,
+                                   const char *plan_file,
+                                   libcrun_error_t *err)
+{
+  struct write_plan_s old_plan = {};
+  struct write_plan_s new_plan = {};
+  int ret;
+
+  if (plan_file == NULL)
+    return update_cgroup_resources (cgroup_dirfd, path, resources, err);
+
+  ret = write_plan_load (plan_file, &old_plan, err);
+  if (UNLIKELY (ret < 0))
+    {
+      /* A missing or unreadable plan only means nothing can be skipped.  */
+      crun_error_release (err);
+      write_plan_free (&old_plan);
+    }
+
+  previous_plan = old_plan.len ? &old_plan : NULL;
+  current_plan = &new_plan;
+
+  ret = update_cgroup_resources (cgroup_dirfd, path, resources, err);
+
+  current_plan = NULL;
+  previous_plan = NULL;
+
+  if (LIKELY (ret >= 0))
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      /* Failing to persist the plan must not fail the update.  */
+      if (UNLIKELY (write_plan_store (plan_file, &new_plan, &tmp_err) < 0))
+        crun_error_release (&tmp_err);
+    }
+
+  write_plan_free (&old_plan);
+  write_plan_free (&new_plan);
+
+  return ret;
+}
+
+int
+libcrun_cgroup_reclaim_memory (struct libcrun_cgroup_status *cgroup_status, const char *value,
+                               libcrun_error_t *err)
+{
+  cleanup_close int dirfd = -1;
+  const char *rel_path;
+  int cgroup_mode;
+  int root_dirfd;
+  int ret;
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, 0, "memory.reclaim is supported only on cgroup v2");
+
+  if (is_empty_string (cgroup_status->path))
+    return crun_make_error (err, 0, "cannot reclaim memory without cgroups");
+
+  root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+  if (UNLIKELY (root_dirfd < 0))
+    return root_dirfd;
+
+  rel_path = consume_slashes (cgroup_status->path);
+  dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_CLOEXEC);
+  if (UNLIKELY (dirfd < 0))
+    return crun_make_error (err, errno, "open `%s`", cgroup_status->path);
+
+  ret = write_cgroup_file (dirfd, "memory.reclaim", value, strlen (value), err);
+  if (UNLIKELY (ret < 0))
+    {
+      /* The kernel reports a partial reclaim with EAGAIN.  */
+      if (crun_error_get_errno (err) == EAGAIN)
+        {
+          crun_error_release (err);
+          return crun_make_error (err, EAGAIN, "could not reclaim `%s` from the container", value);
+        }
+      return ret;
+    }
+
+  return 0;
+}
@@ -22,8 +22,22 @@
 #include "cgroup.h"
 #include <unistd.h>
 
-int update_cgroup_resources (const char *path,
+int update_cgroup_resources (int cgroup_dirfd, const char *path,
                              runtime_spec_schema_config_linux_resources *resources,
                              libcrun_error_t *err);
 
+int update_cgroup_resources_with_plan (int cgroup_dirfd, const char *path,
+                                       runtime_spec_schema_config_linux_resources *resources,
+                                       const char *plan_file,
+                                       libcrun_error_t *err);
+
+int write_io_annotations (int cgroup_dirfd, const char *path, json_map_string_string *annotations,
+                          libcrun_error_t *err);
+
+int write_cpuset_partition (int cgroup_dirfd, const char *path, json_map_string_string *annotations,
+                            runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err);
+
+int write_cpu_burst_annotation (int cgroup_dirfd, const char *path, json_map_string_string *annotations,
+                                runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err);
+
 #endif
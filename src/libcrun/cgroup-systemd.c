@@ -35,7 +35,7 @@
 #include <time.h>
 
 #ifdef HAVE_SYSTEMD
-#  include <systemd/sd-bus.h>
+#  include "dl-systemd.h"
 
 #  define SYSTEMD_PROPERTY_PREFIX "org.systemd.property."
 
@@ -437,6 +437,9 @@ systemd_finalize (struct libcrun_cgroup_args *args, char **path_out,
 struct systemd_job_removed_s
 {
   const char *path;
+  /* Match on the unit name instead of the job path, for jobs whose object
+     path is not known yet.  */
+  const char *unit;
   const char *op;
   int terminated;
   libcrun_error_t err;
@@ -454,7 +457,7 @@ systemd_job_removed (sd_bus_message *m, void *userdata, sd_bus_error *error arg_
   if (ret < 0)
     return -1;
 
-  if (strcmp (d->path, path) == 0)
+  if ((d->path && strcmp (d->path, path) == 0) || (d->unit && strcmp (d->unit, unit) == 0))
     {
       d->terminated = 1;
       if (strcmp (result, "done") != 0)
@@ -467,11 +470,14 @@ systemd_job_removed (sd_bus_message *m, void *userdata, sd_bus_error *error arg_
 }
 
 static int
-systemd_check_job_status_setup (sd_bus *bus, struct systemd_job_removed_s *data, libcrun_error_t *err)
+systemd_check_job_status_setup (sd_bus *bus, sd_bus_slot **slot, struct systemd_job_removed_s *data,
+                                libcrun_error_t *err)
 {
   int ret;
 
-  ret = sd_bus_match_signal_async (bus, NULL, "org.freedesktop.systemd1", "/org/freedesktop/systemd1",
+  /* The slot must be released by the caller: the bus connection is cached and
+     outlives DATA, which is on the caller stack.  */
+  ret = sd_bus_match_signal_async (bus, slot, "org.freedesktop.systemd1", "/org/freedesktop/systemd1",
                                    "org.freedesktop.systemd1.Manager", "JobRemoved", systemd_job_removed, NULL, data);
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, -ret, "sd-bus match signal");
@@ -750,11 +756,29 @@ append_systemd_annotation (sd_bus_message *m, const char *name, size_t name_len,
   return crun_make_error (err, errno, "unknown type for `%s`", name);
 }
 
+/* The sd-bus connection is opened once per process and cached, so it can be
+   established early (from the precreate hook, before the container process is
+   cloned) and reused by every subsequent call.  */
+static sd_bus *cached_sd_bus;
+
 static int
 open_sd_bus_connection (sd_bus **bus, libcrun_error_t *err)
 {
   int rootless;
   int sd_err = 0;
+  int ret;
+
+  if (cached_sd_bus)
+    {
+      *bus = sd_bus_ref (cached_sd_bus);
+      return 0;
+    }
+
+  /* Every sd_bus operation goes through a connection, so this is the single
+     place where libsystemd must be resolved.  */
+  ret = libcrun_load_libsystemd (err);
+  if (UNLIKELY (ret < 0))
+    return ret;
 
   rootless = is_rootless (err);
   if (UNLIKELY (rootless < 0))
@@ -767,6 +791,7 @@ open_sd_bus_connection (sd_bus **bus, libcrun_error_t *err)
   if (sd_err < 0)
     return crun_make_error (err, -sd_err, "cannot open sd-bus");
 
+  cached_sd_bus = sd_bus_ref (*bus);
   return 0;
 }
 
@@ -992,6 +1017,26 @@ exit:
   return sd_err;
 }
 
+struct transient_unit_call_s
+{
+  sd_bus_message *reply;
+  sd_bus_error error;
+  bool done;
+};
+
+static int
+on_transient_unit_reply (sd_bus_message *reply, void *userdata, sd_bus_error *ret_error arg_unused)
+{
+  struct transient_unit_call_s *d = userdata;
+
+  d->done = true;
+  if (sd_bus_message_is_method_error (reply, NULL))
+    sd_bus_error_copy (&d->error, sd_bus_message_get_error (reply));
+  else
+    d->reply = sd_bus_message_ref (reply);
+  return 0;
+}
+
 static int
 enter_systemd_cgroup_scope (runtime_spec_schema_config_linux_resources *resources,
                             int cgroup_mode,
@@ -1000,12 +1045,14 @@ enter_systemd_cgroup_scope (runtime_spec_schema_config_linux_resources *resource
                             pid_t pid, libcrun_error_t *err)
 {
   sd_bus *bus = NULL;
+  sd_bus_slot *slot = NULL;
   sd_bus_message *m = NULL;
   sd_bus_message *reply = NULL;
   int sd_err, ret = 0;
   sd_bus_error error = SD_BUS_ERROR_NULL;
   const char *object = NULL;
   struct systemd_job_removed_s job_data = {};
+  struct transient_unit_call_s call_data = { .error = SD_BUS_ERROR_NULL };
   int i;
   const char *boolean_opts[10];
 
@@ -1028,7 +1075,7 @@ enter_systemd_cgroup_scope (runtime_spec_schema_config_linux_resources *resource
   if (UNLIKELY (ret < 0))
     goto exit;
 
-  ret = systemd_check_job_status_setup (bus, &job_data, err);
+  ret = systemd_check_job_status_setup (bus, &slot, &job_data, err);
   if (UNLIKELY (ret < 0))
     goto exit;
 
@@ -1134,22 +1181,52 @@ enter_systemd_cgroup_scope (runtime_spec_schema_config_linux_resources *resource
       goto exit;
     }
 
-  sd_err = sd_bus_call (bus, m, 0, &error, &reply);
+  /* Send the call asynchronously so the JobRemoved signal for the scope is
+     handled while waiting for the method reply: one event loop covers both
+     round trips, instead of a blocking call followed by a second wait.  */
+  job_data.unit = scope;
+  job_data.op = "creating";
+
+  sd_err = sd_bus_call_async (bus, NULL, m, on_transient_unit_reply, &call_data, 0);
   if (UNLIKELY (sd_err < 0))
     {
-      if (reset_failed_unit (bus, scope) == 0)
+      ret = crun_make_error (err, -sd_err, "sd-bus call async");
+      goto exit;
+    }
+
+  while (! call_data.done)
+    {
+      sd_err = sd_bus_process (bus, NULL);
+      if (UNLIKELY (sd_err < 0))
         {
-          sd_bus_error_free (&error);
-          if (reply)
-            sd_bus_message_unref (reply);
+          ret = crun_make_error (err, -sd_err, "sd-bus process");
+          goto exit;
+        }
 
-          error = SD_BUS_ERROR_NULL;
-          reply = NULL;
+      if (sd_err != 0)
+        continue;
 
-          sd_err = sd_bus_call (bus, m, 0, &error, &reply);
+      sd_err = sd_bus_wait (bus, (uint64_t) -1);
+      if (UNLIKELY (sd_err < 0))
+        {
+          ret = crun_make_error (err, -sd_err, "sd-bus wait");
+          goto exit;
         }
+    }
+
+  reply = call_data.reply;
+  call_data.reply = NULL;
+
+  if (UNLIKELY (reply == NULL))
+    {
+      /* The call failed.  Reset the unit and retry once, synchronously.  */
+      sd_err = -1;
+      if (reset_failed_unit (bus, scope) == 0)
+        sd_err = sd_bus_call (bus, m, 0, &error, &reply);
       if (sd_err < 0)
         {
+          if (error.name == NULL)
+            sd_bus_error_copy (&error, &call_data.error);
           ret = crun_make_error (err, sd_bus_error_get_errno (&error), "sd-bus call: %s", error.message ?: error.name);
           goto exit;
         }
@@ -1165,13 +1242,18 @@ enter_systemd_cgroup_scope (runtime_spec_schema_config_linux_resources *resource
   ret = systemd_check_job_status (bus, &job_data, object, "creating", err);
 
 exit:
+  if (slot)
+    sd_bus_slot_unref (slot);
   if (bus)
     sd_bus_unref (bus);
   if (m)
     sd_bus_message_unref (m);
   if (reply)
     sd_bus_message_unref (reply);
+  if (call_data.reply)
+    sd_bus_message_unref (call_data.reply);
   sd_bus_error_free (&error);
+  sd_bus_error_free (&call_data.error);
   return ret;
 }
 
@@ -1180,6 +1262,7 @@ libcrun_destroy_systemd_cgroup_scope (struct libcrun_cgroup_status *cgroup_statu
                                       libcrun_error_t *err)
 {
   sd_bus *bus = NULL;
+  sd_bus_slot *slot = NULL;
   sd_bus_message *m = NULL;
   sd_bus_message *reply = NULL;
   int ret = 0;
@@ -1192,7 +1275,7 @@ libcrun_destroy_systemd_cgroup_scope (struct libcrun_cgroup_status *cgroup_statu
   if (UNLIKELY (ret < 0))
     goto exit;
 
-  ret = systemd_check_job_status_setup (bus, &job_data, err);
+  ret = systemd_check_job_status_setup (bus, &slot, &job_data, err);
   if (UNLIKELY (ret < 0))
     goto exit;
 
@@ -1231,6 +1314,8 @@ libcrun_destroy_systemd_cgroup_scope (struct libcrun_cgroup_status *cgroup_statu
   reset_failed_unit (bus, scope);
 
 exit:
+  if (slot)
+    sd_bus_slot_unref (slot);
   if (bus)
     sd_bus_unref (bus);
   if (m)
@@ -1257,6 +1342,26 @@ find_systemd_subgroup (json_map_string_string *annotations)
   return "container";
 }
 
+static int
+libcrun_precreate_cgroup_systemd (struct libcrun_cgroup_args *args arg_unused, int *dirfd, libcrun_error_t *err)
+{
+  sd_bus *bus = NULL;
+  int ret;
+
+  *dirfd = -1;
+
+  /* Establish the sd-bus connection before the container process is cloned,
+     so the connect and authentication round trips overlap with the rest of
+     the setup.  The connection is cached and reused when the scope is
+     created.  */
+  ret = open_sd_bus_connection (&bus, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  sd_bus_unref (bus);
+  return 0;
+}
+
 static int
 libcrun_cgroup_enter_systemd (struct libcrun_cgroup_args *args,
                               struct libcrun_cgroup_status *out,
@@ -1359,6 +1464,7 @@ libcrun_update_resources_systemd (struct libcrun_cgroup_status *cgroup_status,
   sd_bus_error error = SD_BUS_ERROR_NULL;
   sd_bus_message *reply = NULL;
   sd_bus_message *m = NULL;
+  sd_bus_slot *slot = NULL;
   sd_bus *bus = NULL;
   int sd_err, ret;
   int cgroup_mode;
@@ -1371,7 +1477,7 @@ libcrun_update_resources_systemd (struct libcrun_cgroup_status *cgroup_status,
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = systemd_check_job_status_setup (bus, &job_data, err);
+  ret = systemd_check_job_status_setup (bus, &slot, &job_data, err);
   if (UNLIKELY (ret < 0))
     goto exit;
 
@@ -1435,6 +1541,8 @@ libcrun_update_resources_systemd (struct libcrun_cgroup_status *cgroup_status,
   ret = 0;
 
 exit:
+  if (slot)
+    sd_bus_slot_unref (slot);
   if (bus)
     sd_bus_unref (bus);
   if (m)
@@ -1476,10 +1584,20 @@ libcrun_update_resources_systemd (struct libcrun_cgroup_status *cgroup_status,
 
   return crun_make_error (err, ENOTSUP, "systemd not supported");
 }
+
+static int
+libcrun_precreate_cgroup_systemd (struct libcrun_cgroup_args *args, int *dirfd, libcrun_error_t *err)
+{
+  (void) args;
+  (void) err;
+
+  *dirfd = -1;
+  return 0;
+}
 #endif
 
 struct libcrun_cgroup_manager cgroup_manager_systemd = {
-  .precreate_cgroup = NULL,
+  .precreate_cgroup = libcrun_precreate_cgroup_systemd,
   .create_cgroup = libcrun_cgroup_enter_systemd,
   .destroy_cgroup = libcrun_destroy_cgroup_systemd,
   .update_resources = libcrun_update_resources_systemd,
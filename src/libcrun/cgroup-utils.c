@@ -27,12 +27,14 @@
 #include "ebpf.h"
 #include "utils.h"
 #include "status.h"
+#include "probe-cache.h"
 #include <string.h>
 #include <sys/types.h>
 #include <signal.h>
 #include <sys/vfs.h>
 #include <inttypes.h>
 #include <time.h>
+#include <poll.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -219,32 +221,65 @@ detect_cgroup_mode (libcrun_error_t *err)
   return stat.f_type == CGROUP2_SUPER_MAGIC ? CGROUP_MODE_HYBRID : CGROUP_MODE_LEGACY;
 }
 
+/* Detecting the cgroup mode and opening /sys/fs/cgroup are paid once per
+   process; operations iterating over many containers reuse the result.  */
+static int cgroup_mode = 0;
+static int cgroup_root_fd = -1;
+
 int
 libcrun_get_cgroup_mode (libcrun_error_t *err)
 {
   int tmp;
-  static int cgroup_mode = 0;
 
   if (cgroup_mode)
     return cgroup_mode;
 
+  /* The mount layout of /sys/fs/cgroup does not change while the system is
+     up, so trust a cached result from an earlier invocation this boot.  */
+  if (libcrun_probe_cache_get ("cgroup-mode", &tmp) == 0
+      && (tmp == CGROUP_MODE_UNIFIED || tmp == CGROUP_MODE_HYBRID || tmp == CGROUP_MODE_LEGACY))
+    {
+      cgroup_mode = tmp;
+      return cgroup_mode;
+    }
+
   tmp = detect_cgroup_mode (err);
   if (UNLIKELY (tmp < 0))
     return tmp;
 
   cgroup_mode = tmp;
+  libcrun_probe_cache_store ("cgroup-mode", cgroup_mode);
 
   return cgroup_mode;
 }
 
+int
+libcrun_get_cgroup_root_dirfd (libcrun_error_t *err)
+{
+  if (cgroup_root_fd >= 0)
+    return cgroup_root_fd;
+
+  cgroup_root_fd = open (CGROUP_ROOT, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+  if (UNLIKELY (cgroup_root_fd < 0))
+    return crun_make_error (err, errno, "open `" CGROUP_ROOT "`");
+
+  return cgroup_root_fd;
+}
+
+void
+libcrun_cgroup_invalidate_cache (void)
+{
+  cgroup_mode = 0;
+  close_and_reset (&cgroup_root_fd);
+}
+
 static int
 read_pids_cgroup (int dfd, bool recurse, pid_t **pids, size_t *n_pids, size_t *allocated, libcrun_error_t *err)
 {
   __attribute__ ((unused)) cleanup_close int clean_dfd = dfd;
   cleanup_close int tasksfd = -1;
   cleanup_free char *buffer = NULL;
-  char *saveptr = NULL;
-  size_t n_new_pids;
+  pid_t pid = 0;
   size_t len;
   char *it;
   int ret;
@@ -253,6 +288,8 @@ read_pids_cgroup (int dfd, bool recurse, pid_t **pids, size_t *n_pids, size_t *a
   if (tasksfd < 0)
     return crun_make_error (err, errno, "open `cgroup.procs`");
 
+  /* cgroup files report a zero st_size, so the buffer length read is the
+     only sizing information available.  */
   ret = read_all_fd (tasksfd, "cgroup.procs", &buffer, &len, err);
   if (UNLIKELY (ret < 0))
     return ret;
@@ -260,22 +297,27 @@ read_pids_cgroup (int dfd, bool recurse, pid_t **pids, size_t *n_pids, size_t *a
   if (len == 0)
     return 0;
 
-  for (n_new_pids = 0, it = buffer; it; it = strchr (it + 1, '\n'))
-    n_new_pids++;
-
-  if (*allocated < *n_pids + n_new_pids + 1)
+  /* Each pid takes at least two bytes ("N\n"), so len / 2 bounds the number
+     of new entries and a single parsing pass is enough.  */
+  if (*allocated < *n_pids + len / 2 + 1)
     {
-      *allocated = *n_pids + n_new_pids + 1;
+      *allocated = *n_pids + len / 2 + 1;
       *pids = xrealloc (*pids, sizeof (pid_t) * *allocated);
     }
 
-  for (it = strtok_r (buffer, "\n", &saveptr); it; it = strtok_r (NULL, "\n", &saveptr))
+  for (it = buffer; it < buffer + len; it++)
     {
-      pid_t pid = strtoul (it, NULL, 10);
-
-      if (pid > 0)
-        (*pids)[(*n_pids)++] = pid;
+      if (*it >= '0' && *it <= '9')
+        pid = pid * 10 + (*it - '0');
+      else
+        {
+          if (pid > 0)
+            (*pids)[(*n_pids)++] = pid;
+          pid = 0;
+        }
     }
+  if (pid > 0)
+    (*pids)[(*n_pids)++] = pid;
   (*pids)[*n_pids] = 0;
 
   if (recurse)
@@ -409,10 +451,23 @@ libcrun_cgroup_read_pids_from_path (const char *path, bool recurse, pid_t **pids
   switch (mode)
     {
     case CGROUP_MODE_UNIFIED:
-      ret = append_paths (&cgroup_path, err, CGROUP_ROOT, path, NULL);
-      if (UNLIKELY (ret < 0))
-        return ret;
-      break;
+      {
+        const char *rel_path = consume_slashes (path);
+        int root_dirfd;
+
+        root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+        if (UNLIKELY (root_dirfd < 0))
+          return root_dirfd;
+
+        dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_CLOEXEC);
+        if (dirfd < 0)
+          return crun_make_error (err, errno, "open `%s`", path);
+
+        n_pids = 0;
+        allocated = 0;
+
+        return read_pids_cgroup (dirfd, recurse, pids, &n_pids, &allocated, err);
+      }
 
     case CGROUP_MODE_HYBRID:
     case CGROUP_MODE_LEGACY:
@@ -660,6 +715,108 @@ libcrun_cgroup_pause_unpause_path (const char *cgroup_path, const bool pause, li
   return libcrun_cgroup_pause_unpause_with_mode (cgroup_path, cgroup_mode, pause, err);
 }
 
+/* Wait until the `frozen` line in every cgroup.events file matches
+   EXPECTED.  The kernel notifies changes to cgroup.events with POLLPRI,
+   so one poll set covers the whole batch.  Settled entries are disabled
+   by negating their descriptor, which poll(2) ignores.  */
+static int
+wait_frozen_state (struct pollfd *pfds, size_t n, const bool expected, libcrun_error_t *err)
+{
+  size_t pending = n, i;
+  int ret;
+
+  while (pending > 0)
+    {
+      for (i = 0; i < n; i++)
+        {
+          char buf[256];
+          const char *frozen;
+
+          if (pfds[i].fd < 0)
+            continue;
+
+          ret = TEMP_FAILURE_RETRY (pread (pfds[i].fd, buf, sizeof (buf) - 1, 0));
+          if (UNLIKELY (ret < 0))
+            return crun_make_error (err, errno, "read `cgroup.events`");
+          buf[ret] = '\0';
+
+          frozen = strstr (buf, "frozen ");
+          if (frozen && (frozen[strlen ("frozen ")] == '1') == expected)
+            {
+              pfds[i].fd = -pfds[i].fd;
+              pending--;
+            }
+        }
+
+      if (pending == 0)
+        break;
+
+      ret = TEMP_FAILURE_RETRY (poll (pfds, n, -1));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "poll `cgroup.events`");
+    }
+
+  return 0;
+}
+
+int
+libcrun_cgroup_batch_pause_unpause_paths (const char *const *paths, size_t n_paths, const bool pause,
+                                          libcrun_error_t *err)
+{
+  cleanup_free struct pollfd *pfds = NULL;
+  int cgroup_mode;
+  size_t i, n_fds = 0;
+  int ret = 0;
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+
+  /* Write every freeze file first so the kernel works on the whole batch
+     concurrently, then wait for completion in a single poll set instead
+     of one poll loop per container.  */
+  for (i = 0; i < n_paths; i++)
+    {
+      ret = libcrun_cgroup_pause_unpause_with_mode (paths[i], cgroup_mode, pause, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  /* Only the unified hierarchy reports freeze completion through
+     cgroup.events; the legacy freezer keeps the fire-and-forget behavior
+     of the single-container path.  */
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return 0;
+
+  pfds = xmalloc0 (n_paths * sizeof (struct pollfd));
+  for (i = 0; i < n_paths; i++)
+    {
+      cleanup_free char *events_path = NULL;
+      int fd;
+
+      ret = append_paths (&events_path, err, CGROUP_ROOT, paths[i], "cgroup.events", NULL);
+      if (UNLIKELY (ret < 0))
+        goto out;
+
+      fd = open (events_path, O_RDONLY | O_CLOEXEC);
+      if (UNLIKELY (fd < 0))
+        {
+          ret = crun_make_error (err, errno, "open `%s`", events_path);
+          goto out;
+        }
+      pfds[n_fds].fd = fd;
+      pfds[n_fds].events = POLLPRI;
+      n_fds++;
+    }
+
+  ret = wait_frozen_state (pfds, n_fds, pause, err);
+
+out:
+  for (i = 0; i < n_fds; i++)
+    TEMP_FAILURE_RETRY (close (pfds[i].fd < 0 ? -pfds[i].fd : pfds[i].fd));
+  return ret;
+}
+
 int
 cgroup_killall_path (const char *path, int signal, libcrun_error_t *err)
 {
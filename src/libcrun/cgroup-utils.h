@@ -30,6 +30,14 @@ int libcrun_get_current_unified_cgroup (char **path, bool absolute, libcrun_erro
 
 int libcrun_get_cgroup_mode (libcrun_error_t *err);
 
+/* Return a cached read-only dirfd for /sys/fs/cgroup.  The descriptor is
+   owned by the cache and must not be closed by the caller.  */
+int libcrun_get_cgroup_root_dirfd (libcrun_error_t *err);
+
+/* Drop the cached cgroup mode and root dirfd, e.g. after changing mount
+   namespace.  The next getter call resolves them again.  */
+void libcrun_cgroup_invalidate_cache (void);
+
 int libcrun_get_cgroup_dirfd (struct libcrun_cgroup_status *status, const char *sub_cgroup, libcrun_error_t *err);
 
 int maybe_make_cgroup_threaded (const char *path, libcrun_error_t *err);
@@ -41,6 +41,14 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <libgen.h>
+#include <sys/param.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
 
 static int
 libcrun_cgroup_enter_disabled (struct libcrun_cgroup_args *args arg_unused, struct libcrun_cgroup_status *out, libcrun_error_t *err arg_unused)
@@ -137,6 +145,66 @@ libcrun_cgroup_pause_unpause (struct libcrun_cgroup_status *status, const bool p
   return libcrun_cgroup_pause_unpause_path (status->path, pause, err);
 }
 
+/* Mirror the process ioPriority class on the cgroup through the
+   io.prio.class interface, so the priority follows the cgroup and later
+   forks and execs inherit it without a per-process ioprio_set.  */
+int
+libcrun_cgroup_set_io_priority (struct libcrun_cgroup_status *status,
+                                runtime_spec_schema_config_schema_process *process, libcrun_error_t *err)
+{
+  const char *cgroup_path = status->path;
+  cleanup_free char *path = NULL;
+  const char *class = NULL;
+  int cgroup_mode;
+  int ret;
+
+  if (process == NULL || process->io_priority == NULL)
+    return 0;
+
+  if (cgroup_path == NULL || cgroup_path[0] == '\0')
+    return 0;
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+
+  /* Only the unified hierarchy has the blk-ioprio policy.  */
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return 0;
+
+  if (strcmp (process->io_priority->class, "IOPRIO_CLASS_RT") == 0)
+    class = "promote-to-rt";
+  else if (strcmp (process->io_priority->class, "IOPRIO_CLASS_BE") == 0)
+    class = "restrict-to-be";
+  else if (strcmp (process->io_priority->class, "IOPRIO_CLASS_IDLE") == 0)
+    class = "idle";
+  else
+    return crun_make_error (err, 0, "invalid io priority `%s`", process->io_priority->class);
+
+  ret = append_paths (&path, err, CGROUP_ROOT, cgroup_path, "io.prio.class", NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = write_file (path, class, strlen (class), err);
+  if (ret < 0)
+    {
+      /* `promote-to-rt` was named `none-to-rt` before Linux 6.2.  */
+      if (crun_error_get_errno (err) == EINVAL && strcmp (class, "promote-to-rt") == 0)
+        {
+          crun_error_release (err);
+          ret = write_file (path, "none-to-rt", strlen ("none-to-rt"), err);
+        }
+
+      /* The kernel has no blk-ioprio support, keep the per-process value only.  */
+      if (ret < 0 && crun_error_get_errno (err) == ENOENT)
+        {
+          crun_error_release (err);
+          return 0;
+        }
+    }
+  return ret < 0 ? ret : 0;
+}
+
 int
 libcrun_cgroup_is_container_paused (struct libcrun_cgroup_status *status, bool *paused, libcrun_error_t *err)
 {
@@ -185,6 +253,393 @@ libcrun_cgroup_read_pids (struct libcrun_cgroup_status *status, bool recurse, pi
   return libcrun_cgroup_read_pids_from_path (status->path, recurse, pids, err);
 }
 
+/* Descriptors for the stat files of the last polled cgroup.  Monitoring
+   reads the same cgroup at a high frequency, so keep the files open and
+   pread them instead of resolving the path on every sample.  */
+static struct
+{
+  char *path;
+  int memory_fd;
+  int cpu_fd;
+  int io_fd;
+  int pids_fd;
+} stats_files_cache = { NULL, -1, -1, -1, -1 };
+
+/* Return the value following KEY in CONTENT, where each line has the form
+   `KEY VALUE`.  Return 0 if KEY is not present.  */
+static uint64_t
+find_stat_key (const char *content, const char *key)
+{
+  size_t key_len = strlen (key);
+  const char *it;
+
+  for (it = content; it; it = strchr (it, '\n'), it = it ? it + 1 : NULL)
+    {
+      if (strncmp (it, key, key_len) == 0 && it[key_len] == ' ')
+        return (uint64_t) strtoull (it + key_len + 1, NULL, 10);
+    }
+  return 0;
+}
+
+/* Like find_stat_key, but for ` KEY=VALUE` tokens on a single LINE.  */
+static uint64_t
+find_stat_subkey (const char *line, const char *key)
+{
+  size_t key_len = strlen (key);
+  const char *it;
+
+  for (it = line; *it && *it != '\n'; it++)
+    {
+      if (*it == ' ' && strncmp (it + 1, key, key_len) == 0 && it[1 + key_len] == '=')
+        return (uint64_t) strtoull (it + key_len + 2, NULL, 10);
+    }
+  return 0;
+}
+
+static void
+parse_cpu_stat_buf (const char *buf, struct libcrun_cgroup_stats_s *stats)
+{
+  stats->cpu_usage_usec = find_stat_key (buf, "usage_usec");
+  stats->cpu_user_usec = find_stat_key (buf, "user_usec");
+  stats->cpu_system_usec = find_stat_key (buf, "system_usec");
+}
+
+static void
+parse_memory_stat_buf (const char *buf, struct libcrun_cgroup_stats_s *stats)
+{
+  stats->memory_anon = find_stat_key (buf, "anon");
+  stats->memory_file = find_stat_key (buf, "file");
+  stats->memory_kernel_stack = find_stat_key (buf, "kernel_stack");
+  stats->memory_pgfault = find_stat_key (buf, "pgfault");
+  stats->memory_pgmajfault = find_stat_key (buf, "pgmajfault");
+}
+
+static void
+parse_io_stat_buf (const char *buf, struct libcrun_cgroup_stats_s *stats)
+{
+  /* One line for each device: `MAJ:MIN rbytes=N wbytes=N rios=N wios=N ...`.  */
+  const char *it = buf;
+
+  while (it && *it)
+    {
+      stats->io_rbytes += find_stat_subkey (it, "rbytes");
+      stats->io_wbytes += find_stat_subkey (it, "wbytes");
+      stats->io_rios += find_stat_subkey (it, "rios");
+      stats->io_wios += find_stat_subkey (it, "wios");
+
+      it = strchr (it, '\n');
+      if (it)
+        it++;
+    }
+}
+
+static ssize_t
+pread_stat_file (int fd, char *buf, size_t size)
+{
+  size_t read_size = 0;
+  ssize_t ret;
+
+  if (fd < 0)
+    {
+      buf[0] = '\0';
+      return 0;
+    }
+
+  do
+    {
+      ret = TEMP_FAILURE_RETRY (pread (fd, buf + read_size, size - read_size - 1, read_size));
+      if (UNLIKELY (ret < 0))
+        return ret;
+      read_size += ret;
+    }
+  while (ret > 0 && read_size < size - 1);
+
+  buf[read_size] = '\0';
+  return read_size;
+}
+
+static int
+open_stats_files (const char *path, libcrun_error_t *err)
+{
+  cleanup_close int dirfd = -1;
+  const char *rel_path;
+  int root_dirfd;
+
+  if (stats_files_cache.path && strcmp (stats_files_cache.path, path) == 0)
+    return 0;
+
+  free (stats_files_cache.path);
+  stats_files_cache.path = NULL;
+  close_and_reset (&stats_files_cache.memory_fd);
+  close_and_reset (&stats_files_cache.cpu_fd);
+  close_and_reset (&stats_files_cache.io_fd);
+  close_and_reset (&stats_files_cache.pids_fd);
+
+  root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+  if (UNLIKELY (root_dirfd < 0))
+    return root_dirfd;
+
+  rel_path = consume_slashes (path);
+  dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+  if (UNLIKELY (dirfd < 0))
+    return crun_make_error (err, errno, "open `%s`", path);
+
+  /* Missing files mean the controller is not enabled; their counters stay
+     at zero.  */
+  stats_files_cache.memory_fd = openat (dirfd, "memory.stat", O_RDONLY | O_CLOEXEC);
+  stats_files_cache.cpu_fd = openat (dirfd, "cpu.stat", O_RDONLY | O_CLOEXEC);
+  stats_files_cache.io_fd = openat (dirfd, "io.stat", O_RDONLY | O_CLOEXEC);
+  stats_files_cache.pids_fd = openat (dirfd, "pids.current", O_RDONLY | O_CLOEXEC);
+
+  stats_files_cache.path = xstrdup (path);
+  return 0;
+}
+
+int
+libcrun_cgroup_read_stats (struct libcrun_cgroup_status *status, struct libcrun_cgroup_stats_s *stats,
+                           libcrun_error_t *err)
+{
+  char buf[8192];
+  ssize_t size;
+  int cgroup_mode;
+  int ret;
+
+  memset (stats, 0, sizeof (*stats));
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, ENOTSUP, "stats are supported only on cgroup v2");
+
+  if (status->path == NULL || status->path[0] == '\0')
+    return crun_make_error (err, 0, "the container is not using cgroups");
+
+  ret = open_stats_files (status->path, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  size = pread_stat_file (stats_files_cache.cpu_fd, buf, sizeof (buf));
+  if (UNLIKELY (size < 0))
+    return crun_make_error (err, errno, "read `cpu.stat`");
+  parse_cpu_stat_buf (buf, stats);
+
+  size = pread_stat_file (stats_files_cache.memory_fd, buf, sizeof (buf));
+  if (UNLIKELY (size < 0))
+    return crun_make_error (err, errno, "read `memory.stat`");
+  parse_memory_stat_buf (buf, stats);
+
+  size = pread_stat_file (stats_files_cache.io_fd, buf, sizeof (buf));
+  if (UNLIKELY (size < 0))
+    return crun_make_error (err, errno, "read `io.stat`");
+  parse_io_stat_buf (buf, stats);
+
+  size = pread_stat_file (stats_files_cache.pids_fd, buf, sizeof (buf));
+  if (UNLIKELY (size < 0))
+    return crun_make_error (err, errno, "read `pids.current`");
+  stats->pids_current = (uint64_t) strtoull (buf, NULL, 10);
+
+  return 0;
+}
+
+#define STATS_BATCH_BUF_SIZE 8192
+#define STATS_FILES_PER_ITEM 4
+
+struct stats_read_op_s
+{
+  int fd;
+  char *buf;
+  ssize_t res;
+};
+
+#ifdef HAVE_LINUX_IO_URING_H
+/* Submit all the OPS as IORING_OP_READ requests and wait for their
+   completions, chunked only by the ring size.  Failed reads get a negative
+   res and are retried synchronously by the caller, so an old kernel or a
+   seccomp policy without io_uring degrades instead of breaking.  */
+static int
+io_uring_read_batch (struct stats_read_op_s *ops, size_t n)
+{
+  struct io_uring_params params = {};
+  void *sq_ptr = MAP_FAILED;
+  void *cq_ptr = MAP_FAILED;
+  void *sqes_ptr = MAP_FAILED;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  unsigned *sq_tail, *sq_mask, *sq_array, *cq_head, *cq_tail, *cq_mask;
+  size_t sq_len, cq_len, sqes_len;
+  unsigned entries = 8;
+  size_t done = 0;
+  cleanup_close int fd = -1;
+  int ret = -1;
+
+  while (entries < n && entries < 1024)
+    entries <<= 1;
+
+  fd = syscall (__NR_io_uring_setup, entries, &params);
+  if (fd < 0)
+    return -1;
+
+  sq_len = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+  cq_len = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      sq_len = cq_len = MAX (sq_len, cq_len);
+      sq_ptr = mmap (NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+      cq_ptr = sq_ptr;
+    }
+  else
+    {
+      sq_ptr = mmap (NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+      cq_ptr = mmap (NULL, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+  sqes_len = params.sq_entries * sizeof (struct io_uring_sqe);
+  sqes_ptr = mmap (NULL, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes_ptr == MAP_FAILED)
+    goto exit;
+
+  sq_tail = (unsigned *) ((char *) sq_ptr + params.sq_off.tail);
+  sq_mask = (unsigned *) ((char *) sq_ptr + params.sq_off.ring_mask);
+  sq_array = (unsigned *) ((char *) sq_ptr + params.sq_off.array);
+  cq_head = (unsigned *) ((char *) cq_ptr + params.cq_off.head);
+  cq_tail = (unsigned *) ((char *) cq_ptr + params.cq_off.tail);
+  cq_mask = (unsigned *) ((char *) cq_ptr + params.cq_off.ring_mask);
+  sqes = sqes_ptr;
+  cqes = (struct io_uring_cqe *) ((char *) cq_ptr + params.cq_off.cqes);
+
+  while (done < n)
+    {
+      size_t batch = MIN (n - done, (size_t) params.sq_entries);
+      size_t i;
+      int r;
+
+      for (i = 0; i < batch; i++)
+        {
+          unsigned idx = (*sq_tail + i) & *sq_mask;
+          struct io_uring_sqe *sqe = &sqes[idx];
+
+          memset (sqe, 0, sizeof (*sqe));
+          sqe->opcode = IORING_OP_READ;
+          sqe->fd = ops[done + i].fd;
+          sqe->addr = (uint64_t) (uintptr_t) ops[done + i].buf;
+          sqe->len = STATS_BATCH_BUF_SIZE - 1;
+          sqe->user_data = done + i;
+          sq_array[idx] = idx;
+        }
+      __atomic_store_n (sq_tail, *sq_tail + batch, __ATOMIC_RELEASE);
+
+      r = syscall (__NR_io_uring_enter, fd, batch, batch, IORING_ENTER_GETEVENTS, NULL, 0);
+      if (r < 0)
+        goto exit;
+
+      while (*cq_head != __atomic_load_n (cq_tail, __ATOMIC_ACQUIRE))
+        {
+          struct io_uring_cqe *cqe = &cqes[*cq_head & *cq_mask];
+
+          if (cqe->user_data < n)
+            ops[cqe->user_data].res = cqe->res;
+          __atomic_store_n (cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+        }
+
+      done += batch;
+    }
+
+  ret = 0;
+
+exit:
+  if (sqes_ptr != MAP_FAILED)
+    munmap (sqes_ptr, sqes_len);
+  if (sq_ptr != MAP_FAILED)
+    munmap (sq_ptr, sq_len);
+  if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+    munmap (cq_ptr, cq_len);
+  return ret;
+}
+#endif
+
+int
+libcrun_cgroup_read_stats_batch (struct libcrun_cgroup_stats_batch_item_s *items, size_t n,
+                                 libcrun_error_t *err)
+{
+  static const char *stat_files[STATS_FILES_PER_ITEM] = { "cpu.stat", "memory.stat", "io.stat", "pids.current" };
+  cleanup_free struct stats_read_op_s *ops = NULL;
+  cleanup_free char *buffers = NULL;
+  size_t i, j;
+  int cgroup_mode;
+  int root_dirfd;
+
+  cgroup_mode = libcrun_get_cgroup_mode (err);
+  if (UNLIKELY (cgroup_mode < 0))
+    return cgroup_mode;
+
+  if (cgroup_mode != CGROUP_MODE_UNIFIED)
+    return crun_make_error (err, ENOTSUP, "stats are supported only on cgroup v2");
+
+  root_dirfd = libcrun_get_cgroup_root_dirfd (err);
+  if (UNLIKELY (root_dirfd < 0))
+    return root_dirfd;
+
+  buffers = xmalloc (n * STATS_FILES_PER_ITEM * STATS_BATCH_BUF_SIZE);
+  ops = xmalloc0 (n * STATS_FILES_PER_ITEM * sizeof (*ops));
+
+  /* Build the whole fd set first, so the reads can go out as one batch.  */
+  for (i = 0; i < n; i++)
+    {
+      cleanup_close int dirfd = -1;
+      const char *rel_path;
+
+      memset (&items[i].stats, 0, sizeof (items[i].stats));
+      items[i].error = 0;
+
+      rel_path = consume_slashes (items[i].path);
+      dirfd = openat (root_dirfd, *rel_path ? rel_path : ".", O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+      if (dirfd < 0)
+        items[i].error = errno;
+
+      for (j = 0; j < STATS_FILES_PER_ITEM; j++)
+        {
+          struct stats_read_op_s *op = &ops[i * STATS_FILES_PER_ITEM + j];
+
+          /* Missing files mean the controller is not enabled.  */
+          op->fd = dirfd < 0 ? -1 : openat (dirfd, stat_files[j], O_RDONLY | O_CLOEXEC);
+          op->buf = buffers + (i * STATS_FILES_PER_ITEM + j) * STATS_BATCH_BUF_SIZE;
+          op->res = -1;
+        }
+    }
+
+#ifdef HAVE_LINUX_IO_URING_H
+  io_uring_read_batch (ops, n * STATS_FILES_PER_ITEM);
+#endif
+
+  for (i = 0; i < n * STATS_FILES_PER_ITEM; i++)
+    {
+      if (ops[i].res >= 0)
+        ops[i].buf[ops[i].res] = '\0';
+      else if (pread_stat_file (ops[i].fd, ops[i].buf, STATS_BATCH_BUF_SIZE) < 0)
+        ops[i].buf[0] = '\0';
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      struct stats_read_op_s *item_ops = &ops[i * STATS_FILES_PER_ITEM];
+
+      if (items[i].error == 0)
+        {
+          parse_cpu_stat_buf (item_ops[0].buf, &items[i].stats);
+          parse_memory_stat_buf (item_ops[1].buf, &items[i].stats);
+          parse_io_stat_buf (item_ops[2].buf, &items[i].stats);
+          items[i].stats.pids_current = (uint64_t) strtoull (item_ops[3].buf, NULL, 10);
+        }
+
+      for (j = 0; j < STATS_FILES_PER_ITEM; j++)
+        close_and_reset (&item_ops[j].fd);
+    }
+
+  return 0;
+}
+
 int
 libcrun_cgroup_killall (struct libcrun_cgroup_status *cgroup_status, int signal, libcrun_error_t *err)
 {
@@ -204,10 +659,52 @@ libcrun_cgroup_destroy (struct libcrun_cgroup_status *cgroup_status, libcrun_err
   return cgroup_manager->destroy_cgroup (cgroup_status, err);
 }
 
+int
+libcrun_cgroup_destroy_async (struct libcrun_cgroup_status *cgroup_status, libcrun_error_t *err)
+{
+  pid_t pid;
+  int ret;
+
+  pid = fork ();
+  if (UNLIKELY (pid < 0))
+    return crun_make_error (err, errno, "fork");
+  if (pid == 0)
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      /* Double fork so the worker is reparented to init and the caller does
+         not wait for the recursive removal.  */
+      if (fork () != 0)
+        _exit (EXIT_SUCCESS);
+
+      setsid ();
+
+      ret = libcrun_cgroup_destroy (cgroup_status, &tmp_err);
+      if (UNLIKELY (ret < 0))
+        crun_error_release (&tmp_err);
+      _exit (ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+  ret = waitpid_ignore_stopped (pid, NULL, 0);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "waitpid for cgroup destroy worker");
+
+  return 0;
+}
+
 int
 libcrun_update_cgroup_resources (struct libcrun_cgroup_status *cgroup_status,
                                  runtime_spec_schema_config_linux_resources *resources,
                                  libcrun_error_t *err)
+{
+  return libcrun_update_cgroup_resources_with_plan (cgroup_status, resources, NULL, err);
+}
+
+int
+libcrun_update_cgroup_resources_with_plan (struct libcrun_cgroup_status *cgroup_status,
+                                           runtime_spec_schema_config_linux_resources *resources,
+                                           const char *plan_file,
+                                           libcrun_error_t *err)
 {
   struct libcrun_cgroup_manager *cgroup_manager = NULL;
   int ret;
@@ -222,7 +719,7 @@ libcrun_update_cgroup_resources (struct libcrun_cgroup_status *cgroup_status,
       if (UNLIKELY (ret < 0))
         return ret;
     }
-  return update_cgroup_resources (cgroup_status->path, resources, err);
+  return update_cgroup_resources_with_plan (-1, cgroup_status->path, resources, plan_file, err);
 }
 
 static int
@@ -375,10 +872,22 @@ libcrun_cgroup_enter (struct libcrun_cgroup_args *args, struct libcrun_cgroup_st
 
       if (args->resources)
         {
-          ret = update_cgroup_resources (status->path, args->resources, err);
+          ret = update_cgroup_resources (args->cgroup_dirfd, status->path, args->resources, err);
           if (UNLIKELY (ret < 0))
             return ret;
         }
+
+      ret = write_io_annotations (args->cgroup_dirfd, status->path, args->annotations, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = write_cpuset_partition (args->cgroup_dirfd, status->path, args->annotations, args->resources, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = write_cpu_burst_annotation (args->cgroup_dirfd, status->path, args->annotations, args->resources, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
     }
   /* Reset the inherited cpu affinity. Old kernels do that automatically, but
      new kernels remember the affinity that was set before the cgroup move.
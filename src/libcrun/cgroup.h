@@ -56,6 +56,8 @@ struct libcrun_cgroup_args
   gid_t root_gid;
   const char *id;
   bool joined;
+  /* Already open dirfd for the container cgroup on cgroup v2, or -1.  */
+  int cgroup_dirfd;
 };
 
 /* cgroup life-cycle management.  */
@@ -63,6 +65,9 @@ int libcrun_cgroup_preenter (struct libcrun_cgroup_args *args, int *dirfd, libcr
 int libcrun_cgroup_enter (struct libcrun_cgroup_args *args, struct libcrun_cgroup_status **out, libcrun_error_t *err);
 int libcrun_cgroup_enter_finalize (struct libcrun_cgroup_args *args, struct libcrun_cgroup_status *cgroup_status, libcrun_error_t *err);
 int libcrun_cgroup_destroy (struct libcrun_cgroup_status *cgroup_status, libcrun_error_t *err);
+/* Like libcrun_cgroup_destroy, but the removal is performed by a detached
+   worker process so the caller does not serialize on the rmdir walk.  */
+int libcrun_cgroup_destroy_async (struct libcrun_cgroup_status *cgroup_status, libcrun_error_t *err);
 
 /* Handle the cgroup status.  */
 int libcrun_cgroup_get_status (struct libcrun_cgroup_status *cgroup_status, libcrun_container_status_t *status,
@@ -88,12 +93,78 @@ int libcrun_cgroup_has_oom (struct libcrun_cgroup_status *status, libcrun_error_
 
 int libcrun_cgroup_read_pids (struct libcrun_cgroup_status *status, bool recurse, pid_t **pids, libcrun_error_t *err);
 
+/* Resource usage counters filled by libcrun_cgroup_read_stats.  Counters
+   whose controller is not enabled are left to zero.  */
+struct libcrun_cgroup_stats_s
+{
+  uint64_t cpu_usage_usec;
+  uint64_t cpu_user_usec;
+  uint64_t cpu_system_usec;
+
+  uint64_t memory_anon;
+  uint64_t memory_file;
+  uint64_t memory_kernel_stack;
+  uint64_t memory_pgfault;
+  uint64_t memory_pgmajfault;
+
+  uint64_t io_rbytes;
+  uint64_t io_wbytes;
+  uint64_t io_rios;
+  uint64_t io_wios;
+
+  uint64_t pids_current;
+};
+
+int libcrun_cgroup_read_stats (struct libcrun_cgroup_status *status, struct libcrun_cgroup_stats_s *stats,
+                               libcrun_error_t *err);
+
+/* One container sampled by libcrun_cgroup_read_stats_batch.  */
+struct libcrun_cgroup_stats_batch_item_s
+{
+  /* Input: the cgroup path of the container.  */
+  const char *path;
+  /* Outputs.  ERROR is an errno-style error for this item only: a container
+     disappearing mid-sample does not fail the whole batch.  */
+  struct libcrun_cgroup_stats_s stats;
+  int error;
+};
+
+/* Sample all the ITEMS in one pass: the stat files of every container are
+   opened first, then read with a single io_uring submission when available
+   so that a full node sample costs one syscall batch.  */
+int libcrun_cgroup_read_stats_batch (struct libcrun_cgroup_stats_batch_item_s *items, size_t n,
+                                     libcrun_error_t *err);
+
 int libcrun_update_cgroup_resources (struct libcrun_cgroup_status *status,
                                      runtime_spec_schema_config_linux_resources *resources,
                                      libcrun_error_t *err);
 
+/* Like libcrun_update_cgroup_resources, but diff the writes against the plan
+   persisted in PLAN_FILE by the previous update, so that unchanged values do
+   not touch the cgroup filesystem.  */
+int libcrun_update_cgroup_resources_with_plan (struct libcrun_cgroup_status *status,
+                                               runtime_spec_schema_config_linux_resources *resources,
+                                               const char *plan_file,
+                                               libcrun_error_t *err);
+
+/* Write VALUE to memory.reclaim, asking the kernel to proactively reclaim
+   that many bytes from the cgroup.  Only supported with cgroup v2; a partial
+   reclaim fails with EAGAIN.  */
+int libcrun_cgroup_reclaim_memory (struct libcrun_cgroup_status *status, const char *value, libcrun_error_t *err);
+
 int libcrun_cgroup_is_container_paused (struct libcrun_cgroup_status *status, bool *paused, libcrun_error_t *err);
 
+/* Apply the process ioPriority class to the cgroup via io.prio.class, so
+   it is inherited by every process that joins the cgroup later.  */
+int libcrun_cgroup_set_io_priority (struct libcrun_cgroup_status *status,
+                                    runtime_spec_schema_config_schema_process *process, libcrun_error_t *err);
+
 int libcrun_cgroup_pause_unpause (struct libcrun_cgroup_status *status, const bool pause, libcrun_error_t *err);
 
+/* Freeze or thaw a batch of cgroups: all the freeze files are written
+   first, then completion is awaited on every cgroup.events file with a
+   single poll set.  */
+int libcrun_cgroup_batch_pause_unpause_paths (const char *const *paths, size_t n_paths, const bool pause,
+                                              libcrun_error_t *err);
+
 #endif
@@ -57,6 +57,10 @@
 #include <sys/mount.h>
 #include <sys/sendfile.h>
 #include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
 
 #include "utils.h"
 
@@ -452,6 +456,185 @@ static ssize_t fd_to_fd(int outfd, int infd)
 	return total;
 }
 
+/*
+ * Reusing the sealed memfd across invocations: the first invocation that has
+ * to copy the binary forks a small holder process that keeps the sealed
+ * memfd open and hands out duplicates over a unix socket in
+ * XDG_RUNTIME_DIR, so later invocations pay one connect+recvmsg instead of
+ * a multi-MB copy. The received fd is only trusted after checking that the
+ * peer runs with our own uid, that the memfd is fully sealed, and that its
+ * size matches the current binary (a mismatch after an update invalidates
+ * the cache). The holder exits after being idle, so it never outlives a
+ * burst of container creations by much.
+ */
+#define EXECFD_SOCK_NAME "crun-execfd.sock"
+#define EXECFD_HOLDER_IDLE_MS (30 * 1000)
+
+static int execfd_sock_path(char *buf, size_t len)
+{
+	char *dir = getenv("XDG_RUNTIME_DIR");
+
+	/* Without a per-user runtime directory there is no path that is safe
+	 * to share the fd through. */
+	if (!dir || *dir != '/')
+		return -1;
+	if ((size_t) snprintf(buf, len, "%s/" EXECFD_SOCK_NAME, dir) >= len)
+		return -1;
+	return 0;
+}
+
+static int try_recv_execfd(void)
+{
+	char path[PATH_MAX] = {0};
+	struct sockaddr_un addr = {};
+	struct ucred cred = {};
+	socklen_t cred_len = sizeof(cred);
+	struct timeval tv = { .tv_sec = 1 };
+	struct stat exebuf = {}, fdbuf = {};
+	cleanup_close int sockfd = -1;
+	int execfd = -1, seals;
+	struct msghdr msg = {};
+	struct cmsghdr *cmsg;
+	char cmsgbuf[CMSG_SPACE(sizeof(int))] = {0};
+	struct iovec iov;
+	char dummy;
+
+	if (execfd_sock_path(path, sizeof(path)) < 0)
+		return -1;
+
+	sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (sockfd < 0)
+		return -1;
+
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if (connect(sockfd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+		return -1;
+
+	/* Never trust an fd served by another user. */
+	if (getsockopt(sockfd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0)
+		return -1;
+	if (cred.uid != geteuid())
+		return -1;
+
+	setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	iov.iov_base = &dummy;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf;
+	msg.msg_controllen = sizeof(cmsgbuf);
+
+	if (recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC) < 0)
+		return -1;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(int)))
+		return -1;
+	memcpy(&execfd, CMSG_DATA(cmsg), sizeof(int));
+
+	/* The fd is only usable if it is a fully sealed memfd holding a copy
+	 * of the binary we are running now. */
+	seals = fcntl(execfd, F_GET_SEALS);
+	if (seals != CRUN_MEMFD_SEALS)
+		goto invalid;
+	if (stat("/proc/self/exe", &exebuf) < 0 || fstat(execfd, &fdbuf) < 0)
+		goto invalid;
+	if (exebuf.st_size != fdbuf.st_size)
+		goto invalid;
+
+	return execfd;
+
+invalid:
+	/* Stale holder (e.g. the binary was updated): drop the socket so the
+	 * next copy respawns a fresh one. */
+	close(execfd);
+	unlink(path);
+	return -1;
+}
+
+static void execfd_holder_main(int srvfd, int execfd)
+{
+	for (;;) {
+		struct pollfd pfd = { .fd = srvfd, .events = POLLIN };
+		struct msghdr msg = {};
+		struct cmsghdr *cmsg;
+		char cmsgbuf[CMSG_SPACE(sizeof(int))] = {0};
+		struct iovec iov;
+		char dummy = '\0';
+		int connfd, n;
+
+		n = poll(&pfd, 1, EXECFD_HOLDER_IDLE_MS);
+		if (n <= 0)
+			_exit(0);
+
+		connfd = accept(srvfd, NULL, NULL);
+		if (connfd < 0)
+			continue;
+
+		iov.iov_base = &dummy;
+		iov.iov_len = 1;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgbuf;
+		msg.msg_controllen = sizeof(cmsgbuf);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &execfd, sizeof(int));
+
+		sendmsg(connfd, &msg, MSG_NOSIGNAL);
+		close(connfd);
+	}
+}
+
+static void spawn_execfd_holder(int execfd)
+{
+	char path[PATH_MAX] = {0};
+	struct sockaddr_un addr = {};
+	mode_t mask;
+	int srvfd = -1;
+	pid_t pid;
+
+	if (execfd_sock_path(path, sizeof(path)) < 0)
+		return;
+
+	pid = fork();
+	if (pid < 0)
+		return;
+	if (pid > 0) {
+		/* The holder double-forks, reap the intermediate child. */
+		waitpid(pid, NULL, 0);
+		return;
+	}
+
+	if (fork() != 0)
+		_exit(0);
+	setsid();
+
+	srvfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (srvfd < 0)
+		_exit(1);
+
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	unlink(path);
+	mask = umask(0077);
+	if (bind(srvfd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		umask(mask);
+		_exit(1);
+	}
+	umask(mask);
+	if (listen(srvfd, 16) < 0)
+		_exit(1);
+
+	execfd_holder_main(srvfd, execfd);
+	_exit(0);
+}
+
 static int clone_binary(void)
 {
 	cleanup_close int binfd = -1;
@@ -460,6 +643,17 @@ static int clone_binary(void)
 	ssize_t sent = 0;
 	int fdtype = EFD_NONE;
 
+	/*
+	 * Cheapest option first: a previous invocation may have parked the
+	 * sealed memfd in a holder process.
+	 */
+	execfd = try_recv_execfd();
+	if (execfd >= 0) {
+		int ret_execfd = execfd;
+		execfd = -1;
+		return ret_execfd;
+	}
+
 	/*
 	 * Before we resort to copying, let's try creating an ro-binfd in one shot
 	 * by getting a handle for a read-only bind-mount of the execfd.
@@ -504,6 +698,13 @@ static int clone_binary(void)
 	if (seal_execfd(&execfd, fdtype) < 0)
 		goto error;
 
+	/*
+	 * Once sealed, the memfd is immutable and safe to share: park it in a
+	 * holder process so the next invocations skip the copy entirely.
+	 */
+	if (fdtype == EFD_MEMFD)
+		spawn_execfd_holder(execfd);
+
 	{
 		/* Transfer ownership to caller */
 		int ret_execfd = execfd;
@@ -22,9 +22,12 @@
 #include <stdbool.h>
 #include "container.h"
 #include "utils.h"
+#include "json-scan.h"
+#include "ns-pool.h"
+#include "bundle-cache.h"
 #include "seccomp.h"
 #ifdef HAVE_SECCOMP
-#  include <seccomp.h>
+#  include "dl-seccomp.h"
 #endif
 #include "scheduler.h"
 #include "seccomp_notify.h"
@@ -43,12 +46,19 @@
 #include "linux.h"
 #include "terminal.h"
 #include "io_priority.h"
+#include "mempolicy.h"
+#include "profile.h"
 #include "cgroup.h"
 #include "cgroup-utils.h"
+#include "criu.h"
+#include "intelrdt.h"
 #include <sys/prctl.h>
+#include <sys/mman.h>
 #include <sys/signalfd.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
 #ifdef HAVE_CAP
 #  include <sys/capability.h>
 #endif
@@ -58,7 +68,7 @@
 #include <git-version.h>
 
 #ifdef HAVE_SYSTEMD
-#  include <systemd/sd-daemon.h>
+#  include "dl-systemd.h"
 #endif
 
 #include <yajl/yajl_tree.h>
@@ -71,6 +81,7 @@ enum
   SYNC_SOCKET_SYNC_MESSAGE,
   SYNC_SOCKET_ERROR_MESSAGE,
   SYNC_SOCKET_WARNING_MESSAGE,
+  SYNC_SOCKET_TRACE_MESSAGE,
 };
 
 struct container_entrypoint_s
@@ -87,6 +98,11 @@ struct container_entrypoint_s
   int seccomp_receiver_fd;
   int console_socket_fd;
 
+  /* Console socket handshake queued by queue_console_socket_send when the
+     receiver is slow, completed right before exec.  */
+  int pending_console_socket;
+  int pending_terminal_fd;
+
   int hooks_out_fd;
   int hooks_err_fd;
 
@@ -395,6 +411,36 @@ sync_socket_write_error (int fd, libcrun_error_t *out_err)
   return sync_socket_write_msg (fd, false, (*out_err)->status, (*out_err)->msg);
 }
 
+/* Mark a startup phase in the init process.  When the trace log backend is
+   enabled the mark is forwarded to the parent over the sync socket together
+   with its CLOCK_MONOTONIC timestamp, so both timelines end up in the same
+   trace file.  */
+static void
+child_startup_mark (int sync_socket, const char *phase)
+{
+  struct sync_socket_message_s msg;
+  struct timespec ts;
+  int ret, len;
+
+  crun_startup_probe (phase);
+
+  if (! libcrun_profile_trace_enabled () || sync_socket < 0)
+    return;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  len = snprintf (msg.message, sizeof (msg.message), "%s %lld %ld", phase, (long long) ts.tv_sec, ts.tv_nsec);
+  if (len < 0 || len >= (int) sizeof (msg.message))
+    return;
+
+  msg.type = SYNC_SOCKET_TRACE_MESSAGE;
+  msg.error_value = getpid ();
+
+  /* Best effort, an error is reported when the next sync message fails.  */
+  ret = TEMP_FAILURE_RETRY (write (sync_socket, &msg, SYNC_SOCKET_MESSAGE_LEN (msg, len + 1)));
+  (void) ret;
+}
+
 static void
 log_write_to_sync_socket (int errno_, const char *msg, bool warning, void *arg)
 {
@@ -480,6 +526,24 @@ sync_socket_wait_sync (libcrun_context_t *context, int fd, bool flush, libcrun_e
             context->output_handler (msg.error_value, msg.message, 1, context->output_handler_arg);
           continue;
         }
+      if (msg.type == SYNC_SOCKET_TRACE_MESSAGE)
+        {
+          char *sep = strchr (msg.message, ' ');
+          long long sec;
+          long nsec;
+
+          if (sep)
+            {
+              *sep = '\0';
+              if (sscanf (sep + 1, "%lld %ld", &sec, &nsec) == 2)
+                {
+                  struct timespec ts = { .tv_sec = sec, .tv_nsec = nsec };
+
+                  profile_startup_mark_child (msg.error_value, msg.message, &ts);
+                }
+            }
+          continue;
+        }
       if (msg.type == SYNC_SOCKET_ERROR_MESSAGE)
         return crun_make_error (err, msg.error_value, "%s", msg.message);
     }
@@ -514,6 +578,36 @@ sync_socket_send_sync (int fd, bool flush_errors, libcrun_error_t *err)
   return 0;
 }
 
+/* Send the container PID and the first synchronization point as one packet:
+   the PID arriving is itself the signal that the parent side is ready, so a
+   separate sync message would only cost the child another wakeup.  */
+static int
+sync_socket_send_pid_sync (int fd, pid_t pid, libcrun_error_t *err)
+{
+  int ret;
+  struct sync_socket_message_s msg = {
+    0,
+  };
+  msg.type = SYNC_SOCKET_SYNC_MESSAGE;
+  msg.error_value = pid;
+
+  if (fd < 0)
+    return 0;
+
+  ret = TEMP_FAILURE_RETRY (write (fd, &msg, SYNC_SOCKET_MESSAGE_LEN (msg, 0)));
+  if (UNLIKELY (ret < 0))
+    {
+      int saved_errno = errno;
+      ret = TEMP_FAILURE_RETRY (read (fd, &msg, sizeof (msg)));
+      if (ret >= 0 && msg.type == SYNC_SOCKET_ERROR_MESSAGE)
+        return crun_make_error (err, msg.error_value, "%s", msg.message);
+      errno = saved_errno;
+      return crun_make_error (err, errno, "write to sync socket");
+    }
+
+  return 0;
+}
+
 static libcrun_container_t *
 make_container (runtime_spec_schema_config_schema *container_def, const char *path, const char *config)
 {
@@ -524,19 +618,41 @@ make_container (runtime_spec_schema_config_schema *container_def, const char *pa
   container->host_gid = getegid ();
 
   if (path)
-    container->config_file = xstrdup (path);
+    container->config_file = libcrun_arena_strdup (&container->arena, path);
   if (config)
-    container->config_file_content = xstrdup (config);
+    container->config_file_content = libcrun_arena_strdup (&container->arena, config);
+
+  libcrun_precompute_caps (container);
 
   return container;
 }
 
+/* Parse the configuration through the vectorized scanner and hand the tree
+   to the libocispec generated converter, leaving the schema code untouched.
+   Input the scanner rejects goes through the stock parser, which also
+   produces the error message.  */
+static runtime_spec_schema_config_schema *
+parse_spec_data (const char *json, size_t len, char **oci_error)
+{
+  struct parser_context ctx = { 0, stderr };
+  runtime_spec_schema_config_schema *def;
+  yajl_val tree;
+
+  tree = libcrun_json_parse_tree (json, len);
+  if (tree == NULL)
+    return runtime_spec_schema_config_schema_parse_data (json, NULL, oci_error);
+
+  def = make_runtime_spec_schema_config_schema (tree, &ctx, oci_error);
+  yajl_tree_free (tree);
+  return def;
+}
+
 libcrun_container_t *
 libcrun_container_load_from_memory (const char *json, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *container_def;
   cleanup_free char *oci_error = NULL;
-  container_def = runtime_spec_schema_config_schema_parse_data (json, NULL, &oci_error);
+  container_def = parse_spec_data (json, strlen (json), &oci_error);
   if (container_def == NULL)
     {
       crun_make_error (err, 0, "load: `%s`", oci_error);
@@ -545,12 +661,57 @@ libcrun_container_load_from_memory (const char *json, libcrun_error_t *err)
   return make_container (container_def, NULL, json);
 }
 
+/* Try to parse the config directly from a private file mapping, so that the
+   JSON payload is never copied into an intermediate heap buffer.  The parser
+   requires a NUL terminated string, so this path is usable only when the file
+   size is not a multiple of the page size, in which case the kernel guarantees
+   the trailing bytes of the last page are zero.  Return 1 if the caller must
+   fall back to the read based loader.  */
+static int
+load_spec_mmap (const char *path, runtime_spec_schema_config_schema **out, char **oci_error)
+{
+  cleanup_close int fd = -1;
+  struct stat st;
+  long pagesize;
+  void *addr;
+  int ret;
+
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (UNLIKELY (fd < 0))
+    return 1;
+
+  ret = fstat (fd, &st);
+  if (UNLIKELY (ret < 0))
+    return 1;
+
+  pagesize = sysconf (_SC_PAGESIZE);
+  if (st.st_size == 0 || pagesize <= 0 || (st.st_size % pagesize) == 0)
+    return 1;
+
+  addr = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED)
+    return 1;
+
+  /* The parser walks the buffer exactly once from the beginning.  */
+  madvise (addr, st.st_size, MADV_SEQUENTIAL);
+  madvise (addr, st.st_size, MADV_WILLNEED);
+
+  *out = parse_spec_data (addr, st.st_size, oci_error);
+
+  munmap (addr, st.st_size);
+  return 0;
+}
+
 libcrun_container_t *
 libcrun_container_load_from_file (const char *path, libcrun_error_t *err)
 {
-  runtime_spec_schema_config_schema *container_def;
+  runtime_spec_schema_config_schema *container_def = NULL;
   cleanup_free char *oci_error = NULL;
-  container_def = runtime_spec_schema_config_schema_parse_file (path, NULL, &oci_error);
+  int ret;
+
+  ret = load_spec_mmap (path, &container_def, &oci_error);
+  if (ret > 0)
+    container_def = runtime_spec_schema_config_schema_parse_file (path, NULL, &oci_error);
   if (container_def == NULL)
     {
       crun_make_error (err, 0, "load `%s`: %s", path, oci_error);
@@ -571,8 +732,7 @@ libcrun_container_free (libcrun_container_t *ctr)
   if (ctr->container_def)
     free_runtime_spec_schema_config_schema (ctr->container_def);
 
-  free (ctr->config_file_content);
-  free (ctr->config_file);
+  libcrun_arena_free (&ctr->arena);
   free (ctr);
 }
 
@@ -639,22 +799,307 @@ initialize_security (runtime_spec_schema_config_schema_process *proc, libcrun_er
   return 0;
 }
 
+/* Milliseconds left before DEADLINE, clamped to zero once it passed, or -1
+   when no deadline is set.  */
 static int
-do_hooks (runtime_spec_schema_config_schema *def, pid_t pid, const char *id, bool keep_going, const char *cwd,
-          const char *status, hook **hooks, size_t hooks_len, int out_fd, int err_fd, libcrun_error_t *err)
+deadline_remaining_ms (const struct timespec *deadline)
 {
-  size_t i, stdin_len;
-  int r, ret;
+  struct timespec now;
+  long long ms;
+
+  if (deadline->tv_sec == 0 && deadline->tv_nsec == 0)
+    return -1;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  ms = (deadline->tv_sec - now.tv_sec) * 1000LL + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+  if (ms <= 0)
+    return 0;
+  if (ms > INT_MAX)
+    return INT_MAX;
+  return ms;
+}
+
+/* Hand the state JSON to a long-lived hook executor instead of paying
+   fork+exec+runtime-init of the hook binary for every container.  The
+   protocol is a single request per connection: crun connects to the unix
+   socket configured as the hook path, writes the state JSON, shuts down
+   the write side, then reads back the decimal exit status of the hook
+   logic.  The whole exchange is non-blocking against one deadline derived
+   from the hook timeout, so a hung executor cannot stall container start
+   in connect or write either.  */
+static int
+run_hook_via_server (const char *path, int timeout, const char *stdin, size_t stdin_len, libcrun_error_t *err)
+{
+  struct timespec deadline = {};
+  struct sockaddr_un addr = {};
+  cleanup_close int fd = -1;
+  char response[32];
+  size_t written = 0;
+  long exit_status;
+  char *endptr;
+  ssize_t ret;
+
+  if (strlen (path) >= sizeof (addr.sun_path))
+    return crun_make_error (err, ENAMETOOLONG, "hook server socket path `%s`", path);
+
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, path);
+
+  if (timeout > 0)
+    {
+      clock_gettime (CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += timeout;
+    }
+
+  fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (UNLIKELY (fd < 0))
+    return crun_make_error (err, errno, "create socket for the hook server `%s`", path);
+
+  for (;;)
+    {
+      ret = connect (fd, (struct sockaddr *) &addr, sizeof (addr));
+      if (ret == 0)
+        break;
+      if (errno == EINTR)
+        continue;
+      if (errno == EINPROGRESS)
+        {
+          struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+          socklen_t so_len = sizeof (int);
+          int so_error = 0;
+
+          ret = TEMP_FAILURE_RETRY (poll (&pfd, 1, deadline_remaining_ms (&deadline)));
+          if (UNLIKELY (ret < 0))
+            return crun_make_error (err, errno, "poll the hook server `%s`", path);
+          if (ret == 0)
+            return crun_make_error (err, 0, "timeout connecting to the hook server `%s`", path);
+
+          ret = getsockopt (fd, SOL_SOCKET, SO_ERROR, &so_error, &so_len);
+          if (UNLIKELY (ret < 0))
+            return crun_make_error (err, errno, "getsockopt `SO_ERROR` for the hook server `%s`", path);
+          if (so_error != 0)
+            return crun_make_error (err, so_error, "connect to the hook server `%s`", path);
+          break;
+        }
+      if (errno == EAGAIN)
+        {
+          /* A unix socket reports EAGAIN instead of EINPROGRESS when the
+             listener backlog is full; retry until the deadline.  */
+          struct timespec wait = { 0, 10 * 1000 * 1000 };
+
+          if (deadline_remaining_ms (&deadline) == 0)
+            return crun_make_error (err, 0, "timeout connecting to the hook server `%s`", path);
+          nanosleep (&wait, NULL);
+          continue;
+        }
+      return crun_make_error (err, errno, "connect to the hook server `%s`", path);
+    }
+
+  while (written < stdin_len)
+    {
+      ret = write (fd, stdin + written, stdin_len - written);
+      if (ret < 0 && errno == EINTR)
+        continue;
+      if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+          struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+
+          ret = TEMP_FAILURE_RETRY (poll (&pfd, 1, deadline_remaining_ms (&deadline)));
+          if (UNLIKELY (ret < 0))
+            return crun_make_error (err, errno, "poll the hook server `%s`", path);
+          if (ret == 0)
+            return crun_make_error (err, 0, "timeout writing to the hook server `%s`", path);
+          continue;
+        }
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "write the state to the hook server `%s`", path);
+      written += ret;
+    }
+
+  ret = shutdown (fd, SHUT_WR);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "shutdown the socket to the hook server `%s`", path);
+
+  {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    ret = TEMP_FAILURE_RETRY (poll (&pfd, 1, deadline_remaining_ms (&deadline)));
+    if (UNLIKELY (ret < 0))
+      return crun_make_error (err, errno, "poll the hook server `%s`", path);
+    if (ret == 0)
+      return crun_make_error (err, 0, "timeout waiting for the hook server `%s`", path);
+  }
+
+  ret = TEMP_FAILURE_RETRY (read (fd, response, sizeof (response) - 1));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "read the status from the hook server `%s`", path);
+  if (ret == 0)
+    return crun_make_error (err, 0, "the hook server `%s` closed the connection without a status", path);
+  response[ret] = '\0';
+
+  errno = 0;
+  exit_status = strtol (response, &endptr, 10);
+  if (errno != 0 || endptr == response || exit_status < 0 || exit_status > 255)
+    return crun_make_error (err, 0, "invalid status `%s` from the hook server `%s`", response, path);
+
+  return exit_status;
+}
+
+/* Run a single hook.  A hook whose path is a unix socket is handled by the
+   executor listening there, everything else is executed as before.  */
+static int
+run_one_hook (hook *hook, const char *cwd, char *stdin, size_t stdin_len, int out_fd, int err_fd,
+              libcrun_error_t *err)
+{
+  char **env = environ;
+  struct stat st;
+
+  if (stat (hook->path, &st) == 0 && S_ISSOCK (st.st_mode))
+    return run_hook_via_server (hook->path, hook->timeout, stdin, stdin_len, err);
+
+  if (hook->env)
+    env = hook->env;
+
+  return run_process_with_stdin_timeout_envp (hook->path, hook->args, cwd, hook->timeout, env, stdin, stdin_len,
+                                              out_fd, err_fd, err);
+}
+
+/* Run the hooks of one stage with bounded concurrency.  Hooks are started in
+   their configured order in batches sized to the number of online CPUs, and
+   every batch is fully reaped before the next one starts.  Each hook keeps its
+   own timeout handling by running through run_process_with_stdin_timeout_envp
+   in a forked runner, and the children share the already generated state JSON.  */
+static int
+do_hooks_parallel (hook **hooks, size_t hooks_len, const char *cwd, bool keep_going, char *stdin,
+                   size_t stdin_len, int out_fd, int err_fd, libcrun_error_t *err)
+{
+  cleanup_free pid_t *pids = xmalloc0 (hooks_len * sizeof (pid_t));
+  size_t batch_start, max_jobs;
+  long n_online;
+  int ret = 0;
+
+  n_online = sysconf (_SC_NPROCESSORS_ONLN);
+  max_jobs = n_online > 0 ? (size_t) n_online : 1;
+  if (max_jobs > 8)
+    max_jobs = 8;
+
+  for (batch_start = 0; batch_start < hooks_len; batch_start += max_jobs)
+    {
+      size_t batch_end = batch_start + max_jobs;
+      size_t i;
+
+      if (batch_end > hooks_len)
+        batch_end = hooks_len;
+
+      for (i = batch_start; i < batch_end; i++)
+        {
+          pid_t hook_pid = fork ();
+
+          if (UNLIKELY (hook_pid < 0))
+            {
+              crun_make_error (err, errno, "fork hook process");
+              batch_end = i;
+              ret = -1;
+              break;
+            }
+          if (hook_pid == 0)
+            {
+              libcrun_error_t tmp_err = NULL;
+              int r;
+
+              r = run_one_hook (hooks[i], cwd, stdin, stdin_len, out_fd, err_fd, &tmp_err);
+              if (r < 0)
+                {
+                  if (tmp_err)
+                    {
+                      libcrun_error (0, "%s", tmp_err->msg);
+                      crun_error_release (&tmp_err);
+                    }
+                  _exit (127);
+                }
+              _exit (r & 0xff);
+            }
+          pids[i] = hook_pid;
+        }
+
+      for (i = batch_start; i < batch_end; i++)
+        {
+          int hook_status = 0;
+          int r;
+
+          r = waitpid_ignore_stopped (pids[i], &hook_status, 0);
+          if (UNLIKELY (r < 0))
+            {
+              if (ret == 0)
+                ret = crun_make_error (err, errno, "waitpid for hook `%s`", hooks[i]->path);
+              continue;
+            }
+
+          hook_status = get_process_exit_status (hook_status);
+          if (hook_status != 0)
+            {
+              if (keep_going)
+                libcrun_warning ("error executing hook `%s` (exit code: %d)", hooks[i]->path, hook_status);
+              else if (ret == 0)
+                {
+                  libcrun_error (0, "error executing hook `%s` (exit code: %d)", hooks[i]->path, hook_status);
+                  ret = hook_status;
+                }
+            }
+        }
+
+      /* Do not start the next batch after a fatal error.  */
+      if (ret != 0 && ! keep_going)
+        break;
+    }
+
+  return ret;
+}
+
+/* Sentinel written in place of the status value so that the surrounding
+   document can be cached and reused across hook stages.  */
+#define HOOKS_STATE_STATUS_SENTINEL "@CRUN-STATUS@"
+
+/* The state document sent to the hooks changes only in its `status` field
+   between the stages of one container start, but generating it costs a whole
+   yajl tree build.  Cache the parts surrounding the status value and stitch
+   the current status in with a couple of memcpy calls.  */
+static struct hooks_state_cache_s
+{
+  pid_t pid;
+  char *id;
+  char *cwd;
+  char *prefix;
+  size_t prefix_len;
+  char *suffix;
+  size_t suffix_len;
+} hooks_state_cache;
+
+static int
+generate_hooks_state (runtime_spec_schema_config_schema *def, pid_t pid, const char *id, const char *cwd,
+                      const char *status, char **out, size_t *out_len, libcrun_error_t *err)
+{
+  size_t i, stdin_len, status_len;
+  int r;
   char *stdin = NULL;
-  cleanup_free char *cwd_allocated = NULL;
+  char *sentinel;
   const char *rootfs = def->root ? def->root->path : "";
   yajl_gen gen = NULL;
 
-  if (cwd == NULL)
+  status_len = strlen (status);
+
+  if (hooks_state_cache.id != NULL && hooks_state_cache.pid == pid
+      && strcmp (hooks_state_cache.id, id) == 0 && strcmp (hooks_state_cache.cwd, cwd) == 0)
     {
-      cwd = cwd_allocated = getcwd (NULL, 0);
-      if (cwd == NULL)
-        OOM ();
+    from_cache:
+      *out_len = hooks_state_cache.prefix_len + status_len + hooks_state_cache.suffix_len;
+      *out = xmalloc (*out_len + 1);
+      memcpy (*out, hooks_state_cache.prefix, hooks_state_cache.prefix_len);
+      memcpy (*out + hooks_state_cache.prefix_len, status, status_len);
+      memcpy (*out + hooks_state_cache.prefix_len + status_len, hooks_state_cache.suffix,
+              hooks_state_cache.suffix_len);
+      (*out)[*out_len] = '\0';
+      return 0;
     }
 
   gen = yajl_gen_alloc (NULL);
@@ -709,7 +1154,7 @@ do_hooks (runtime_spec_schema_config_schema *def, pid_t pid, const char *id, boo
   if (UNLIKELY (r != yajl_gen_status_ok))
     goto yajl_error;
 
-  r = yajl_gen_string (gen, YAJL_STR (status), strlen (status));
+  r = yajl_gen_string (gen, YAJL_STR (HOOKS_STATE_STATUS_SENTINEL), strlen (HOOKS_STATE_STATUS_SENTINEL));
   if (UNLIKELY (r != yajl_gen_status_ok))
     goto yajl_error;
 
@@ -749,33 +1194,37 @@ do_hooks (runtime_spec_schema_config_schema *def, pid_t pid, const char *id, boo
   if (UNLIKELY (r != yajl_gen_status_ok))
     goto yajl_error;
 
-  ret = 0;
-
-  for (i = 0; i < hooks_len; i++)
+  sentinel = memmem (stdin, stdin_len, "\"" HOOKS_STATE_STATUS_SENTINEL "\"",
+                     strlen (HOOKS_STATE_STATUS_SENTINEL) + 2);
+  if (UNLIKELY (sentinel == NULL))
     {
-      char **env = environ;
+      yajl_gen_free (gen);
+      return crun_make_error (err, 0, "internal error: cannot find the status in the state document");
+    }
 
-      if (hooks[i]->env)
-        env = hooks[i]->env;
+  free (hooks_state_cache.id);
+  free (hooks_state_cache.cwd);
+  free (hooks_state_cache.prefix);
+  free (hooks_state_cache.suffix);
 
-      ret = run_process_with_stdin_timeout_envp (hooks[i]->path, hooks[i]->args, cwd, hooks[i]->timeout, env,
-                                                 stdin, stdin_len, out_fd, err_fd, err);
-      if (UNLIKELY (ret != 0))
-        {
-          if (keep_going)
-            libcrun_warning ("error executing hook `%s` (exit code: %d)", hooks[i]->path, ret);
-          else
-            {
-              libcrun_error (0, "error executing hook `%s` (exit code: %d)", hooks[i]->path, ret);
-              break;
-            }
-        }
-    }
+  hooks_state_cache.pid = pid;
+  hooks_state_cache.id = xstrdup (id);
+  hooks_state_cache.cwd = xstrdup (cwd);
 
-  if (gen)
-    yajl_gen_free (gen);
+  /* The opening quote belongs to the prefix, the closing one to the suffix.  */
+  hooks_state_cache.prefix_len = sentinel - stdin + 1;
+  hooks_state_cache.prefix = xmalloc (hooks_state_cache.prefix_len);
+  memcpy (hooks_state_cache.prefix, stdin, hooks_state_cache.prefix_len);
 
-  return ret;
+  hooks_state_cache.suffix_len = stdin_len - hooks_state_cache.prefix_len - strlen (HOOKS_STATE_STATUS_SENTINEL);
+  hooks_state_cache.suffix = xmalloc (hooks_state_cache.suffix_len);
+  memcpy (hooks_state_cache.suffix, sentinel + strlen (HOOKS_STATE_STATUS_SENTINEL) + 1,
+          hooks_state_cache.suffix_len);
+
+  yajl_gen_free (gen);
+  gen = NULL;
+
+  goto from_cache;
 
 yajl_error:
   if (gen)
@@ -783,6 +1232,53 @@ yajl_error:
   return yajl_error_to_crun_error (r, err);
 }
 
+static int
+do_hooks (runtime_spec_schema_config_schema *def, pid_t pid, const char *id, bool keep_going, const char *cwd,
+          const char *status, hook **hooks, size_t hooks_len, int out_fd, int err_fd, libcrun_error_t *err)
+{
+  cleanup_free char *cwd_allocated = NULL;
+  cleanup_free char *stdin = NULL;
+  const char *parallel_hooks;
+  size_t i, stdin_len;
+  int ret;
+
+  if (cwd == NULL)
+    {
+      cwd = cwd_allocated = getcwd (NULL, 0);
+      if (cwd == NULL)
+        OOM ();
+    }
+
+  ret = generate_hooks_state (def, pid, id, cwd, status, &stdin, &stdin_len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = 0;
+
+  /* The OCI spec mandates sequential execution, so hooks within a stage run
+     concurrently only when explicitly allowed by the annotation.  */
+  parallel_hooks = find_annotation_map (def ? def->annotations : NULL, "run.oci.hooks.parallel");
+  if (hooks_len > 1 && parallel_hooks && strcmp (parallel_hooks, "true") == 0)
+    ret = do_hooks_parallel (hooks, hooks_len, cwd, keep_going, stdin, stdin_len, out_fd, err_fd, err);
+  else
+    for (i = 0; i < hooks_len; i++)
+      {
+        ret = run_one_hook (hooks[i], cwd, stdin, stdin_len, out_fd, err_fd, err);
+        if (UNLIKELY (ret != 0))
+          {
+            if (keep_going)
+              libcrun_warning ("error executing hook `%s` (exit code: %d)", hooks[i]->path, ret);
+            else
+              {
+                libcrun_error (0, "error executing hook `%s` (exit code: %d)", hooks[i]->path, ret);
+                break;
+              }
+          }
+      }
+
+  return ret;
+}
+
 static int
 get_yajl_result (yajl_gen gen, char **out, size_t *out_len)
 {
@@ -1037,39 +1533,146 @@ libcrun_container_notify_handler (struct container_entrypoint_s *args,
                                  rootfs, err);
 }
 
-/* Initialize the environment where the container process runs.
-   It is used by the container init process.  */
+/* Queue the terminal fd on the console socket without blocking.  When the
+   receiver is slow the fds are parked in ENTRYPOINT_ARGS and the send is
+   completed by flush_console_socket_send right before exec, so a slow
+   console consumer does not stall the rest of the setup.  */
 static int
-container_init_setup (void *args, pid_t own_pid, char *notify_socket,
-                      int sync_socket, char **exec_path, libcrun_error_t *err)
+queue_console_socket_send (struct container_entrypoint_s *entrypoint_args, int *console_socket, int *terminal_fd, libcrun_error_t *err)
 {
-  struct container_entrypoint_s *entrypoint_args = args;
-  libcrun_container_t *container = entrypoint_args->container;
-  bool chdir_done = false;
   int ret;
-  int has_terminal;
-  cleanup_close int console_socket = -1;
-  cleanup_close int console_socketpair = -1;
-  runtime_spec_schema_config_schema *def = container->container_def;
-  runtime_spec_schema_config_schema_process_capabilities *capabilities;
-  cleanup_free char *rootfs = NULL;
-  int no_new_privs;
 
-  ret = initialize_security (def->process, err);
+  ret = set_blocking_fd (*console_socket, 0, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = libcrun_configure_network (container, err);
+  ret = send_fd_to_socket (*console_socket, *terminal_fd, err);
+  if (LIKELY (ret == 0))
+    {
+      close_and_reset (console_socket);
+      return 0;
+    }
+
+  if (crun_error_get_errno (err) != EAGAIN)
+    return ret;
+  crun_error_release (err);
+
+  entrypoint_args->pending_console_socket = *console_socket;
+  entrypoint_args->pending_terminal_fd = *terminal_fd;
+  *console_socket = -1;
+  *terminal_fd = -1;
+
+  return 0;
+}
+
+/* Complete a console socket handshake queued by queue_console_socket_send.
+   Wait at most `run.oci.console_socket_timeout` seconds for the receiver to
+   drain the socket before giving up.  */
+static int
+flush_console_socket_send (struct container_entrypoint_s *entrypoint_args, libcrun_error_t *err)
+{
+  cleanup_close int console_socket = entrypoint_args->pending_console_socket;
+  cleanup_close int terminal_fd = entrypoint_args->pending_terminal_fd;
+  int timeout = 10;
+  const char *annotation;
+  struct pollfd pfd;
+  int ret;
+
+  if (console_socket < 0)
+    return 0;
+
+  entrypoint_args->pending_console_socket = -1;
+  entrypoint_args->pending_terminal_fd = -1;
+
+  annotation = find_annotation (entrypoint_args->container, "run.oci.console_socket_timeout");
+  if (annotation)
+    {
+      errno = 0;
+      timeout = strtol (annotation, NULL, 10);
+      if (errno != 0 || timeout <= 0)
+        return crun_make_error (err, 0, "invalid value for `run.oci.console_socket_timeout` annotation");
+    }
+
+  for (;;)
+    {
+      ret = send_fd_to_socket (console_socket, terminal_fd, err);
+      if (LIKELY (ret == 0))
+        return 0;
+
+      if (crun_error_get_errno (err) != EAGAIN)
+        return ret;
+      crun_error_release (err);
+
+      pfd.fd = console_socket;
+      pfd.events = POLLOUT;
+      pfd.revents = 0;
+      ret = TEMP_FAILURE_RETRY (poll (&pfd, 1, timeout * 1000));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "poll on the console socket");
+      if (ret == 0)
+        return crun_make_error (err, 0, "timeout sending the terminal to the console socket");
+    }
+}
+
+/* Initialize the environment where the container process runs.
+   It is used by the container init process.
+
+   The phases run strictly in this order on purpose, they form a chain even
+   where they look independent: sysctls are written before the mounts can
+   make /proc/sys read-only, the rootfs must be fully assembled before
+   pivot_root, masked and readonly paths apply to the final tree, the
+   terminal needs setsid first, and seccomp plus the capability drop come
+   last or they would block the setup itself.  Keep this process single
+   threaded: it calls unshare, setresuid/setresgid and fork for hooks, whose
+   semantics change in a multi-threaded process, and the error machinery is
+   not thread safe.  Concurrency belongs in the parent, which already runs
+   during these phases, or in batching syscalls within a phase.  */
+static int
+container_init_setup (void *args, pid_t own_pid, char *notify_socket,
+                      int sync_socket, char **exec_path, libcrun_error_t *err)
+{
+  struct container_entrypoint_s *entrypoint_args = args;
+  libcrun_container_t *container = entrypoint_args->container;
+  bool chdir_done = false;
+  int ret;
+  int has_terminal;
+  cleanup_close int console_socket = -1;
+  cleanup_close int console_socketpair = -1;
+  runtime_spec_schema_config_schema *def = container->container_def;
+  runtime_spec_schema_config_schema_process_capabilities *capabilities;
+  cleanup_free char *rootfs = NULL;
+  int no_new_privs;
+
+  ret = initialize_security (def->process, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = libcrun_configure_network (container, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
   if (def->root && def->root->path)
     {
-      rootfs = realpath (def->root->path, NULL);
-      if (UNLIKELY (rootfs == NULL))
+      if (container->context && container->context->rootfs_fd > 0)
+        {
+          /* The caller supplied an fd for the rootfs: read the canonical path
+             from it instead of walking def->root->path again.  */
+          proc_fd_path_t fd_path;
+
+          get_proc_self_fd_path (fd_path, container->context->rootfs_fd);
+          ret = safe_readlinkat (AT_FDCWD, fd_path, &rootfs, 0, err);
+          if (UNLIKELY (ret < 0))
+            crun_error_release (err);
+        }
+
+      if (rootfs == NULL)
         {
-          /* If realpath failed for any reason, try the relative directory.  */
-          rootfs = xstrdup (def->root->path);
+          rootfs = realpath (def->root->path, NULL);
+          if (UNLIKELY (rootfs == NULL))
+            {
+              /* If realpath failed for any reason, try the relative directory.  */
+              rootfs = xstrdup (def->root->path);
+            }
         }
     }
 
@@ -1079,10 +1682,9 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
       console_socketpair = entrypoint_args->terminal_socketpair[1];
     }
 
-  /* sync 1.  */
-  ret = sync_socket_wait_sync (NULL, sync_socket, false, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  /* sync 1 already happened in container_init: the PID packet doubles as the
+     first synchronization point.  */
+  child_startup_mark (sync_socket, "init:sync-1");
 
   has_terminal = container->container_def->process && container->container_def->process->terminal;
   if (has_terminal && entrypoint_args->context->console_socket)
@@ -1097,10 +1699,12 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
     return ret;
 
   /* sync 2 and 3 are sent as part of libcrun_set_mounts.  */
+  child_startup_mark (sync_socket, "init:mounts");
   ret = libcrun_set_mounts (entrypoint_args, container, rootfs, send_sync_cb, &sync_socket, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
+  child_startup_mark (sync_socket, "init:create-container-hooks");
   if (def->hooks && def->hooks->create_container_len)
     {
       ret = do_hooks (def, 0, container->context->id, false, NULL, "created", (hook **) def->hooks->create_container,
@@ -1205,10 +1809,11 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
 
       if (console_socket >= 0)
         {
-          ret = send_fd_to_socket (console_socket, terminal_fd, err);
+          /* Asynchronous: the rest of the setup proceeds while a slow
+             receiver catches up, the send completes right before exec.  */
+          ret = queue_console_socket_send (entrypoint_args, &console_socket, &terminal_fd, err);
           if (UNLIKELY (ret < 0))
             return ret;
-          close_and_reset (&console_socket);
         }
       else if (entrypoint_args->has_terminal_socket_pair && console_socketpair >= 0)
         {
@@ -1235,6 +1840,12 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
         return ret;
     }
 
+  /* Applied here so the policy is inherited across the exec and the payload
+     allocations land on the configured NUMA nodes from the start.  */
+  ret = libcrun_set_mempolicy (container, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   if (def->process && def->process->user)
     umask (def->process->user->umask_present ? def->process->user->umask : 0022);
 
@@ -1245,6 +1856,12 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
       cleanup_free char *seccomp_fd_payload = NULL;
       size_t seccomp_fd_payload_len = 0;
 
+      /* The filter could restrict the syscalls the handshake needs, so
+         synchronize with the console socket receiver first.  */
+      ret = flush_console_socket_send (entrypoint_args, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
       if (def->linux && def->linux->seccomp)
         {
           seccomp_flags = def->linux->seccomp->flags;
@@ -1269,7 +1886,7 @@ container_init_setup (void *args, pid_t own_pid, char *notify_socket,
 
   capabilities = def->process ? def->process->capabilities : NULL;
   no_new_privs = def->process ? def->process->no_new_privileges : 1;
-  ret = libcrun_set_caps (capabilities, container->container_uid, container->container_gid, no_new_privs, err);
+  ret = libcrun_set_caps (container, capabilities, container->container_uid, container->container_gid, no_new_privs, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -1375,14 +1992,20 @@ container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_
 
   crun_set_output_handler (log_write_to_sync_socket, args, false);
 
-  /* sync receive own pid.  */
-  ret = TEMP_FAILURE_RETRY (read (sync_socket, &own_pid, sizeof (own_pid)));
-  if (UNLIKELY (ret != sizeof (own_pid)))
-    {
-      if (ret >= 0)
-        errno = 0;
-      return crun_make_error (err, errno, "read from sync socket");
-    }
+  /* sync 1: receive own pid.  The parent coalesces the PID and the first
+     synchronization point into this single packet.  */
+  {
+    struct sync_socket_message_s msg;
+
+    ret = TEMP_FAILURE_RETRY (read (sync_socket, &msg, sizeof (msg)));
+    if (UNLIKELY (ret < (int) SYNC_SOCKET_MESSAGE_LEN (msg, 0) || msg.type != SYNC_SOCKET_SYNC_MESSAGE))
+      {
+        if (ret >= 0)
+          errno = 0;
+        return crun_make_error (err, errno, "read from sync socket");
+      }
+    own_pid = msg.error_value;
+  }
 
   ret = container_init_setup (args, own_pid, notify_socket, sync_socket, &exec_path, err);
   if (UNLIKELY (ret < 0))
@@ -1411,22 +2034,37 @@ container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_
 
   if (entrypoint_args->context->fifo_exec_wait_fd >= 0)
     {
-      char buffer[1];
+      char buffer[8];
       fd_set read_set;
       cleanup_close int fd = entrypoint_args->context->fifo_exec_wait_fd;
+      cleanup_close int efd = entrypoint_args->context->eventfd_exec_wait_fd;
+      int nfds = (efd > fd ? efd : fd) + 1;
       entrypoint_args->context->fifo_exec_wait_fd = -1;
+      entrypoint_args->context->eventfd_exec_wait_fd = -1;
 
-      FD_ZERO (&read_set);
-      FD_SET (fd, &read_set);
       do
         {
-          ret = select (fd + 1, &read_set, NULL, NULL, NULL);
+          FD_ZERO (&read_set);
+          FD_SET (fd, &read_set);
+          if (efd >= 0)
+            FD_SET (efd, &read_set);
+
+          ret = select (nfds, &read_set, NULL, NULL, NULL);
           if (UNLIKELY (ret < 0))
             return crun_make_error (err, errno, "select");
 
-          ret = TEMP_FAILURE_RETRY (read (fd, buffer, sizeof (buffer)));
-          if (UNLIKELY (ret < 0))
-            return crun_make_error (err, errno, "read from the exec fifo");
+          if (efd >= 0 && FD_ISSET (efd, &read_set))
+            {
+              ret = TEMP_FAILURE_RETRY (read (efd, buffer, sizeof (buffer)));
+              if (UNLIKELY (ret < 0))
+                return crun_make_error (err, errno, "read from the exec eventfd");
+            }
+          else
+            {
+              ret = TEMP_FAILURE_RETRY (read (fd, buffer, 1));
+              if (UNLIKELY (ret < 0))
+                return crun_make_error (err, errno, "read from the exec fifo");
+            }
       } while (ret == 0);
 
       close_and_reset (&entrypoint_args->context->fifo_exec_wait_fd);
@@ -1434,6 +2072,12 @@ container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_
 
   crun_set_output_handler (log_write_to_stderr, NULL, false);
 
+  /* Synchronize with the console socket receiver before seccomp can
+     restrict the syscalls the handshake needs.  */
+  ret = flush_console_socket_send (entrypoint_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   if (def->process && def->process->no_new_privileges)
     {
       char **seccomp_flags = NULL;
@@ -1524,6 +2168,9 @@ container_init (void *args, char *notify_socket, int sync_socket, libcrun_error_
       return ret;
     }
 
+  /* The sync socket is already closed here, so the mark cannot be forwarded
+     to the trace log.  */
+  crun_startup_probe ("init:exec");
   TEMP_FAILURE_RETRY (execv (exec_path, def->process->args));
 
   if (errno == ENOENT)
@@ -1702,14 +2349,38 @@ container_delete_internal (libcrun_context_t *context, runtime_spec_schema_confi
 
   if (! is_empty_string (status.intelrdt))
     {
-      ret = libcrun_destroy_intelrdt (status.intelrdt, err);
+      ret = libcrun_destroy_intelrdt (status.intelrdt, id, err);
       if (UNLIKELY (ret < 0))
         crun_error_write_warning_and_release (context->output_handler_arg, &err);
     }
 
   if (status.cgroup_path)
     {
-      ret = libcrun_cgroup_destroy (cgroup_status, err);
+      bool async = false;
+
+      /* The config is needed anyway for the poststop hooks, so reading it
+         here to check the annotation does not add a parse.  If it cannot be
+         read, fall back to the synchronous destroy.  */
+      if (def == NULL && container == NULL)
+        {
+          libcrun_error_t tmp_err = NULL;
+
+          ret = read_container_config_from_state (&container, state_root, id, &tmp_err);
+          if (UNLIKELY (ret < 0))
+            crun_error_release (&tmp_err);
+          else
+            def = container->container_def;
+        }
+
+      if (def)
+        {
+          const char *annotation = find_annotation_map (def->annotations, "run.oci.cgroup.async-destroy");
+
+          async = annotation != NULL && strcmp (annotation, "true") == 0;
+        }
+
+      ret = async ? libcrun_cgroup_destroy_async (cgroup_status, err)
+                  : libcrun_cgroup_destroy (cgroup_status, err);
       if (UNLIKELY (ret < 0))
         crun_error_write_warning_and_release (context->output_handler_arg, &err);
     }
@@ -1718,6 +2389,16 @@ container_delete_internal (libcrun_context_t *context, runtime_spec_schema_confi
   if (UNLIKELY (ret < 0))
     crun_error_write_warning_and_release (context->output_handler_arg, &err);
 
+  /* Stop any CRIU service process left behind by checkpoint operations before
+     its socket is removed together with the state directory.  */
+  {
+    cleanup_free char *state_dir = libcrun_get_state_directory (state_root, id);
+    libcrun_error_t tmp_err = NULL;
+
+    if (state_dir != NULL && libcrun_criu_stop_service (state_dir, &tmp_err) < 0)
+      crun_error_release (&tmp_err);
+  }
+
   return libcrun_container_delete_status (state_root, id, err);
 }
 
@@ -1728,6 +2409,83 @@ libcrun_container_delete (libcrun_context_t *context, runtime_spec_schema_config
   return container_delete_internal (context, def, id, force, true, err);
 }
 
+int
+libcrun_container_delete_many (libcrun_context_t *context, const char *const *ids, size_t n_ids, bool force,
+                               libcrun_error_t *err)
+{
+  size_t next = 0, running = 0, failures = 0;
+  long max_jobs;
+
+  if (n_ids == 0)
+    return 0;
+  if (n_ids == 1)
+    return libcrun_container_delete (context, NULL, ids[0], force, err);
+
+  /* Prime the per process cgroup caches so every worker inherits them
+     through fork instead of detecting the mode again.  */
+  {
+    libcrun_error_t tmp_err = NULL;
+
+    if (libcrun_get_cgroup_mode (&tmp_err) < 0)
+      crun_error_release (&tmp_err);
+    if (libcrun_get_cgroup_root_dirfd (&tmp_err) < 0)
+      crun_error_release (&tmp_err);
+  }
+
+  max_jobs = sysconf (_SC_NPROCESSORS_ONLN);
+  if (max_jobs < 1)
+    max_jobs = 1;
+  if (max_jobs > 16)
+    max_jobs = 16;
+
+  while (next < n_ids || running > 0)
+    {
+      int wstatus;
+      pid_t pid;
+
+      if (next < n_ids && running < (size_t) max_jobs)
+        {
+          pid = fork ();
+          if (UNLIKELY (pid < 0))
+            {
+              if (running == 0)
+                return crun_make_error (err, errno, "fork");
+              /* Wait for a worker to finish and retry.  */
+            }
+          else if (pid == 0)
+            {
+              libcrun_error_t del_err = NULL;
+              int ret;
+
+              ret = libcrun_container_delete (context, NULL, ids[next], force, &del_err);
+              if (UNLIKELY (ret < 0))
+                libcrun_error_write_warning_and_release (stderr, &del_err);
+              fflush (stderr);
+              _exit (ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+            }
+          else
+            {
+              next++;
+              running++;
+              continue;
+            }
+        }
+
+      pid = TEMP_FAILURE_RETRY (waitpid (-1, &wstatus, 0));
+      if (UNLIKELY (pid < 0))
+        return crun_make_error (err, errno, "waitpid");
+
+      running--;
+      if (! WIFEXITED (wstatus) || WEXITSTATUS (wstatus) != 0)
+        failures++;
+    }
+
+  if (failures)
+    return crun_make_error (err, 0, "could not delete %zu container%s", failures, failures > 1 ? "s" : "");
+
+  return 0;
+}
+
 int
 libcrun_container_kill (libcrun_context_t *context, const char *id, const char *signal, libcrun_error_t *err)
 {
@@ -1746,6 +2504,101 @@ libcrun_container_kill (libcrun_context_t *context, const char *id, const char *
   return libcrun_kill_linux (&status, sig, err);
 }
 
+int
+libcrun_container_kill_with_timeout (libcrun_context_t *context, const char *id, const char *signal, int timeout_ms,
+                                     libcrun_error_t *err)
+{
+  cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+  cleanup_container_status libcrun_container_status_t status = {};
+  const char *state_root = context->state_root;
+  struct pollfd pfd;
+  int sig, pidfd, ret;
+
+  sig = str2sig (signal);
+  if (UNLIKELY (sig < 0))
+    return crun_make_error (err, 0, "unknown signal `%s`", signal);
+
+  ret = libcrun_read_container_status (&status, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* Open the pidfd before sending the signal so the exit cannot be missed.  */
+  pidfd = libcrun_status_get_pidfd (&status);
+  if (pidfd == 0)
+    {
+      errno = ESRCH;
+      return crun_make_error (err, errno, "kill container");
+    }
+
+  ret = libcrun_kill_linux (&status, sig, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (pidfd > 0)
+    {
+      pfd.fd = pidfd;
+      pfd.events = POLLIN;
+
+      /* The pidfd becomes readable once the process exited.  */
+      ret = TEMP_FAILURE_RETRY (poll (&pfd, 1, timeout_ms));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "poll pidfd");
+      if (ret > 0)
+        return 0;
+    }
+  else
+    {
+      /* No pidfd on this kernel, check the process at a fixed interval.  */
+      struct timespec delay = { 0, 10 * 1000 * 1000 };
+      int waited_ms;
+
+      for (waited_ms = 0; waited_ms < timeout_ms; waited_ms += 10)
+        {
+          ret = libcrun_is_container_running (&status, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+          if (ret == 0)
+            return 0;
+
+          nanosleep (&delay, NULL);
+        }
+    }
+
+  /* The container did not exit within the timeout: escalate to SIGKILL,
+     through the cgroup when there is one so the whole hierarchy is killed
+     atomically via cgroup.kill.  */
+  if (! is_empty_string (status.cgroup_path))
+    {
+      cgroup_status = libcrun_cgroup_make_status (&status);
+
+      ret = libcrun_cgroup_killall (cgroup_status, SIGKILL, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+  else
+    {
+      ret = libcrun_kill_linux (&status, SIGKILL, err);
+      if (UNLIKELY (ret < 0))
+        {
+          /* The process exited between the wait and the escalation.  */
+          if (crun_error_get_errno (err) != ESRCH)
+            return ret;
+          crun_error_release (err);
+        }
+    }
+
+  /* SIGKILL cannot be ignored, so the exit is only a matter of the kernel
+     tearing the processes down.  */
+  if (pidfd > 0)
+    {
+      ret = TEMP_FAILURE_RETRY (poll (&pfd, 1, -1));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "poll pidfd");
+    }
+
+  return 1;
+}
+
 int
 libcrun_container_killall (libcrun_context_t *context, const char *id, const char *signal, libcrun_error_t *err)
 {
@@ -1785,15 +2638,23 @@ write_container_status (libcrun_container_t *container, libcrun_context_t *conte
   if (container_has_intelrdt (container))
     {
       bool explicit = false;
-      const char *tmp;
+      int ret;
 
-      tmp = libcrun_get_intelrdt_name (context->id, container, &explicit);
-      if (tmp == NULL)
-        return crun_make_error (err, 0, "internal error: cannot get intelrdt name");
-      /* It is stored in the status only for cleanup purposes.  Delete the group only
-         if it was not explicitly set.  */
-      if (! explicit)
-        intelrdt = xstrdup (tmp);
+      ret = libcrun_get_intelrdt_shared_name (container, &intelrdt, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      if (ret == 0)
+        {
+          const char *tmp;
+
+          tmp = libcrun_get_intelrdt_name (context->id, container, &explicit);
+          if (tmp == NULL)
+            return crun_make_error (err, 0, "internal error: cannot get intelrdt name");
+          /* It is stored in the status only for cleanup purposes.  Delete the group only
+             if it was not explicitly set.  */
+          if (! explicit)
+            intelrdt = xstrdup (tmp);
+        }
     }
 
   libcrun_container_status_t status = {
@@ -1829,6 +2690,23 @@ write_container_status (libcrun_container_t *container, libcrun_context_t *conte
   return libcrun_write_container_status (context->state_root, context->id, &status, err);
 }
 
+static int
+syscall_pidfd_open (pid_t pid, unsigned int flags)
+{
+#if defined __NR_pidfd_open
+  return (int) syscall (__NR_pidfd_open, pid, flags);
+#else
+  (void) pid;
+  (void) flags;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+#ifndef P_PIDFD
+#  define P_PIDFD 3
+#endif
+
 static int
 reap_subprocesses (pid_t main_process, int *main_process_exit, int *last_process, libcrun_error_t *err)
 {
@@ -1862,17 +2740,56 @@ static int
 handle_notify_socket (int notify_socketfd, libcrun_error_t *err)
 {
 #ifdef HAVE_SYSTEMD
-  int ret;
-  char buf[256];
+#  define NOTIFY_SOCKET_BATCH 8
+  struct mmsghdr msgs[NOTIFY_SOCKET_BATCH];
+  struct iovec iovs[NOTIFY_SOCKET_BATCH];
+  char bufs[NOTIFY_SOCKET_BATCH][256];
   const char *ready_str = "READY=1";
+  bool ready = false;
+  int ret, i;
 
-  ret = recvfrom (notify_socketfd, buf, sizeof (buf) - 1, 0, NULL, NULL);
-  if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "recvfrom notify socket");
+  for (i = 0; i < NOTIFY_SOCKET_BATCH; i++)
+    {
+      iovs[i].iov_base = bufs[i];
+      iovs[i].iov_len = sizeof (bufs[i]) - 1;
+      memset (&msgs[i].msg_hdr, 0, sizeof (msgs[i].msg_hdr));
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+  /* Drain every datagram queued on the socket in this wakeup.  sd_notify
+     traffic is bursty (STATUS= and WATCHDOG= spam around startup), so the
+     batch costs one syscall per NOTIFY_SOCKET_BATCH messages and forwards at
+     most a single READY.  */
+  while (1)
+    {
+      ret = recvmmsg (notify_socketfd, msgs, NOTIFY_SOCKET_BATCH, MSG_DONTWAIT, NULL);
+      if (UNLIKELY (ret < 0))
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+          return crun_make_error (err, errno, "recvmmsg from notify socket");
+        }
+
+      for (i = 0; i < ret; i++)
+        {
+          bufs[i][msgs[i].msg_len] = '\0';
+          if (strstr (bufs[i], ready_str))
+            ready = true;
+        }
+
+      if (ret < NOTIFY_SOCKET_BATCH)
+        break;
+    }
 
-  buf[ret] = '\0';
-  if (strstr (buf, ready_str))
+  if (ready)
     {
+      ret = libcrun_load_libsystemd (err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
       ret = sd_notify (0, ready_str);
       if (UNLIKELY (ret < 0))
         return crun_make_error (err, -ret, "sd_notify");
@@ -1908,6 +2825,7 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
 {
   cleanup_close int epollfd = -1;
   cleanup_close int signalfd = -1;
+  cleanup_close int pidfd = -1;
   int ret, container_exit_code = 0, last_process;
   sigset_t mask;
   int fds[10];
@@ -1951,6 +2869,13 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
   if (UNLIKELY (signalfd < 0))
     return signalfd;
 
+  /* Supervise the main child through a pidfd: its exit becomes readable
+     directly, so a SIGCHLD storm from reparented descendants never needs a
+     rescan to learn whether the container itself exited.  Opened before the
+     initial reap so an early exit cannot slip between the two; when the
+     kernel lacks pidfd_open the SIGCHLD path below covers everything.  */
+  pidfd = syscall_pidfd_open (args->pid, 0);
+
   ret = reap_subprocesses (args->pid, &container_exit_code, &last_process, err);
   if (UNLIKELY (ret < 0))
     return ret;
@@ -1993,6 +2918,8 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
     }
 
   fds[fds_len++] = signalfd;
+  if (pidfd >= 0)
+    fds[fds_len++] = pidfd;
   if (args->notify_socket >= 0)
     fds[fds_len++] = args->notify_socket;
   if (args->terminal_fd >= 0)
@@ -2056,12 +2983,64 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
               if (ret && args->context->detach)
                 return 0;
             }
+          else if (pidfd >= 0 && events[i].data.fd == pidfd)
+            {
+              siginfo_t info;
+
+              /* The main child exited: reap it directly off the pidfd.  */
+              info.si_pid = 0;
+              ret = waitid (P_PIDFD, pidfd, &info, WEXITED | WNOHANG);
+              if (ret == 0 && info.si_pid != 0)
+                container_exit_code = info.si_code == CLD_EXITED ? (info.si_status & 0xff) : 128 + info.si_status;
+
+              /* A pidfd stays readable forever once the process exited.  */
+              ret = epoll_ctl (epollfd, EPOLL_CTL_DEL, pidfd, NULL);
+              if (UNLIKELY (ret < 0))
+                return crun_make_error (err, errno, "epoll_ctl delete pidfd");
+              close_and_reset (&pidfd);
+
+              ret = reap_subprocesses (args->pid, &container_exit_code, &last_process, err);
+              if (UNLIKELY (ret < 0))
+                return ret;
+              if (last_process)
+                return container_exit_code;
+            }
           else if (events[i].data.fd == signalfd)
             {
-              res = TEMP_FAILURE_RETRY (read (signalfd, &si, sizeof (si)));
-              if (UNLIKELY (res < 0))
-                return crun_make_error (err, errno, "read from signalfd");
-              if (si.ssi_signo == SIGCHLD)
+              bool winch_pending = false;
+              bool chld_pending = false;
+
+              /* Drain every queued signal before touching the pty, so that a
+                 burst of SIGWINCH during an interactive resize costs a single
+                 ioctl pair instead of interleaving with the data relay.  */
+              while (1)
+                {
+                  res = TEMP_FAILURE_RETRY (read (signalfd, &si, sizeof (si)));
+                  if (res < 0 && errno == EAGAIN)
+                    break;
+                  if (UNLIKELY (res < 0))
+                    return crun_make_error (err, errno, "read from signalfd");
+                  if (si.ssi_signo == SIGCHLD)
+                    {
+                      /* Coalesced below: one reap sweep per wakeup, not one
+                         per queued SIGCHLD.  */
+                      chld_pending = true;
+                    }
+                  else if (si.ssi_signo == SIGWINCH)
+                    {
+                      if (UNLIKELY (args->terminal_fd < 0))
+                        return 0;
+
+                      winch_pending = true;
+                    }
+                  else
+                    {
+                      /* Send any other signal to the child process.  */
+                      ret = kill (args->pid, si.ssi_signo);
+                    }
+                }
+
+              if (chld_pending)
                 {
                   ret = reap_subprocesses (args->pid, &container_exit_code,
                                            &last_process, err);
@@ -2070,11 +3049,9 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
                   if (last_process)
                     return container_exit_code;
                 }
-              else if (si.ssi_signo == SIGWINCH)
-                {
-                  if (UNLIKELY (args->terminal_fd < 0))
-                    return 0;
 
+              if (winch_pending)
+                {
                   ret = ioctl (0, TIOCGWINSZ, &ws);
                   if (UNLIKELY (ret < 0))
                     return crun_make_error (err, errno, "copy terminal size from stdin");
@@ -2083,11 +3060,6 @@ wait_for_process (struct wait_for_process_args *args, libcrun_error_t *err)
                   if (UNLIKELY (ret < 0))
                     return crun_make_error (err, errno, "copy terminal size to pty");
                 }
-              else
-                {
-                  /* Send any other signal to the child process.  */
-                  ret = kill (args->pid, si.ssi_signo);
-                }
             }
           else
             {
@@ -2294,6 +3266,8 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
     .context = context,
     .terminal_socketpair = { -1, -1 },
     .console_socket_fd = -1,
+    .pending_console_socket = -1,
+    .pending_terminal_fd = -1,
     .hooks_out_fd = -1,
     .hooks_err_fd = -1,
     .seccomp_receiver_fd = -1,
@@ -2317,6 +3291,12 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
 
   container->context = context;
 
+  /* Adopt pre-warmed namespaces before any of them is created from
+     scratch; on any failure the container just builds its own.  */
+  ret = libcrun_ns_pool_adopt (container, err);
+  if (UNLIKELY (ret < 0))
+    crun_error_release (err);
+
   if (! detach || context->notify_socket)
     {
       ret = prctl (PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0);
@@ -2433,12 +3413,16 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
         return ret;
     }
 
+  libcrun_profile_startup_mark ("clone");
   pid = libcrun_run_linux_container (container, container_init, &container_args, &sync_socket, &cgroup_dirfd_s, err);
   if (UNLIKELY (pid < 0))
     return pid;
 
   cg.pid = pid;
   cg.joined = cgroup_dirfd_s.joined;
+  /* Reuse the precreated cgroup dirfd, if it is still open, to apply the
+     resources without resolving the cgroup path again.  */
+  cg.cgroup_dirfd = cgroup_dirfd;
 
   if (context->fifo_exec_wait_fd < 0 && context->notify_socket)
     {
@@ -2461,6 +3445,7 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
         goto fail;
     }
 
+  libcrun_profile_startup_mark ("cgroup-enter");
   ret = libcrun_cgroup_enter (&cg, &cgroup_status, err);
   if (UNLIKELY (ret < 0))
     goto fail;
@@ -2469,26 +3454,19 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   if (UNLIKELY (ret < 0))
     goto fail;
 
-  /* sync send own pid.  */
-  ret = TEMP_FAILURE_RETRY (write (sync_socket, &pid, sizeof (pid)));
-  if (UNLIKELY (ret != sizeof (pid)))
-    {
-      if (ret >= 0)
-        errno = 0;
-      crun_make_error (err, errno, "write to sync socket");
-      goto fail;
-    }
-
-  /* sync 1.  */
-  ret = sync_socket_send_sync (sync_socket, true, err);
+  /* sync 1: sent together with the container PID as a single packet, so the
+     child wakes up once for both.  */
+  ret = sync_socket_send_pid_sync (sync_socket, pid, err);
   if (UNLIKELY (ret < 0))
     goto fail;
 
-  /* sync 2.  */
+  /* sync 2.  This interval is dominated by the mount setup in the child.  */
+  libcrun_profile_startup_mark ("sync-2-wait");
   ret = sync_socket_wait_sync (context, sync_socket, false, err);
   if (UNLIKELY (ret < 0))
     goto fail;
 
+  libcrun_profile_startup_mark ("cgroup-enter-finalize");
   ret = libcrun_cgroup_enter_finalize (&cg, cgroup_status, err);
   if (UNLIKELY (ret < 0))
     goto fail;
@@ -2497,10 +3475,22 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   if (UNLIKELY (ret < 0))
     goto fail;
 
+  ret = libcrun_create_core_sched_cookie (pid, container, err);
+  if (UNLIKELY (ret < 0))
+    goto fail;
+
   ret = libcrun_set_io_priority (pid, def->process, err);
   if (UNLIKELY (ret < 0))
     goto fail;
 
+  /* Also pin the class on the cgroup, so the container's own forks and
+     later execs keep it.  */
+  ret = libcrun_cgroup_set_io_priority (cgroup_status, def->process, err);
+  if (UNLIKELY (ret < 0))
+    goto fail;
+
+  libcrun_profile_startup_mark ("prestart-hooks");
+
   /* The container is waiting that we write back.  In this phase we can launch the
      prestart hooks.  */
   if (def->hooks && def->hooks->prestart_len)
@@ -2518,6 +3508,7 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
         goto fail;
     }
 
+  libcrun_profile_startup_mark ("seccomp-generate");
   if (seccomp_fd >= 0)
     {
       if (seccomp_bpf_data != NULL)
@@ -2554,6 +3545,7 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
     }
 
   /* sync 4.  */
+  libcrun_profile_startup_mark ("sync-4-wait");
   ret = sync_socket_wait_sync (context, sync_socket, false, err);
   if (UNLIKELY (ret < 0))
     goto fail;
@@ -2562,6 +3554,7 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
   if (UNLIKELY (ret < 0))
     goto fail;
 
+  libcrun_profile_startup_mark ("status-write");
   ret = write_container_status (container, context, pid, cgroup_status, err);
   if (UNLIKELY (ret < 0))
     goto fail;
@@ -2576,6 +3569,9 @@ libcrun_container_run_internal (libcrun_container_t *container, libcrun_context_
         goto fail;
     }
 
+  libcrun_profile_startup_mark ("ready");
+  libcrun_profile_startup_write (context->id);
+
   /* Let's receive the seccomp notify fd and handle it as part of wait_for_process().  */
   if (own_seccomp_receiver_fd >= 0)
     {
@@ -2658,16 +3654,23 @@ libcrun_copy_config_file (const char *id, const char *state_root, libcrun_contai
 
   if (container->config_file == NULL)
     {
-      ret = write_file (dest_path, container->config_file_content, strlen (container->config_file_content), err);
-      if (UNLIKELY (ret < 0))
-        return ret;
+      buffer = xstrdup (container->config_file_content);
+      len = strlen (buffer);
     }
   else
     {
       ret = read_all_file (container->config_file, &buffer, &len, err);
       if (UNLIKELY (ret < 0))
         return ret;
+    }
 
+  /* Identical configurations are hard linked from the bundle cache instead of
+     being copied for each container.  */
+  ret = libcrun_bundle_cache_store_config (state_root, dest_path, buffer, len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  if (ret > 0)
+    {
       ret = write_file (dest_path, buffer, len, err);
       if (UNLIKELY (ret < 0))
         return ret;
@@ -2684,6 +3687,42 @@ force_delete_container_status (libcrun_context_t *context, runtime_spec_schema_c
   crun_error_release (&tmp_err);
 }
 
+#ifndef P_PIDFD
+#  define P_PIDFD 3
+#endif
+
+/* Reap the detached child, through its pidfd when available so the wait
+   cannot be confused by pid reuse.  */
+static void
+wait_detached_child (pid_t pid, int pidfd)
+{
+  if (pidfd >= 0)
+    {
+      siginfo_t info;
+
+      if (TEMP_FAILURE_RETRY (waitid (P_PIDFD, pidfd, &info, WEXITED)) == 0)
+        return;
+    }
+
+  waitpid_ignore_stopped (pid, NULL, 0);
+}
+
+/* Reap the detached child only if it already exited: one that is still alive
+   is reparented to init once this process exits.  */
+static void
+try_reap_detached_child (pid_t pid, int pidfd)
+{
+  if (pidfd >= 0)
+    {
+      siginfo_t info;
+
+      info.si_pid = 0;
+      if (TEMP_FAILURE_RETRY (waitid (P_PIDFD, pidfd, &info, WEXITED | WNOHANG)) == 0)
+        return;
+    }
+  waitpid (pid, NULL, WNOHANG);
+}
+
 int
 libcrun_container_run (libcrun_context_t *context, libcrun_container_t *container, unsigned int options,
                        libcrun_error_t *err)
@@ -2692,9 +3731,11 @@ libcrun_container_run (libcrun_context_t *context, libcrun_container_t *containe
   int ret;
   int detach = context->detach;
   int container_ret_status[2];
+  cleanup_close int child_pidfd = -1;
   cleanup_close int pipefd0 = -1;
   cleanup_close int pipefd1 = -1;
   libcrun_error_t tmp_err = NULL;
+  pid_t child_pid;
 
   container->context = context;
 
@@ -2729,15 +3770,18 @@ libcrun_container_run (libcrun_context_t *context, libcrun_container_t *containe
   pipefd0 = container_ret_status[0];
   pipefd1 = container_ret_status[1];
 
-  ret = fork ();
-  if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "fork");
-  if (ret)
+  /* A single clone creates the detached supervisor directly: it sits in
+     its own session and is reparented to init when this process exits, so
+     no intermediate process and its exit round trip are needed.  */
+  child_pid = libcrun_clone_detached (&child_pidfd, err);
+  if (UNLIKELY (child_pid < 0))
+    return child_pid;
+  if (child_pid)
     {
       int status;
       close_and_reset (&pipefd1);
 
-      waitpid_ignore_stopped (ret, &status, 0);
+      wait_detached_child (child_pid, child_pidfd);
 
       ret = TEMP_FAILURE_RETRY (read (pipefd0, &status, sizeof (status)));
       if (UNLIKELY (ret < 0))
@@ -2764,11 +3808,7 @@ libcrun_container_run (libcrun_context_t *context, libcrun_container_t *containe
 
   close_and_reset (&pipefd0);
 
-  /* forked process.  */
-  ret = detach_process ();
-  if (UNLIKELY (ret < 0))
-    libcrun_fail_with_error (errno, "detach process");
-
+  /* detached child.  */
   ret = libcrun_copy_config_file (context->id, context->state_root, container, &tmp_err);
   if (UNLIKELY (ret < 0))
     goto fail;
@@ -2799,9 +3839,11 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
   runtime_spec_schema_config_schema *def = container->container_def;
   int ret;
   int container_ready_pipe[2];
+  cleanup_close int child_pidfd = -1;
   cleanup_close int pipefd0 = -1;
   cleanup_close int pipefd1 = -1;
   cleanup_close int exec_fifo_fd = -1;
+  pid_t child_pid;
   context->detach = 1;
 
   container->context = context;
@@ -2827,6 +3869,14 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
   context->fifo_exec_wait_fd = exec_fifo_fd;
   exec_fifo_fd = -1;
 
+  /* The eventfd is an optimization to skip the fifo open on start, the
+     container still listens on the fifo so it is safe to go without it.  */
+  ret = libcrun_status_create_exec_eventfd (context->state_root, context->id, err);
+  if (UNLIKELY (ret < 0))
+    crun_error_release (err);
+  else
+    context->eventfd_exec_wait_fd = ret;
+
   if ((options & LIBCRUN_RUN_OPTIONS_PREFORK) == 0)
     {
       ret = libcrun_copy_config_file (context->id, context->state_root, container, err);
@@ -2844,17 +3894,24 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
   pipefd0 = container_ready_pipe[0];
   pipefd1 = container_ready_pipe[1];
 
-  ret = fork ();
-  if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "fork");
-  if (ret)
+  /* A single clone creates the detached supervisor directly, see the
+     comment in libcrun_container_run.  */
+  child_pid = libcrun_clone_detached (&child_pidfd, err);
+  if (UNLIKELY (child_pid < 0))
+    return child_pid;
+  if (child_pid)
     {
       int exit_code;
       close_and_reset (&pipefd1);
 
-      waitpid_ignore_stopped (ret, NULL, 0);
-
+      /* Read the readiness report before any wait: with a notify socket the
+         detached process stays in wait_for_process until the container sends
+         READY=1, which needs `crun start`, so blocking on its exit here
+         would deadlock.  It is only reaped if it already exited.  */
       ret = TEMP_FAILURE_RETRY (read (pipefd0, &exit_code, sizeof (exit_code)));
+
+      try_reap_detached_child (child_pid, child_pidfd);
+
       if (UNLIKELY (ret < 0))
         return crun_make_error (err, errno, "waiting for container to be ready");
       if (ret > 0)
@@ -2870,11 +3927,7 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
       return 1;
     }
 
-  /* forked process.  */
-  ret = detach_process ();
-  if (UNLIKELY (ret < 0))
-    libcrun_fail_with_error (errno, "detach process");
-
+  /* detached child.  */
   ret = libcrun_copy_config_file (context->id, context->state_root, container, err);
   if (UNLIKELY (ret < 0))
     libcrun_fail_with_error (errno, "copy config file");
@@ -2892,6 +3945,231 @@ libcrun_container_create (libcrun_context_t *context, libcrun_container_t *conta
   exit (ret ? EXIT_FAILURE : 0);
 }
 
+/* Start OPERATION in a forked worker and fill OP so the caller can poll for
+   its completion.  The worker reports back on a pipe with the same format
+   used by the detached branch of libcrun_container_run: the return value,
+   followed by the errno and message when it is negative.  */
+static int
+async_operation_start (libcrun_context_t *context, libcrun_container_t *container, unsigned int options,
+                       int (*operation) (libcrun_context_t *, libcrun_container_t *, unsigned int, libcrun_error_t *),
+                       struct libcrun_async_operation_s *op, libcrun_error_t *err)
+{
+  cleanup_close int child_pidfd = -1;
+  cleanup_close int pipefd0 = -1;
+  cleanup_close int pipefd1 = -1;
+  libcrun_error_t tmp_err = NULL;
+  int result_pipe[2];
+  pid_t child_pid;
+  int ret;
+
+  op->pid = 0;
+  op->poll_fd = -1;
+  op->result_fd = -1;
+
+  ret = pipe2 (result_pipe, O_CLOEXEC);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "pipe");
+  pipefd0 = result_pipe[0];
+  pipefd1 = result_pipe[1];
+
+  child_pid = libcrun_clone_detached (&child_pidfd, err);
+  if (UNLIKELY (child_pid < 0))
+    return child_pid;
+  if (child_pid)
+    {
+      if (child_pidfd < 0)
+        {
+          /* No clone3: get a pidfd for the already running worker.  */
+          child_pidfd = syscall_pidfd_open (child_pid, 0);
+          if (UNLIKELY (child_pidfd < 0))
+            {
+              ret = crun_make_error (err, errno, "pidfd_open");
+              kill (child_pid, SIGKILL);
+              TEMP_FAILURE_RETRY (waitpid (child_pid, NULL, 0));
+              return ret;
+            }
+        }
+
+      op->pid = child_pid;
+      op->poll_fd = get_and_reset (&child_pidfd);
+      op->result_fd = get_and_reset (&pipefd0);
+      return 0;
+    }
+
+  close_and_reset (&pipefd0);
+
+  ret = operation (context, container, options, &tmp_err);
+  TEMP_FAILURE_RETRY (write (pipefd1, &ret, sizeof (ret)));
+  if (UNLIKELY (ret < 0) && tmp_err)
+    {
+      TEMP_FAILURE_RETRY (write (pipefd1, &(tmp_err->status), sizeof (tmp_err->status)));
+      TEMP_FAILURE_RETRY (write (pipefd1, tmp_err->msg, strlen (tmp_err->msg) + 1));
+      crun_error_release (&tmp_err);
+    }
+
+  exit (ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+int
+libcrun_container_run_async (libcrun_context_t *context, libcrun_container_t *container, unsigned int options,
+                             struct libcrun_async_operation_s *op, libcrun_error_t *err)
+{
+  return async_operation_start (context, container, options, libcrun_container_run, op, err);
+}
+
+int
+libcrun_container_create_async (libcrun_context_t *context, libcrun_container_t *container, unsigned int options,
+                                struct libcrun_async_operation_s *op, libcrun_error_t *err)
+{
+  return async_operation_start (context, container, options, libcrun_container_create, op, err);
+}
+
+int
+libcrun_async_operation_finish (struct libcrun_async_operation_s *op, libcrun_error_t *err)
+{
+  cleanup_close int poll_fd = get_and_reset (&op->poll_fd);
+  cleanup_close int result_fd = get_and_reset (&op->result_fd);
+  int status = 0;
+  int ret;
+
+  if (op->pid == 0)
+    return crun_make_error (err, EINVAL, "the async operation is not running");
+
+  ret = waitpid_ignore_stopped (op->pid, NULL, 0);
+  op->pid = 0;
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "waitpid for the async worker");
+
+  ret = TEMP_FAILURE_RETRY (read (result_fd, &status, sizeof (status)));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "read from the async worker");
+  if (UNLIKELY (ret == 0))
+    return crun_make_error (err, 0, "the async worker exited without reporting a result");
+
+  if (status < 0)
+    {
+      int errno_;
+      char buf[512];
+
+      ret = TEMP_FAILURE_RETRY (read (result_fd, &errno_, sizeof (errno_)));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "read from the async worker");
+
+      ret = TEMP_FAILURE_RETRY (read (result_fd, buf, sizeof (buf) - 1));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "read from the async worker");
+      buf[ret] = '\0';
+
+      return crun_make_error (err, errno_, "%s", buf);
+    }
+
+  return status;
+}
+
+/* Point the namespace of the given TYPE in the container configuration to
+   the one owned by PID, adding the namespace entry if it is missing.  */
+static int
+container_join_group_namespace (libcrun_container_t *container, const char *type, pid_t pid, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  const char *proc_file;
+  char *path = NULL;
+  size_t i;
+
+  proc_file = libcrun_namespace_proc_file (type);
+  if (UNLIKELY (proc_file == NULL))
+    return crun_make_error (err, 0, "invalid shared namespace `%s`", type);
+
+  if (def->linux == NULL)
+    return crun_make_error (err, 0, "invalid config file, no linux block specified");
+
+  xasprintf (&path, "/proc/%d/ns/%s", pid, proc_file);
+
+  for (i = 0; i < def->linux->namespaces_len; i++)
+    if (strcmp (def->linux->namespaces[i]->type, type) == 0)
+      {
+        free (def->linux->namespaces[i]->path);
+        def->linux->namespaces[i]->path = path;
+        return 0;
+      }
+
+  def->linux->namespaces = xrealloc (def->linux->namespaces,
+                                     sizeof (*def->linux->namespaces) * (def->linux->namespaces_len + 1));
+  def->linux->namespaces[def->linux->namespaces_len] = xmalloc0 (sizeof (**def->linux->namespaces));
+  def->linux->namespaces[def->linux->namespaces_len]->type = xstrdup (type);
+  def->linux->namespaces[def->linux->namespaces_len]->path = path;
+  def->linux->namespaces_len++;
+  return 0;
+}
+
+int
+libcrun_container_group_create (libcrun_context_t *context, struct libcrun_container_group_member_s *members,
+                                size_t n_members, const char *shared_namespaces, libcrun_error_t *err)
+{
+  cleanup_container_status libcrun_container_status_t leader_status = {};
+  libcrun_context_t member_context;
+  size_t i, created = 0;
+  int ret;
+
+  if (n_members == 0)
+    return crun_make_error (err, EINVAL, "no containers specified");
+
+  /* The first member owns the shared namespaces: it is created unmodified and
+     every other member is rewritten to join its namespaces, so the kernel
+     side setup is performed only once for the whole group.  */
+  member_context = *context;
+  member_context.id = members[0].id;
+  ret = libcrun_container_create (&member_context, members[0].container, LIBCRUN_RUN_OPTIONS_PREFORK, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  created = 1;
+
+  if (n_members > 1)
+    {
+      ret = libcrun_read_container_status (&leader_status, context->state_root, members[0].id, err);
+      if (UNLIKELY (ret < 0))
+        goto rollback;
+
+      for (i = 1; i < n_members; i++)
+        {
+          if (shared_namespaces)
+            {
+              cleanup_free char *copy = xstrdup (shared_namespaces);
+              char *it, *saveptr = NULL;
+
+              for (it = strtok_r (copy, ",", &saveptr); it; it = strtok_r (NULL, ",", &saveptr))
+                {
+                  ret = container_join_group_namespace (members[i].container, it, leader_status.pid, err);
+                  if (UNLIKELY (ret < 0))
+                    goto rollback;
+                }
+            }
+
+          member_context = *context;
+          member_context.id = members[i].id;
+          ret = libcrun_container_create (&member_context, members[i].container, LIBCRUN_RUN_OPTIONS_PREFORK, err);
+          if (UNLIKELY (ret < 0))
+            goto rollback;
+          created++;
+        }
+    }
+
+  return 0;
+
+rollback:
+  /* Best effort: do not leave a partially created group behind.  */
+  for (i = 0; i < created; i++)
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      member_context = *context;
+      member_context.id = members[i].id;
+      if (libcrun_container_delete (&member_context, NULL, members[i].id, true, &tmp_err) < 0)
+        crun_error_release (&tmp_err);
+    }
+  return ret;
+}
+
 int
 libcrun_container_start (libcrun_context_t *context, const char *id, libcrun_error_t *err)
 {
@@ -2924,9 +4202,15 @@ libcrun_container_start (libcrun_context_t *context, const char *id, libcrun_err
         return ret;
     }
 
-  ret = libcrun_status_write_exec_fifo (context->state_root, id, err);
+  ret = libcrun_status_write_exec_eventfd (&status, context->state_root, id, err);
   if (UNLIKELY (ret < 0))
     return ret;
+  if (ret == 0)
+    {
+      ret = libcrun_status_write_exec_fifo (context->state_root, id, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
 
   def = container->container_def;
 
@@ -3112,10 +4396,19 @@ libcrun_container_state (libcrun_context_t *context, const char *id, FILE *out,
     }
 
   {
-    size_t i;
+    /* Only the annotations are needed from the stored config.json: parse
+       the document with yajl and pick them directly instead of
+       materializing the whole libocispec schema tree, which allocates for
+       every mount, env variable and resource limit the state output never
+       touches.  */
+    const char *annotations_path[] = { "annotations", NULL };
+    struct parser_context ctx = { 0, stderr };
     cleanup_free char *config_file = NULL;
-    cleanup_container libcrun_container_t *container = NULL;
+    cleanup_free char *content = NULL;
     cleanup_free char *dir = NULL;
+    yajl_val tree = NULL;
+    yajl_val annotations;
+    size_t i;
 
     dir = libcrun_get_state_directory (state_root, id);
     if (UNLIKELY (dir == NULL))
@@ -3128,26 +4421,33 @@ libcrun_container_state (libcrun_context_t *context, const char *id, FILE *out,
     if (UNLIKELY (ret < 0))
       goto exit;
 
-    container = libcrun_container_load_from_file (config_file, err);
-    if (UNLIKELY (container == NULL))
-      {
-        ret = crun_make_error (err, 0, "error loading config.json");
-        goto exit;
-      }
+    ret = read_all_file (config_file, &content, NULL, err);
+    if (UNLIKELY (ret < 0))
+      goto exit;
+
+    ret = parse_json_file (&tree, content, &ctx, err);
+    if (UNLIKELY (ret < 0))
+      goto exit;
 
-    if (container->container_def->annotations && container->container_def->annotations->len)
+    annotations = yajl_tree_get (tree, annotations_path, yajl_t_object);
+    if (annotations && YAJL_GET_OBJECT (annotations)->len)
       {
         yajl_gen_string (gen, YAJL_STR ("annotations"), strlen ("annotations"));
         yajl_gen_map_open (gen);
-        for (i = 0; i < container->container_def->annotations->len; i++)
+        for (i = 0; i < YAJL_GET_OBJECT (annotations)->len; i++)
           {
-            const char *key = container->container_def->annotations->keys[i];
-            const char *val = container->container_def->annotations->values[i];
+            const char *key = YAJL_GET_OBJECT (annotations)->keys[i];
+            const char *val = YAJL_GET_STRING (YAJL_GET_OBJECT (annotations)->values[i]);
+
+            if (val == NULL)
+              continue;
             yajl_gen_string (gen, YAJL_STR (key), strlen (key));
             yajl_gen_string (gen, YAJL_STR (val), strlen (val));
           }
         yajl_gen_map_close (gen);
       }
+
+    yajl_tree_free (tree);
   }
 
   yajl_gen_map_close (gen);
@@ -3167,77 +4467,314 @@ exit:
   return ret;
 }
 
-int
-libcrun_container_exec (libcrun_context_t *context, const char *id, runtime_spec_schema_config_schema_process *process,
-                        libcrun_error_t *err)
+/* Minimal JSON writer into a fixed buffer, used by the allocation free state
+   serializer below.  Overflows are recorded and checked once at the end.  */
+struct state_buf_s
 {
-  struct libcrun_container_exec_options_s opts;
-  memset (&opts, 0, sizeof (opts));
+  char *buf;
+  size_t size;
+  size_t off;
+  bool overflow;
+};
 
-  opts.struct_size = sizeof (opts);
-  opts.process = process;
+static void
+state_buf_puts (struct state_buf_s *sb, const char *s)
+{
+  size_t len = strlen (s);
 
-  return libcrun_container_exec_with_options (context, id, &opts, err);
+  if (sb->overflow || len >= sb->size - sb->off)
+    {
+      sb->overflow = true;
+      return;
+    }
+  memcpy (sb->buf + sb->off, s, len);
+  sb->off += len;
+  sb->buf[sb->off] = '\0';
 }
 
-int
-libcrun_container_exec_process_file (libcrun_context_t *context, const char *id, const char *path, libcrun_error_t *err)
+static void
+state_buf_put_json_string (struct state_buf_s *sb, const char *s)
 {
-  struct libcrun_container_exec_options_s opts;
-  memset (&opts, 0, sizeof (opts));
+  state_buf_puts (sb, "\"");
+  for (; *s; s++)
+    {
+      unsigned char c = (unsigned char) *s;
+      char escape[8];
 
-  opts.struct_size = sizeof (opts);
-  opts.path = path;
+      if (c == '"' || c == '\\')
+        {
+          escape[0] = '\\';
+          escape[1] = c;
+          escape[2] = '\0';
+        }
+      else if (c >= 0x20)
+        {
+          escape[0] = c;
+          escape[1] = '\0';
+        }
+      else
+        snprintf (escape, sizeof (escape), "\\u%04x", c);
 
-  return libcrun_container_exec_with_options (context, id, &opts, err);
+      state_buf_puts (sb, escape);
+    }
+  state_buf_puts (sb, "\"");
 }
 
-#define cleanup_process_schema __attribute__ ((cleanup (cleanup_process_schemap)))
-
-static inline void
-cleanup_process_schemap (runtime_spec_schema_config_schema_process **p)
+static void
+state_buf_put_string_pair (struct state_buf_s *sb, const char *key, const char *value)
 {
-  runtime_spec_schema_config_schema_process *process = *p;
-  if (process)
-    (void) free_runtime_spec_schema_config_schema_process (process);
+  state_buf_put_json_string (sb, key);
+  state_buf_puts (sb, ":");
+  state_buf_put_json_string (sb, value);
 }
 
-static int
-exec_process_entrypoint (libcrun_context_t *context,
-                         libcrun_container_t *container,
-                         runtime_spec_schema_config_schema_process *process,
-                         int pipefd1,
-                         int seccomp_fd,
-                         int seccomp_receiver_fd,
-                         struct custom_handler_instance_s *custom_handler,
-                         libcrun_error_t *err)
+int
+libcrun_container_state_buf (libcrun_context_t *context, const char *id, char *buf, size_t size, libcrun_error_t *err)
 {
-  runtime_spec_schema_config_schema_process_capabilities *capabilities = NULL;
-  cleanup_free char *exec_path = NULL;
-  uid_t container_uid;
-  gid_t container_gid;
-  const char *cwd;
-  bool chdir_done = false;
-  size_t seccomp_flags_len = 0;
-  char **seccomp_flags = NULL;
-  pid_t own_pid = 0;
-  size_t i;
+  cleanup_container_status libcrun_container_status_t status = {};
+  const char *state_root = context->state_root;
+  const char *container_status = NULL;
+  struct state_buf_s sb = {
+    .buf = buf,
+    .size = size,
+  };
+  char pid_buf[32];
+  int running;
   int ret;
 
-  container_uid = process->user ? process->user->uid : 0;
-  container_gid = process->user ? process->user->gid : 0;
-
-  TEMP_FAILURE_RETRY (read (pipefd1, &own_pid, sizeof (own_pid)));
-
-  cwd = process->cwd ? process->cwd : "/";
-  if (LIKELY (chdir (cwd) == 0))
-    chdir_done = true;
+  if (size == 0)
+    return crun_make_error (err, ERANGE, "state buffer too small");
 
-  ret = unblock_signals (err);
+  ret = libcrun_read_container_status (&status, state_root, id, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = clearenv ();
+  ret = libcrun_get_container_state_string (id, &status, state_root, &container_status, &running, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  snprintf (pid_buf, sizeof (pid_buf), "%d", running ? status.pid : 0);
+
+  state_buf_puts (&sb, "{");
+  state_buf_put_string_pair (&sb, "ociVersion", "1.0.0");
+  state_buf_puts (&sb, ",");
+  state_buf_put_string_pair (&sb, "id", id);
+  state_buf_puts (&sb, ",\"pid\":");
+  state_buf_puts (&sb, pid_buf);
+  state_buf_puts (&sb, ",");
+  state_buf_put_string_pair (&sb, "status", container_status);
+  state_buf_puts (&sb, ",");
+  state_buf_put_string_pair (&sb, "bundle", status.bundle);
+  state_buf_puts (&sb, ",");
+  state_buf_put_string_pair (&sb, "rootfs", status.rootfs);
+  state_buf_puts (&sb, ",");
+  state_buf_put_string_pair (&sb, "created", status.created);
+  if (status.scope)
+    {
+      state_buf_puts (&sb, ",");
+      state_buf_put_string_pair (&sb, "systemd-scope", status.scope);
+    }
+  if (status.owner)
+    {
+      state_buf_puts (&sb, ",");
+      state_buf_put_string_pair (&sb, "owner", status.owner);
+    }
+  state_buf_puts (&sb, "}");
+
+  if (sb.overflow)
+    return crun_make_error (err, ERANGE, "state buffer too small");
+
+  return (int) sb.off;
+}
+
+int
+libcrun_get_states (libcrun_context_t *context, const char *const *ids, size_t n_ids, FILE *out, libcrun_error_t *err)
+{
+  cleanup_container_list libcrun_container_list_t *list = NULL;
+  libcrun_container_list_t *it = NULL;
+  bool first = true;
+  size_t i = 0;
+  int ret;
+
+  /* When no ids are given, walk the state root once instead of letting the
+     caller issue one invocation per container.  The cgroup mode probe and
+     the run directory scan are paid a single time for the whole batch.  */
+  if (n_ids == 0)
+    {
+      ret = libcrun_get_containers_list (&list, context->state_root, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+      it = list;
+    }
+
+  fprintf (out, "[");
+  for (;;)
+    {
+      libcrun_error_t tmp_err = NULL;
+      char buf[8192];
+      const char *id;
+
+      if (n_ids)
+        {
+          if (i == n_ids)
+            break;
+          id = ids[i++];
+        }
+      else
+        {
+          if (it == NULL)
+            break;
+          id = it->name;
+          it = it->next;
+        }
+
+      ret = libcrun_container_state_buf (context, id, buf, sizeof (buf), &tmp_err);
+      if (UNLIKELY (ret < 0))
+        {
+          /* An explicitly requested container must exist; a container that
+             vanished while enumerating the state root is not an error.  */
+          if (n_ids)
+            {
+              fprintf (out, "]\n");
+              *err = tmp_err;
+              return ret;
+            }
+          crun_error_release (&tmp_err);
+          continue;
+        }
+
+      fprintf (out, "%s%s", first ? "" : ",", buf);
+      first = false;
+    }
+  fprintf (out, "]\n");
+
+  return 0;
+}
+
+int
+libcrun_container_exec (libcrun_context_t *context, const char *id, runtime_spec_schema_config_schema_process *process,
+                        libcrun_error_t *err)
+{
+  struct libcrun_container_exec_options_s opts;
+  memset (&opts, 0, sizeof (opts));
+
+  opts.struct_size = sizeof (opts);
+  opts.process = process;
+
+  return libcrun_container_exec_with_options (context, id, &opts, err);
+}
+
+int
+libcrun_container_exec_process_file (libcrun_context_t *context, const char *id, const char *path, libcrun_error_t *err)
+{
+  struct libcrun_container_exec_options_s opts;
+  memset (&opts, 0, sizeof (opts));
+
+  opts.struct_size = sizeof (opts);
+  opts.path = path;
+
+  return libcrun_container_exec_with_options (context, id, &opts, err);
+}
+
+#define cleanup_process_schema __attribute__ ((cleanup (cleanup_process_schemap)))
+
+static inline void
+cleanup_process_schemap (runtime_spec_schema_config_schema_process **p)
+{
+  runtime_spec_schema_config_schema_process *process = *p;
+  if (process)
+    (void) free_runtime_spec_schema_config_schema_process (process);
+}
+
+static int
+load_process_file (const char *path, runtime_spec_schema_config_schema_process **out, libcrun_error_t *err)
+{
+  struct parser_context ctx = { 0, stderr };
+  cleanup_free char *content = NULL;
+  parser_error parser_err = NULL;
+  yajl_val tree = NULL;
+  size_t len;
+  int ret;
+
+  ret = read_all_file (path, &content, &len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = parse_json_file (&tree, content, &ctx, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  *out = make_runtime_spec_schema_config_schema_process (tree, &ctx, &parser_err);
+  if (UNLIKELY (*out == NULL))
+    {
+      ret = crun_make_error (err, errno, "cannot parse process file: `%s`", parser_err);
+      free (parser_err);
+      if (tree)
+        yajl_tree_free (tree);
+      return ret;
+    }
+
+  free (parser_err);
+  if (tree)
+    yajl_tree_free (tree);
+
+  return 0;
+}
+
+struct exec_process_batch_s
+{
+  runtime_spec_schema_config_schema_process **processes;
+  size_t len;
+};
+
+#define cleanup_exec_process_batch __attribute__ ((cleanup (cleanup_exec_process_batchp)))
+
+static void
+cleanup_exec_process_batchp (struct exec_process_batch_s *batch)
+{
+  size_t i;
+
+  for (i = 0; i < batch->len; i++)
+    free_runtime_spec_schema_config_schema_process (batch->processes[i]);
+  free (batch->processes);
+}
+
+static int
+exec_process_entrypoint (libcrun_context_t *context,
+                         libcrun_container_t *container,
+                         runtime_spec_schema_config_schema_process *process,
+                         int pipefd1,
+                         int seccomp_fd,
+                         int seccomp_receiver_fd,
+                         struct custom_handler_instance_s *custom_handler,
+                         libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema_process_capabilities *capabilities = NULL;
+  cleanup_free char *exec_path = NULL;
+  uid_t container_uid;
+  gid_t container_gid;
+  const char *cwd;
+  bool chdir_done = false;
+  size_t seccomp_flags_len = 0;
+  char **seccomp_flags = NULL;
+  pid_t own_pid = 0;
+  size_t i;
+  int ret;
+
+  container_uid = process->user ? process->user->uid : 0;
+  container_gid = process->user ? process->user->gid : 0;
+
+  TEMP_FAILURE_RETRY (read (pipefd1, &own_pid, sizeof (own_pid)));
+
+  cwd = process->cwd ? process->cwd : "/";
+  if (LIKELY (chdir (cwd) == 0))
+    chdir_done = true;
+
+  ret = unblock_signals (err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = clearenv ();
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -3339,7 +4876,7 @@ exec_process_entrypoint (libcrun_context_t *context,
   else if (container->container_def->process)
     capabilities = container->container_def->process->capabilities;
 
-  ret = libcrun_set_caps (capabilities, container_uid, container_gid, process->no_new_privileges, err);
+  ret = libcrun_set_caps (container, capabilities, container_uid, container_gid, process->no_new_privileges, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -3408,23 +4945,86 @@ exec_process_entrypoint (libcrun_context_t *context,
   return 0;
 }
 
-int
-libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
-                                     struct libcrun_container_exec_options_s *opts,
-                                     libcrun_error_t *err)
+/* Run every process of a batch exec.  It runs from inside the container
+   namespaces: the join already happened, so each process only costs a
+   fork.  Workers run sequentially and each exit status is reported back
+   on PIPEFD1 as soon as the worker terminates.  */
+static int
+exec_batch_supervisor (libcrun_context_t *context,
+                       libcrun_container_t *container,
+                       struct exec_process_batch_s *batch,
+                       int pipefd1,
+                       int seccomp_fd,
+                       struct custom_handler_instance_s *custom_handler,
+                       libcrun_error_t *err)
+{
+  size_t i;
+  int ret;
+
+  for (i = 0; i < batch->len; i++)
+    {
+      cleanup_close int wfd0 = -1;
+      cleanup_close int wfd1 = -1;
+      int worker_pipe[2];
+      int status = 0;
+      int exit_code;
+      pid_t worker_pid;
+      char b;
+
+      ret = pipe2 (worker_pipe, O_CLOEXEC);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "pipe");
+      wfd0 = worker_pipe[0];
+      wfd1 = worker_pipe[1];
+
+      worker_pid = fork ();
+      if (UNLIKELY (worker_pid < 0))
+        return crun_make_error (err, errno, "fork");
+
+      if (worker_pid == 0)
+        {
+          close_and_reset (&wfd0);
+
+          exec_process_entrypoint (context, container, batch->processes[i], wfd1, seccomp_fd, -1, custom_handler, err);
+          /* It gets here only on errors.  */
+          if (*err)
+            libcrun_fail_with_error ((*err)->status, "%s", (*err)->msg);
+
+          _exit (EXIT_FAILURE);
+        }
+
+      close_and_reset (&wfd1);
+
+      /* '0' arrives just before the worker execs, EOF when the setup
+         failed; either way the exit status below is authoritative.  */
+      TEMP_FAILURE_RETRY (read (wfd0, &b, sizeof (b)));
+
+      ret = waitpid_ignore_stopped (worker_pid, &status, 0);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "waitpid for the exec process");
+
+      exit_code = get_process_exit_status (status);
+      ret = TEMP_FAILURE_RETRY (write (pipefd1, &exit_code, sizeof (exit_code)));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "write exit status");
+    }
+
+  return 0;
+}
+
+static int
+container_exec_internal (libcrun_context_t *context, const char *id,
+                         libcrun_container_status_t *status,
+                         libcrun_container_t *container,
+                         struct libcrun_container_exec_options_s *opts,
+                         libcrun_error_t *err)
 {
   cleanup_custom_handler_instance struct custom_handler_instance_s *custom_handler = NULL;
-  int container_status, ret;
   bool container_paused = false;
   pid_t pid;
-  libcrun_container_status_t status = {};
-  const char *state_root = context->state_root;
   cleanup_close int terminal_fd = -1;
   cleanup_close int seccomp_fd = -1;
   cleanup_terminal void *orig_terminal = NULL;
-  cleanup_free char *config_file = NULL;
-  cleanup_container libcrun_container_t *container = NULL;
-  cleanup_free char *dir = NULL;
   int container_ret_status[2];
   cleanup_close int pipefd0 = -1;
   cleanup_close int pipefd1 = -1;
@@ -3433,40 +5033,17 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   cleanup_close int seccomp_notify_fd = -1;
   const char *seccomp_notify_plugins = NULL;
   __attribute__ ((unused)) cleanup_process_schema runtime_spec_schema_config_schema_process *process_cleanup = NULL;
+  cleanup_exec_process_batch struct exec_process_batch_s batch = { NULL, 0 };
   runtime_spec_schema_config_schema_process *process = opts->process;
   struct libcrun_seccomp_gen_ctx_s seccomp_gen_ctx;
+  size_t i;
+  int ret;
   char b;
 
-  ret = libcrun_read_container_status (&status, state_root, id, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  ret = libcrun_is_container_running (&status, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
-  container_status = ret;
-
-  dir = libcrun_get_state_directory (state_root, id);
-  if (UNLIKELY (dir == NULL))
-    return crun_make_error (err, 0, "cannot get state directory");
-
-  ret = append_paths (&config_file, err, dir, "config.json", NULL);
-  if (UNLIKELY (ret < 0))
-    return ret;
-
-  container = libcrun_container_load_from_file (config_file, err);
-  if (container == NULL)
-    return crun_make_error (err, 0, "error loading config.json");
-
-  container->context = context;
-
-  if (container_status == 0)
-    return crun_make_error (err, 0, "the container `%s` is not running", id);
-
   {
     cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
 
-    cgroup_status = libcrun_cgroup_make_status (&status);
+    cgroup_status = libcrun_cgroup_make_status (status);
 
     ret = libcrun_cgroup_is_container_paused (cgroup_status, &container_paused, err);
     if (UNLIKELY (ret < 0))
@@ -3506,46 +5083,60 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   if (sizeof (*opts) != opts->struct_size)
     return crun_make_error (err, EINVAL, "invalid libcrun_container_exec_options_s struct");
 
-  if (opts->path)
+  if (opts->batch_paths_len > 0)
     {
-      struct parser_context ctx = { 0, stderr };
-      cleanup_free char *content = NULL;
-      parser_error parser_err = NULL;
-      yajl_val tree = NULL;
-      size_t len;
+      if (process || opts->path)
+        return crun_make_error (err, EINVAL, "cannot specify both a process and a batch of process files");
+      if (context->detach)
+        return crun_make_error (err, EINVAL, "batch exec cannot be detached");
+      if (opts->batch_exit_codes == NULL)
+        return crun_make_error (err, EINVAL, "batch exec requires an exit codes array");
+      if (seccomp_receiver_fd >= 0 || own_seccomp_receiver_fd >= 0)
+        return crun_make_error (err, 0, "the seccomp notify receiver is not supported with batch exec");
+
+      batch.processes = xmalloc0 (opts->batch_paths_len * sizeof (*batch.processes));
+      for (i = 0; i < opts->batch_paths_len; i++)
+        {
+          ret = load_process_file (opts->batch_paths[i], &batch.processes[i], err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+          batch.len++;
+
+          if (batch.processes[i]->terminal)
+            return crun_make_error (err, EINVAL, "a terminal is not supported with batch exec");
+        }
 
+      /* The shared parent side setup below follows the first process.  */
+      process = batch.processes[0];
+    }
+  else if (opts->path)
+    {
       if (process)
         return crun_make_error (err, EINVAL, "cannot specify both exec file and options");
 
-      ret = read_all_file (opts->path, &content, &len, err);
+      ret = load_process_file (opts->path, &process, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
-      ret = parse_json_file (&tree, content, &ctx, err);
-      if (UNLIKELY (ret < 0))
-        return ret;
-
-      process = make_runtime_spec_schema_config_schema_process (tree, &ctx, &parser_err);
-      if (UNLIKELY (process == NULL))
-        {
-          ret = crun_make_error (err, errno, "cannot parse process file: `%s`", parser_err);
-          free (parser_err);
-          if (tree)
-            yajl_tree_free (tree);
-          return ret;
-        }
-
-      free (parser_err);
-      if (tree)
-        yajl_tree_free (tree);
-
       process_cleanup = process;
     }
 
   /* This must be done before we enter a user namespace.  */
-  ret = libcrun_set_rlimits (process->rlimits, process->rlimits_len, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  if (batch.len > 0)
+    {
+      for (i = 0; i < batch.len; i++)
+        {
+          ret = libcrun_set_rlimits (batch.processes[i]->rlimits, batch.processes[i]->rlimits_len, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+        }
+    }
+  else
+    {
+      ret = libcrun_set_rlimits (process->rlimits, process->rlimits_len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
 
   ret = pipe2 (container_ret_status, O_CLOEXEC);
   if (UNLIKELY (ret < 0))
@@ -3557,11 +5148,18 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
      use the configuration from the original config file.  */
   if (container->container_def->process)
     {
-      if (process->selinux_label == NULL && container->container_def->process->selinux_label)
-        process->selinux_label = xstrdup (container->container_def->process->selinux_label);
+      runtime_spec_schema_config_schema_process *p;
+
+      for (i = 0; i < (batch.len > 0 ? batch.len : 1); i++)
+        {
+          p = batch.len > 0 ? batch.processes[i] : process;
 
-      if (process->apparmor_profile == NULL && container->container_def->process->apparmor_profile)
-        process->apparmor_profile = xstrdup (container->container_def->process->apparmor_profile);
+          if (p->selinux_label == NULL && container->container_def->process->selinux_label)
+            p->selinux_label = xstrdup (container->container_def->process->selinux_label);
+
+          if (p->apparmor_profile == NULL && container->container_def->process->apparmor_profile)
+            p->apparmor_profile = xstrdup (container->container_def->process->apparmor_profile);
+        }
     }
 
   ret = initialize_security (process, err);
@@ -3572,7 +5170,7 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, errno, "prctl (PR_SET_DUMPABLE)");
 
-  pid = libcrun_join_process (context, container, status.pid, &status, opts->cgroup, context->detach,
+  pid = libcrun_join_process (context, container, status->pid, status, opts->cgroup, context->detach,
                               process, process->terminal ? &terminal_fd : NULL, err);
   if (UNLIKELY (pid < 0))
     return pid;
@@ -3583,6 +5181,15 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
       TEMP_FAILURE_RETRY (close (pipefd0));
       pipefd0 = -1;
 
+      if (batch.len > 0)
+        {
+          ret = exec_batch_supervisor (context, container, &batch, pipefd1, seccomp_fd, custom_handler, err);
+          if (UNLIKELY (ret < 0))
+            libcrun_fail_with_error ((*err)->status, "%s", (*err)->msg);
+
+          _exit (EXIT_SUCCESS);
+        }
+
       exec_process_entrypoint (context, container, process, pipefd1, seccomp_fd, seccomp_receiver_fd, custom_handler, err);
       /* It gets here only on errors.  */
       if (*err)
@@ -3599,6 +5206,37 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
   if (seccomp_fd >= 0)
     close_and_reset (&seccomp_fd);
 
+  if (batch.len > 0)
+    {
+      int status = 0;
+
+      /* The supervisor reports one exit status per process as soon as it is
+         available; EOF means it terminated before running all of them.  */
+      for (i = 0; i < batch.len; i++)
+        {
+          int exit_code;
+
+          ret = TEMP_FAILURE_RETRY (read (pipefd0, &exit_code, sizeof (exit_code)));
+          if (UNLIKELY (ret != sizeof (exit_code)))
+            return crun_make_error (err, 0, "the batch exec supervisor terminated unexpectedly");
+
+          opts->batch_exit_codes[i] = exit_code;
+        }
+
+      TEMP_FAILURE_RETRY (close (pipefd0));
+      pipefd0 = -1;
+
+      ret = waitpid_ignore_stopped (pid, &status, 0);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "waitpid for the batch exec supervisor");
+
+      ret = get_process_exit_status (status);
+      if (UNLIKELY (ret != 0))
+        return crun_make_error (err, 0, "the batch exec supervisor failed with status %d", ret);
+
+      return 0;
+    }
+
   if (terminal_fd >= 0)
     {
       unsigned short rows = 0, cols = 0;
@@ -3665,14 +5303,127 @@ libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
           .seccomp_notify_plugins = seccomp_notify_plugins,
         };
 
-        ret = wait_for_process (&args, err);
-      }
-    }
+        ret = wait_for_process (&args, err);
+      }
+    }
+
+  flush_fd_to_err (context, terminal_fd);
+  return ret;
+}
+
+int
+libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
+                                     struct libcrun_container_exec_options_s *opts,
+                                     libcrun_error_t *err)
+{
+  cleanup_container_status libcrun_container_status_t status = {};
+  cleanup_container libcrun_container_t *container = NULL;
+  const char *state_root = context->state_root;
+  int ret;
+
+  ret = libcrun_read_container_status (&status, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = libcrun_is_container_running (&status, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  if (ret == 0)
+    return crun_make_error (err, 0, "the container `%s` is not running", id);
+
+  ret = read_container_config_from_state (&container, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  container->context = context;
+
+  return container_exec_internal (context, id, &status, container, opts, err);
+}
+
+struct libcrun_exec_context_s
+{
+  char *id;
+  libcrun_container_status_t status;
+  libcrun_container_t *container;
+};
+
+int
+libcrun_exec_context_open (libcrun_context_t *context, const char *id, struct libcrun_exec_context_s **out,
+                           libcrun_error_t *err)
+{
+  cleanup_free struct libcrun_exec_context_s *exec_ctx = NULL;
+  const char *state_root = context->state_root;
+  int ret;
+
+  *out = NULL;
+
+  exec_ctx = xmalloc0 (sizeof (*exec_ctx));
+
+  ret = libcrun_read_container_status (&exec_ctx->status, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = libcrun_is_container_running (&exec_ctx->status, err);
+  if (UNLIKELY (ret < 0))
+    goto fail;
+  if (ret == 0)
+    {
+      ret = crun_make_error (err, 0, "the container `%s` is not running", id);
+      goto fail;
+    }
+
+  ret = read_container_config_from_state (&exec_ctx->container, state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    goto fail;
+
+  /* Prime the validated pidfd now so that every exec reuses it instead of
+     going through /proc, and so that join_process can take the single setns
+     shortcut without racing against pid reuse.  */
+  (void) libcrun_status_get_pidfd (&exec_ctx->status);
+
+  exec_ctx->id = xstrdup (id);
 
-  flush_fd_to_err (context, terminal_fd);
+  *out = exec_ctx;
+  exec_ctx = NULL;
+  return 0;
+
+fail:
+  libcrun_free_container_status (&exec_ctx->status);
   return ret;
 }
 
+void
+libcrun_exec_context_free (struct libcrun_exec_context_s *exec_ctx)
+{
+  if (exec_ctx == NULL)
+    return;
+
+  if (exec_ctx->container)
+    libcrun_container_free (exec_ctx->container);
+  libcrun_free_container_status (&exec_ctx->status);
+  free (exec_ctx->id);
+  free (exec_ctx);
+}
+
+int
+libcrun_container_exec_fast (libcrun_context_t *context, struct libcrun_exec_context_s *exec_ctx,
+                             struct libcrun_container_exec_options_s *opts, libcrun_error_t *err)
+{
+  int ret;
+
+  /* Liveness is a single poll on the pidfd cached in the status; the status
+     file and config.json were parsed once when the context was opened.  */
+  ret = libcrun_is_container_running (&exec_ctx->status, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  if (ret == 0)
+    return crun_make_error (err, 0, "the container `%s` is not running", exec_ctx->id);
+
+  exec_ctx->container->context = context;
+
+  return container_exec_internal (context, exec_ctx->id, &exec_ctx->status, exec_ctx->container, opts, err);
+}
+
 int
 libcrun_container_update (libcrun_context_t *context, const char *id, const char *content, size_t len arg_unused,
                           libcrun_error_t *err)
@@ -3731,7 +5482,31 @@ libcrun_container_update (libcrun_context_t *context, const char *id, const char
         return ret;
     }
 
-  ret = libcrun_linux_container_update (&status, resources, err);
+  {
+    cleanup_free char *state_dir = NULL;
+    cleanup_free char *plan_file = NULL;
+
+    state_dir = libcrun_get_state_directory (state_root, id);
+    if (UNLIKELY (state_dir == NULL))
+      {
+        ret = crun_make_error (err, 0, "cannot get state directory");
+        goto cleanup;
+      }
+
+    ret = append_paths (&plan_file, err, state_dir, "resources-plan", NULL);
+    if (UNLIKELY (ret < 0))
+      goto cleanup;
+
+    ret = libcrun_linux_container_update (&status, plan_file, resources, err);
+    if (UNLIKELY (ret < 0))
+      goto cleanup;
+  }
+
+  /* Let the handler propagate the new limits into a running sandbox, e.g.
+     resize a microVM.  */
+  if (custom_handler && custom_handler->vtable->update_resources)
+    ret = custom_handler->vtable->update_resources (custom_handler->cookie, context, container,
+                                                    &status, resources, err);
 
 cleanup:
   if (tree)
@@ -3968,13 +5743,17 @@ libcrun_container_get_features (libcrun_context_t *context, struct features_info
 
   // Populate the values for annotations
 #ifdef HAVE_SECCOMP
-  {
-    const struct scmp_version *version = seccomp_version ();
-    int size = snprintf (NULL, 0, "%u.%u.%u", version->major, version->minor, version->micro) + 1;
-    char *version_string = xmalloc0 (size);
-    snprintf (version_string, size, "%u.%u.%u", version->major, version->minor, version->micro);
-    (*info)->annotations.io_github_seccomp_libseccomp_version = xstrdup (version_string);
-  }
+  /* Loaded lazily, the annotation is skipped when the library is not available.  */
+  if (libcrun_load_libseccomp (err) < 0)
+    crun_error_release (err);
+  else
+    {
+      const struct scmp_version *version = seccomp_version ();
+      int size = snprintf (NULL, 0, "%u.%u.%u", version->major, version->minor, version->micro) + 1;
+      char *version_string = xmalloc0 (size);
+      snprintf (version_string, size, "%u.%u.%u", version->major, version->minor, version->micro);
+      (*info)->annotations.io_github_seccomp_libseccomp_version = xstrdup (version_string);
+    }
 #endif
 
   if (context->handler_manager && handler_by_name (context->handler_manager, "wasm"))
@@ -4004,6 +5783,41 @@ libcrun_container_spec (bool root, FILE *out, libcrun_error_t *err)
                   cgroup_mode == CGROUP_MODE_UNIFIED ? spec_cgroupns : "");
 }
 
+/* If the container opted in with the run.oci.memory_reclaim_on_pause
+   annotation, ask the kernel to reclaim that many bytes right after the
+   container was frozen: a paused container is the cheapest moment to shave
+   off its cold pages.  Best effort, the pause itself already succeeded.  */
+static void
+reclaim_memory_on_pause (libcrun_context_t *context, libcrun_container_status_t *status, const char *id)
+{
+  cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+  cleanup_container libcrun_container_t *container = NULL;
+  libcrun_error_t tmp_err = NULL;
+  const char *value;
+  int ret;
+
+  if (is_empty_string (status->cgroup_path))
+    return;
+
+  ret = read_container_config_from_state (&container, context->state_root, id, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return;
+    }
+
+  value = find_annotation (container, "run.oci.memory_reclaim_on_pause");
+  if (value == NULL)
+    return;
+
+  cgroup_status = libcrun_cgroup_make_status (status);
+  if (UNLIKELY (libcrun_cgroup_reclaim_memory (cgroup_status, value, &tmp_err) < 0))
+    {
+      libcrun_warning ("cannot reclaim memory from container `%s`: %s", id, tmp_err->msg);
+      crun_error_release (&tmp_err);
+    }
+}
+
 int
 libcrun_container_pause (libcrun_context_t *context, const char *id, libcrun_error_t *err)
 {
@@ -4021,7 +5835,13 @@ libcrun_container_pause (libcrun_context_t *context, const char *id, libcrun_err
   if (ret == 0)
     return crun_make_error (err, errno, "the container `%s` is not running", id);
 
-  return libcrun_container_pause_linux (&status, err);
+  ret = libcrun_container_pause_linux (&status, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  reclaim_memory_on_pause (context, &status, id);
+
+  return 0;
 }
 
 int
@@ -4044,6 +5864,102 @@ libcrun_container_unpause (libcrun_context_t *context, const char *id, libcrun_e
   return libcrun_container_unpause_linux (&status, err);
 }
 
+int
+libcrun_container_batch_pause_unpause (libcrun_context_t *context, const char *const *ids, size_t n_ids,
+                                       const bool pause, libcrun_error_t *err)
+{
+  cleanup_free libcrun_container_status_t *statuses = NULL;
+  cleanup_free const char **cgroup_paths = NULL;
+  const char *state_root = context->state_root;
+  size_t i, n_read = 0;
+  int ret = 0;
+
+  if (n_ids == 1)
+    return pause ? libcrun_container_pause (context, ids[0], err)
+                 : libcrun_container_unpause (context, ids[0], err);
+
+  statuses = xmalloc0 (n_ids * sizeof (libcrun_container_status_t));
+  cgroup_paths = xmalloc0 (n_ids * sizeof (char *));
+
+  for (i = 0; i < n_ids; i++)
+    {
+      ret = libcrun_read_container_status (&statuses[i], state_root, ids[i], err);
+      if (UNLIKELY (ret < 0))
+        goto out;
+      n_read++;
+
+      ret = libcrun_is_container_running (&statuses[i], err);
+      if (UNLIKELY (ret < 0))
+        goto out;
+      if (ret == 0)
+        {
+          ret = crun_make_error (err, 0, "the container `%s` is not running", ids[i]);
+          goto out;
+        }
+      cgroup_paths[i] = statuses[i].cgroup_path;
+    }
+
+  ret = libcrun_cgroup_batch_pause_unpause_paths (cgroup_paths, n_ids, pause, err);
+
+out:
+  for (i = 0; i < n_read; i++)
+    libcrun_free_container_status (&statuses[i]);
+  return ret;
+}
+
+#ifdef CRIU_PRE_DUMP_SUPPORT
+#  define CHECKPOINT_PARENT_FILENAME "checkpoint-parent"
+
+/* Compute the path of the directory TO relative to the directory FROM.
+   Both paths must be absolute and canonical.  CRIU accepts the parent
+   image directory only as a path relative to the image directory.  */
+static char *
+make_relative_path (const char *from, const char *to)
+{
+  size_t from_len = strlen (from);
+  size_t to_len = strlen (to);
+  size_t i = 0, common = 1;
+  size_t n_up = 0;
+  const char *from_rest;
+  const char *to_rest;
+  char *ret, *p;
+
+  while (i < from_len && i < to_len && from[i] == to[i])
+    {
+      if (from[i] == '/')
+        common = i + 1;
+      i++;
+    }
+  /* One path is a prefix of the other at a component boundary.  */
+  if (i == from_len && (i == to_len || to[i] == '/'))
+    common = i < to_len ? i + 1 : i;
+  else if (i == to_len && from[i] == '/')
+    common = i + 1;
+
+  from_rest = from + (common < from_len ? common : from_len);
+  to_rest = to + (common < to_len ? common : to_len);
+
+  if (*from_rest)
+    {
+      n_up = 1;
+      for (i = 0; from_rest[i]; i++)
+        if (from_rest[i] == '/')
+          n_up++;
+    }
+
+  ret = xmalloc (n_up * 3 + strlen (to_rest) + 2);
+  p = ret;
+  for (i = 0; i < n_up; i++)
+    p = stpcpy (p, "../");
+  p = stpcpy (p, to_rest);
+  while (p > ret && p[-1] == '/')
+    *--p = '\0';
+  if (p == ret)
+    strcpy (ret, ".");
+  return ret;
+}
+#endif
+
 int
 libcrun_container_checkpoint (libcrun_context_t *context, const char *id, libcrun_checkpoint_restore_t *cr_options,
                               libcrun_error_t *err)
@@ -4052,11 +5968,23 @@ libcrun_container_checkpoint (libcrun_context_t *context, const char *id, libcru
   const char *state_root = context->state_root;
   libcrun_container_status_t status = {};
   cleanup_container libcrun_container_t *container = NULL;
+  cleanup_free char *state_dir = NULL;
+#ifdef CRIU_PRE_DUMP_SUPPORT
+  cleanup_free char *parent_path_file = NULL;
+  cleanup_free char *auto_parent_path = NULL;
+  cleanup_free char *image_path_real = NULL;
+  bool parent_path_set_here = false;
+#endif
 
   ret = libcrun_read_container_status (&status, state_root, id, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
+  state_dir = libcrun_get_state_directory (state_root, id);
+  if (UNLIKELY (state_dir == NULL))
+    return crun_make_error (err, 0, "cannot get state directory");
+  cr_options->state_dir = state_dir;
+
   ret = libcrun_is_container_running (&status, err);
   if (UNLIKELY (ret < 0))
     return ret;
@@ -4066,10 +5994,67 @@ libcrun_container_checkpoint (libcrun_context_t *context, const char *id, libcru
   ret = read_container_config_from_state (&container, state_root, id, err);
   if (UNLIKELY (ret < 0))
     return ret;
+
+#ifdef CRIU_PRE_DUMP_SUPPORT
+  /* Track the pre-dump image chain in the container state directory, so that
+     repeated `checkpoint --pre-dump` invocations and the final dump are
+     chained automatically when no --parent-path is given explicitly.  */
+  if (cr_options->image_path != NULL)
+    {
+      ret = append_paths (&parent_path_file, err, state_dir, CHECKPOINT_PARENT_FILENAME, NULL);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = mkdir (cr_options->image_path, 0700);
+      if (UNLIKELY (ret < 0 && errno != EEXIST))
+        return crun_make_error (err, errno, "error creating checkpoint directory `%s`", cr_options->image_path);
+
+      image_path_real = realpath (cr_options->image_path, NULL);
+      if (UNLIKELY (image_path_real == NULL))
+        return crun_make_error (err, errno, "realpath `%s`", cr_options->image_path);
+
+      if (cr_options->parent_path == NULL)
+        {
+          cleanup_free char *previous_path = NULL;
+
+          ret = read_all_file (parent_path_file, &previous_path, NULL, err);
+          if (ret < 0)
+            crun_error_release (err);
+          else if (previous_path[0] != '\0' && strcmp (previous_path, image_path_real) != 0)
+            {
+              auto_parent_path = make_relative_path (image_path_real, previous_path);
+              cr_options->parent_path = auto_parent_path;
+              parent_path_set_here = true;
+            }
+        }
+    }
+#endif
+
   ret = libcrun_container_checkpoint_linux (&status, container, cr_options, err);
+  cr_options->state_dir = NULL;
+#ifdef CRIU_PRE_DUMP_SUPPORT
+  if (parent_path_set_here)
+    cr_options->parent_path = NULL;
+#endif
   if (UNLIKELY (ret < 0))
     return ret;
 
+#ifdef CRIU_PRE_DUMP_SUPPORT
+  if (parent_path_file != NULL)
+    {
+      if (cr_options->pre_dump)
+        {
+          /* Record the layer just written as the parent of the next dump.  */
+          ret = write_file (parent_path_file, image_path_real, strlen (image_path_real), err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+        }
+      else
+        /* A final dump consumes the chain.  */
+        unlink (parent_path_file);
+    }
+#endif
+
   if (! (cr_options->leave_running || cr_options->pre_dump))
     return container_delete_internal (context, NULL, id, true, true, err);
 
@@ -4153,6 +6138,7 @@ libcrun_container_restore (libcrun_context_t *context, const char *id, libcrun_c
       .root_uid = root_uid,
       .root_gid = root_gid,
       .id = context->id,
+      .cgroup_dirfd = -1,
     };
 
     ret = libcrun_cgroup_enter (&cg, &cgroup_status, err);
@@ -4210,16 +6196,76 @@ libcrun_container_read_pids (libcrun_context_t *context, const char *id, bool re
   return libcrun_cgroup_read_pids (cgroup_status, recurse, pids, err);
 }
 
+int
+libcrun_container_stats (libcrun_context_t *context, const char *id, struct libcrun_cgroup_stats_s *stats,
+                         libcrun_error_t *err)
+{
+  cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+  cleanup_container_status libcrun_container_status_t status = {};
+  int ret;
+
+  ret = libcrun_read_container_status (&status, context->state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (status.cgroup_path == NULL || status.cgroup_path[0] == '\0')
+    return crun_make_error (err, 0, "the container is not using cgroups");
+
+  cgroup_status = libcrun_cgroup_make_status (&status);
+
+  return libcrun_cgroup_read_stats (cgroup_status, stats, err);
+}
+
+int
+libcrun_container_rdt_stats (libcrun_context_t *context, const char *id, struct libcrun_intelrdt_stats_s *stats,
+                             libcrun_error_t *err)
+{
+  cleanup_container_status libcrun_container_status_t status = {};
+  int ret;
+
+  memset (stats, 0, sizeof (*stats));
+
+  ret = libcrun_read_container_status (&status, context->state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* Not an error: the counters are simply not present without resctrl.  */
+  if (is_empty_string (status.intelrdt))
+    return 0;
+
+  return resctl_read_mon_stats (status.intelrdt, id, stats, err);
+}
+
+int
+libcrun_container_reclaim_memory (libcrun_context_t *context, const char *id, const char *value,
+                                  libcrun_error_t *err)
+{
+  cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+  cleanup_container_status libcrun_container_status_t status = {};
+  int ret;
+
+  ret = libcrun_read_container_status (&status, context->state_root, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (status.cgroup_path == NULL || status.cgroup_path[0] == '\0')
+    return crun_make_error (err, 0, "the container is not using cgroups");
+
+  cgroup_status = libcrun_cgroup_make_status (&status);
+
+  return libcrun_cgroup_reclaim_memory (cgroup_status, value, err);
+}
+
 int
 libcrun_write_json_containers_list (libcrun_context_t *context, FILE *out, libcrun_error_t *err)
 {
-  libcrun_container_list_t *list = NULL, *it;
+  cleanup_containers_array libcrun_containers_array_t array = {};
   const unsigned char *content = NULL;
   yajl_gen gen = NULL;
-  size_t len;
+  size_t len, i;
   int ret;
 
-  ret = libcrun_get_containers_list (&list, context->state_root, err);
+  ret = libcrun_get_containers_array (&array, context->state_root, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -4234,20 +6280,19 @@ libcrun_write_json_containers_list (libcrun_context_t *context, FILE *out, libcr
   yajl_gen_config (gen, yajl_gen_validate_utf8, 1);
   yajl_gen_array_open (gen);
 
-  for (it = list; it; it = it->next)
+  for (i = 0; i < array.len; i++)
     {
-      libcrun_container_status_t status;
+      libcrun_container_array_entry_t *entry = &array.entries[i];
       int running = 0;
       int pid;
       const char *container_status = NULL;
 
-      ret = libcrun_read_container_status (&status, context->state_root, it->name, err);
-      if (UNLIKELY (ret < 0))
-        goto exit;
+      if (! entry->status_loaded)
+        continue;
 
-      pid = status.pid;
+      pid = entry->status.pid;
 
-      ret = libcrun_get_container_state_string (it->name, &status, context->state_root, &container_status,
+      ret = libcrun_get_container_state_string (entry->name, &entry->status, context->state_root, &container_status,
                                                 &running, err);
       if (UNLIKELY (ret < 0))
         {
@@ -4260,20 +6305,18 @@ libcrun_write_json_containers_list (libcrun_context_t *context, FILE *out, libcr
 
       yajl_gen_map_open (gen);
       yajl_gen_string (gen, YAJL_STR ("id"), strlen ("id"));
-      yajl_gen_string (gen, YAJL_STR (it->name), strlen (it->name));
+      yajl_gen_string (gen, YAJL_STR (entry->name), strlen (entry->name));
       yajl_gen_string (gen, YAJL_STR ("pid"), strlen ("pid"));
       yajl_gen_integer (gen, pid);
       yajl_gen_string (gen, YAJL_STR ("status"), strlen ("status"));
       yajl_gen_string (gen, YAJL_STR (container_status), strlen (container_status));
       yajl_gen_string (gen, YAJL_STR ("bundle"), strlen ("bundle"));
-      yajl_gen_string (gen, YAJL_STR (status.bundle), strlen (status.bundle));
+      yajl_gen_string (gen, YAJL_STR (entry->status.bundle), strlen (entry->status.bundle));
       yajl_gen_string (gen, YAJL_STR ("created"), strlen ("created"));
-      yajl_gen_string (gen, YAJL_STR (status.created), strlen (status.created));
+      yajl_gen_string (gen, YAJL_STR (entry->status.created), strlen (entry->status.created));
       yajl_gen_string (gen, YAJL_STR ("owner"), strlen ("owner"));
-      yajl_gen_string (gen, YAJL_STR (status.owner), strlen (status.owner));
+      yajl_gen_string (gen, YAJL_STR (entry->status.owner), strlen (entry->status.owner));
       yajl_gen_map_close (gen);
-
-      libcrun_free_container_status (&status);
     }
 
   yajl_gen_array_close (gen);
@@ -4298,8 +6341,126 @@ libcrun_write_json_containers_list (libcrun_context_t *context, FILE *out, libcr
   ret = 0;
 
 exit:
-  if (list)
-    libcrun_free_containers_list (list);
+  if (gen)
+    yajl_gen_free (gen);
+
+  return ret;
+}
+
+int
+libcrun_write_json_containers_stats (libcrun_context_t *context, FILE *out, libcrun_error_t *err)
+{
+  cleanup_containers_array libcrun_containers_array_t array = {};
+  cleanup_free struct libcrun_cgroup_stats_batch_item_s *items = NULL;
+  cleanup_free const char **names = NULL;
+  const unsigned char *content = NULL;
+  yajl_gen gen = NULL;
+  size_t len, i, n = 0;
+  int ret;
+
+  ret = libcrun_get_containers_array (&array, context->state_root, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (array.len > 0)
+    {
+      items = xmalloc0 (array.len * sizeof (*items));
+      names = xmalloc0 (array.len * sizeof (*names));
+
+      for (i = 0; i < array.len; i++)
+        {
+          libcrun_container_array_entry_t *entry = &array.entries[i];
+
+          if (! entry->status_loaded)
+            continue;
+          if (entry->status.cgroup_path == NULL || entry->status.cgroup_path[0] == '\0')
+            continue;
+
+          items[n].path = entry->status.cgroup_path;
+          names[n] = entry->name;
+          n++;
+        }
+    }
+
+  if (n > 0)
+    {
+      ret = libcrun_cgroup_read_stats_batch (items, n, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  gen = yajl_gen_alloc (NULL);
+  if (gen == NULL)
+    return crun_make_error (err, 0, "cannot allocate json generator");
+
+  yajl_gen_config (gen, yajl_gen_beautify, 1);
+  yajl_gen_config (gen, yajl_gen_validate_utf8, 1);
+  yajl_gen_array_open (gen);
+
+  for (i = 0; i < n; i++)
+    {
+      struct libcrun_cgroup_stats_s *stats = &items[i].stats;
+      size_t j;
+      struct
+      {
+        const char *name;
+        uint64_t value;
+      } counters[] = {
+        { "cpu.usage_usec", stats->cpu_usage_usec },
+        { "cpu.user_usec", stats->cpu_user_usec },
+        { "cpu.system_usec", stats->cpu_system_usec },
+        { "memory.anon", stats->memory_anon },
+        { "memory.file", stats->memory_file },
+        { "memory.kernel_stack", stats->memory_kernel_stack },
+        { "memory.pgfault", stats->memory_pgfault },
+        { "memory.pgmajfault", stats->memory_pgmajfault },
+        { "io.rbytes", stats->io_rbytes },
+        { "io.wbytes", stats->io_wbytes },
+        { "io.rios", stats->io_rios },
+        { "io.wios", stats->io_wios },
+        { "pids.current", stats->pids_current },
+      };
+
+      /* The container went away between the walk and the sample.  */
+      if (items[i].error != 0)
+        continue;
+
+      yajl_gen_map_open (gen);
+      yajl_gen_string (gen, YAJL_STR ("id"), strlen ("id"));
+      yajl_gen_string (gen, YAJL_STR (names[i]), strlen (names[i]));
+      yajl_gen_string (gen, YAJL_STR ("stats"), strlen ("stats"));
+      yajl_gen_map_open (gen);
+      for (j = 0; j < sizeof (counters) / sizeof (counters[0]); j++)
+        {
+          yajl_gen_string (gen, YAJL_STR (counters[j].name), strlen (counters[j].name));
+          yajl_gen_integer (gen, (long long) counters[j].value);
+        }
+      yajl_gen_map_close (gen);
+      yajl_gen_map_close (gen);
+    }
+
+  yajl_gen_array_close (gen);
+  if (yajl_gen_get_buf (gen, &content, &len) != yajl_gen_status_ok)
+    {
+      ret = libcrun_make_error (err, 0, "cannot generate json stats");
+      goto exit;
+    }
+
+  while (len)
+    {
+      size_t written = fwrite (content, 1, len, out);
+      if (ferror (out))
+        {
+          ret = libcrun_make_error (err, errno, "error writing to file");
+          goto exit;
+        }
+      len -= written;
+      content += written;
+    }
+
+  ret = 0;
+
+exit:
   if (gen)
     yajl_gen_free (gen);
 
@@ -31,6 +31,7 @@ enum handler_configure_phase
 };
 
 struct custom_handler_manager_s;
+struct libcrun_arena_s;
 
 struct libcrun_context_s
 {
@@ -46,10 +47,18 @@ struct libcrun_context_s
   // Following context variable makes sure we get exact value of listen_fds irrespective of preserve_fds.
   int listen_fds;
 
+  /* Pre-opened descriptors supplied by the caller: an O_PATH fd for the
+     rootfs and a directory fd for the bundle.  When set they are used instead
+     of resolving the corresponding paths.  0 means not set.  */
+  int rootfs_fd;
+  int bundle_fd;
+
   crun_output_handler output_handler;
   void *output_handler_arg;
 
   int fifo_exec_wait_fd;
+  /* Faster eventfd based start handshake, the fifo is kept as a fallback.  */
+  int eventfd_exec_wait_fd;
 
   bool systemd_cgroup;
   bool detach;
@@ -85,6 +94,15 @@ struct libcrun_container_s
   void *private_data;
   void (*cleanup_private_data) (void *private_data);
   struct libcrun_context_s *context;
+
+  /* Setup-phase allocations that live as long as the container object.
+     Released all at once by libcrun_container_free.  */
+  struct libcrun_arena_s *arena;
+
+  /* Capability bitmasks translated from container_def->process->capabilities
+     when the spec is loaded, so the init process applies them without any
+     string lookup.  NULL until computed; allocated from the arena.  */
+  struct all_caps_s *precomputed_caps;
 };
 
 struct libcrun_container_status_s;
@@ -180,6 +198,19 @@ struct libcrun_checkpoint_restore_s
   char *parent_path;
   bool pre_dump;
   int manage_cgroups_mode;
+  /* Post-copy live migration: serve memory pages on demand instead of
+     including them in the images.  */
+  bool lazy_pages;
+  char *page_server_address;
+  int page_server_port;
+  /* Compress the checkpoint images with zstd while the dump is still
+     running.  Restore detects compressed images on its own.  */
+  bool compress;
+  /* Container state directory.  Set by libcrun before calling into the
+     checkpoint backend, not owned by this struct.  Used to keep per-container
+     helper state, such as the persistent CRIU service socket, across
+     checkpoint operations.  */
+  const char *state_dir;
 };
 typedef struct libcrun_checkpoint_restore_s libcrun_checkpoint_restore_t;
 
@@ -192,23 +223,99 @@ LIBCRUN_PUBLIC void libcrun_container_free (libcrun_container_t *);
 LIBCRUN_PUBLIC int libcrun_container_run (libcrun_context_t *context, libcrun_container_t *container,
                                           unsigned int options, libcrun_error_t *error);
 
+/* Asynchronous lifecycle operations.  The _async variants fork a worker that
+   performs the blocking operation and return immediately; POLL_FD becomes
+   readable when the operation completed, so a single-threaded epoll loop can
+   drive many concurrent starts.  Once POLL_FD is readable, call
+   libcrun_async_operation_finish to reap the worker, collect the result (the
+   same return value and error the blocking variant would have produced) and
+   release the handle.  The handle cannot be abandoned without finishing it,
+   or the worker is left as a zombie.  */
+struct libcrun_async_operation_s
+{
+  pid_t pid;
+  /* A pidfd for the worker: poll for POLLIN.  */
+  int poll_fd;
+  /* Internal: carries the result from the worker.  */
+  int result_fd;
+};
+
+LIBCRUN_PUBLIC int libcrun_container_run_async (libcrun_context_t *context, libcrun_container_t *container,
+                                                unsigned int options, struct libcrun_async_operation_s *op,
+                                                libcrun_error_t *err);
+
+LIBCRUN_PUBLIC int libcrun_container_create_async (libcrun_context_t *context, libcrun_container_t *container,
+                                                   unsigned int options, struct libcrun_async_operation_s *op,
+                                                   libcrun_error_t *err);
+
+LIBCRUN_PUBLIC int libcrun_async_operation_finish (struct libcrun_async_operation_s *op, libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_delete (libcrun_context_t *context, runtime_spec_schema_config_schema *def,
                                              const char *id, bool force, libcrun_error_t *err);
 
+/* Delete multiple containers concurrently with a bounded pool of forked
+   workers that share the already detected cgroup mode and root dirfd.
+   Failures are reported as warnings per container and summarized in ERR.  */
+LIBCRUN_PUBLIC int libcrun_container_delete_many (libcrun_context_t *context, const char *const *ids, size_t n_ids,
+                                                  bool force, libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_kill (libcrun_context_t *context, const char *id, const char *signal,
                                            libcrun_error_t *err);
 
+/* Send SIGNAL to the container, wait up to TIMEOUT_MS milliseconds for it to
+   exit, then escalate to SIGKILL.  Returns 0 when the container exited from
+   the first signal and 1 when the escalation was needed.  */
+LIBCRUN_PUBLIC int libcrun_container_kill_with_timeout (libcrun_context_t *context, const char *id,
+                                                        const char *signal, int timeout_ms, libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_killall (libcrun_context_t *context, const char *id, const char *signal,
                                               libcrun_error_t *err);
 
 LIBCRUN_PUBLIC int libcrun_container_create (libcrun_context_t *context, libcrun_container_t *container,
                                              unsigned int options, libcrun_error_t *err);
 
+struct libcrun_container_group_member_s
+{
+  const char *id;
+  libcrun_container_t *container;
+};
+
+/* Create a group of containers that share the namespaces listed in
+   SHARED_NAMESPACES (a comma separated list of OCI namespace types, e.g.
+   "network,ipc,uts").  The first member owns the shared namespaces and is
+   created as-is; the configuration of every other member is rewritten to
+   join them through the owner /proc/PID/ns paths, so the kernel side setup
+   happens once for the whole group.  The id from each member overrides the
+   one in the context.  On any failure the members already created are
+   deleted, so the group either exists completely or not at all.  */
+LIBCRUN_PUBLIC int libcrun_container_group_create (libcrun_context_t *context,
+                                                   struct libcrun_container_group_member_s *members,
+                                                   size_t n_members, const char *shared_namespaces,
+                                                   libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_start (libcrun_context_t *context, const char *id, libcrun_error_t *err);
 
 LIBCRUN_PUBLIC int libcrun_container_state (libcrun_context_t *context, const char *id, FILE *out,
                                             libcrun_error_t *err);
 
+/* Serialize the state record directly into BUF without any intermediate
+   generator tree, for callers that poll the state at high frequency.  The
+   document contains every field backed by the container status; annotations
+   are not included since they require parsing the stored config.json, use
+   libcrun_container_state for the complete document.  Returns the number of
+   bytes written excluding the terminating NUL, or an error when BUF is too
+   small (ERANGE).  */
+LIBCRUN_PUBLIC int libcrun_container_state_buf (libcrun_context_t *context, const char *id, char *buf, size_t size,
+                                                libcrun_error_t *err);
+
+/* Write the state of several containers as one JSON array to OUT.  With
+   N_IDS == 0 every container under the state root is reported and entries
+   that disappear during the scan are skipped; otherwise exactly the
+   requested IDS are reported and a missing one is an error.  The state root
+   is scanned and the cgroup mode probed once for the whole batch.  */
+LIBCRUN_PUBLIC int libcrun_get_states (libcrun_context_t *context, const char *const *ids, size_t n_ids, FILE *out,
+                                       libcrun_error_t *err);
+
 int libcrun_container_notify_handler (struct container_entrypoint_s *args,
                                       enum handler_configure_phase phase,
                                       libcrun_container_t *container, const char *rootfs,
@@ -224,6 +331,16 @@ struct libcrun_container_exec_options_s
   runtime_spec_schema_config_schema_process *process;
   const char *path;
   const char *cgroup;
+
+  /* Batch mode, used instead of PROCESS/PATH: every process file in
+     BATCH_PATHS is executed sequentially from a single namespace join,
+     cloning one worker per process from inside the container.  Terminal
+     and detach are not supported.  BATCH_EXIT_CODES must point to room
+     for BATCH_PATHS_LEN entries and receives the exit status of each
+     process; the call returns 0 once every process was run.  */
+  const char *const *batch_paths;
+  size_t batch_paths_len;
+  int *batch_exit_codes;
 };
 
 LIBCRUN_PUBLIC int libcrun_container_exec_with_options (libcrun_context_t *context, const char *id,
@@ -236,6 +353,25 @@ LIBCRUN_PUBLIC int libcrun_container_exec (libcrun_context_t *context, const cha
 LIBCRUN_PUBLIC int libcrun_container_exec_process_file (libcrun_context_t *context, const char *id, const char *path,
                                                         libcrun_error_t *err);
 
+/* Warm exec path for callers that exec into the same container at high
+   frequency, e.g. exec based health probes.  libcrun_exec_context_open reads
+   the container status and parses the stored config.json once, and keeps a
+   validated pidfd to the container process; every libcrun_container_exec_fast
+   then only needs a poll on the pidfd before joining the namespaces through
+   it, instead of re-reading the status file and re-parsing the configuration
+   on every exec.  The context stays valid until the container is deleted;
+   once the container process exits, exec_fast fails like a regular exec on a
+   stopped container.  */
+struct libcrun_exec_context_s;
+
+LIBCRUN_PUBLIC int libcrun_exec_context_open (libcrun_context_t *context, const char *id,
+                                              struct libcrun_exec_context_s **out, libcrun_error_t *err);
+
+LIBCRUN_PUBLIC void libcrun_exec_context_free (struct libcrun_exec_context_s *exec_ctx);
+
+LIBCRUN_PUBLIC int libcrun_container_exec_fast (libcrun_context_t *context, struct libcrun_exec_context_s *exec_ctx,
+                                                struct libcrun_container_exec_options_s *opts, libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_update (libcrun_context_t *context, const char *id, const char *content,
                                              size_t len, libcrun_error_t *err);
 
@@ -272,6 +408,12 @@ LIBCRUN_PUBLIC int libcrun_container_pause (libcrun_context_t *context, const ch
 
 LIBCRUN_PUBLIC int libcrun_container_unpause (libcrun_context_t *context, const char *id, libcrun_error_t *err);
 
+/* Freeze or thaw several containers at once: every freezer file is
+   written before completion is awaited, so the whole batch settles in
+   one freezer round trip.  */
+LIBCRUN_PUBLIC int libcrun_container_batch_pause_unpause (libcrun_context_t *context, const char *const *ids,
+                                                          size_t n_ids, const bool pause, libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_container_checkpoint (libcrun_context_t *context, const char *id,
                                                  libcrun_checkpoint_restore_t *cr_options, libcrun_error_t *err);
 
@@ -280,8 +422,35 @@ LIBCRUN_PUBLIC int libcrun_container_restore (libcrun_context_t *context, const
 
 LIBCRUN_PUBLIC int libcrun_container_read_pids (libcrun_context_t *context, const char *id, bool recurse, pid_t **pids, libcrun_error_t *err);
 
+struct libcrun_cgroup_stats_s;
+
+/* Read the cgroup usage counters for the container into the caller provided
+   STATS, reusing cached descriptors for the stat files so frequent polling
+   does not pay path resolution or allocations.  The layout of the struct is
+   defined in cgroup.h.  */
+LIBCRUN_PUBLIC int libcrun_container_stats (libcrun_context_t *context, const char *id,
+                                            struct libcrun_cgroup_stats_s *stats, libcrun_error_t *err);
+
+struct libcrun_intelrdt_stats_s;
+
+/* Read the resctrl monitoring counters for the container into the caller
+   provided STATS, defined in intelrdt.h.  The counters are reported as not
+   present when the container has no resctrl group or the kernel does not
+   support monitoring.  */
+LIBCRUN_PUBLIC int libcrun_container_rdt_stats (libcrun_context_t *context, const char *id,
+                                                struct libcrun_intelrdt_stats_s *stats, libcrun_error_t *err);
+
+/* Ask the kernel to proactively reclaim VALUE bytes from the container
+   through memory.reclaim.  */
+LIBCRUN_PUBLIC int libcrun_container_reclaim_memory (libcrun_context_t *context, const char *id,
+                                                     const char *value, libcrun_error_t *err);
+
 LIBCRUN_PUBLIC int libcrun_write_json_containers_list (libcrun_context_t *context, FILE *out, libcrun_error_t *err);
 
+/* Walk the state root once, sample the cgroup usage counters of every
+   container in one batch and write them to OUT as a single JSON array.  */
+LIBCRUN_PUBLIC int libcrun_write_json_containers_stats (libcrun_context_t *context, FILE *out, libcrun_error_t *err);
+
 // Not part of the public API, just a method in container.c we need to access from linux.c
 void get_root_in_the_userns (runtime_spec_schema_config_schema *def, uid_t host_uid, gid_t host_gid,
                              uid_t *uid, gid_t *gid);
@@ -28,6 +28,12 @@
 #  include <sys/stat.h>
 #  include <sys/mount.h>
 #  include <fcntl.h>
+#  include <sys/inotify.h>
+#  include <sys/wait.h>
+#  include <signal.h>
+#  include <poll.h>
+#  include <dirent.h>
+#  include <limits.h>
 
 #  include "container.h"
 #  include "linux.h"
@@ -42,6 +48,11 @@
 #  define CRIU_RESTORE_LOG_FILE "restore.log"
 #  define DESCRIPTORS_FILENAME "descriptors.json"
 
+/* Persistent `criu service` process, kept alive in the container state
+   directory across checkpoint operations.  */
+#  define CRIU_SERVICE_SOCKET_FILENAME "criu-service.sock"
+#  define CRIU_SERVICE_PIDFILE "criu-service.pid"
+
 #  define CRIU_EXT_NETNS "extRootNetNS"
 #  define CRIU_EXT_PIDNS "extRootPidNS"
 
@@ -81,10 +92,14 @@ struct libcriu_wrapper_s
   void (*criu_set_manage_cgroups_mode) (enum criu_cg_mode mode);
   void (*criu_set_notify_cb) (int (*cb) (char *action, criu_notify_arg_t na));
   void (*criu_set_orphan_pts_master) (bool orphan_pts_master);
+  void (*criu_set_lazy_pages) (bool lazy_pages);
+  int (*criu_set_page_server_address_port) (const char *address, int port);
   void (*criu_set_images_dir_fd) (int fd);
   int (*criu_set_parent_images) (const char *path);
   void (*criu_set_pid) (int pid);
   int (*criu_set_root) (const char *root);
+  void (*criu_set_service_address) (const char *address);
+  void (*criu_set_service_comm) (enum criu_service_comm comm);
   void (*criu_set_shell_job) (bool shell_job);
   void (*criu_set_tcp_established) (bool tcp_established);
   void (*criu_set_track_mem) (bool track_mem);
@@ -163,9 +178,17 @@ load_wrapper (struct libcriu_wrapper_s **wrapper_out, libcrun_error_t *err)
   LOAD_CRIU_FUNCTION (criu_set_manage_cgroups_mode, false);
   LOAD_CRIU_FUNCTION (criu_set_notify_cb, false);
   LOAD_CRIU_FUNCTION (criu_set_orphan_pts_master, false);
+  /* Lazy pages support needs a recent libcriu, only fail when it is
+   * actually requested.  */
+  LOAD_CRIU_FUNCTION (criu_set_lazy_pages, true);
+  LOAD_CRIU_FUNCTION (criu_set_page_server_address_port, true);
   LOAD_CRIU_FUNCTION (criu_set_parent_images, false);
   LOAD_CRIU_FUNCTION (criu_set_pid, false);
   LOAD_CRIU_FUNCTION (criu_set_root, false);
+  /* Talking to a persistent `criu service` process needs a recent libcriu,
+     fall back to spawning one swrk per operation when not available.  */
+  LOAD_CRIU_FUNCTION (criu_set_service_address, true);
+  LOAD_CRIU_FUNCTION (criu_set_service_comm, true);
   LOAD_CRIU_FUNCTION (criu_set_shell_job, false);
   LOAD_CRIU_FUNCTION (criu_set_tcp_established, false);
   LOAD_CRIU_FUNCTION (criu_set_track_mem, false);
@@ -382,6 +405,428 @@ checkpoint_cgroup_v1_mount (runtime_spec_schema_config_schema *def, libcrun_erro
   return 0;
 }
 
+#  define CHECKPOINT_COMPRESS_SUFFIX ".zst"
+#  define MAX_DECOMPRESS_WORKERS 8
+
+/* Compress a single image file with zstd, removing the input on success.
+   Runs in the compressor child, so failures surface via the return value
+   and ultimately the child's exit status.  */
+static int
+compress_one_image (const char *dir_path, const char *name)
+{
+  char path[PATH_MAX];
+  int ret, wait_status;
+  pid_t pid;
+
+  ret = snprintf (path, sizeof (path), "%s/%s", dir_path, name);
+  if (UNLIKELY (ret < 0 || (size_t) ret >= sizeof (path)))
+    return -1;
+
+  pid = fork ();
+  if (pid < 0)
+    return -1;
+  if (pid == 0)
+    {
+      /* -T0 lets zstd use every core, which matters for the pages files.  */
+      execlp ("zstd", "zstd", "-q", "-T0", "--rm", path, (char *) NULL);
+      _exit (127);
+    }
+
+  ret = TEMP_FAILURE_RETRY (waitpid (pid, &wait_status, 0));
+  if (ret < 0 || ! WIFEXITED (wait_status) || WEXITSTATUS (wait_status) != 0)
+    return -1;
+  return 0;
+}
+
+static bool
+image_name_compressible (const char *name)
+{
+  size_t len = strlen (name);
+
+  return len > 4 && strcmp (name + len - 4, ".img") == 0;
+}
+
+/* Main loop of the checkpoint compressor child: compress every image CRIU
+   finished writing while the dump keeps producing the next ones, so the
+   checkpoint wall time is bounded by the slower of the two instead of their
+   sum.  The parent signals completion by closing its end of DONE_FD; by that
+   point every close event is already queued on the watch, so one final drain
+   sees them all.  */
+static void __attribute__ ((noreturn))
+checkpoint_compress_worker (const char *dir_path, int done_fd)
+{
+  char buf[sizeof (struct inotify_event) + NAME_MAX + 1]
+      __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  bool failures = false;
+  bool done = false;
+  ssize_t len;
+  int ifd;
+
+  ifd = inotify_init1 (IN_CLOEXEC | IN_NONBLOCK);
+  if (ifd < 0)
+    _exit (1);
+  if (inotify_add_watch (ifd, dir_path, IN_CLOSE_WRITE) < 0)
+    _exit (1);
+
+  while (! done)
+    {
+      struct pollfd pfds[2] = { { ifd, POLLIN, 0 }, { done_fd, POLLIN, 0 } };
+
+      if (poll (pfds, 2, -1) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          _exit (1);
+        }
+
+      if (pfds[1].revents)
+        done = true;
+
+      while ((len = TEMP_FAILURE_RETRY (read (ifd, buf, sizeof (buf)))) > 0)
+        {
+          char *it;
+
+          for (it = buf; it < buf + len;)
+            {
+              struct inotify_event *event = (struct inotify_event *) it;
+
+              if (event->len > 0 && image_name_compressible (event->name))
+                if (compress_one_image (dir_path, event->name) < 0)
+                  failures = true;
+
+              it += sizeof (struct inotify_event) + event->len;
+            }
+        }
+      if (len < 0 && errno != EAGAIN)
+        _exit (1);
+    }
+
+  _exit (failures ? 2 : 0);
+}
+
+static int
+start_image_compressor (const char *image_path, pid_t *pid_out, int *done_fd_out, libcrun_error_t *err)
+{
+  int pipefd[2];
+  pid_t pid;
+
+  if (UNLIKELY (pipe2 (pipefd, O_CLOEXEC) < 0))
+    return crun_make_error (err, errno, "pipe");
+
+  pid = fork ();
+  if (UNLIKELY (pid < 0))
+    {
+      TEMP_FAILURE_RETRY (close (pipefd[0]));
+      TEMP_FAILURE_RETRY (close (pipefd[1]));
+      return crun_make_error (err, errno, "fork checkpoint compressor");
+    }
+  if (pid == 0)
+    {
+      TEMP_FAILURE_RETRY (close (pipefd[1]));
+      checkpoint_compress_worker (image_path, pipefd[0]);
+    }
+
+  TEMP_FAILURE_RETRY (close (pipefd[0]));
+  *pid_out = pid;
+  *done_fd_out = pipefd[1];
+  return 0;
+}
+
+static int
+finish_image_compressor (pid_t pid, int *done_fd, libcrun_error_t *err)
+{
+  int ret, wait_status;
+
+  close_and_reset (done_fd);
+
+  ret = TEMP_FAILURE_RETRY (waitpid (pid, &wait_status, 0));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "waitpid for the checkpoint compressor");
+  if (! WIFEXITED (wait_status) || WEXITSTATUS (wait_status) != 0)
+    return crun_make_error (err, 0, "compressing the checkpoint images failed, is zstd installed?");
+  return 0;
+}
+
+/* Ask the kernel to read the image set ahead of the restore.  CRIU walks
+   the images with sequential reads and would otherwise leave the device
+   idle between them; with the whole set queued up front the page-in
+   bandwidth approaches what the device can deliver.  Purely best effort:
+   any failure just means a cold read later.  */
+static void
+prefetch_checkpoint_images (const char *image_path)
+{
+  cleanup_dir DIR *dir = NULL;
+  struct dirent *de;
+
+  dir = opendir (image_path);
+  if (dir == NULL)
+    return;
+
+  for (de = readdir (dir); de; de = readdir (dir))
+    {
+      cleanup_close int fd = -1;
+
+      if (de->d_name[0] == '.')
+        continue;
+
+      fd = openat (dirfd (dir), de->d_name, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+      if (fd < 0)
+        continue;
+
+      posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+    }
+}
+
+static pid_t
+spawn_zstd_decompress (char **files, size_t n_files)
+{
+  pid_t pid = fork ();
+  if (pid != 0)
+    return pid;
+
+  {
+    char **args = xmalloc ((n_files + 5) * sizeof (char *));
+    size_t argc = 0, i;
+
+    args[argc++] = (char *) "zstd";
+    args[argc++] = (char *) "-d";
+    args[argc++] = (char *) "-q";
+    args[argc++] = (char *) "--rm";
+    for (i = 0; i < n_files; i++)
+      args[argc++] = files[i];
+    args[argc] = NULL;
+
+    execvp ("zstd", args);
+    _exit (127);
+  }
+}
+
+/* Decompress the images a `checkpoint --compress` left behind.  Directories
+   mixing compressed and plain images are fine: only the `*.zst` entries are
+   rewritten.  The files are spread over parallel zstd workers, since a
+   single invocation decompresses one file at a time.  */
+static int
+decompress_checkpoint_images (const char *image_path, libcrun_error_t *err)
+{
+  const size_t suffix_len = strlen (CHECKPOINT_COMPRESS_SUFFIX);
+  cleanup_dir DIR *dir = NULL;
+  pid_t pids[MAX_DECOMPRESS_WORKERS];
+  size_t n_files = 0, cap = 0, i;
+  long n_workers, w = 0;
+  char **paths = NULL;
+  struct dirent *de;
+  int ret = 0;
+
+  dir = opendir (image_path);
+  if (UNLIKELY (dir == NULL))
+    return crun_make_error (err, errno, "opendir `%s`", image_path);
+
+  for (de = readdir (dir); de; de = readdir (dir))
+    {
+      size_t len = strlen (de->d_name);
+      char *path;
+
+      if (len <= suffix_len || strcmp (de->d_name + len - suffix_len, CHECKPOINT_COMPRESS_SUFFIX) != 0)
+        continue;
+
+      if (n_files == cap)
+        {
+          cap = cap ? cap * 2 : 16;
+          paths = xrealloc (paths, cap * sizeof (char *));
+        }
+      xasprintf (&path, "%s/%s", image_path, de->d_name);
+      paths[n_files++] = path;
+    }
+
+  if (n_files == 0)
+    return 0;
+
+  n_workers = sysconf (_SC_NPROCESSORS_ONLN);
+  if (n_workers < 1)
+    n_workers = 1;
+  if (n_workers > MAX_DECOMPRESS_WORKERS)
+    n_workers = MAX_DECOMPRESS_WORKERS;
+  if ((size_t) n_workers > n_files)
+    n_workers = n_files;
+
+  for (w = 0; w < n_workers; w++)
+    {
+      /* Contiguous slice of the file list for this worker.  */
+      size_t from = n_files * w / n_workers;
+      size_t to = n_files * (w + 1) / n_workers;
+
+      pids[w] = spawn_zstd_decompress (paths + from, to - from);
+      if (UNLIKELY (pids[w] < 0))
+        {
+          ret = crun_make_error (err, errno, "fork");
+          break;
+        }
+    }
+
+  for (i = 0; i < (size_t) w; i++)
+    {
+      int wait_status;
+
+      if (TEMP_FAILURE_RETRY (waitpid (pids[i], &wait_status, 0)) < 0)
+        {
+          if (ret == 0)
+            ret = crun_make_error (err, errno, "waitpid");
+          continue;
+        }
+      if (! WIFEXITED (wait_status) || WEXITSTATUS (wait_status) != 0)
+        {
+          if (ret == 0)
+            ret = crun_make_error (err, 0, "decompressing the checkpoint images failed, is zstd installed?");
+        }
+    }
+
+  for (i = 0; i < n_files; i++)
+    free (paths[i]);
+  free (paths);
+  return ret;
+}
+
+/* By default libcriu forks and execs a fresh `criu swrk` process for every
+   request, paying the CRIU startup and feature negotiation cost on each
+   operation.  For iterative pre-dump loops that cost dominates the actual
+   dump work, so keep one `criu service` process per container alive next to
+   the rest of the container state and point libcriu at its socket.  */
+
+static bool
+criu_service_alive (const char *socket_path)
+{
+  libcrun_error_t tmp_err = NULL;
+  cleanup_close int fd = -1;
+
+  fd = open_unix_domain_client_socket (socket_path, 0, &tmp_err);
+  if (fd < 0)
+    {
+      crun_error_release (&tmp_err);
+      return false;
+    }
+  return true;
+}
+
+static int
+start_criu_service (const char *socket_path, const char *pid_path, libcrun_error_t *err)
+{
+  int ret, wait_status;
+  pid_t pid;
+  int i;
+
+  unlink (socket_path);
+  unlink (pid_path);
+
+  pid = fork ();
+  if (UNLIKELY (pid < 0))
+    return crun_make_error (err, errno, "fork");
+  if (pid == 0)
+    {
+      execlp ("criu", "criu", "service", "--address", socket_path, "--daemon", "--pidfile", pid_path, (char *) NULL);
+      _exit (127);
+    }
+
+  ret = TEMP_FAILURE_RETRY (waitpid (pid, &wait_status, 0));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "waitpid for `criu service`");
+  if (! WIFEXITED (wait_status) || WEXITSTATUS (wait_status) != 0)
+    return crun_make_error (err, 0, "`criu service` failed to start");
+
+  /* `--daemon` returns once the daemon forked off, the socket can still show
+     up a moment later.  */
+  for (i = 0; i < 100; i++)
+    {
+      if (criu_service_alive (socket_path))
+        return 0;
+      usleep (10000);
+    }
+  return crun_make_error (err, 0, "timed out waiting for the CRIU service socket `%s`", socket_path);
+}
+
+/* Point libcriu at the per-container CRIU service, starting the service on
+   first use.  Returns 1 when the service is used and 0 to fall back to one
+   swrk per operation; *REUSED is set when an already running service was
+   found.  The address stored in *ADDRESS must stay alive until the operation
+   completed, libcriu does not copy it.  */
+static int
+setup_criu_service (libcrun_checkpoint_restore_t *cr_options, char **address, bool *reused, libcrun_error_t *err)
+{
+  cleanup_free char *socket_path = NULL;
+  cleanup_free char *pid_path = NULL;
+  int ret;
+
+  *reused = false;
+
+  if (cr_options->state_dir == NULL || libcriu_wrapper->criu_set_service_address == NULL
+      || libcriu_wrapper->criu_set_service_comm == NULL)
+    return 0;
+
+  ret = append_paths (&socket_path, err, cr_options->state_dir, CRIU_SERVICE_SOCKET_FILENAME, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = append_paths (&pid_path, err, cr_options->state_dir, CRIU_SERVICE_PIDFILE, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (criu_service_alive (socket_path))
+    *reused = true;
+  else
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      /* The service is only an optimization, fall back to one swrk per
+         operation when it cannot be started.  */
+      ret = start_criu_service (socket_path, pid_path, &tmp_err);
+      if (UNLIKELY (ret < 0))
+        {
+          crun_error_release (&tmp_err);
+          return 0;
+        }
+    }
+
+  libcriu_wrapper->criu_set_service_comm (CRIU_COMM_SK);
+  libcriu_wrapper->criu_set_service_address (socket_path);
+  *address = socket_path;
+  socket_path = NULL;
+  return 1;
+}
+
+int
+libcrun_criu_stop_service (const char *state_dir, libcrun_error_t *err)
+{
+  cleanup_free char *socket_path = NULL;
+  cleanup_free char *pid_path = NULL;
+  cleanup_free char *content = NULL;
+  pid_t pid;
+  int ret;
+
+  ret = append_paths (&socket_path, err, state_dir, CRIU_SERVICE_SOCKET_FILENAME, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = append_paths (&pid_path, err, state_dir, CRIU_SERVICE_PIDFILE, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = read_all_file (pid_path, &content, NULL, err);
+  if (ret < 0)
+    {
+      /* No pidfile means no service was started.  */
+      crun_error_release (err);
+      return 0;
+    }
+
+  errno = 0;
+  pid = strtol (content, NULL, 10);
+  if (errno == 0 && pid > 1)
+    kill (pid, SIGTERM);
+
+  unlink (socket_path);
+  unlink (pid_path);
+  return 0;
+}
+
 int
 libcrun_container_checkpoint_linux_criu (libcrun_container_status_t *status, libcrun_container_t *container,
                                          libcrun_checkpoint_restore_t *cr_options, libcrun_error_t *err)
@@ -389,10 +834,14 @@ libcrun_container_checkpoint_linux_criu (libcrun_container_status_t *status, lib
   runtime_spec_schema_config_schema *def = container->container_def;
   cleanup_wrapper struct libcriu_wrapper_s *wrapper = NULL;
   cleanup_free char *descriptors_path = NULL;
+  cleanup_free char *service_address = NULL;
   cleanup_free char *freezer_path = NULL;
   cleanup_free char *path = NULL;
+  bool service_reused = false;
   cleanup_close int image_fd = -1;
   cleanup_close int work_fd = -1;
+  cleanup_close int compressor_done_fd = -1;
+  pid_t compressor_pid = 0;
   int cgroup_mode;
   size_t i;
   int ret;
@@ -425,7 +874,14 @@ libcrun_container_checkpoint_linux_criu (libcrun_container_status_t *status, lib
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, 0, "CRIU init failed with %d", ret);
 
-  if (! libcriu_wrapper->criu_check_version (LIBCRIU_MIN_VERSION))
+  ret = setup_criu_service (cr_options, &service_address, &service_reused, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* A reused service process was already version checked when it was started
+     and its version cannot change while it runs, so renegotiate only when
+     talking to a new CRIU instance.  */
+  if (! service_reused && ! libcriu_wrapper->criu_check_version (LIBCRIU_MIN_VERSION))
     return crun_make_error (err, 0, "libcriu is too old");
 
   if (UNLIKELY (cr_options->image_path == NULL))
@@ -641,11 +1097,75 @@ libcrun_container_checkpoint_linux_criu (libcrun_container_status_t *status, lib
     libcriu_wrapper->criu_set_manage_cgroups_mode (cr_options->manage_cgroups_mode);
   libcriu_wrapper->criu_set_manage_cgroups (true);
 
+  /* Post-copy migration: do not write the memory pages into the images but
+   * start a page server that the lazy-pages daemon on the destination node
+   * connects to, so the restored container faults pages in on demand. */
+  if (cr_options->lazy_pages || cr_options->page_server_address != NULL)
+    {
+      if (libcriu_wrapper->criu_set_lazy_pages == NULL
+          || libcriu_wrapper->criu_set_page_server_address_port == NULL)
+        return crun_make_error (err, 0, "lazy pages support not available in libcriu");
+
+      libcriu_wrapper->criu_set_lazy_pages (cr_options->lazy_pages);
+
+      if (cr_options->page_server_address != NULL)
+        {
+          if (cr_options->page_server_port == 0)
+            return crun_make_error (err, 0, "page server address specified without a port");
+
+          ret = libcriu_wrapper->criu_set_page_server_address_port (cr_options->page_server_address,
+                                                                    cr_options->page_server_port);
+          if (UNLIKELY (ret < 0))
+            return crun_make_error (err, 0, "error setting CRIU page server to `%s:%d`",
+                                    cr_options->page_server_address, cr_options->page_server_port);
+        }
+    }
+
+  if (cr_options->compress)
+    {
+      /* Pre-dump chains reference memory pages in the parent images by
+         offset; compressing them would break the chain.  */
+      if (cr_options->pre_dump || cr_options->parent_path != NULL)
+        return crun_make_error (err, 0, "compression cannot be used together with pre-dump");
+
+      /* Started before the dump so images are compressed while CRIU still
+         writes the next ones.  */
+      ret = start_image_compressor (cr_options->image_path, &compressor_pid, &compressor_done_fd, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
   ret = libcriu_wrapper->criu_dump ();
   if (UNLIKELY (ret != 0))
-    return crun_make_error (err, 0,
-                            "CRIU checkpointing failed %d.  Please check CRIU logfile %s/%s",
-                            ret, cr_options->work_path, CRIU_CHECKPOINT_LOG_FILE);
+    {
+      if (compressor_pid > 0)
+        {
+          libcrun_error_t tmp_err = NULL;
+
+          if (finish_image_compressor (compressor_pid, &compressor_done_fd, &tmp_err) < 0)
+            crun_error_release (&tmp_err);
+        }
+      return crun_make_error (err, 0,
+                              "CRIU checkpointing failed %d.  Please check CRIU logfile %s/%s",
+                              ret, cr_options->work_path, CRIU_CHECKPOINT_LOG_FILE);
+    }
+
+  if (compressor_pid > 0)
+    {
+      ret = finish_image_compressor (compressor_pid, &compressor_done_fd, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  /* A final dump ends the checkpoint sequence.  Unless the container keeps
+     running there will be no further operation for the service to serve.  */
+  if (! cr_options->leave_running && cr_options->state_dir != NULL)
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      if (libcrun_criu_stop_service (cr_options->state_dir, &tmp_err) < 0)
+        crun_error_release (&tmp_err);
+    }
 
   return 0;
 }
@@ -758,6 +1278,16 @@ libcrun_container_restore_linux_criu (libcrun_container_status_t *status, libcru
   if (UNLIKELY (cr_options->image_path == NULL))
     return crun_make_error (err, 0, "image path not set");
 
+  /* Queue readahead for the whole image set before anything reads it, so
+     the decompression workers and CRIU itself mostly hit the page cache.  */
+  prefetch_checkpoint_images (cr_options->image_path);
+
+  /* Images from a `checkpoint --compress` are detected by their suffix, no
+     option needed on the restore side.  */
+  ret = decompress_checkpoint_images (cr_options->image_path, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   image_fd = open (cr_options->image_path, O_DIRECTORY | O_CLOEXEC);
   if (UNLIKELY (image_fd == -1))
     return crun_make_error (err, errno, "error opening checkpoint directory `%s`", cr_options->image_path);
@@ -962,6 +1492,19 @@ libcrun_container_restore_linux_criu (libcrun_container_status_t *status, libcru
   libcriu_wrapper->criu_set_orphan_pts_master (true);
   libcriu_wrapper->criu_set_manage_cgroups (true);
 
+  /* Restore with lazy pages: the memory pages are not read from the images
+   * but faulted in over the network from the page server on the source
+   * node, via the lazy-pages daemon listening in the work directory. */
+  if (cr_options->lazy_pages)
+    {
+      if (libcriu_wrapper->criu_set_lazy_pages == NULL)
+        {
+          ret = crun_make_error (err, 0, "lazy pages support not available in libcriu");
+          goto out_umount;
+        }
+      libcriu_wrapper->criu_set_lazy_pages (true);
+    }
+
   libcriu_wrapper->criu_set_log_level (4);
   libcriu_wrapper->criu_set_log_file (CRIU_RESTORE_LOG_FILE);
   ret = libcriu_wrapper->criu_restore_child ();
@@ -32,6 +32,11 @@ int libcrun_container_checkpoint_linux_criu (libcrun_container_status_t *status,
 int libcrun_container_restore_linux_criu (libcrun_container_status_t *status, libcrun_container_t *container,
                                           libcrun_checkpoint_restore_t *cr_options, libcrun_error_t *err);
 
+/* Stop the persistent `criu service` process for the container with the
+   given state directory, if one is running.  It is a no-op when no service
+   was started.  */
+int libcrun_criu_stop_service (const char *state_dir, libcrun_error_t *err);
+
 #else
 
 static inline int
@@ -50,5 +55,11 @@ libcrun_container_restore_linux_criu (arg_unused libcrun_container_status_t *sta
   return crun_make_error (err, 0, "compiled without CRIU support. Restore not available");
 }
 
+static inline int
+libcrun_criu_stop_service (arg_unused const char *state_dir, arg_unused libcrun_error_t *err)
+{
+  return 0;
+}
+
 #endif
 #endif
@@ -78,6 +78,11 @@ struct custom_handler_manager_s
 {
   struct custom_handler_s **handlers;
   void **handles;
+  /* Pool of loaded runtimes.  A handler is loaded at most once for the
+     lifetime of the manager and its cookie is shared among the containers,
+     so repeated starts through the same manager skip the library loading.  */
+  void **cookies;
+  bool *loaded;
   size_t handlers_len;
 };
 
@@ -105,6 +110,11 @@ libcrun_handler_manager_create (libcrun_error_t *err arg_unused)
   m = xmalloc0 (sizeof (struct custom_handler_manager_s));
   m->handlers = handlers;
   m->handles = handles;
+  if (handlers_len)
+    {
+      m->cookies = xmalloc0 (sizeof (void *) * handlers_len);
+      m->loaded = xmalloc0 (sizeof (bool) * handlers_len);
+    }
   m->handlers_len = handlers_len;
 
   return m;
@@ -117,6 +127,15 @@ handler_manager_free (struct custom_handler_manager_s *manager)
 
   for (i = 0; i < manager->handlers_len; i++)
     {
+      if (manager->loaded[i] && manager->handlers[i]->unload)
+        {
+          libcrun_error_t tmp_err = NULL;
+          int tmp_ret;
+
+          tmp_ret = manager->handlers[i]->unload (manager->cookies[i], &tmp_err);
+          if (UNLIKELY (tmp_ret < 0))
+            crun_error_release (&tmp_err);
+        }
 #ifdef HAVE_DLOPEN
       if (manager->handles[i])
         dlclose (manager->handles[i]);
@@ -124,6 +143,8 @@ handler_manager_free (struct custom_handler_manager_s *manager)
     }
   free (manager->handlers);
   free (manager->handles);
+  free (manager->cookies);
+  free (manager->loaded);
   free (manager);
 }
 
@@ -144,9 +165,13 @@ handler_manager_add_so (struct custom_handler_manager_s *manager, void *handle,
 
   manager->handlers = xrealloc (manager->handlers, sizeof (struct custom_handler_s *) * (manager->handlers_len + 1));
   manager->handles = xrealloc (manager->handles, sizeof (void *) * (manager->handlers_len + 1));
+  manager->cookies = xrealloc (manager->cookies, sizeof (void *) * (manager->handlers_len + 1));
+  manager->loaded = xrealloc (manager->loaded, sizeof (bool) * (manager->handlers_len + 1));
 
   manager->handlers[manager->handlers_len] = h;
   manager->handles[manager->handlers_len] = handle;
+  manager->cookies[manager->handlers_len] = NULL;
+  manager->loaded[manager->handlers_len] = false;
   manager->handlers_len++;
   return 0;
 }
@@ -220,15 +245,54 @@ libcrun_handler_manager_print_feature_tags (struct custom_handler_manager_s *man
       fprintf (out, "+%s ", manager->handlers[i]->feature_string);
 }
 
-static inline struct custom_handler_instance_s *
-make_custom_handler_instance_s (struct custom_handler_s *vtable)
+/* Create an instance for the handler, loading its runtime through the
+   manager pool so that a second container reuses the already loaded
+   runtime.  */
+static int
+make_custom_handler_instance (struct custom_handler_manager_s *manager,
+                              struct custom_handler_s *vtable,
+                              struct custom_handler_instance_s **out,
+                              libcrun_error_t *err)
 {
-  struct custom_handler_instance_s *ret = xmalloc0 (sizeof (struct custom_handler_instance_s));
+  struct custom_handler_instance_s *instance;
+  size_t i;
+
+  instance = xmalloc0 (sizeof (struct custom_handler_instance_s));
+  instance->vtable = vtable;
+
+  if (vtable->load == NULL)
+    {
+      *out = instance;
+      return 0;
+    }
 
-  ret->vtable = vtable;
-  ret->cookie = NULL;
+  for (i = 0; i < manager->handlers_len; i++)
+    if (manager->handlers[i] == vtable)
+      break;
+
+  if (i < manager->handlers_len)
+    {
+      if (! manager->loaded[i])
+        {
+          int ret;
+
+          ret = vtable->load (&manager->cookies[i], err);
+          if (UNLIKELY (ret < 0))
+            {
+              free (instance);
+              return ret;
+            }
+          manager->loaded[i] = true;
+        }
+
+      instance->cookie = manager->cookies[i];
+      instance->cookie_shared = true;
+      *out = instance;
+      return 0;
+    }
 
-  return ret;
+  *out = instance;
+  return vtable->load (&instance->cookie, err);
 }
 
 static int
@@ -253,13 +317,7 @@ find_handler_for_container (struct custom_handler_manager_s *manager,
         return ret;
 
       if (ret)
-        {
-          *out = make_custom_handler_instance_s (manager->handlers[i]);
-          if ((*out)->vtable->load)
-            return (*out)->vtable->load (&((*out)->cookie), err);
-
-          return 0;
-        }
+        return make_custom_handler_instance (manager, manager->handlers[i], out, err);
     }
 
   return 0;
@@ -303,12 +361,7 @@ libcrun_configure_handler (struct custom_handler_manager_s *manager,
 
       h = handler_by_name (manager, explicit_handler);
       if (h)
-        {
-          *out = make_custom_handler_instance_s (h);
-          if ((*out)->vtable->load)
-            return (*out)->vtable->load (&((*out)->cookie), err);
-          return 0;
-        }
+        return make_custom_handler_instance (manager, h, out, err);
     }
 
   if (manager == NULL)
@@ -48,6 +48,14 @@ struct custom_handler_s
   int (*modify_oci_configuration) (void *cookie, libcrun_context_t *context,
                                    runtime_spec_schema_config_schema *def,
                                    libcrun_error_t *err);
+
+  /* Called by libcrun_container_update after the new limits were applied to
+     the cgroup, so the handler can propagate them to a running sandbox.
+     Optional.  */
+  int (*update_resources) (void *cookie, libcrun_context_t *context, libcrun_container_t *container,
+                           libcrun_container_status_t *status,
+                           runtime_spec_schema_config_linux_resources *resources,
+                           libcrun_error_t *err);
 };
 
 struct custom_handler_manager_s;
@@ -63,6 +71,9 @@ struct custom_handler_instance_s
 {
   struct custom_handler_s *vtable;
   void *cookie;
+  /* The cookie is owned by the handler manager pool and shared among the
+     containers, it must not be unloaded with the instance.  */
+  bool cookie_shared;
 };
 
 LIBCRUN_PUBLIC int libcrun_configure_handler (struct custom_handler_manager_s *manager,
@@ -81,7 +92,7 @@ cleanup_custom_handler_instancep (struct custom_handler_instance_s **p)
   struct custom_handler_instance_s *handler = (struct custom_handler_instance_s *) *p;
   if (handler)
     {
-      if (handler->vtable)
+      if (handler->vtable && ! handler->cookie_shared)
         {
           libcrun_error_t tmp_err = NULL;
           int tmp_ret;
@@ -0,0 +1,79 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include "dl-seccomp.h"
+#include "utils.h"
+
+#if defined HAVE_SECCOMP && defined HAVE_DLOPEN
+
+#  include <dlfcn.h>
+#  include <stdbool.h>
+
+#  define LIBSECCOMP_SO "libseccomp.so.2"
+
+struct libseccomp_syms_s libseccomp_syms;
+
+int
+libcrun_load_libseccomp (libcrun_error_t *err)
+{
+  static bool loaded = false;
+  void *handle;
+
+  if (loaded)
+    return 0;
+
+  handle = dlopen (LIBSECCOMP_SO, RTLD_NOW);
+  if (UNLIKELY (handle == NULL))
+    return crun_make_error (err, 0, "load `%s`: `%s`", LIBSECCOMP_SO, dlerror ());
+
+#  define LOAD_SYM(member, sym)                                                        \
+    do                                                                                 \
+      {                                                                                \
+        *(void **) &libseccomp_syms.member = dlsym (handle, sym);                      \
+        if (UNLIKELY (libseccomp_syms.member == NULL))                                 \
+          {                                                                            \
+            dlclose (handle);                                                          \
+            return crun_make_error (err, 0, "symbol `%s` not found in `%s`", sym,      \
+                                    LIBSECCOMP_SO);                                    \
+          }                                                                            \
+      }                                                                                \
+    while (0)
+
+  LOAD_SYM (init, "seccomp_init");
+  LOAD_SYM (release, "seccomp_release");
+#  ifdef SECCOMP_ARCH_RESOLVE_NAME
+  LOAD_SYM (arch_resolve_name, "seccomp_arch_resolve_name");
+#  endif
+  LOAD_SYM (arch_add, "seccomp_arch_add");
+  LOAD_SYM (rule_add, "seccomp_rule_add");
+  LOAD_SYM (rule_add_array, "seccomp_rule_add_array");
+  LOAD_SYM (export_bpf, "seccomp_export_bpf");
+  LOAD_SYM (syscall_resolve_name, "seccomp_syscall_resolve_name");
+  LOAD_SYM (version, "seccomp_version");
+  LOAD_SYM (attr_set, "seccomp_attr_set");
+  LOAD_SYM (syscall_priority, "seccomp_syscall_priority");
+  LOAD_SYM (arch_remove, "seccomp_arch_remove");
+  LOAD_SYM (arch_native, "seccomp_arch_native");
+
+#  undef LOAD_SYM
+
+  loaded = true;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DL_SECCOMP_H
+#define DL_SECCOMP_H
+
+#include <config.h>
+#include "error.h"
+
+#ifdef HAVE_SECCOMP
+#  include <seccomp.h>
+
+#  ifdef HAVE_DLOPEN
+
+/* Every libseccomp entry point used by crun.  The library is resolved with
+   dlopen the first time a profile must be compiled, so the many invocations
+   that reuse a cached bpf filter or have no seccomp profile at all do not
+   pay the dynamic linker for it.  */
+struct libseccomp_syms_s
+{
+  scmp_filter_ctx (*init) (uint32_t def_action);
+  void (*release) (scmp_filter_ctx ctx);
+  uint32_t (*arch_resolve_name) (const char *arch_name);
+  int (*arch_add) (scmp_filter_ctx ctx, uint32_t arch_token);
+  int (*rule_add) (scmp_filter_ctx ctx, uint32_t action, int syscall, unsigned int arg_cnt, ...);
+  int (*rule_add_array) (scmp_filter_ctx ctx, uint32_t action, int syscall, unsigned int arg_cnt,
+                         const struct scmp_arg_cmp *arg_array);
+  int (*export_bpf) (const scmp_filter_ctx ctx, int fd);
+  int (*syscall_resolve_name) (const char *name);
+  const struct scmp_version *(*version) (void);
+  int (*attr_set) (scmp_filter_ctx ctx, enum scmp_filter_attr attr, uint32_t value);
+  int (*syscall_priority) (scmp_filter_ctx ctx, int syscall, uint8_t priority);
+  int (*arch_remove) (scmp_filter_ctx ctx, uint32_t arch_token);
+  uint32_t (*arch_native) (void);
+};
+
+extern struct libseccomp_syms_s libseccomp_syms;
+
+/* Resolve libseccomp and fill the symbols table.  It is a no-op after the
+   first successful call.  */
+int libcrun_load_libseccomp (libcrun_error_t *err);
+
+/* Route the callers through the table without changing them.  The seccomp_*
+   names below must not be used before libcrun_load_libseccomp succeeded.  */
+#    define seccomp_init libseccomp_syms.init
+#    define seccomp_release libseccomp_syms.release
+#    define seccomp_arch_resolve_name libseccomp_syms.arch_resolve_name
+#    define seccomp_arch_add libseccomp_syms.arch_add
+#    define seccomp_rule_add libseccomp_syms.rule_add
+#    define seccomp_rule_add_array libseccomp_syms.rule_add_array
+#    define seccomp_export_bpf libseccomp_syms.export_bpf
+#    define seccomp_syscall_resolve_name libseccomp_syms.syscall_resolve_name
+#    define seccomp_version libseccomp_syms.version
+#    define seccomp_attr_set libseccomp_syms.attr_set
+#    define seccomp_syscall_priority libseccomp_syms.syscall_priority
+#    define seccomp_arch_remove libseccomp_syms.arch_remove
+#    define seccomp_arch_native libseccomp_syms.arch_native
+
+#  else
+
+/* Without dlopen the library is linked as usual and there is nothing to
+   resolve.  */
+static inline int
+libcrun_load_libseccomp (libcrun_error_t *err)
+{
+  (void) err;
+  return 0;
+}
+
+#  endif
+
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include "dl-systemd.h"
+#include "utils.h"
+
+#if defined HAVE_SYSTEMD && defined HAVE_DLOPEN
+
+#  include <dlfcn.h>
+#  include <stdbool.h>
+
+#  define LIBSYSTEMD_SO "libsystemd.so.0"
+
+struct libsystemd_syms_s libsystemd_syms;
+
+int
+libcrun_load_libsystemd (libcrun_error_t *err)
+{
+  static bool loaded = false;
+  void *handle;
+
+  if (loaded)
+    return 0;
+
+  handle = dlopen (LIBSYSTEMD_SO, RTLD_NOW);
+  if (UNLIKELY (handle == NULL))
+    return crun_make_error (err, 0, "load `%s`: `%s`", LIBSYSTEMD_SO, dlerror ());
+
+#  define LOAD_SYM(member, sym)                                                        \
+    do                                                                                 \
+      {                                                                                \
+        *(void **) &libsystemd_syms.member = dlsym (handle, sym);                      \
+        if (UNLIKELY (libsystemd_syms.member == NULL))                                 \
+          {                                                                            \
+            dlclose (handle);                                                          \
+            return crun_make_error (err, 0, "symbol `%s` not found in `%s`", sym,      \
+                                    LIBSYSTEMD_SO);                                    \
+          }                                                                            \
+      }                                                                                \
+    while (0)
+
+  LOAD_SYM (bus_default_user, "sd_bus_default_user");
+  LOAD_SYM (bus_default_system, "sd_bus_default_system");
+  LOAD_SYM (bus_ref, "sd_bus_ref");
+  LOAD_SYM (bus_unref, "sd_bus_unref");
+  LOAD_SYM (bus_process, "sd_bus_process");
+  LOAD_SYM (bus_wait, "sd_bus_wait");
+  LOAD_SYM (bus_call, "sd_bus_call");
+  LOAD_SYM (bus_call_async, "sd_bus_call_async");
+  LOAD_SYM (bus_match_signal_async, "sd_bus_match_signal_async");
+  LOAD_SYM (bus_slot_unref, "sd_bus_slot_unref");
+  LOAD_SYM (bus_message_new_method_call, "sd_bus_message_new_method_call");
+  LOAD_SYM (bus_message_ref, "sd_bus_message_ref");
+  LOAD_SYM (bus_message_unref, "sd_bus_message_unref");
+  LOAD_SYM (bus_message_append, "sd_bus_message_append");
+  LOAD_SYM (bus_message_append_basic, "sd_bus_message_append_basic");
+  LOAD_SYM (bus_message_append_array, "sd_bus_message_append_array");
+  LOAD_SYM (bus_message_append_strv, "sd_bus_message_append_strv");
+  LOAD_SYM (bus_message_open_container, "sd_bus_message_open_container");
+  LOAD_SYM (bus_message_close_container, "sd_bus_message_close_container");
+  LOAD_SYM (bus_message_read, "sd_bus_message_read");
+  LOAD_SYM (bus_message_is_method_error, "sd_bus_message_is_method_error");
+  LOAD_SYM (bus_message_get_error, "sd_bus_message_get_error");
+  LOAD_SYM (bus_error_free, "sd_bus_error_free");
+  LOAD_SYM (bus_error_get_errno, "sd_bus_error_get_errno");
+  LOAD_SYM (bus_error_copy, "sd_bus_error_copy");
+  LOAD_SYM (notify, "sd_notify");
+#  ifdef HAVE_SD_NOTIFY_BARRIER
+  LOAD_SYM (notify_barrier, "sd_notify_barrier");
+#  endif
+  LOAD_SYM (journal_send, "sd_journal_send");
+
+#  undef LOAD_SYM
+
+  loaded = true;
+  return 0;
+}
+
+#endif
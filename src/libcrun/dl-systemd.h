@@ -0,0 +1,123 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DL_SYSTEMD_H
+#define DL_SYSTEMD_H
+
+#include <config.h>
+#include "error.h"
+
+#ifdef HAVE_SYSTEMD
+#  include <systemd/sd-bus.h>
+#  include <systemd/sd-daemon.h>
+#  include <systemd/sd-journal.h>
+
+#  ifdef HAVE_DLOPEN
+
+/* Every libsystemd entry point used by crun.  The library is resolved with
+   dlopen on first use instead of being linked eagerly, so invocations that
+   never talk to systemd do not pay the dynamic linker for the library and
+   its dependencies.  */
+struct libsystemd_syms_s
+{
+  int (*bus_default_user) (sd_bus **ret);
+  int (*bus_default_system) (sd_bus **ret);
+  sd_bus *(*bus_ref) (sd_bus *bus);
+  sd_bus *(*bus_unref) (sd_bus *bus);
+  int (*bus_process) (sd_bus *bus, sd_bus_message **r);
+  int (*bus_wait) (sd_bus *bus, uint64_t timeout_usec);
+  int (*bus_call) (sd_bus *bus, sd_bus_message *m, uint64_t usec, sd_bus_error *ret_error, sd_bus_message **reply);
+  int (*bus_call_async) (sd_bus *bus, sd_bus_slot **slot, sd_bus_message *m, sd_bus_message_handler_t callback,
+                         void *userdata, uint64_t usec);
+  int (*bus_match_signal_async) (sd_bus *bus, sd_bus_slot **ret, const char *sender, const char *path,
+                                 const char *interface, const char *member, sd_bus_message_handler_t callback,
+                                 sd_bus_message_handler_t install_callback, void *userdata);
+  sd_bus_slot *(*bus_slot_unref) (sd_bus_slot *slot);
+  int (*bus_message_new_method_call) (sd_bus *bus, sd_bus_message **m, const char *destination, const char *path,
+                                      const char *interface, const char *member);
+  sd_bus_message *(*bus_message_ref) (sd_bus_message *m);
+  sd_bus_message *(*bus_message_unref) (sd_bus_message *m);
+  int (*bus_message_append) (sd_bus_message *m, const char *types, ...);
+  int (*bus_message_append_basic) (sd_bus_message *m, char type, const void *p);
+  int (*bus_message_append_array) (sd_bus_message *m, char type, const void *ptr, size_t size);
+  int (*bus_message_append_strv) (sd_bus_message *m, char **l);
+  int (*bus_message_open_container) (sd_bus_message *m, char type, const char *contents);
+  int (*bus_message_close_container) (sd_bus_message *m);
+  int (*bus_message_read) (sd_bus_message *m, const char *types, ...);
+  int (*bus_message_is_method_error) (sd_bus_message *m, const char *name);
+  const sd_bus_error *(*bus_message_get_error) (sd_bus_message *m);
+  void (*bus_error_free) (sd_bus_error *e);
+  int (*bus_error_get_errno) (const sd_bus_error *e);
+  int (*bus_error_copy) (sd_bus_error *dest, const sd_bus_error *e);
+  int (*notify) (int unset_environment, const char *state);
+  int (*notify_barrier) (int unset_environment, uint64_t timeout);
+  int (*journal_send) (const char *format, ...);
+};
+
+extern struct libsystemd_syms_s libsystemd_syms;
+
+/* Resolve libsystemd and fill the symbols table.  It is a no-op after the
+   first successful call.  */
+int libcrun_load_libsystemd (libcrun_error_t *err);
+
+/* Route the callers through the table without changing them.  The sd_*
+   names below must not be used before libcrun_load_libsystemd succeeded.  */
+#    define sd_bus_default_user libsystemd_syms.bus_default_user
+#    define sd_bus_default_system libsystemd_syms.bus_default_system
+#    define sd_bus_ref libsystemd_syms.bus_ref
+#    define sd_bus_unref libsystemd_syms.bus_unref
+#    define sd_bus_process libsystemd_syms.bus_process
+#    define sd_bus_wait libsystemd_syms.bus_wait
+#    define sd_bus_call libsystemd_syms.bus_call
+#    define sd_bus_call_async libsystemd_syms.bus_call_async
+#    define sd_bus_match_signal_async libsystemd_syms.bus_match_signal_async
+#    define sd_bus_slot_unref libsystemd_syms.bus_slot_unref
+#    define sd_bus_message_new_method_call libsystemd_syms.bus_message_new_method_call
+#    define sd_bus_message_ref libsystemd_syms.bus_message_ref
+#    define sd_bus_message_unref libsystemd_syms.bus_message_unref
+#    define sd_bus_message_append libsystemd_syms.bus_message_append
+#    define sd_bus_message_append_basic libsystemd_syms.bus_message_append_basic
+#    define sd_bus_message_append_array libsystemd_syms.bus_message_append_array
+#    define sd_bus_message_append_strv libsystemd_syms.bus_message_append_strv
+#    define sd_bus_message_open_container libsystemd_syms.bus_message_open_container
+#    define sd_bus_message_close_container libsystemd_syms.bus_message_close_container
+#    define sd_bus_message_read libsystemd_syms.bus_message_read
+#    define sd_bus_message_is_method_error libsystemd_syms.bus_message_is_method_error
+#    define sd_bus_message_get_error libsystemd_syms.bus_message_get_error
+#    define sd_bus_error_free libsystemd_syms.bus_error_free
+#    define sd_bus_error_get_errno libsystemd_syms.bus_error_get_errno
+#    define sd_bus_error_copy libsystemd_syms.bus_error_copy
+#    define sd_notify libsystemd_syms.notify
+#    define sd_notify_barrier libsystemd_syms.notify_barrier
+#    define sd_journal_send libsystemd_syms.journal_send
+
+#  else
+
+/* Without dlopen the library is linked as usual and there is nothing to
+   resolve.  */
+static inline int
+libcrun_load_libsystemd (libcrun_error_t *err)
+{
+  (void) err;
+  return 0;
+}
+
+#  endif
+
+#endif
+
+#endif
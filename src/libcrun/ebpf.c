@@ -47,7 +47,20 @@ ptr_to_u64 (const void *ptr)
 
 enum
 {
-  HAS_WILDCARD = 1
+  HAS_WILDCARD = 1,
+  USES_DEV_MAP = 2,
+};
+
+/* One device rule as recorded by bpf_program_append_dev.  ACCESS is the
+   BPF_DEVCG_ACC_* mask; a negative major/minor or type 'a' means a
+   wildcard.  */
+struct dev_rule_s
+{
+  char type;
+  int major;
+  int minor;
+  int access;
+  bool accept;
 };
 
 struct bpf_program
@@ -55,6 +68,14 @@ struct bpf_program
   size_t allocated;
   size_t used;
   unsigned int private;
+  /* Device rules recorded by bpf_program_append_dev, consumed and freed by
+     bpf_program_complete_dev when the instructions are generated.  */
+  struct dev_rule_s *rules;
+  size_t n_rules;
+  size_t rules_allocated;
+  /* Devices map referenced by the program, closed once the program that
+     holds a reference to it was loaded.  */
+  int map_fd;
   char program[];
 };
 
@@ -87,6 +108,26 @@ struct bpf_program
 
 #  define BPF_EXIT_INSN() \
     ((struct bpf_insn){ .code = BPF_JMP | BPF_EXIT, .dst_reg = 0, .src_reg = 0, .off = 0, .imm = 0 })
+
+#  define BPF_ALU64_IMM(OP, DST, IMM) \
+    ((struct bpf_insn){ .code = BPF_ALU64 | BPF_OP (OP) | BPF_K, .dst_reg = DST, .src_reg = 0, .off = 0, .imm = IMM })
+
+#  define BPF_ALU32_REG(OP, DST, SRC) \
+    ((struct bpf_insn){ .code = BPF_ALU | BPF_OP (OP) | BPF_X, .dst_reg = DST, .src_reg = SRC, .off = 0, .imm = 0 })
+
+#  define BPF_STX_MEM(SIZE, DST, SRC, OFF) \
+    ((struct bpf_insn){                    \
+        .code = BPF_STX | BPF_SIZE (SIZE) | BPF_MEM, .dst_reg = DST, .src_reg = SRC, .off = OFF, .imm = 0 })
+
+#  define BPF_EMIT_CALL(FUNC) \
+    ((struct bpf_insn){ .code = BPF_JMP | BPF_CALL, .dst_reg = 0, .src_reg = 0, .off = 0, .imm = FUNC })
+
+/* A 64 bit immediate load takes two instruction slots.  */
+#  define BPF_LD_IMM64_RAW_1(DST, SRC, IMM)                                                       \
+    ((struct bpf_insn){                                                                           \
+        .code = BPF_LD | BPF_DW | BPF_IMM, .dst_reg = DST, .src_reg = SRC, .off = 0, .imm = IMM })
+#  define BPF_LD_IMM64_RAW_2(IMM) \
+    ((struct bpf_insn){ .code = 0, .dst_reg = 0, .src_reg = 0, .off = 0, .imm = IMM })
 #endif
 
 #ifdef HAVE_EBPF
@@ -105,6 +146,10 @@ bpf_program_new (size_t size)
   p->used = 0;
   p->private = 0;
   p->allocated = size;
+  p->rules = NULL;
+  p->n_rules = 0;
+  p->rules_allocated = 0;
+  p->map_fd = -1;
 
   return p;
 }
@@ -152,18 +197,8 @@ bpf_program_append_dev (struct bpf_program *program, const char *access, char ty
                         libcrun_error_t *err arg_unused)
 {
 #ifdef HAVE_EBPF
+  struct dev_rule_s rule = { .type = type, .major = major, .minor = minor, .access = 0, .accept = accept };
   int i;
-  int bpf_access = 0;
-  int bpf_type = type == 'b' ? BPF_DEVCG_DEV_BLOCK : BPF_DEVCG_DEV_CHAR;
-  bool has_type = type != 'a';
-  bool has_major = major >= 0;
-  bool has_minor = minor >= 0;
-  bool has_access = false;
-  int number_instructions = 0;
-  struct bpf_insn accept_block[] = {
-    BPF_MOV64_IMM (BPF_REG_0, accept ? 1 : 0),
-    BPF_EXIT_INSN (),
-  };
 
   if (access == NULL)
     access = "";
@@ -176,19 +211,62 @@ bpf_program_append_dev (struct bpf_program *program, const char *access, char ty
       switch (access[i])
         {
         case 'r':
-          bpf_access |= BPF_DEVCG_ACC_READ;
+          rule.access |= BPF_DEVCG_ACC_READ;
           break;
 
         case 'w':
-          bpf_access |= BPF_DEVCG_ACC_WRITE;
+          rule.access |= BPF_DEVCG_ACC_WRITE;
           break;
 
         case 'm':
-          bpf_access |= BPF_DEVCG_ACC_MKNOD;
+          rule.access |= BPF_DEVCG_ACC_MKNOD;
           break;
         }
     }
 
+  /* The rule is only recorded here, the instructions are generated by
+     bpf_program_complete_dev once the whole set is known.  */
+  if (program->n_rules == program->rules_allocated)
+    {
+      program->rules_allocated = program->rules_allocated ? program->rules_allocated * 2 : 16;
+      program->rules = xrealloc (program->rules, program->rules_allocated * sizeof (struct dev_rule_s));
+    }
+  program->rules[program->n_rules++] = rule;
+
+  /* A rule matching any device makes the rest of the program unreachable.  */
+  if (type == 'a' && major < 0 && minor < 0
+      && rule.access == (BPF_DEVCG_ACC_READ | BPF_DEVCG_ACC_WRITE | BPF_DEVCG_ACC_MKNOD))
+    program->private |= HAS_WILDCARD;
+#endif
+  (void) access;
+  (void) type;
+  (void) major;
+  (void) minor;
+  (void) accept;
+
+  return program;
+}
+
+#ifdef HAVE_EBPF
+
+/* Smallest number of exact rules for which the hash map variant of the
+   program is generated.  */
+#  define EBPF_DEV_MAP_MIN_RULES 16
+
+static struct bpf_program *
+bpf_program_emit_dev_rule (struct bpf_program *program, struct dev_rule_s *rule)
+{
+  int bpf_type = rule->type == 'b' ? BPF_DEVCG_DEV_BLOCK : BPF_DEVCG_DEV_CHAR;
+  bool has_type = rule->type != 'a';
+  bool has_major = rule->major >= 0;
+  bool has_minor = rule->minor >= 0;
+  bool has_access = false;
+  int number_instructions = 0;
+  struct bpf_insn accept_block[] = {
+    BPF_MOV64_IMM (BPF_REG_0, rule->accept ? 1 : 0),
+    BPF_EXIT_INSN (),
+  };
+
   /*
     if (request.type != device.type)
       goto next_block:
@@ -203,7 +281,7 @@ bpf_program_append_dev (struct bpf_program *program, const char *access, char ty
   */
 
   /* If the access is rwm, skip the check.  */
-  has_access = bpf_access != (BPF_DEVCG_ACC_READ | BPF_DEVCG_ACC_WRITE | BPF_DEVCG_ACC_MKNOD);
+  has_access = rule->access != (BPF_DEVCG_ACC_READ | BPF_DEVCG_ACC_WRITE | BPF_DEVCG_ACC_MKNOD);
 
   /* Number of instructions to skip the ACCEPT BLOCK.  */
   number_instructions = (has_type ? 1 : 0) + (has_access ? 3 : 0) + (has_major ? 1 : 0) + (has_minor ? 1 : 0) + 1;
@@ -218,7 +296,7 @@ bpf_program_append_dev (struct bpf_program *program, const char *access, char ty
     {
       struct bpf_insn i[] = {
         BPF_MOV32_REG (BPF_REG_1, BPF_REG_3),
-        BPF_ALU32_IMM (BPF_AND, BPF_REG_1, bpf_access),
+        BPF_ALU32_IMM (BPF_AND, BPF_REG_1, rule->access),
         BPF_JMP_REG (BPF_JNE, BPF_REG_1, BPF_REG_3, number_instructions - 2),
       };
       number_instructions -= 3;
@@ -226,44 +304,246 @@ bpf_program_append_dev (struct bpf_program *program, const char *access, char ty
     }
   if (has_major)
     {
-      struct bpf_insn i[] = { BPF_JMP_IMM (BPF_JNE, BPF_REG_4, major, number_instructions) };
+      struct bpf_insn i[] = { BPF_JMP_IMM (BPF_JNE, BPF_REG_4, rule->major, number_instructions) };
       number_instructions--;
       program = bpf_program_append (program, i, sizeof (i));
     }
   if (has_minor)
     {
-      struct bpf_insn i[] = { BPF_JMP_IMM (BPF_JNE, BPF_REG_5, minor, number_instructions) };
+      struct bpf_insn i[] = { BPF_JMP_IMM (BPF_JNE, BPF_REG_5, rule->minor, number_instructions) };
       number_instructions--;
       program = bpf_program_append (program, i, sizeof (i));
     }
 
-  if (has_type == 0 && has_access == 0 && has_major == 0 && has_minor == 0)
-    program->private |= HAS_WILDCARD;
+  return bpf_program_append (program, accept_block, sizeof (accept_block));
+}
 
-  program = bpf_program_append (program, accept_block, sizeof (accept_block));
-#endif
-  (void) access;
-  (void) type;
-  (void) major;
-  (void) minor;
-  (void) accept;
+/* Key and value of the devices hash map.  */
+struct dev_map_key_s
+{
+  uint32_t type;
+  uint32_t major;
+  uint32_t minor;
+};
 
-  return program;
+struct dev_map_value_s
+{
+  uint32_t access;
+  uint32_t accept;
+};
+
+static bool
+dev_rule_is_exact (struct dev_rule_s *rule)
+{
+  return rule->type != 'a' && rule->major >= 0 && rule->minor >= 0;
+}
+
+/* Check whether the wildcard RULE can match a request for the device that
+   the exact rule EXACT describes.  */
+static bool
+dev_rule_shadows (struct dev_rule_s *rule, struct dev_rule_s *exact)
+{
+  if (rule->type != 'a' && rule->type != exact->type)
+    return false;
+  if (rule->major >= 0 && rule->major != exact->major)
+    return false;
+  if (rule->minor >= 0 && rule->minor != exact->minor)
+    return false;
+  return (rule->access & exact->access) != 0;
 }
 
+/* Decide whether the recorded rules can be served from a hash map keyed on
+   (type, major, minor).  The rules are evaluated in order with the first
+   match winning, while the map lookup effectively gives every exact rule
+   precedence over the wildcard rules left in the fallback chain.  That is
+   correct only when no wildcard rule appearing before an exact rule can
+   match the same device with a different outcome, and when duplicated exact
+   keys cannot change the result, so fall back to the linear program
+   otherwise.  */
+static bool
+dev_rules_map_compatible (struct dev_rule_s *rules, size_t n_rules, size_t *n_exact)
+{
+  size_t i, j;
+
+  *n_exact = 0;
+  for (i = 0; i < n_rules; i++)
+    {
+      bool duplicate = false;
+
+      if (! dev_rule_is_exact (&rules[i]))
+        continue;
+
+      for (j = 0; j < i; j++)
+        {
+          if (dev_rule_is_exact (&rules[j]))
+            {
+              if (rules[j].type == rules[i].type && rules[j].major == rules[i].major
+                  && rules[j].minor == rules[i].minor)
+                {
+                  /* The earlier rule wins; dropping the later duplicate is
+                     valid only when it cannot change the outcome.  */
+                  if (rules[j].accept != rules[i].accept
+                      || (rules[j].access & rules[i].access) != rules[i].access)
+                    return false;
+                  duplicate = true;
+                }
+            }
+          else if (rules[j].accept != rules[i].accept && dev_rule_shadows (&rules[j], &rules[i]))
+            return false;
+        }
+
+      if (! duplicate)
+        (*n_exact)++;
+    }
+
+  return *n_exact >= EBPF_DEV_MAP_MIN_RULES;
+}
+
+static int
+create_dev_map (struct dev_rule_s *rules, size_t n_rules, size_t n_exact, libcrun_error_t *err)
+{
+  cleanup_close int map_fd = -1;
+  union bpf_attr attr;
+  size_t i, j;
+  int ret;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.map_type = BPF_MAP_TYPE_HASH;
+  attr.key_size = sizeof (struct dev_map_key_s);
+  attr.value_size = sizeof (struct dev_map_value_s);
+  attr.max_entries = n_exact;
+  map_fd = bpf (BPF_MAP_CREATE, &attr, sizeof (attr));
+  if (UNLIKELY (map_fd < 0))
+    return crun_make_error (err, errno, "bpf create devices map");
+
+  for (i = 0; i < n_rules; i++)
+    {
+      struct dev_map_value_s value;
+      struct dev_map_key_s key;
+      bool duplicate = false;
+
+      if (! dev_rule_is_exact (&rules[i]))
+        continue;
+
+      /* First match wins, keep the earliest rule for each device.  */
+      for (j = 0; j < i && ! duplicate; j++)
+        duplicate = dev_rule_is_exact (&rules[j]) && rules[j].type == rules[i].type
+                    && rules[j].major == rules[i].major && rules[j].minor == rules[i].minor;
+      if (duplicate)
+        continue;
+
+      memset (&key, 0, sizeof (key));
+      key.type = rules[i].type == 'b' ? BPF_DEVCG_DEV_BLOCK : BPF_DEVCG_DEV_CHAR;
+      key.major = rules[i].major;
+      key.minor = rules[i].minor;
+
+      memset (&value, 0, sizeof (value));
+      value.access = rules[i].access;
+      value.accept = rules[i].accept ? 1 : 0;
+
+      memset (&attr, 0, sizeof (attr));
+      attr.map_fd = map_fd;
+      attr.key = ptr_to_u64 (&key);
+      attr.value = ptr_to_u64 (&value);
+      attr.flags = BPF_ANY;
+      ret = bpf (BPF_MAP_UPDATE_ELEM, &attr, sizeof (attr));
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "bpf update devices map");
+    }
+
+  ret = map_fd;
+  map_fd = -1;
+  return ret;
+}
+
+static struct bpf_program *
+bpf_program_append_dev_map_lookup (struct bpf_program *program, int map_fd)
+{
+  struct bpf_insn insn[] = {
+    /* Spill the request to the stack: the lookup key must live in memory
+       and the helper call clobbers R1-R5.  */
+    BPF_STX_MEM (BPF_W, BPF_REG_10, BPF_REG_2, -16),
+    BPF_STX_MEM (BPF_W, BPF_REG_10, BPF_REG_4, -12),
+    BPF_STX_MEM (BPF_W, BPF_REG_10, BPF_REG_5, -8),
+    BPF_STX_MEM (BPF_W, BPF_REG_10, BPF_REG_3, -20),
+
+    /* R0 = bpf_map_lookup_elem (map, &key).  */
+    BPF_LD_IMM64_RAW_1 (BPF_REG_1, BPF_PSEUDO_MAP_FD, map_fd),
+    BPF_LD_IMM64_RAW_2 (0),
+    BPF_MOV64_REG (BPF_REG_2, BPF_REG_10),
+    BPF_ALU64_IMM (BPF_ADD, BPF_REG_2, -16),
+    BPF_EMIT_CALL (BPF_FUNC_map_lookup_elem),
+    BPF_JMP_IMM (BPF_JEQ, BPF_REG_0, 0, 6),
+
+    /* Hit: the rule decides only when the requested access is a subset of
+       the rule access, otherwise continue with the wildcard chain.  */
+    BPF_LDX_MEM (BPF_W, BPF_REG_1, BPF_REG_0, offsetof (struct dev_map_value_s, access)),
+    BPF_LDX_MEM (BPF_W, BPF_REG_2, BPF_REG_10, -20),
+    BPF_ALU32_REG (BPF_AND, BPF_REG_1, BPF_REG_2),
+    BPF_JMP_REG (BPF_JNE, BPF_REG_1, BPF_REG_2, 2),
+    BPF_LDX_MEM (BPF_W, BPF_REG_0, BPF_REG_0, offsetof (struct dev_map_value_s, accept)),
+    BPF_EXIT_INSN (),
+
+    /* Miss: restore the request registers for the wildcard chain.  */
+    BPF_LDX_MEM (BPF_W, BPF_REG_2, BPF_REG_10, -16),
+    BPF_LDX_MEM (BPF_W, BPF_REG_3, BPF_REG_10, -20),
+    BPF_LDX_MEM (BPF_W, BPF_REG_4, BPF_REG_10, -12),
+    BPF_LDX_MEM (BPF_W, BPF_REG_5, BPF_REG_10, -8),
+  };
+
+  return bpf_program_append (program, insn, sizeof (insn));
+}
+
+#endif
+
 struct bpf_program *
 bpf_program_complete_dev (struct bpf_program *program, libcrun_error_t *err arg_unused)
 {
 #ifdef HAVE_EBPF
-  struct bpf_insn i[] = {
+  struct bpf_insn footer[] = {
     BPF_MOV64_IMM (BPF_REG_0, 0),
     BPF_EXIT_INSN (),
   };
+  size_t n_exact = 0;
+  size_t i;
+
+  /* With many exact rules, move them into a hash map so every device access
+     costs a single lookup instead of walking a compare chain, and the
+     verifier only sees a short program.  */
+  if (dev_rules_map_compatible (program->rules, program->n_rules, &n_exact))
+    {
+      libcrun_error_t tmp_err = NULL;
+      int map_fd;
+
+      map_fd = create_dev_map (program->rules, program->n_rules, n_exact, &tmp_err);
+      if (UNLIKELY (map_fd < 0))
+        /* The map is only an optimization, fall back to the linear program.  */
+        crun_error_release (&tmp_err);
+      else
+        {
+          program->map_fd = map_fd;
+          program->private |= USES_DEV_MAP;
+          program = bpf_program_append_dev_map_lookup (program, map_fd);
+        }
+    }
+
+  for (i = 0; i < program->n_rules; i++)
+    {
+      /* Rules served by the map lookup are not part of the fallback chain.  */
+      if ((program->private & USES_DEV_MAP) && dev_rule_is_exact (&program->rules[i]))
+        continue;
+      program = bpf_program_emit_dev_rule (program, &program->rules[i]);
+    }
+
+  free (program->rules);
+  program->rules = NULL;
+  program->n_rules = 0;
+  program->rules_allocated = 0;
 
   if (program->private & HAS_WILDCARD)
     return program;
 
-  program = bpf_program_append (program, &i, sizeof (i));
+  program = bpf_program_append (program, footer, sizeof (footer));
 #endif
   return program;
 }
@@ -447,6 +727,16 @@ ebpf_attach_program (int fd, int dirfd, libcrun_error_t *err)
 #endif
 }
 
+#ifdef HAVE_EBPF
+/* The most recently loaded device program, kept together with its
+   instructions so an identical program can be reused across containers.  */
+static struct
+{
+  struct bpf_program *program;
+  int fd;
+} loaded_program_cache = { NULL, -1 };
+#endif
+
 int
 libcrun_ebpf_load (struct bpf_program *program, int dirfd, const char *pin, libcrun_error_t *err)
 {
@@ -461,38 +751,67 @@ libcrun_ebpf_load (struct bpf_program *program, int dirfd, const char *pin, libc
   cleanup_close int fd = -1;
   union bpf_attr attr;
   struct rlimit limit;
+  int prog_fd;
   int ret;
 
-  limit.rlim_cur = RLIM_INFINITY;
-  limit.rlim_max = RLIM_INFINITY;
-  ret = setrlimit (RLIMIT_MEMLOCK, &limit);
-  if (UNLIKELY (ret < 0))
-    return crun_make_error (err, errno, "setrlimit (RLIM_MEMLOCK)");
-
-  memset (&attr, 0, sizeof (attr));
-  attr.prog_type = BPF_PROG_TYPE_CGROUP_DEVICE;
-  attr.insns = ptr_to_u64 (program->program);
-  attr.insn_cnt = bpf_program_instructions (program);
-  attr.license = ptr_to_u64 ("GPL");
-
-  /* First try without log.  */
-  fd = bpf (BPF_PROG_LOAD, &attr, sizeof (attr));
-  if (fd < 0)
+  /* Containers overwhelmingly share the same devices list, so the program
+     verified for the previous container can usually be attached as-is to the
+     new cgroup, skipping another verifier pass.  Map backed programs are not
+     cached: the devices map content is not part of the instructions.  */
+  if ((program->private & USES_DEV_MAP) == 0 && loaded_program_cache.fd >= 0
+      && loaded_program_cache.program->used == program->used
+      && memcmp (loaded_program_cache.program->program, program->program, program->used) == 0)
+    prog_fd = loaded_program_cache.fd;
+  else
     {
-      const size_t log_size = 8192;
-      cleanup_free char *log = xmalloc (log_size);
+      limit.rlim_cur = RLIM_INFINITY;
+      limit.rlim_max = RLIM_INFINITY;
+      ret = setrlimit (RLIMIT_MEMLOCK, &limit);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "setrlimit (RLIM_MEMLOCK)");
 
-      log[0] = '\0';
-      attr.log_level = 1;
-      attr.log_buf = ptr_to_u64 (log);
-      attr.log_size = log_size;
+      memset (&attr, 0, sizeof (attr));
+      attr.prog_type = BPF_PROG_TYPE_CGROUP_DEVICE;
+      attr.insns = ptr_to_u64 (program->program);
+      attr.insn_cnt = bpf_program_instructions (program);
+      attr.license = ptr_to_u64 ("GPL");
 
+      /* First try without log.  */
       fd = bpf (BPF_PROG_LOAD, &attr, sizeof (attr));
       if (fd < 0)
-        return crun_make_error (err, errno, "bpf create `%s`", log);
+        {
+          const size_t log_size = 8192;
+          cleanup_free char *log = xmalloc (log_size);
+
+          log[0] = '\0';
+          attr.log_level = 1;
+          attr.log_buf = ptr_to_u64 (log);
+          attr.log_size = log_size;
+
+          fd = bpf (BPF_PROG_LOAD, &attr, sizeof (attr));
+          if (fd < 0)
+            {
+              ret = crun_make_error (err, errno, "bpf create `%s`", log);
+              if (program->map_fd >= 0)
+                {
+                  close (program->map_fd);
+                  program->map_fd = -1;
+                }
+              return ret;
+            }
+        }
+
+      /* A loaded program holds its own reference to the devices map.  */
+      if (program->map_fd >= 0)
+        {
+          close (program->map_fd);
+          program->map_fd = -1;
+        }
+
+      prog_fd = fd;
     }
 
-  ret = ebpf_attach_program (fd, dirfd, err);
+  ret = ebpf_attach_program (prog_fd, dirfd, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -503,12 +822,28 @@ libcrun_ebpf_load (struct bpf_program *program, int dirfd, const char *pin, libc
 
       memset (&attr, 0, sizeof (attr));
       attr.pathname = ptr_to_u64 (pin);
-      attr.bpf_fd = fd;
+      attr.bpf_fd = prog_fd;
       ret = bpf (BPF_OBJ_PIN, &attr, sizeof (attr));
       if (ret < 0)
         return crun_make_error (err, errno, "bpf pin to `%s`", pin);
     }
 
+  /* The program was loaded and attached: remember it together with its
+     instructions.  */
+  if (fd >= 0 && (program->private & USES_DEV_MAP) == 0)
+    {
+      size_t size = sizeof (struct bpf_program) + program->used;
+
+      free (loaded_program_cache.program);
+      if (loaded_program_cache.fd >= 0)
+        close (loaded_program_cache.fd);
+
+      loaded_program_cache.program = xmalloc (size);
+      memcpy (loaded_program_cache.program, program, size);
+      loaded_program_cache.fd = fd;
+      fd = -1;
+    }
+
   return 0;
 #endif
 }
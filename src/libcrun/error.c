@@ -25,12 +25,13 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include "utils.h"
+#include "profile.h"
 
 #include <yajl/yajl_tree.h>
 #include <yajl/yajl_gen.h>
 
 #ifdef HAVE_SYSTEMD
-#  include <systemd/sd-journal.h>
+#  include "dl-systemd.h"
 #endif
 
 #define YAJL_STR(x) ((const unsigned char *) (x))
@@ -94,6 +95,20 @@ crun_error_wrap (libcrun_error_t *err, const char *fmt, ...)
   return ret;
 }
 
+int
+crun_error_from_probe (libcrun_error_t *err, struct crun_probe_error_s *probe_err, const char *fmt, ...)
+{
+  cleanup_free char *prefix = NULL;
+  va_list args_list;
+
+  va_start (args_list, fmt);
+  if (vasprintf (&prefix, fmt, args_list) < 0)
+    OOM ();
+  va_end (args_list);
+
+  return crun_make_error (err, probe_err->status, "%s: %s", prefix, probe_err->msg);
+}
+
 int
 crun_error_release (libcrun_error_t *err)
 {
@@ -177,7 +192,8 @@ enum
 {
   LOG_TYPE_FILE = 1,
   LOG_TYPE_SYSLOG = 2,
-  LOG_TYPE_JOURNALD = 3
+  LOG_TYPE_JOURNALD = 3,
+  LOG_TYPE_TRACE = 4
 };
 
 static int
@@ -197,6 +213,8 @@ get_log_type (const char *log, const char **data)
     return LOG_TYPE_JOURNALD;
   if (has_prefix (log, "file:"))
     return LOG_TYPE_FILE;
+  if (has_prefix (log, "trace:"))
+    return LOG_TYPE_TRACE;
 
   return -1;
 }
@@ -235,9 +253,33 @@ libcrun_init_logging (crun_output_handler *new_output_handler, void **new_output
           break;
 
         case LOG_TYPE_JOURNALD:
+#ifdef HAVE_SYSTEMD
+          {
+            /* The handler itself cannot report errors, resolve the library
+               while it is still possible to fail cleanly.  */
+            int ret = libcrun_load_libsystemd (err);
+            if (UNLIKELY (ret < 0))
+              return ret;
+          }
+#endif
           *new_output_handler = log_write_to_journald;
           *new_output_handler_arg = NULL;
           break;
+
+        case LOG_TYPE_TRACE:
+          {
+            FILE *stream = fopen (arg, "we");
+            if (stream == NULL)
+              return crun_make_error (err, errno, "open log file `%s`", log);
+            setlinebuf (stream);
+            /* The closing bracket is never written: the trace viewers accept
+               an unterminated array and the process can exit at any time.  */
+            fputs ("[\n", stream);
+            libcrun_profile_set_trace_stream (stream);
+            *new_output_handler = log_write_to_trace;
+            *new_output_handler_arg = NULL;
+          }
+          break;
         }
     }
   crun_set_output_handler (*new_output_handler, *new_output_handler_arg, log != NULL);
@@ -285,6 +327,20 @@ log_write_to_syslog (int errno_, const char *msg, bool warning, void *arg arg_un
     syslog (warning ? LOG_WARNING : LOG_ERR, "%s: %s", msg, strerror (errno_));
 }
 
+void
+log_write_to_trace (int errno_, const char *msg, bool warning, void *arg arg_unused)
+{
+  if (errno_ == 0)
+    libcrun_profile_trace_instant (msg, warning);
+  else
+    {
+      cleanup_free char *tmp = NULL;
+
+      xasprintf (&tmp, "%s: %s", msg, strerror (errno_));
+      libcrun_profile_trace_instant (tmp, warning);
+    }
+}
+
 void
 log_write_to_journald (int errno_, const char *msg, bool warning, void *arg arg_unused)
 {
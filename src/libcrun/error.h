@@ -48,6 +48,32 @@ struct libcrun_error_s
 };
 typedef struct libcrun_error_s *libcrun_error_t;
 
+/* Non-allocating error for expected-failure probing chains, e.g. trying a
+   syscall that is likely to fail with EPERM before falling back to another
+   method.  The struct is caller owned (usually on the stack) and MSG must
+   point to a static string, so no memory is allocated and nothing must be
+   released when the failure is consumed.  Promote it with
+   crun_error_from_probe only when the whole chain failed.  */
+struct crun_probe_error_s
+{
+  int status;
+  const char *msg;
+};
+
+static inline int
+crun_probe_error (struct crun_probe_error_s *probe_err, int status, const char *msg)
+{
+  probe_err->status = status;
+  probe_err->msg = msg;
+  return -status - 1;
+}
+
+static inline int
+crun_probe_error_get_errno (struct crun_probe_error_s *probe_err)
+{
+  return probe_err->status;
+}
+
 #define OOM()                            \
   do                                     \
     {                                    \
@@ -67,8 +93,12 @@ void log_write_to_stream (int errno_, const char *msg, bool warning, void *arg);
 
 void log_write_to_stderr (int errno_, const char *msg, bool warning, void *arg);
 
+void log_write_to_trace (int errno_, const char *msg, bool warning, void *arg);
+
 int crun_error_wrap (libcrun_error_t *err, const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
 
+int crun_error_from_probe (libcrun_error_t *err, struct crun_probe_error_s *probe_err, const char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
+
 int crun_error_get_errno (libcrun_error_t *err);
 
 int crun_error_release (libcrun_error_t *err);
@@ -21,7 +21,126 @@
 #include <config.h>
 #include "../container.h"
 #include "../utils.h"
+#include "../status.h"
 #include "handler-utils.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#define WASM_CACHE_DEFAULT_LIMIT (512LL * 1024 * 1024)
+
+int
+wasm_handler_cache_open (libcrun_context_t *context, const char *name)
+{
+  cleanup_free char *cache_dir = NULL;
+  libcrun_error_t tmp_err = NULL;
+  int ret;
+
+  cache_dir = libcrun_get_state_directory (context->state_root, name);
+  if (UNLIKELY (cache_dir == NULL))
+    return -1;
+
+  ret = crun_ensure_directory (cache_dir, 0700, true, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return -1;
+    }
+
+  return open (cache_dir, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+}
+
+bool
+wasm_handler_cache_key (int cache_dirfd, const char *pathname, const char *suffix, char *out, size_t out_size)
+{
+  struct stat st;
+  int ret;
+
+  if (cache_dirfd < 0)
+    return false;
+
+  if (stat (pathname, &st) < 0)
+    return false;
+
+  ret = snprintf (out, out_size, "%llu-%llu-%lld-%lld%s", (unsigned long long) st.st_dev,
+                  (unsigned long long) st.st_ino, (long long) st.st_size, (long long) st.st_mtime, suffix);
+  return ret > 0 && ret < (int) out_size;
+}
+
+void
+wasm_handler_cache_trim (int cache_dirfd)
+{
+  cleanup_dir DIR *dir = NULL;
+  struct dirent *next;
+  const char *limit_env;
+  long long limit = WASM_CACHE_DEFAULT_LIMIT;
+  long long total = 0;
+  int fd;
+
+  if (cache_dirfd < 0)
+    return;
+
+  limit_env = getenv ("CRUN_WASM_CACHE_LIMIT");
+  if (limit_env)
+    limit = strtoll (limit_env, NULL, 10);
+  if (limit <= 0)
+    return;
+
+  fd = dup (cache_dirfd);
+  if (UNLIKELY (fd < 0))
+    return;
+
+  dir = fdopendir (fd);
+  if (UNLIKELY (dir == NULL))
+    {
+      TEMP_FAILURE_RETRY (close (fd));
+      return;
+    }
+
+  for (next = readdir (dir); next; next = readdir (dir))
+    {
+      struct stat st;
+
+      if (next->d_name[0] == '.')
+        continue;
+
+      if (fstatat (cache_dirfd, next->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+        total += st.st_size;
+    }
+
+  while (total > limit)
+    {
+      char oldest_name[256];
+      long long oldest_mtime = 0;
+      long long oldest_size = 0;
+      bool found = false;
+
+      rewinddir (dir);
+      for (next = readdir (dir); next; next = readdir (dir))
+        {
+          struct stat st;
+
+          if (next->d_name[0] == '.')
+            continue;
+
+          if (fstatat (cache_dirfd, next->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+            continue;
+
+          if (! found || (long long) st.st_mtime < oldest_mtime)
+            {
+              snprintf (oldest_name, sizeof (oldest_name), "%s", next->d_name);
+              oldest_mtime = st.st_mtime;
+              oldest_size = st.st_size;
+              found = true;
+            }
+        }
+
+      if (! found || unlinkat (cache_dirfd, oldest_name, 0) < 0)
+        break;
+
+      total -= oldest_size;
+    }
+}
 
 int
 wasm_can_handle_container (libcrun_container_t *container, libcrun_error_t *err arg_unused)
@@ -23,4 +23,20 @@
 
 int wasm_can_handle_container (libcrun_container_t *container, libcrun_error_t *err);
 
+/* Cache of precompiled wasm artifacts under the state root, shared by the
+   wasm handlers.  All the functions are best effort: the caller falls back
+   to compiling or interpreting the module when the cache is not usable.
+
+   The directory must be opened while the host file system is still
+   reachable (HANDLER_CONFIGURE_BEFORE_MOUNTS); the fd stays valid after the
+   pivot_root.  Entries are keyed on the identity of the module file so a
+   lookup does not read the module bytes; the handler appends its own
+   artifact suffix.  The total size is capped (CRUN_WASM_CACHE_LIMIT,
+   512MB by default) evicting the oldest entries.  */
+int wasm_handler_cache_open (libcrun_context_t *context, const char *name);
+
+bool wasm_handler_cache_key (int cache_dirfd, const char *pathname, const char *suffix, char *out, size_t out_size);
+
+void wasm_handler_cache_trim (int cache_dirfd);
+
 #endif
@@ -20,10 +20,13 @@
 #include <config.h>
 #include "../custom-handler.h"
 #include "../container.h"
+#include "../status.h"
+#include "../cgroup.h"
 #include "../utils.h"
 #include "../linux.h"
 #include <unistd.h>
 #include <sys/stat.h>
+#include <inttypes.h>
 #include <errno.h>
 #include <sys/param.h>
 #include <sys/types.h>
@@ -70,6 +73,7 @@ libkrun_exec (void *cookie, libcrun_container_t *container, const char *pathname
   uint32_t num_vcpus, ram_mib;
   int32_t ctx_id, ret;
   cpu_set_t set;
+  const char *snapshot_path;
   char *const envp[] = { 0 };
 
   if (access ("/krun-sev.json", F_OK) == 0)
@@ -159,6 +163,39 @@ libkrun_exec (void *cookie, libcrun_container_t *container, const char *pathname
         error (EXIT_FAILURE, -ret, "could not set krun executable");
     }
 
+  /* Snapshot/restore of the microVM, when supported by libkrun.  The
+     orchestrator keys the path per image and resource shape: if a snapshot
+     already exists the microVM is restored from it, skipping the guest
+     kernel boot, otherwise libkrun is asked to write one once the guest is
+     ready.  The symbols are probed at runtime since not every libkrun build
+     exposes the snapshot API; without them the annotation is ignored and
+     the microVM boots normally.  */
+  snapshot_path = find_annotation (container, "run.oci.krun.snapshot_path");
+  if (snapshot_path && ! kconf->sev)
+    {
+      int32_t (*krun_set_snapshot_path) (uint32_t ctx_id, const char *path);
+      int32_t (*krun_set_restore_path) (uint32_t ctx_id, const char *path);
+
+      krun_set_snapshot_path = dlsym (handle, "krun_set_snapshot_path");
+      krun_set_restore_path = dlsym (handle, "krun_set_restore_path");
+
+      if (access (snapshot_path, F_OK) == 0)
+        {
+          if (krun_set_restore_path != NULL)
+            {
+              ret = krun_set_restore_path (ctx_id, snapshot_path);
+              if (UNLIKELY (ret < 0))
+                error (EXIT_FAILURE, -ret, "could not set krun restore path");
+            }
+        }
+      else if (krun_set_snapshot_path != NULL)
+        {
+          ret = krun_set_snapshot_path (ctx_id, snapshot_path);
+          if (UNLIKELY (ret < 0))
+            error (EXIT_FAILURE, -ret, "could not set krun snapshot path");
+        }
+    }
+
   return krun_start_enter (ctx_id);
 }
 
@@ -360,6 +397,62 @@ libkrun_modify_oci_configuration (void *cookie arg_unused, libcrun_context_t *co
   return 0;
 }
 
+/* Propagate an updated resources block to a running microVM.  libkrun has no
+   post-boot configuration API: the guest-visible number of vCPUs and the RAM
+   size are fixed once krun_start_enter runs.  What can be resized from the
+   host is how much of them the microVM really uses: the vCPU threads are
+   ordinary host threads, so the cpu limits applied by the generic update
+   path already throttle them, and the memory footprint is shrunk by pairing
+   the new cgroup limit with a proactive reclaim, which pushes the guest's
+   cold and free pages back to the host.  Growing beyond the boot-time RAM
+   size still needs a restart and is reported as an error.  */
+static int
+libkrun_update_resources (void *cookie arg_unused, libcrun_context_t *context arg_unused,
+                          libcrun_container_t *container, libcrun_container_status_t *status,
+                          runtime_spec_schema_config_linux_resources *resources,
+                          libcrun_error_t *err)
+{
+  cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
+  runtime_spec_schema_config_schema *def = container->container_def;
+  uint64_t boot_ram = 2ULL * 1024 * 1024 * 1024;
+  char fmt_buf[32];
+  int ret;
+
+  if (resources == NULL || resources->memory == NULL || ! resources->memory->limit_present)
+    return 0;
+
+  /* The boot-time RAM size was derived from the memory limit in the original
+     configuration, defaulting to 2G, see libkrun_exec.  */
+  if (def && def->linux && def->linux->resources && def->linux->resources->memory
+      && def->linux->resources->memory->limit_present)
+    boot_ram = def->linux->resources->memory->limit;
+
+  if ((uint64_t) resources->memory->limit > boot_ram)
+    return crun_make_error (err, 0, "cannot grow a krun microVM above its boot memory size without a restart");
+
+  if (status == NULL || status->cgroup_path == NULL || status->cgroup_path[0] == '\0')
+    return 0;
+
+  /* The new limit is already in place on the cgroup; reclaim the excess so
+     the microVM shrinks to the new size right away instead of keeping its
+     old footprint around as cold pages.  A partial reclaim is fine, the
+     limit keeps the container from growing back.  */
+  cgroup_status = libcrun_cgroup_make_status (status);
+  sprintf (fmt_buf, "%" PRIu64, boot_ram - (uint64_t) resources->memory->limit);
+  ret = libcrun_cgroup_reclaim_memory (cgroup_status, fmt_buf, err);
+  if (UNLIKELY (ret < 0))
+    {
+      if (crun_error_get_errno (err) == EAGAIN)
+        {
+          crun_error_release (err);
+          return 0;
+        }
+      return ret;
+    }
+
+  return 0;
+}
+
 struct custom_handler_s handler_libkrun = {
   .name = "krun",
   .alias = NULL,
@@ -369,6 +462,7 @@ struct custom_handler_s handler_libkrun = {
   .run_func = libkrun_exec,
   .configure_container = libkrun_configure_container,
   .modify_oci_configuration = libkrun_modify_oci_configuration,
+  .update_resources = libkrun_update_resources,
 };
 
 #endif
@@ -42,9 +42,10 @@
 
 #if HAVE_DLOPEN && HAVE_MONO
 static int
-mono_exec (void *cookie arg_unused, libcrun_container_t *container arg_unused,
+mono_exec (void *cookie arg_unused, libcrun_container_t *container,
            const char *pathname, char *const argv[] arg_unused)
 {
+  const char *aot_mode;
   MonoDomain *domain;
   char *path = (char *) pathname;
   int argc = 2;
@@ -61,6 +62,25 @@ mono_exec (void *cookie arg_unused, libcrun_container_t *container arg_unused,
   MonoAllocatorVTable mem_vtable = { MONO_ALLOCATOR_VTABLE_VERSION, xmalloc, NULL, NULL, NULL };
   mono_set_allocator_vtable (&mem_vtable);
 
+  /* AOT images built ahead of time next to the assemblies let the runtime
+     skip the JIT during bring-up.  They are mmapped read-only, so the kernel
+     shares the compiled code across every container running the same
+     assembly.  The mode must be set before the runtime is initialized.  */
+  aot_mode = find_annotation (container, "run.oci.mono.aot_mode");
+  if (aot_mode)
+    {
+      if (strcmp (aot_mode, "normal") == 0)
+        mono_jit_set_aot_mode (MONO_AOT_MODE_NORMAL);
+      else if (strcmp (aot_mode, "hybrid") == 0)
+        mono_jit_set_aot_mode (MONO_AOT_MODE_HYBRID);
+      else if (strcmp (aot_mode, "full") == 0)
+        mono_jit_set_aot_mode (MONO_AOT_MODE_FULL);
+      else if (strcmp (aot_mode, "llvmonly") == 0)
+        mono_jit_set_aot_mode (MONO_AOT_MODE_LLVMONLY);
+      else if (strcmp (aot_mode, "none") != 0)
+        error (EXIT_FAILURE, 0, "unknown mono AOT mode `%s`", aot_mode);
+    }
+
   /*
    * Load the default Mono configuration file, this is needed
    * if you are planning on using the dllmaps defined on the
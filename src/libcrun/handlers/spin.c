@@ -21,6 +21,10 @@
 #include "../custom-handler.h"
 #include "../linux.h"
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #ifdef HAVE_DLOPEN
 #  include <dlfcn.h>
@@ -31,13 +35,71 @@
 #endif
 
 #if HAVE_DLOPEN && HAVE_SPIN
+
+/* Bind and listen on ADDRESS ("HOST:PORT") so that connections are queued in
+   the kernel backlog while the Spin runtime boots and instantiates the
+   component graph.  The socket is then handed off to spin through the
+   sd_listen_fds protocol.  */
+static int
+spin_open_listen_socket (const char *address)
+{
+  cleanup_free char *host = NULL;
+  struct addrinfo hints = { 0 };
+  struct addrinfo *res = NULL;
+  struct addrinfo *addr;
+  const char *port;
+  char *sep;
+  int fd = -1;
+  int ret;
+
+  host = xstrdup (address);
+  sep = strrchr (host, ':');
+  if (sep == NULL)
+    return -1;
+  *sep = '\0';
+  port = sep + 1;
+
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+
+  ret = getaddrinfo (host[0] ? host : NULL, port, &hints, &res);
+  if (ret != 0)
+    return -1;
+
+  for (addr = res; addr; addr = addr->ai_next)
+    {
+      const int enable = 1;
+
+      fd = socket (addr->ai_family, addr->ai_socktype | SOCK_CLOEXEC, addr->ai_protocol);
+      if (fd < 0)
+        continue;
+
+      setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof (enable));
+      if (bind (fd, addr->ai_addr, addr->ai_addrlen) == 0 && listen (fd, SOMAXCONN) == 0)
+        break;
+
+      close (fd);
+      fd = -1;
+    }
+  freeaddrinfo (res);
+  return fd;
+}
+
 static int
-spin_exec (void *cookie arg_unused, libcrun_container_t *container arg_unused,
+spin_exec (void *cookie arg_unused, libcrun_container_t *container,
            const char *pathname arg_unused, char *const argv[] arg_unused)
 {
   // wasmtime fails to determine default config path if $HOME is not set
-  char *newenviron[] = { "HOME=/root", NULL };
-  char *newargv[] = { "/bin/spin", "up", "--listen", "0.0.0.0:80", NULL };
+  char *newenviron[] = { "HOME=/root", NULL, NULL, NULL };
+  char listen_pid_env[64];
+  const char *listen_addr;
+  char *newargv[] = { "/bin/spin", "up", "--listen", NULL, NULL };
+
+  listen_addr = find_annotation (container, "run.oci.spin.listen");
+  if (listen_addr == NULL)
+    listen_addr = "0.0.0.0:80";
+  newargv[3] = (char *) listen_addr;
 
   // spin up needs a /tmp folder
   int dir_result = mkdir ("/tmp", 0777);
@@ -46,6 +108,30 @@ spin_exec (void *cookie arg_unused, libcrun_container_t *container arg_unused,
       error (EXIT_FAILURE, errno, "failed to execute mkdir `/tmp`");
     }
 
+  /* Bind the request socket before the runtime boots, so scale-from-zero
+     requests wait in the backlog instead of being refused, and spin only
+     needs to pick up the inherited socket once instantiation is done.  */
+  if (find_annotation (container, "run.oci.spin.early_listen"))
+    {
+      int fd = spin_open_listen_socket (listen_addr);
+      if (fd < 0)
+        error (EXIT_FAILURE, errno, "failed to bind spin listen socket `%s`", listen_addr);
+
+      /* The sd_listen_fds protocol expects the socket at fd 3.  */
+      if (fd != 3)
+        {
+          if (dup2 (fd, 3) < 0)
+            error (EXIT_FAILURE, errno, "failed to dup spin listen socket");
+          close (fd);
+        }
+      else
+        fcntl (fd, F_SETFD, 0);
+
+      snprintf (listen_pid_env, sizeof (listen_pid_env), "LISTEN_PID=%d", getpid ());
+      newenviron[1] = "LISTEN_FDS=1";
+      newenviron[2] = listen_pid_env;
+    }
+
   execve (newargv[0], newargv, newenviron);
   perror ("execve");
   exit (EXIT_FAILURE);
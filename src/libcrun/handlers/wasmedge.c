@@ -39,6 +39,22 @@
 #endif
 
 #if HAVE_DLOPEN && HAVE_WASMEDGE
+
+/* Cache of AOT compiled modules, see wasm_handler_cache_open.  */
+static int wasmedge_cache_dirfd = -1;
+
+static int
+libwasmedge_configure_container (void *cookie arg_unused, enum handler_configure_phase phase,
+                                 libcrun_context_t *context, libcrun_container_t *container arg_unused,
+                                 const char *rootfs arg_unused, libcrun_error_t *err arg_unused)
+{
+  if (phase != HANDLER_CONFIGURE_BEFORE_MOUNTS)
+    return 0;
+
+  wasmedge_cache_dirfd = wasm_handler_cache_open (context, "wasmedge-cache");
+  return 0;
+}
+
 static int
 libwasmedge_load (void **cookie, libcrun_error_t *err)
 {
@@ -79,6 +95,9 @@ libwasmedge_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *co
   WasmEdge_Result (*WasmEdge_VMRunWasmFromFile) (WasmEdge_VMContext *Cxt, const char *Path, const WasmEdge_String FuncName, const WasmEdge_Value *Params, const uint32_t ParamLen, WasmEdge_Value *Returns, const uint32_t ReturnLen);
   bool (*WasmEdge_ResultOK) (const WasmEdge_Result Res);
   WasmEdge_String (*WasmEdge_StringCreateByCString) (const char *Str);
+  WasmEdge_CompilerContext *(*WasmEdge_CompilerCreate) (const WasmEdge_ConfigureContext *ConfCxt);
+  WasmEdge_Result (*WasmEdge_CompilerCompile) (WasmEdge_CompilerContext *Cxt, const char *InPath, const char *OutPath);
+  void (*WasmEdge_CompilerDelete) (WasmEdge_CompilerContext *Cxt);
   uint32_t argn = 0;
   uint32_t envn = 0;
   const char *dirs[2] = { "/:/", ".:." };
@@ -102,6 +121,10 @@ libwasmedge_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *co
   WasmEdge_VMRunWasmFromFile = dlsym (cookie, "WasmEdge_VMRunWasmFromFile");
   WasmEdge_ResultOK = dlsym (cookie, "WasmEdge_ResultOK");
   WasmEdge_StringCreateByCString = dlsym (cookie, "WasmEdge_StringCreateByCString");
+  /* Optional, the AOT cache is skipped when they are missing.  */
+  WasmEdge_CompilerCreate = dlsym (cookie, "WasmEdge_CompilerCreate");
+  WasmEdge_CompilerCompile = dlsym (cookie, "WasmEdge_CompilerCompile");
+  WasmEdge_CompilerDelete = dlsym (cookie, "WasmEdge_CompilerDelete");
 
   if (WasmEdge_ConfigureCreate == NULL || WasmEdge_ConfigureDelete == NULL || WasmEdge_ConfigureAddProposal == NULL
       || WasmEdge_ConfigureAddHostRegistration == NULL || WasmEdge_VMCreate == NULL || WasmEdge_VMDelete == NULL
@@ -142,7 +165,54 @@ libwasmedge_exec (void *cookie, __attribute__ ((unused)) libcrun_container_t *co
 
   WasmEdge_ModuleInstanceInitWASI (wasi_module, (const char *const *) &argv[0], argn, (const char *const *) &environ[0], envn, dirs, 1, NULL, 0);
 
-  result = WasmEdge_VMRunWasmFromFile (vm, pathname, WasmEdge_StringCreateByCString ("_start"), NULL, 0, NULL, 0);
+  // Run the AOT compiled artifact when one is cached for this module,
+  // compiling and caching it on the first start.  Every failure falls back
+  // to interpreting the module from its original path.
+  const char *run_path = pathname;
+  char cache_key[96];
+  char cache_path[160];
+
+  if (wasm_handler_cache_key (wasmedge_cache_dirfd, pathname, ".so", cache_key, sizeof (cache_key)))
+    {
+      snprintf (cache_path, sizeof (cache_path), "/proc/self/fd/%d/%s", wasmedge_cache_dirfd, cache_key);
+
+      if (faccessat (wasmedge_cache_dirfd, cache_key, R_OK, 0) == 0)
+        run_path = cache_path;
+      else if (WasmEdge_CompilerCreate != NULL && WasmEdge_CompilerCompile != NULL && WasmEdge_CompilerDelete != NULL)
+        {
+          WasmEdge_CompilerContext *compiler = WasmEdge_CompilerCreate (configure);
+
+          if (compiler != NULL)
+            {
+              char tmp_name[128];
+              char tmp_path[160];
+
+              snprintf (tmp_name, sizeof (tmp_name), ".%s.%d", cache_key, getpid ());
+              snprintf (tmp_path, sizeof (tmp_path), "/proc/self/fd/%d/%s", wasmedge_cache_dirfd, tmp_name);
+
+              result = WasmEdge_CompilerCompile (compiler, pathname, tmp_path);
+              WasmEdge_CompilerDelete (compiler);
+
+              if (WasmEdge_ResultOK (result)
+                  && renameat (wasmedge_cache_dirfd, tmp_name, wasmedge_cache_dirfd, cache_key) == 0)
+                {
+                  run_path = cache_path;
+                  wasm_handler_cache_trim (wasmedge_cache_dirfd);
+                }
+              else
+                unlinkat (wasmedge_cache_dirfd, tmp_name, 0);
+            }
+        }
+    }
+
+  result = WasmEdge_VMRunWasmFromFile (vm, run_path, WasmEdge_StringCreateByCString ("_start"), NULL, 0, NULL, 0);
+
+  // A stale or incompatible artifact, drop it and interpret the module.
+  if (UNLIKELY (! WasmEdge_ResultOK (result)) && run_path != pathname)
+    {
+      unlinkat (wasmedge_cache_dirfd, cache_key, 0);
+      result = WasmEdge_VMRunWasmFromFile (vm, pathname, WasmEdge_StringCreateByCString ("_start"), NULL, 0, NULL, 0);
+    }
 
   if (UNLIKELY (! WasmEdge_ResultOK (result)))
     {
@@ -169,6 +239,7 @@ struct custom_handler_s handler_wasmedge = {
   .load = libwasmedge_load,
   .unload = libwasmedge_unload,
   .run_func = libwasmedge_exec,
+  .configure_container = libwasmedge_configure_container,
   .can_handle_container = wasmedge_can_handle_container,
 };
 
@@ -40,6 +40,67 @@
 
 #if HAVE_DLOPEN && HAVE_WASMER
 #  define WASMER_BUF_SIZE 128
+
+/* Compiling the module dominates wasm container start, so the compiled form
+   is cached on disk per boot and later starts only deserialize it, which is
+   orders of magnitude cheaper.  The cache key is the identity of the module
+   file plus the wasmer version, since serialized modules are not stable
+   across releases.  Everything is best effort: with no usable cache entry
+   the module is simply compiled as before.  */
+#  define WASM_MODULE_CACHE_DIR ".cache/wasm"
+
+static char *
+wasm_module_cache_path (const char *pathname, const char *version)
+{
+  libcrun_error_t tmp_err = NULL;
+  cleanup_free char *root = NULL;
+  cleanup_free char *dir = NULL;
+  char *path = NULL;
+  struct stat st;
+  int ret;
+
+  if (stat (pathname, &st) < 0)
+    return NULL;
+
+  root = libcrun_get_state_directory (NULL, NULL);
+  if (root == NULL)
+    return NULL;
+
+  ret = append_paths (&dir, &tmp_err, root, WASM_MODULE_CACHE_DIR, NULL);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return NULL;
+    }
+
+  ret = crun_ensure_directory (dir, 0700, true, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return NULL;
+    }
+
+  xasprintf (&path, "%s/%s-%llu-%llu-%llu-%llu", dir, version ? version : "0",
+             (unsigned long long) st.st_dev, (unsigned long long) st.st_ino,
+             (unsigned long long) st.st_size, (unsigned long long) st.st_mtime);
+  return path;
+}
+
+static void
+wasm_module_cache_store (const char *cache_path, const char *data, size_t len)
+{
+  cleanup_free char *tmp_path = NULL;
+  cleanup_close int fd = -1;
+
+  xasprintf (&tmp_path, "%s.%d", cache_path, getpid ());
+  fd = open (tmp_path, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return;
+
+  if (safe_write (fd, data, (ssize_t) len) < 0 || rename (tmp_path, cache_path) < 0)
+    unlink (tmp_path);
+}
+
 static int
 libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
                 const char *pathname, char *const argv[])
@@ -100,6 +161,10 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
   void (*wasi_env_delete) (struct wasi_env_t *);
   void (*wasi_config_arg) (struct wasi_config_t *config, const char *arg);
   bool (*wasi_env_initialize_instance) (struct wasi_env_t *, wasm_store_t *, wasm_instance_t *);
+  void (*wasm_module_serialize) (const wasm_module_t *, wasm_byte_vec_t *out);
+  wasm_module_t *(*wasm_module_deserialize) (wasm_store_t *, const wasm_byte_vec_t *);
+  const char *(*wasmer_version) (void);
+  cleanup_free char *cache_path = NULL;
 
   wat2wasm = dlsym (cookie, "wat2wasm");
   wasm_module_delete = dlsym (cookie, "wasm_module_delete");
@@ -132,6 +197,11 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasm_func_delete = dlsym (cookie, "wasm_func_delete");
   wasi_env_initialize_instance = dlsym (cookie, "wasi_env_initialize_instance");
 
+  /* Optional: used only for the compiled module cache.  */
+  wasm_module_serialize = dlsym (cookie, "wasm_module_serialize");
+  wasm_module_deserialize = dlsym (cookie, "wasm_module_deserialize");
+  wasmer_version = dlsym (cookie, "wasmer_version");
+
   if (wat2wasm == NULL || wasm_module_delete == NULL || wasm_instance_delete == NULL
       || wasm_engine_delete == NULL || wasm_store_delete == NULL || wasm_func_call == NULL
       || wasm_extern_as_func == NULL || wasm_instance_exports == NULL || wasm_instance_new == NULL
@@ -144,37 +214,72 @@ libwasmer_exec (void *cookie, libcrun_container_t *container arg_unused,
       || wasi_get_imports == NULL || wasi_get_start_function == NULL || wasi_config_inherit_stdout == NULL)
     error (EXIT_FAILURE, 0, "could not find symbol in `libwasmer.so`");
 
-  wat_wasm_file = fopen (pathname, "rbe");
+  engine = wasm_engine_new ();
+  store = wasm_store_new (engine);
 
-  if (! wat_wasm_file)
-    error (EXIT_FAILURE, errno, "error opening wat/wasm module");
+  /* Deserializing a previously compiled module skips the compilation
+     entirely, so try the cache first.  */
+  cache_path = wasm_module_cache_path (pathname, wasmer_version ? wasmer_version () : NULL);
+  module = NULL;
+  if (cache_path && wasm_module_deserialize)
+    {
+      cleanup_free char *serialized = NULL;
+      libcrun_error_t tmp_err = NULL;
+      size_t serialized_len = 0;
+
+      if (read_all_file (cache_path, &serialized, &serialized_len, &tmp_err) >= 0)
+        {
+          wasm_byte_vec_t serialized_bytes;
+
+          wasm_byte_vec_new (&serialized_bytes, serialized_len, serialized);
+          module = wasm_module_deserialize (store, &serialized_bytes);
+          wasm_byte_vec_delete (&serialized_bytes);
+        }
+      else
+        crun_error_release (&tmp_err);
+    }
 
-  fseek (wat_wasm_file, 0L, SEEK_END);
-  file_size = ftell (wat_wasm_file);
-  fseek (wat_wasm_file, 0L, SEEK_SET);
+  if (module == NULL)
+    {
+      wat_wasm_file = fopen (pathname, "rbe");
 
-  wasm_byte_vec_new_uninitialized (&binary_bytes, file_size);
+      if (! wat_wasm_file)
+        error (EXIT_FAILURE, errno, "error opening wat/wasm module");
 
-  if (fread (binary_bytes.data, file_size, 1, wat_wasm_file) != 1)
-    error (EXIT_FAILURE, errno, "error loading wat/wasm module");
+      fseek (wat_wasm_file, 0L, SEEK_END);
+      file_size = ftell (wat_wasm_file);
+      fseek (wat_wasm_file, 0L, SEEK_SET);
 
-  /* We can close entrypoint file.   */
-  fclose (wat_wasm_file);
+      wasm_byte_vec_new_uninitialized (&binary_bytes, file_size);
 
-  /* We have received a wat file: convert wat to wasm.   */
-  if (has_suffix (pathname, "wat") > 0)
-    {
-      wat2wasm (&binary_bytes, &wasm_bytes);
-      binary_bytes = wasm_bytes;
-    }
+      if (fread (binary_bytes.data, file_size, 1, wat_wasm_file) != 1)
+        error (EXIT_FAILURE, errno, "error loading wat/wasm module");
 
-  engine = wasm_engine_new ();
-  store = wasm_store_new (engine);
+      /* We can close entrypoint file.   */
+      fclose (wat_wasm_file);
 
-  module = wasm_module_new (store, &binary_bytes);
+      /* We have received a wat file: convert wat to wasm.   */
+      if (has_suffix (pathname, "wat") > 0)
+        {
+          wat2wasm (&binary_bytes, &wasm_bytes);
+          binary_bytes = wasm_bytes;
+        }
 
-  if (! module)
-    error (EXIT_FAILURE, 0, "error compiling wasm module");
+      module = wasm_module_new (store, &binary_bytes);
+
+      if (! module)
+        error (EXIT_FAILURE, 0, "error compiling wasm module");
+
+      if (cache_path && wasm_module_serialize)
+        {
+          wasm_byte_vec_t serialized = { 0, NULL };
+
+          wasm_module_serialize (module, &serialized);
+          if (serialized.size > 0)
+            wasm_module_cache_store (cache_path, serialized.data, serialized.size);
+          wasm_byte_vec_delete (&serialized);
+        }
+    }
 
   config = wasi_config_new ("crun_wasi_program");
 
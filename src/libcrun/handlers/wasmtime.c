@@ -44,6 +44,22 @@
 #endif
 
 #if HAVE_DLOPEN && HAVE_WASMTIME
+
+/* Cache of precompiled modules, see wasm_handler_cache_open.  */
+static int wasmtime_cache_dirfd = -1;
+
+static int
+libwasmtime_configure_container (void *cookie arg_unused, enum handler_configure_phase phase,
+                                 libcrun_context_t *context, libcrun_container_t *container arg_unused,
+                                 const char *rootfs arg_unused, libcrun_error_t *err arg_unused)
+{
+  if (phase != HANDLER_CONFIGURE_BEFORE_MOUNTS)
+    return 0;
+
+  wasmtime_cache_dirfd = wasm_handler_cache_open (context, "wasmtime-cache");
+  return 0;
+}
+
 static int
 libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
                   const char *pathname, char *const argv[])
@@ -94,6 +110,13 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
       wasmtime_val_t *results,
       size_t nresults,
       wasm_trap_t **trap);
+  wasmtime_error_t *(*wasmtime_module_deserialize_file) (
+      wasm_engine_t *engine,
+      const char *path,
+      wasmtime_module_t **ret);
+  wasmtime_error_t *(*wasmtime_module_serialize) (
+      wasmtime_module_t *module,
+      wasm_byte_vec_t *ret);
   void (*wasmtime_module_delete) (wasmtime_module_t *m);
   void (*wasmtime_store_delete) (wasmtime_store_t *store);
   void (*wasmtime_error_message) (const wasmtime_error_t *error, wasm_name_t *message);
@@ -121,6 +144,9 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
   wasmtime_linker_module = dlsym (cookie, "wasmtime_linker_module");
   wasmtime_linker_get_default = dlsym (cookie, "wasmtime_linker_get_default");
   wasmtime_func_call = dlsym (cookie, "wasmtime_func_call");
+  /* Optional, the module cache is skipped when they are missing.  */
+  wasmtime_module_deserialize_file = dlsym (cookie, "wasmtime_module_deserialize_file");
+  wasmtime_module_serialize = dlsym (cookie, "wasmtime_module_serialize");
   wasmtime_module_delete = dlsym (cookie, "wasmtime_module_delete");
   wasmtime_store_delete = dlsym (cookie, "wasmtime_store_delete");
   wasmtime_error_delete = dlsym (cookie, "wasmtime_error_delete");
@@ -156,44 +182,99 @@ libwasmtime_exec (void *cookie, libcrun_container_t *container arg_unused,
       error (EXIT_FAILURE, 0, "failed to link wasi: %.*s", (int) error_message.size, error_message.data);
     }
 
-  wasm_byte_vec_t wasm;
-  // Load and parse container entrypoint
-  FILE *file = fopen (pathname, "rbe");
-  if (! file)
-    error (EXIT_FAILURE, 0, "error loading entrypoint");
-  fseek (file, 0L, SEEK_END);
-  size_t file_size = ftell (file);
-  wasm_byte_vec_new_uninitialized (&wasm, file_size);
-  fseek (file, 0L, SEEK_SET);
-  if (fread (wasm.data, file_size, 1, file) != 1)
-    error (EXIT_FAILURE, 0, "error load");
-  fclose (file);
-
-  // If entrypoint contains a webassembly text format
-  // compile it on the fly and convert to equivalent
-  // binary format.
-  if (has_suffix (pathname, "wat") > 0)
+  wasmtime_module_t *module = NULL;
+  char cache_key[96];
+  bool cacheable = false;
+
+  // Try the cache of precompiled modules first: deserializing the .cwasm
+  // artifact mmaps it instead of recompiling the module.
+  if (wasmtime_module_deserialize_file != NULL && has_suffix (pathname, "wat") <= 0)
+    cacheable = wasm_handler_cache_key (wasmtime_cache_dirfd, pathname, ".cwasm", cache_key, sizeof (cache_key));
+
+  if (cacheable)
     {
-      wasmtime_error_t *err = wasmtime_wat2wasm ((char *) &wasm_bytes, file_size, &wasm);
-      if (err != NULL)
+      int cache_fd = openat (wasmtime_cache_dirfd, cache_key, O_RDONLY | O_CLOEXEC);
+      if (cache_fd >= 0)
         {
-          wasmtime_error_message (err, &error_message);
-          wasmtime_error_delete (err);
-          error (EXIT_FAILURE, 0, "failed while compiling wat to wasm binary : %.*s", (int) error_message.size, error_message.data);
+          char proc_path[32];
+
+          snprintf (proc_path, sizeof (proc_path), "/proc/self/fd/%d", cache_fd);
+          err = wasmtime_module_deserialize_file (engine, proc_path, &module);
+          if (err != NULL)
+            {
+              // A stale or incompatible artifact, recompile and replace it.
+              wasmtime_error_delete (err);
+              module = NULL;
+            }
+          close (cache_fd);
         }
-      wasm = wasm_bytes;
     }
 
-  // Compile wasm modules
-  wasmtime_module_t *module = NULL;
-  err = wasmtime_module_new (engine, (uint8_t *) wasm.data, wasm.size, &module);
-  if (! module)
+  if (module == NULL)
     {
-      wasmtime_error_message (err, &error_message);
-      wasmtime_error_delete (err);
-      error (EXIT_FAILURE, 0, "failed to compile module: %.*s", (int) error_message.size, error_message.data);
+      wasm_byte_vec_t wasm;
+      // Load and parse container entrypoint
+      FILE *file = fopen (pathname, "rbe");
+      if (! file)
+        error (EXIT_FAILURE, 0, "error loading entrypoint");
+      fseek (file, 0L, SEEK_END);
+      size_t file_size = ftell (file);
+      wasm_byte_vec_new_uninitialized (&wasm, file_size);
+      fseek (file, 0L, SEEK_SET);
+      if (fread (wasm.data, file_size, 1, file) != 1)
+        error (EXIT_FAILURE, 0, "error load");
+      fclose (file);
+
+      // If entrypoint contains a webassembly text format
+      // compile it on the fly and convert to equivalent
+      // binary format.
+      if (has_suffix (pathname, "wat") > 0)
+        {
+          wasmtime_error_t *err = wasmtime_wat2wasm ((char *) &wasm_bytes, file_size, &wasm);
+          if (err != NULL)
+            {
+              wasmtime_error_message (err, &error_message);
+              wasmtime_error_delete (err);
+              error (EXIT_FAILURE, 0, "failed while compiling wat to wasm binary : %.*s", (int) error_message.size, error_message.data);
+            }
+          wasm = wasm_bytes;
+        }
+
+      // Compile wasm modules
+      err = wasmtime_module_new (engine, (uint8_t *) wasm.data, wasm.size, &module);
+      if (! module)
+        {
+          wasmtime_error_message (err, &error_message);
+          wasmtime_error_delete (err);
+          error (EXIT_FAILURE, 0, "failed to compile module: %.*s", (int) error_message.size, error_message.data);
+        }
+      wasm_byte_vec_delete (&wasm);
+
+      // Serialize the compiled module into the cache, best effort.
+      if (cacheable && wasmtime_module_serialize != NULL)
+        {
+          wasm_byte_vec_t serialized;
+
+          if (wasmtime_module_serialize (module, &serialized) == NULL)
+            {
+              char tmp_name[128];
+              int cache_fd;
+
+              snprintf (tmp_name, sizeof (tmp_name), ".%s.%d", cache_key, getpid ());
+              cache_fd = openat (wasmtime_cache_dirfd, tmp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+              if (cache_fd >= 0)
+                {
+                  if (safe_write (cache_fd, serialized.data, serialized.size) != (ssize_t) serialized.size
+                      || renameat (wasmtime_cache_dirfd, tmp_name, wasmtime_cache_dirfd, cache_key) != 0)
+                    unlinkat (wasmtime_cache_dirfd, tmp_name, 0);
+                  else
+                    wasm_handler_cache_trim (wasmtime_cache_dirfd);
+                  close (cache_fd);
+                }
+              wasm_byte_vec_delete (&serialized);
+            }
+        }
     }
-  wasm_byte_vec_delete (&wasm);
 
   // Init WASI program
   wasi_config_t *wasi_config = wasi_config_new ("crun_wasi_program");
@@ -293,6 +374,7 @@ struct custom_handler_s handler_wasmtime = {
   .load = libwasmtime_load,
   .unload = libwasmtime_unload,
   .run_func = libwasmtime_exec,
+  .configure_container = libwasmtime_configure_container,
   .can_handle_container = libwasmtime_can_handle_container,
 };
 
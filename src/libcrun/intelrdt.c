@@ -25,13 +25,21 @@
 #include <string.h>
 #include <sched.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include <sys/vfs.h>
 
 #define INTEL_RDT_MOUNT_POINT "/sys/fs/resctrl"
 #define SCHEMATA_FILE "schemata"
 #define TASKS_FILE "tasks"
+#define MON_GROUPS_DIR "mon_groups"
+#define MON_DATA_DIR "mon_data"
 #define RDTGROUP_SUPER_MAGIC 0x7655821
 
+/* Prefix for groups shared by every container with the same schemata.  */
+#define SHARED_GROUP_PREFIX "crun-rdt-"
+
 static int
 is_rdt_mounted (libcrun_error_t *err)
 {
@@ -229,6 +237,41 @@ intelrdt_clean_l3_cache_schema (const char *l3_cache_schema)
   return ret;
 }
 
+static uint64_t
+fnv1a_64 (const char *data)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (; *data; data++)
+    {
+      hash ^= (unsigned char) *data;
+      hash *= 0x100000001b3ULL;
+    }
+  return hash;
+}
+
+/* Derive the name of the shared group for the given schemata.  Containers
+   that resolve to the same schemata attach to the same group, so the class
+   of service is allocated only once.  A collision maps two different
+   configurations to the same name, but resctl_create validates the existing
+   schemata before reusing a group, so it is detected.  */
+int
+resctl_shared_group_name (char **out, const char *l3_cache_schema, const char *mem_bw_schema, libcrun_error_t *err)
+{
+  cleanup_free char *cleaned_l3_cache_schema = NULL;
+  cleanup_free char *value = NULL;
+  int ret;
+
+  if (l3_cache_schema && strstr (l3_cache_schema, "MB:"))
+    l3_cache_schema = cleaned_l3_cache_schema = intelrdt_clean_l3_cache_schema (l3_cache_schema);
+
+  ret = get_rdt_value (&value, l3_cache_schema, mem_bw_schema);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "internal error get_rdt_value");
+
+  return xasprintf (out, SHARED_GROUP_PREFIX "%016" PRIx64, fnv1a_64 (value));
+}
+
 int
 resctl_create (const char *name, bool explicit_clos_id, bool *created, const char *l3_cache_schema, const char *mem_bw_schema, libcrun_error_t *err)
 {
@@ -322,11 +365,260 @@ resctl_update (const char *name, const char *l3_cache_schema, const char *mem_bw
 }
 
 int
-resctl_destroy (const char *name, libcrun_error_t *err)
+resctl_create_mon_group (const char *name, const char *ctr_name, libcrun_error_t *err)
+{
+  cleanup_free char *path = NULL;
+  int ret;
+
+  ret = append_paths (&path, err, INTEL_RDT_MOUNT_POINT, name, MON_GROUPS_DIR, ctr_name, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = mkdir (path, 0755);
+  if (UNLIKELY (ret < 0))
+    {
+      /* Monitoring is optional: the kernel may lack RDT monitoring support
+         (no mon_groups directory) or have no free RMIDs left.  */
+      if (errno == ENOENT || errno == EEXIST || errno == ENOSPC || errno == EOPNOTSUPP)
+        return 0;
+      return crun_make_error (err, errno, "mkdir `%s`", path);
+    }
+
+  return 0;
+}
+
+int
+resctl_move_task_to_mon_group (const char *name, const char *ctr_name, pid_t pid, libcrun_error_t *err)
 {
   cleanup_free char *path = NULL;
+  char pid_str[32];
+  int exist;
+  int len;
   int ret;
 
+  ret = append_paths (&path, err, INTEL_RDT_MOUNT_POINT, name, MON_GROUPS_DIR, ctr_name, TASKS_FILE, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  /* The monitoring group is best effort, skip when it was not created.  */
+  exist = crun_path_exists (path, err);
+  if (UNLIKELY (exist < 0))
+    return exist;
+  if (exist == 0)
+    return 0;
+
+  len = sprintf (pid_str, "%d", pid);
+
+  return write_file (path, pid_str, len, err);
+}
+
+/* Counter file descriptors for one mon_data domain directory.  A missing
+   counter (feature not enabled) is kept as -1.  */
+struct mon_domain_fds_s
+{
+  int llc_occupancy;
+  int mbm_total_bytes;
+};
+
+/* Descriptors for the group read by the previous resctl_read_mon_stats call,
+   so a telemetry loop reading the counters does not walk /sys/fs/resctrl on
+   every sample.  */
+static struct
+{
+  char *key;
+  struct mon_domain_fds_s *domains;
+  size_t n_domains;
+} mon_stats_cache;
+
+static void
+mon_stats_cache_reset (void)
+{
+  size_t i;
+
+  for (i = 0; i < mon_stats_cache.n_domains; i++)
+    {
+      if (mon_stats_cache.domains[i].llc_occupancy >= 0)
+        close (mon_stats_cache.domains[i].llc_occupancy);
+      if (mon_stats_cache.domains[i].mbm_total_bytes >= 0)
+        close (mon_stats_cache.domains[i].mbm_total_bytes);
+    }
+  free (mon_stats_cache.domains);
+  free (mon_stats_cache.key);
+  memset (&mon_stats_cache, 0, sizeof (mon_stats_cache));
+}
+
+static int
+mon_stats_cache_load (const char *key, const char *mon_data_path, libcrun_error_t *err)
+{
+  cleanup_dir DIR *dir = NULL;
+  struct dirent *de;
+
+  mon_stats_cache_reset ();
+
+  dir = opendir (mon_data_path);
+  if (UNLIKELY (dir == NULL))
+    return crun_make_error (err, errno, "opendir `%s`", mon_data_path);
+
+  while ((de = readdir (dir)))
+    {
+      cleanup_close int domain_fd = -1;
+      struct mon_domain_fds_s fds;
+
+      if (! has_prefix (de->d_name, "mon_"))
+        continue;
+
+      domain_fd = openat (dirfd (dir), de->d_name, O_DIRECTORY | O_PATH | O_CLOEXEC);
+      if (UNLIKELY (domain_fd < 0))
+        continue;
+
+      fds.llc_occupancy = openat (domain_fd, "llc_occupancy", O_RDONLY | O_CLOEXEC);
+      fds.mbm_total_bytes = openat (domain_fd, "mbm_total_bytes", O_RDONLY | O_CLOEXEC);
+      if (fds.llc_occupancy < 0 && fds.mbm_total_bytes < 0)
+        continue;
+
+      mon_stats_cache.domains = xrealloc (mon_stats_cache.domains,
+                                          (mon_stats_cache.n_domains + 1) * sizeof (struct mon_domain_fds_s));
+      mon_stats_cache.domains[mon_stats_cache.n_domains++] = fds;
+    }
+
+  mon_stats_cache.key = xstrdup (key);
+  return 0;
+}
+
+/* Read one counter.  Returns 1 on success, 0 when the value is not available
+   for this domain.  */
+static int
+read_mon_counter (int fd, uint64_t *value)
+{
+  char buf[64];
+  ssize_t ret;
+
+  if (fd < 0)
+    return 0;
+
+  ret = TEMP_FAILURE_RETRY (pread (fd, buf, sizeof (buf) - 1, 0));
+  if (ret <= 0)
+    return 0;
+  buf[ret] = '\0';
+
+  /* The kernel reports "Unavailable" when the RMID is not tracked yet.  */
+  if (buf[0] < '0' || buf[0] > '9')
+    return 0;
+
+  *value = strtoull (buf, NULL, 10);
+  return 1;
+}
+
+int
+resctl_read_mon_stats (const char *name, const char *ctr_name, struct libcrun_intelrdt_stats_s *stats,
+                       libcrun_error_t *err)
+{
+  cleanup_free char *mon_data_path = NULL;
+  cleanup_free char *key = NULL;
+  int exist;
+  size_t i;
+  int ret;
+
+  memset (stats, 0, sizeof (*stats));
+
+  ret = xasprintf (&key, "%s/%s", name, ctr_name);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "internal error xasprintf");
+
+  if (mon_stats_cache.key == NULL || strcmp (mon_stats_cache.key, key) != 0)
+    {
+      ret = append_paths (&mon_data_path, err, INTEL_RDT_MOUNT_POINT, name, MON_GROUPS_DIR, ctr_name,
+                          MON_DATA_DIR, NULL);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      exist = crun_path_exists (mon_data_path, err);
+      if (UNLIKELY (exist < 0))
+        return exist;
+      if (exist == 0)
+        {
+          /* Without a per-container monitoring group, fall back to the
+             counters of the whole control group.  */
+          free (mon_data_path);
+          mon_data_path = NULL;
+          ret = append_paths (&mon_data_path, err, INTEL_RDT_MOUNT_POINT, name, MON_DATA_DIR, NULL);
+          if (UNLIKELY (ret < 0))
+            return ret;
+
+          exist = crun_path_exists (mon_data_path, err);
+          if (UNLIKELY (exist < 0))
+            return exist;
+          if (exist == 0)
+            return 0;
+        }
+
+      ret = mon_stats_cache_load (key, mon_data_path, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  for (i = 0; i < mon_stats_cache.n_domains; i++)
+    {
+      uint64_t value;
+
+      if (read_mon_counter (mon_stats_cache.domains[i].llc_occupancy, &value))
+        {
+          stats->llc_occupancy += value;
+          stats->llc_occupancy_present = true;
+        }
+      if (read_mon_counter (mon_stats_cache.domains[i].mbm_total_bytes, &value))
+        {
+          stats->mbm_total_bytes += value;
+          stats->mbm_total_bytes_present = true;
+        }
+    }
+
+  return 0;
+}
+
+int
+resctl_destroy (const char *name, const char *ctr_name, libcrun_error_t *err)
+{
+  cleanup_free char *path = NULL;
+  int ret;
+
+  /* Remove the per-container monitoring group first, it would keep the
+     control group busy.  */
+  if (ctr_name != NULL)
+    {
+      cleanup_free char *mon_path = NULL;
+
+      ret = append_paths (&mon_path, err, INTEL_RDT_MOUNT_POINT, name, MON_GROUPS_DIR, ctr_name, NULL);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = rmdir (mon_path);
+      if (UNLIKELY (ret < 0 && errno != ENOENT))
+        return crun_make_error (err, errno, "rmdir `%s`", mon_path);
+    }
+
+  /* A shared group is still referenced by other containers as long as their
+     tasks are in it: leave it in place.  A rmdir would silently move them
+     back to the default group.  There is a window between the check and the
+     rmdir where a new task can attach; in that case moving the task fails
+     and the new container creates the group again.  */
+  if (has_prefix (name, SHARED_GROUP_PREFIX))
+    {
+      cleanup_free char *tasks_path = NULL;
+      cleanup_free char *tasks = NULL;
+
+      ret = append_paths (&tasks_path, err, INTEL_RDT_MOUNT_POINT, name, TASKS_FILE, NULL);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = read_all_file (tasks_path, &tasks, NULL, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      if (! is_empty_string (tasks))
+        return 0;
+    }
+
   ret = append_paths (&path, err, INTEL_RDT_MOUNT_POINT, name, NULL);
   if (UNLIKELY (ret < 0))
     return ret;
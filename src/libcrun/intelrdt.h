@@ -22,11 +22,27 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "error.h"
 
+/* Monitoring counters of a container, summed over the resctrl mon_data
+   domains.  The *_present flags tell whether the kernel exposes the
+   counter.  */
+struct libcrun_intelrdt_stats_s
+{
+  bool llc_occupancy_present;
+  bool mbm_total_bytes_present;
+  uint64_t llc_occupancy;
+  uint64_t mbm_total_bytes;
+};
+
+int resctl_shared_group_name (char **out, const char *l3_cache_schema, const char *mem_bw_schema, libcrun_error_t *err);
 int resctl_create (const char *name, bool explicit_clos_id, bool *created, const char *l3_cache_schema, const char *mem_bw_schema, libcrun_error_t *err);
+int resctl_create_mon_group (const char *name, const char *ctr_name, libcrun_error_t *err);
 int resctl_move_task_to (const char *name, pid_t pid, libcrun_error_t *err);
+int resctl_move_task_to_mon_group (const char *name, const char *ctr_name, pid_t pid, libcrun_error_t *err);
+int resctl_read_mon_stats (const char *name, const char *ctr_name, struct libcrun_intelrdt_stats_s *stats, libcrun_error_t *err);
 int resctl_update (const char *name, const char *l3_cache_schema, const char *mem_bw_schema, libcrun_error_t *err);
-int resctl_destroy (const char *name, libcrun_error_t *err);
+int resctl_destroy (const char *name, const char *ctr_name, libcrun_error_t *err);
 
 #endif
@@ -0,0 +1,556 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A vectorized replacement for the yajl byte-at-a-time lexer.  The input is
+   scanned sixteen bytes at a time for the characters that matter (structural
+   whitespace, string delimiters, escapes), and the result is assembled into
+   the same yajl_val tree yajl_tree_parse would produce, so the libocispec
+   generated make_* converters consume it unchanged.  The tree is allocated
+   with plain malloc and is owned by the caller through yajl_tree_free.
+
+   The parser is deliberately strict: on anything it does not fully handle it
+   returns NULL and the caller falls back to yajl, trading a re-parse of the
+   rare odd document for a simple fast path.  */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "json-scan.h"
+#include "utils.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#if defined __SSE2__
+#  include <emmintrin.h>
+#elif defined __aarch64__
+#  include <arm_neon.h>
+#endif
+
+/* Deeper documents fall back to yajl rather than risking the stack.  */
+#define JSON_SCAN_MAX_DEPTH 128
+
+struct json_scan_s
+{
+  const unsigned char *p;
+  const unsigned char *end;
+};
+
+/* Return the position of the first byte a string scan has to stop at: the
+   closing quote, a backslash, or a control character.  */
+static inline const unsigned char *
+find_string_special (const unsigned char *p, const unsigned char *end)
+{
+#if defined __SSE2__
+  while (p + 16 <= end)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) p);
+      __m128i quote = _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('"'));
+      __m128i escape = _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\\'));
+      __m128i control = _mm_cmpeq_epi8 (_mm_subs_epu8 (v, _mm_set1_epi8 (0x1f)), _mm_setzero_si128 ());
+      int mask = _mm_movemask_epi8 (_mm_or_si128 (_mm_or_si128 (quote, escape), control));
+
+      if (mask != 0)
+        return p + __builtin_ctz (mask);
+      p += 16;
+    }
+#elif defined __aarch64__
+  while (p + 16 <= end)
+    {
+      uint8x16_t v = vld1q_u8 (p);
+      uint8x16_t special = vorrq_u8 (vorrq_u8 (vceqq_u8 (v, vdupq_n_u8 ('"')), vceqq_u8 (v, vdupq_n_u8 ('\\'))),
+                                     vcltq_u8 (v, vdupq_n_u8 (0x20)));
+
+      if (vmaxvq_u8 (special) != 0)
+        break;
+      p += 16;
+    }
+#endif
+  while (p < end && *p != '"' && *p != '\\' && *p >= 0x20)
+    p++;
+  return p;
+}
+
+static inline const unsigned char *
+skip_whitespace (const unsigned char *p, const unsigned char *end)
+{
+#if defined __SSE2__
+  while (p + 16 <= end)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) p);
+      __m128i ws = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 (' ')),
+                                               _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\n'))),
+                                 _mm_or_si128 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\t')),
+                                               _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\r'))));
+      int mask = _mm_movemask_epi8 (ws);
+
+      if (mask != 0xffff)
+        return p + __builtin_ctz (~mask & 0xffff);
+      p += 16;
+    }
+#elif defined __aarch64__
+  while (p + 16 <= end)
+    {
+      uint8x16_t v = vld1q_u8 (p);
+      uint8x16_t ws = vorrq_u8 (vorrq_u8 (vceqq_u8 (v, vdupq_n_u8 (' ')), vceqq_u8 (v, vdupq_n_u8 ('\n'))),
+                                vorrq_u8 (vceqq_u8 (v, vdupq_n_u8 ('\t')), vceqq_u8 (v, vdupq_n_u8 ('\r'))));
+
+      if (vminvq_u8 (ws) != 0xff)
+        break;
+      p += 16;
+    }
+#endif
+  while (p < end && (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r'))
+    p++;
+  return p;
+}
+
+static yajl_val
+value_alloc (yajl_type type)
+{
+  yajl_val v = xmalloc0 (sizeof (*v));
+
+  v->type = type;
+  return v;
+}
+
+/* Append CP to OUT as UTF-8.  Return the number of bytes written.  */
+static size_t
+utf8_encode (unsigned long cp, char *out)
+{
+  if (cp < 0x80)
+    {
+      out[0] = (char) cp;
+      return 1;
+    }
+  if (cp < 0x800)
+    {
+      out[0] = (char) (0xc0 | (cp >> 6));
+      out[1] = (char) (0x80 | (cp & 0x3f));
+      return 2;
+    }
+  if (cp < 0x10000)
+    {
+      out[0] = (char) (0xe0 | (cp >> 12));
+      out[1] = (char) (0x80 | ((cp >> 6) & 0x3f));
+      out[2] = (char) (0x80 | (cp & 0x3f));
+      return 3;
+    }
+  out[0] = (char) (0xf0 | (cp >> 18));
+  out[1] = (char) (0x80 | ((cp >> 12) & 0x3f));
+  out[2] = (char) (0x80 | ((cp >> 6) & 0x3f));
+  out[3] = (char) (0x80 | (cp & 0x3f));
+  return 4;
+}
+
+static int
+parse_hex4 (const unsigned char *p, unsigned long *out)
+{
+  unsigned long v = 0;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      unsigned char c = p[i];
+
+      v <<= 4;
+      if (c >= '0' && c <= '9')
+        v |= c - '0';
+      else if (c >= 'a' && c <= 'f')
+        v |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        v |= c - 'A' + 10;
+      else
+        return -1;
+    }
+  *out = v;
+  return 0;
+}
+
+/* Parse the string starting after the opening quote.  Return the decoded,
+   NUL terminated payload or NULL on malformed input.  */
+static char *
+parse_string_payload (struct json_scan_s *s)
+{
+  const unsigned char *start = s->p;
+  const unsigned char *special;
+  char *out;
+  size_t out_len;
+
+  special = find_string_special (s->p, s->end);
+  if (special == s->end || *special < 0x20)
+    return NULL;
+
+  if (*special == '"')
+    {
+      /* Fast path: no escapes, copy the span verbatim.  */
+      out_len = special - start;
+      out = xmalloc (out_len + 1);
+      memcpy (out, start, out_len);
+      out[out_len] = '\0';
+      s->p = special + 1;
+      return out;
+    }
+
+  /* Escapes present: decode into a buffer that can only shrink relative to
+     the input.  */
+  out = xmalloc (s->end - start + 1);
+  out_len = special - start;
+  memcpy (out, start, out_len);
+  s->p = special;
+
+  while (s->p < s->end)
+    {
+      unsigned char c = *s->p;
+
+      if (c == '"')
+        {
+          out[out_len] = '\0';
+          s->p++;
+          return out;
+        }
+      if (c < 0x20)
+        break;
+      if (c != '\\')
+        {
+          special = find_string_special (s->p, s->end);
+          memcpy (out + out_len, s->p, special - s->p);
+          out_len += special - s->p;
+          s->p = special;
+          continue;
+        }
+
+      if (s->p + 1 >= s->end)
+        break;
+      switch (s->p[1])
+        {
+        case '"':
+        case '\\':
+        case '/':
+          out[out_len++] = s->p[1];
+          s->p += 2;
+          break;
+        case 'b':
+          out[out_len++] = '\b';
+          s->p += 2;
+          break;
+        case 'f':
+          out[out_len++] = '\f';
+          s->p += 2;
+          break;
+        case 'n':
+          out[out_len++] = '\n';
+          s->p += 2;
+          break;
+        case 'r':
+          out[out_len++] = '\r';
+          s->p += 2;
+          break;
+        case 't':
+          out[out_len++] = '\t';
+          s->p += 2;
+          break;
+        case 'u':
+          {
+            unsigned long cp, low;
+
+            if (s->p + 6 > s->end || parse_hex4 (s->p + 2, &cp) < 0)
+              goto fail;
+            s->p += 6;
+
+            if (cp >= 0xd800 && cp <= 0xdbff)
+              {
+                /* Surrogate pair.  */
+                if (s->p + 6 > s->end || s->p[0] != '\\' || s->p[1] != 'u' || parse_hex4 (s->p + 2, &low) < 0
+                    || low < 0xdc00 || low > 0xdfff)
+                  goto fail;
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                s->p += 6;
+              }
+            else if (cp >= 0xdc00 && cp <= 0xdfff)
+              goto fail;
+
+            out_len += utf8_encode (cp, out + out_len);
+          }
+          break;
+        default:
+          goto fail;
+        }
+    }
+
+fail:
+  free (out);
+  return NULL;
+}
+
+static yajl_val parse_value (struct json_scan_s *s, int depth);
+
+static yajl_val
+parse_array (struct json_scan_s *s, int depth)
+{
+  yajl_val v = value_alloc (yajl_t_array);
+  size_t cap = 0;
+
+  s->p = skip_whitespace (s->p, s->end);
+  if (s->p < s->end && *s->p == ']')
+    {
+      s->p++;
+      return v;
+    }
+
+  while (s->p < s->end)
+    {
+      yajl_val item = parse_value (s, depth);
+
+      if (item == NULL)
+        break;
+
+      if (v->u.array.len == cap)
+        {
+          cap = cap ? cap * 2 : 8;
+          v->u.array.values = xrealloc (v->u.array.values, cap * sizeof (yajl_val));
+        }
+      v->u.array.values[v->u.array.len++] = item;
+
+      s->p = skip_whitespace (s->p, s->end);
+      if (s->p >= s->end)
+        break;
+      if (*s->p == ',')
+        {
+          s->p = skip_whitespace (s->p + 1, s->end);
+          continue;
+        }
+      if (*s->p == ']')
+        {
+          s->p++;
+          return v;
+        }
+      break;
+    }
+
+  yajl_tree_free (v);
+  return NULL;
+}
+
+static yajl_val
+parse_object (struct json_scan_s *s, int depth)
+{
+  yajl_val v = value_alloc (yajl_t_object);
+  size_t cap = 0;
+
+  s->p = skip_whitespace (s->p, s->end);
+  if (s->p < s->end && *s->p == '}')
+    {
+      s->p++;
+      return v;
+    }
+
+  while (s->p < s->end)
+    {
+      yajl_val value;
+      char *key;
+
+      if (*s->p != '"')
+        break;
+      s->p++;
+      key = parse_string_payload (s);
+      if (key == NULL)
+        break;
+
+      s->p = skip_whitespace (s->p, s->end);
+      if (s->p >= s->end || *s->p != ':')
+        {
+          free (key);
+          break;
+        }
+      s->p = skip_whitespace (s->p + 1, s->end);
+
+      value = parse_value (s, depth);
+      if (value == NULL)
+        {
+          free (key);
+          break;
+        }
+
+      if (v->u.object.len == cap)
+        {
+          cap = cap ? cap * 2 : 8;
+          v->u.object.keys = xrealloc (v->u.object.keys, cap * sizeof (char *));
+          v->u.object.values = xrealloc (v->u.object.values, cap * sizeof (yajl_val));
+        }
+      v->u.object.keys[v->u.object.len] = key;
+      v->u.object.values[v->u.object.len] = value;
+      v->u.object.len++;
+
+      s->p = skip_whitespace (s->p, s->end);
+      if (s->p >= s->end)
+        break;
+      if (*s->p == ',')
+        {
+          s->p = skip_whitespace (s->p + 1, s->end);
+          continue;
+        }
+      if (*s->p == '}')
+        {
+          s->p++;
+          return v;
+        }
+      break;
+    }
+
+  yajl_tree_free (v);
+  return NULL;
+}
+
+static yajl_val
+parse_number (struct json_scan_s *s)
+{
+  const unsigned char *start = s->p;
+  yajl_val v;
+  char *endptr;
+  size_t len;
+
+  /* Enforce the RFC 8259 grammar: an optional minus, an integer part that
+     is either a single zero or starts with a non-zero digit, then optional
+     fraction and exponent parts each with at least one digit.  Anything
+     looser must fail the scan so that yajl gets to judge the document.  */
+  if (s->p < s->end && *s->p == '-')
+    s->p++;
+  if (s->p >= s->end || *s->p < '0' || *s->p > '9')
+    return NULL;
+  if (*s->p == '0')
+    s->p++;
+  else
+    while (s->p < s->end && *s->p >= '0' && *s->p <= '9')
+      s->p++;
+  if (s->p < s->end && *s->p == '.')
+    {
+      s->p++;
+      if (s->p >= s->end || *s->p < '0' || *s->p > '9')
+        return NULL;
+      while (s->p < s->end && *s->p >= '0' && *s->p <= '9')
+        s->p++;
+    }
+  if (s->p < s->end && (*s->p == 'e' || *s->p == 'E'))
+    {
+      s->p++;
+      if (s->p < s->end && (*s->p == '+' || *s->p == '-'))
+        s->p++;
+      if (s->p >= s->end || *s->p < '0' || *s->p > '9')
+        return NULL;
+      while (s->p < s->end && *s->p >= '0' && *s->p <= '9')
+        s->p++;
+    }
+
+  len = s->p - start;
+
+  v = value_alloc (yajl_t_number);
+  v->u.number.r = xmalloc (len + 1);
+  memcpy (v->u.number.r, start, len);
+  v->u.number.r[len] = '\0';
+
+  errno = 0;
+  v->u.number.i = strtoll (v->u.number.r, &endptr, 10);
+  if (errno == 0 && *endptr == '\0')
+    v->u.number.flags |= YAJL_NUMBER_INT_VALID;
+
+  errno = 0;
+  v->u.number.d = strtod (v->u.number.r, &endptr);
+  if (errno == 0 && *endptr == '\0')
+    v->u.number.flags |= YAJL_NUMBER_DOUBLE_VALID;
+
+  return v;
+}
+
+static yajl_val
+parse_value (struct json_scan_s *s, int depth)
+{
+  if (UNLIKELY (depth >= JSON_SCAN_MAX_DEPTH) || s->p >= s->end)
+    return NULL;
+
+  switch (*s->p)
+    {
+    case '{':
+      s->p++;
+      return parse_object (s, depth + 1);
+
+    case '[':
+      s->p++;
+      return parse_array (s, depth + 1);
+
+    case '"':
+      {
+        char *payload;
+        yajl_val v;
+
+        s->p++;
+        payload = parse_string_payload (s);
+        if (payload == NULL)
+          return NULL;
+        v = value_alloc (yajl_t_string);
+        v->u.string = payload;
+        return v;
+      }
+
+    case 't':
+      if (s->end - s->p < 4 || memcmp (s->p, "true", 4) != 0)
+        return NULL;
+      s->p += 4;
+      return value_alloc (yajl_t_true);
+
+    case 'f':
+      if (s->end - s->p < 5 || memcmp (s->p, "false", 5) != 0)
+        return NULL;
+      s->p += 5;
+      return value_alloc (yajl_t_false);
+
+    case 'n':
+      if (s->end - s->p < 4 || memcmp (s->p, "null", 4) != 0)
+        return NULL;
+      s->p += 4;
+      return value_alloc (yajl_t_null);
+
+    default:
+      return parse_number (s);
+    }
+}
+
+yajl_val
+libcrun_json_parse_tree (const char *input, size_t len)
+{
+  struct json_scan_s s;
+  yajl_val v;
+
+  s.p = (const unsigned char *) input;
+  s.end = s.p + len;
+
+  s.p = skip_whitespace (s.p, s.end);
+  v = parse_value (&s, 0);
+  if (v == NULL)
+    return NULL;
+
+  /* Trailing garbage means the fallback parser must judge the document.  */
+  s.p = skip_whitespace (s.p, s.end);
+  if (s.p != s.end)
+    {
+      yajl_tree_free (v);
+      return NULL;
+    }
+
+  return v;
+}
@@ -0,0 +1,30 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+#include <config.h>
+#include <stddef.h>
+#include <yajl/yajl_tree.h>
+
+/* Parse INPUT (LEN bytes) into a yajl_val tree with the vectorized scanner,
+   interchangeable with the output of yajl_tree_parse and freed with
+   yajl_tree_free.  Returns NULL on input the scanner does not handle; the
+   caller is expected to fall back to yajl then.  */
+yajl_val libcrun_json_parse_tree (const char *input, size_t len);
+
+#endif
@@ -114,6 +114,14 @@ struct remount_s
   char *data;
 };
 
+struct idmapped_userns_s
+{
+  struct idmapped_userns_s *next;
+  /* Formatted mappings, see maybe_create_userns_for_idmapped_mount.  */
+  char *key;
+  int fd;
+};
+
 struct private_data_s
 {
   struct remount_s *remounts;
@@ -141,9 +149,19 @@ struct private_data_s
   struct libcrun_fd_map *mount_fds;
   struct libcrun_fd_map *dev_fds;
 
+  /* Sorted index over def->mounts destinations, built lazily by
+     has_mount_for.  */
+  char **mounts_by_dest;
+  size_t n_mounts_by_dest;
+
   /* Used to save stdin, stdout, stderr during checkpointing to descriptors.json
    * and needed during restore. */
   char *external_descriptors;
+
+  /* User namespaces created for idmapped mounts, keyed by the formatted
+     mappings and pinned by their fd for the container's lifetime, so
+     mounts sharing a mapping do not pay a fork+userns each.  */
+  struct idmapped_userns_s *idmapped_userns;
 };
 
 struct linux_namespace_s
@@ -165,9 +183,20 @@ cleanup_private_data (void *private_data)
   if (p->dev_fds)
     cleanup_close_mapp (&(p->dev_fds));
 
+  while (p->idmapped_userns)
+    {
+      struct idmapped_userns_s *next = p->idmapped_userns->next;
+
+      TEMP_FAILURE_RETRY (close (p->idmapped_userns->fd));
+      free (p->idmapped_userns->key);
+      free (p->idmapped_userns);
+      p->idmapped_userns = next;
+    }
+
   free (p->host_notify_socket_path);
   free (p->container_notify_socket_path);
   free (p->external_descriptors);
+  free (p->mounts_by_dest);
   free (p);
 }
 
@@ -227,6 +256,16 @@ libcrun_find_namespace (const char *name)
   return -1;
 }
 
+const char *
+libcrun_namespace_proc_file (const char *name)
+{
+  struct linux_namespace_s *it;
+  for (it = namespaces; it->name; it++)
+    if (strcmp (it->name, name) == 0)
+      return it->ns_file;
+  return NULL;
+}
+
 #ifndef __aligned_u64
 #  define __aligned_u64 uint64_t __attribute__ ((aligned (8)))
 #endif
@@ -351,6 +390,34 @@ struct mount_attr_s
 #  define MOUNT_ATTR_RDONLY 0x00000001 /* Mount read-only */
 #endif
 
+#ifndef MOUNT_ATTR_NOSUID
+#  define MOUNT_ATTR_NOSUID 0x00000002 /* Ignore suid and sgid bits */
+#endif
+
+#ifndef MOUNT_ATTR_NODEV
+#  define MOUNT_ATTR_NODEV 0x00000004 /* Disallow access to device special files */
+#endif
+
+#ifndef MOUNT_ATTR_NOEXEC
+#  define MOUNT_ATTR_NOEXEC 0x00000008 /* Disallow program execution */
+#endif
+
+#ifndef MOUNT_ATTR__ATIME
+#  define MOUNT_ATTR__ATIME 0x00000070 /* Setting on how atime should be updated */
+#endif
+
+#ifndef MOUNT_ATTR_NOATIME
+#  define MOUNT_ATTR_NOATIME 0x00000010 /* - Do not update access times. */
+#endif
+
+#ifndef MOUNT_ATTR_STRICTATIME
+#  define MOUNT_ATTR_STRICTATIME 0x00000020 /* - Always perform atime updates */
+#endif
+
+#ifndef MOUNT_ATTR_NODIRATIME
+#  define MOUNT_ATTR_NODIRATIME 0x00000080 /* Do not update directory access times */
+#endif
+
 #ifndef MOUNT_ATTR_IDMAP
 #  define MOUNT_ATTR_IDMAP 0x00100000 /* Idmap mount to @userns_fd in struct mount_attr. */
 #endif
@@ -424,6 +491,105 @@ do_mount_setattr (const char *target, int targetfd, uint64_t clear, uint64_t set
   return 0;
 }
 
+#if defined HAVE_NEW_MOUNT_API && defined STATX_MNT_ID
+/* Cache of detached mount fds keyed by the bind source.  Nodes bind the same
+   host volumes into many containers, so a hit clones the already prepared
+   tree instead of walking the path and setting the attributes again.  An
+   entry is validated by the mount id of the source path before use.  */
+#  define BIND_MOUNT_CACHE_SIZE 16
+
+struct bind_mount_cache_entry_s
+{
+  char *src;
+  int fd;
+  bool recursive;
+  bool rdonly;
+  uint64_t mnt_id;
+};
+
+static struct bind_mount_cache_entry_s bind_mount_cache[BIND_MOUNT_CACHE_SIZE];
+static size_t bind_mount_cache_next;
+
+static int
+get_mnt_id_for_path (const char *path, uint64_t *mnt_id)
+{
+  struct statx stx = {
+    0,
+  };
+  int ret;
+
+  ret = statx (AT_FDCWD, path, AT_NO_AUTOMOUNT | AT_STATX_DONT_SYNC, STATX_MNT_ID, &stx);
+  if (ret < 0 || (stx.stx_mask & STATX_MNT_ID) == 0)
+    return -1;
+
+  *mnt_id = stx.stx_mnt_id;
+  return 0;
+}
+
+static void
+bind_mount_cache_drop (struct bind_mount_cache_entry_s *entry)
+{
+  free (entry->src);
+  entry->src = NULL;
+  close_and_reset (&entry->fd);
+}
+
+static int
+bind_mount_cache_lookup (const char *src, bool recursive, bool rdonly, uint64_t mnt_id, int recursive_flag)
+{
+  size_t i;
+
+  for (i = 0; i < BIND_MOUNT_CACHE_SIZE; i++)
+    {
+      struct bind_mount_cache_entry_s *entry = &bind_mount_cache[i];
+      int fd;
+
+      if (entry->src == NULL || entry->recursive != recursive || entry->rdonly != rdonly
+          || strcmp (entry->src, src) != 0)
+        continue;
+
+      if (entry->mnt_id != mnt_id)
+        {
+          /* The mount at the source path changed, the cached tree is stale.  */
+          bind_mount_cache_drop (entry);
+          return -1;
+        }
+
+      fd = syscall_open_tree (entry->fd, "",
+                              AT_EMPTY_PATH | OPEN_TREE_CLOEXEC | OPEN_TREE_CLONE | recursive_flag);
+      if (fd >= 0)
+        return fd;
+
+      return -1;
+    }
+  return -1;
+}
+
+static void
+bind_mount_cache_insert (const char *src, bool recursive, bool rdonly, uint64_t mnt_id, int fd, int recursive_flag)
+{
+  struct bind_mount_cache_entry_s *entry;
+  int cached_fd;
+
+  /* Keep an own clone of the prepared tree in the cache.  */
+  cached_fd = syscall_open_tree (fd, "", AT_EMPTY_PATH | OPEN_TREE_CLOEXEC | OPEN_TREE_CLONE | recursive_flag);
+  if (cached_fd < 0)
+    return;
+
+  entry = &bind_mount_cache[bind_mount_cache_next];
+  bind_mount_cache_next = (bind_mount_cache_next + 1) % BIND_MOUNT_CACHE_SIZE;
+
+  if (entry->src)
+    bind_mount_cache_drop (entry);
+
+  entry->src = xstrdup (src);
+  entry->recursive = recursive;
+  entry->rdonly = rdonly;
+  entry->mnt_id = mnt_id;
+  entry->fd = cached_fd;
+}
+#endif
+
 static int
 get_bind_mount (int dirfd, const char *src, bool recursive, bool rdonly, libcrun_error_t *err)
 {
@@ -432,11 +598,28 @@ get_bind_mount (int dirfd, const char *src, bool recursive, bool rdonly, libcrun
     0,
   };
   int recursive_flag = (recursive ? AT_RECURSIVE : 0);
+#if defined HAVE_NEW_MOUNT_API && defined STATX_MNT_ID
+  bool has_mnt_id = false;
+  uint64_t mnt_id = 0;
+#endif
   int ret;
 
   if (rdonly)
     attr.attr_set = MS_RDONLY;
 
+#if defined HAVE_NEW_MOUNT_API && defined STATX_MNT_ID
+  if (dirfd < 0)
+    {
+      has_mnt_id = get_mnt_id_for_path (src, &mnt_id) == 0;
+      if (has_mnt_id)
+        {
+          ret = bind_mount_cache_lookup (src, recursive, rdonly, mnt_id, recursive_flag);
+          if (ret >= 0)
+            return ret;
+        }
+    }
+#endif
+
   errno = 0;
   open_tree_fd = syscall_open_tree (dirfd, src,
                                     AT_NO_AUTOMOUNT | OPEN_TREE_CLOEXEC
@@ -448,6 +631,11 @@ get_bind_mount (int dirfd, const char *src, bool recursive, bool rdonly, libcrun
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, errno, "mount_setattr `%s`", src);
 
+#if defined HAVE_NEW_MOUNT_API && defined STATX_MNT_ID
+  if (has_mnt_id)
+    bind_mount_cache_insert (src, recursive, rdonly, mnt_id, open_tree_fd, recursive_flag);
+#endif
+
   return get_and_reset (&open_tree_fd);
 }
 
@@ -615,19 +803,51 @@ has_same_mappings (runtime_spec_schema_config_schema *def, runtime_spec_schema_d
   return true;
 }
 
-static pid_t
-maybe_create_userns_for_idmapped_mount (runtime_spec_schema_config_schema *def,
+/* Get the user namespace configured with the mappings for an idmapped
+   mount.  Namespaces are cached in the container private data keyed by the
+   formatted mappings, so every mount — and ten mounts sharing the same
+   mapping are common — costs the fork+userns setup only once.  On success
+   *USERNS_FD_OUT is either a borrowed fd owned by the cache, or -1 when
+   the container user namespace must be used.  */
+static int
+maybe_create_userns_for_idmapped_mount (libcrun_container_t *container,
+                                        runtime_spec_schema_config_schema *def,
                                         runtime_spec_schema_defs_mount *mnt,
-                                        const char *options, pid_t *pid_out,
+                                        const char *options, int *userns_fd_out,
                                         libcrun_error_t *err)
 {
+  struct private_data_s *priv = get_private_data (container);
+  cleanup_free char *uid_map = NULL;
+  cleanup_free char *gid_map = NULL;
+  size_t uid_map_len = 0, gid_map_len = 0;
+  cleanup_free char *key = NULL;
+  struct idmapped_userns_s *entry;
+  cleanup_close int userns_fd = -1;
   cleanup_pid pid_t pid = -1;
   char proc_file[64];
   bool need_new_userns = mnt->uid_mappings_len ? ! has_same_mappings (def, mnt) : options != NULL;
 
+  *userns_fd_out = -1;
+
   if (! need_new_userns)
     return 0;
 
+  if (mnt->uid_mappings_len)
+    {
+      uid_map = format_mount_mappings (mnt->uid_mappings, mnt->uid_mappings_len, &uid_map_len);
+      gid_map = format_mount_mappings (mnt->gid_mappings, mnt->gid_mappings_len, &gid_map_len);
+      xasprintf (&key, "uids=%s;gids=%s", uid_map, gid_map);
+    }
+  else
+    xasprintf (&key, "options=%s", options);
+
+  for (entry = priv->idmapped_userns; entry; entry = entry->next)
+    if (strcmp (entry->key, key) == 0)
+      {
+        *userns_fd_out = entry->fd;
+        return 0;
+      }
+
   pid = syscall_clone (CLONE_NEWUSER | SIGCHLD, NULL);
   if (UNLIKELY (pid < 0))
     return crun_make_error (err, errno, "clone");
@@ -642,20 +862,15 @@ maybe_create_userns_for_idmapped_mount (runtime_spec_schema_config_schema *def,
 
   if (mnt->uid_mappings_len)
     {
-      cleanup_free char *uid_map = NULL;
-      cleanup_free char *gid_map = NULL;
-      size_t written = 0;
       int ret;
 
-      uid_map = format_mount_mappings (mnt->uid_mappings, mnt->uid_mappings_len, &written);
       sprintf (proc_file, "/proc/%d/uid_map", pid);
-      ret = write_file (proc_file, uid_map, written, err);
+      ret = write_file (proc_file, uid_map, uid_map_len, err);
       if (UNLIKELY (ret < 0))
         return ret;
 
-      gid_map = format_mount_mappings (mnt->gid_mappings, mnt->gid_mappings_len, &written);
       sprintf (proc_file, "/proc/%d/gid_map", pid);
-      ret = write_file (proc_file, gid_map, written, err);
+      ret = write_file (proc_file, gid_map, gid_map_len, err);
       if (UNLIKELY (ret < 0))
         return ret;
     }
@@ -677,15 +892,20 @@ maybe_create_userns_for_idmapped_mount (runtime_spec_schema_config_schema *def,
           size_t len = 0;
           int ret;
 
-          if (has_prefix (option, "uids="))
+          switch (get_mount_option_key (option))
             {
+            case MOUNT_OPTION_KEY_UIDS:
               is_uids = true;
               sprintf (proc_file, "/proc/%d/uid_map", pid);
+              break;
+
+            case MOUNT_OPTION_KEY_GIDS:
+              sprintf (proc_file, "/proc/%d/gid_map", pid);
+              break;
+
+            default:
+              return crun_make_error (err, 0, "invalid option `%s` specified", option);
             }
-          else if (has_prefix (option, "gids="))
-            sprintf (proc_file, "/proc/%d/gid_map", pid);
-          else
-            return crun_make_error (err, 0, "invalid option `%s` specified", option);
 
           ret = parse_idmapped_mount_option (def, is_uids, option + 5 /* strlen ("uids="), strlen ("gids=")*/, &mappings, &len, err);
           if (UNLIKELY (ret < 0))
@@ -697,8 +917,20 @@ maybe_create_userns_for_idmapped_mount (runtime_spec_schema_config_schema *def,
         }
     }
 
-  *pid_out = pid;
-  pid = -1;
+  /* The fd pins the namespace, the helper process is no longer needed.  */
+  sprintf (proc_file, "/proc/%d/ns/user", pid);
+  userns_fd = open (proc_file, O_RDONLY | O_CLOEXEC);
+  if (UNLIKELY (userns_fd < 0))
+    return crun_make_error (err, errno, "open `%s`", proc_file);
+
+  entry = xmalloc0 (sizeof (*entry));
+  entry->key = key;
+  key = NULL;
+  entry->fd = get_and_reset (&userns_fd);
+  entry->next = priv->idmapped_userns;
+  priv->idmapped_userns = entry;
+
+  *userns_fd_out = entry->fd;
   return 0;
 }
 
@@ -796,6 +1028,61 @@ get_mount_flags (const char *name, int current_flags, int *found, unsigned long
   return current_flags | prop->flags;
 }
 
+/* Keys of the mount options that carry a value, plus the idmap syntax.
+   Unlike the flag options, these cannot go through the gperf table since the
+   value part varies, so classify the key with a single dispatch on its
+   length and first character.  */
+enum
+{
+  MOUNT_OPTION_KEY_NONE = 0,
+  MOUNT_OPTION_KEY_IDMAP,
+  MOUNT_OPTION_KEY_RIDMAP,
+  MOUNT_OPTION_KEY_UIDS,
+  MOUNT_OPTION_KEY_GIDS,
+  MOUNT_OPTION_KEY_MODE,
+  MOUNT_OPTION_KEY_SIZE,
+  MOUNT_OPTION_KEY_CONTEXT,
+  MOUNT_OPTION_KEY_FSCONTEXT,
+};
+
+static int
+get_mount_option_key (const char *option)
+{
+  /* The key ends at the value or at the next option.  */
+  size_t len = strcspn (option, "=,");
+
+  switch (len)
+    {
+    case 4:
+      switch (option[0])
+        {
+        case 'u':
+          return memcmp (option, "uids", 4) == 0 ? MOUNT_OPTION_KEY_UIDS : MOUNT_OPTION_KEY_NONE;
+        case 'g':
+          return memcmp (option, "gids", 4) == 0 ? MOUNT_OPTION_KEY_GIDS : MOUNT_OPTION_KEY_NONE;
+        case 'm':
+          return memcmp (option, "mode", 4) == 0 ? MOUNT_OPTION_KEY_MODE : MOUNT_OPTION_KEY_NONE;
+        case 's':
+          return memcmp (option, "size", 4) == 0 ? MOUNT_OPTION_KEY_SIZE : MOUNT_OPTION_KEY_NONE;
+        }
+      return MOUNT_OPTION_KEY_NONE;
+
+    case 5:
+      return memcmp (option, "idmap", 5) == 0 ? MOUNT_OPTION_KEY_IDMAP : MOUNT_OPTION_KEY_NONE;
+
+    case 6:
+      return memcmp (option, "ridmap", 6) == 0 ? MOUNT_OPTION_KEY_RIDMAP : MOUNT_OPTION_KEY_NONE;
+
+    case 7:
+      return memcmp (option, "context", 7) == 0 ? MOUNT_OPTION_KEY_CONTEXT : MOUNT_OPTION_KEY_NONE;
+
+    case 9:
+      return memcmp (option, "fscontext", 9) == 0 ? MOUNT_OPTION_KEY_FSCONTEXT : MOUNT_OPTION_KEY_NONE;
+    }
+
+  return MOUNT_OPTION_KEY_NONE;
+}
+
 static unsigned long
 get_mount_flags_or_option (const char *name, int current_flags, unsigned long *extra_flags, char **option, uint64_t *rec_clear, uint64_t *rec_set)
 {
@@ -891,11 +1178,98 @@ do_remount (int targetfd, const char *target, unsigned long flags, const char *d
   return 0;
 }
 
+/* Translate the per-mount MS_* flags of a deferred remount into a
+   mount_setattr payload.  Return false when the flags contain something
+   mount_setattr cannot express (superblock flags), so the caller must keep
+   the legacy mount(2) path for that entry.  */
+static bool
+remount_flags_to_mount_attr (unsigned long flags, struct mount_attr_s *attr)
+{
+  unsigned long rest = flags & ~(MS_REMOUNT | MS_BIND | MS_REC | MS_RDONLY | MS_NOSUID | MS_NODEV | MS_NOEXEC);
+
+  memset (attr, 0, sizeof (*attr));
+
+  if (flags & MS_RDONLY)
+    attr->attr_set |= MOUNT_ATTR_RDONLY;
+  if (flags & MS_NOSUID)
+    attr->attr_set |= MOUNT_ATTR_NOSUID;
+  if (flags & MS_NODEV)
+    attr->attr_set |= MOUNT_ATTR_NODEV;
+  if (flags & MS_NOEXEC)
+    attr->attr_set |= MOUNT_ATTR_NOEXEC;
+
+  if (flags & (MS_NOATIME | MS_RELATIME | MS_STRICTATIME | MS_NODIRATIME))
+    {
+      /* Changing any atime mode requires clearing the whole group.  */
+      attr->attr_clr |= MOUNT_ATTR__ATIME;
+      if (flags & MS_NOATIME)
+        attr->attr_set |= MOUNT_ATTR_NOATIME;
+      if (flags & MS_STRICTATIME)
+        attr->attr_set |= MOUNT_ATTR_STRICTATIME;
+      if (flags & MS_NODIRATIME)
+        attr->attr_set |= MOUNT_ATTR_NODIRATIME;
+      rest &= ~(MS_NOATIME | MS_RELATIME | MS_STRICTATIME | MS_NODIRATIME);
+    }
+
+  return rest == 0;
+}
+
 static int
 finalize_mounts (libcrun_container_t *container, libcrun_error_t *err)
 {
+  static bool mount_setattr_supported = true;
   int ret = 0;
-  struct remount_s *r = get_private_data (container)->remounts;
+  struct remount_s *r;
+
+  /* Fast path: apply the deferred remounts through mount_setattr.  Unlike a
+     MS_REMOUNT cycle it changes only the requested attributes, so the
+     per-remount statfs flag fixup in do_remount is not needed; consecutive
+     remounts sharing a flag combination also reuse the translated payload.
+     Entries the new API cannot express, or where it fails, stay on the list
+     and go through the legacy path below.  */
+  if (mount_setattr_supported)
+    {
+      struct remount_s **it = &get_private_data (container)->remounts;
+      unsigned long cached_flags = 0;
+      struct mount_attr_s attr;
+      bool cached = false;
+
+      while (*it != NULL)
+        {
+          struct remount_s *cur = *it;
+
+          if (cur->targetfd < 0)
+            goto keep;
+
+          if (! cached || cur->flags != cached_flags)
+            {
+              if (! remount_flags_to_mount_attr (cur->flags, &attr))
+                goto keep;
+              cached = true;
+              cached_flags = cur->flags;
+            }
+
+          ret = syscall_mount_setattr (cur->targetfd, "", AT_EMPTY_PATH, &attr);
+          if (ret < 0)
+            {
+              if (errno == ENOSYS)
+                {
+                  mount_setattr_supported = false;
+                  break;
+                }
+              goto keep;
+            }
+
+          *it = cur->next;
+          free_remount (cur);
+          continue;
+
+        keep:
+          it = &cur->next;
+        }
+    }
+
+  r = get_private_data (container)->remounts;
   while (r)
     {
       struct remount_s *next = r->next;
@@ -995,22 +1369,141 @@ enum
   LABEL_XATTR,
 };
 
+/* Mount an overlay file system through the new mount API.  Every lowerdir is
+   opened once and passed as a /proc/self/fd path with the incremental
+   `lowerdir+` key, so the kernel does not re-parse long option strings nor
+   re-resolve the lowerdir chain, and flag options like `volatile` map to
+   FSCONFIG_SET_FLAG.  Returns 0 on success and 1 when the caller must fall
+   back to mount(2), e.g. on kernels without `lowerdir+` support.  */
+static int
+do_overlay_mount_new_api (int targetfd, const char *data, const char *labeltype, const char *label)
+{
+#ifdef HAVE_NEW_MOUNT_API
+  cleanup_close int fsfd = -1;
+  cleanup_close int mfd = -1;
+  int ret;
+
+  fsfd = syscall_fsopen ("overlay", FSOPEN_CLOEXEC);
+  if (UNLIKELY (fsfd < 0))
+    return 1;
+
+  if (data)
+    {
+      cleanup_free char *options = xstrdup (data);
+      char *saveptr = NULL;
+      char *opt;
+
+      for (opt = strtok_r (options, ",", &saveptr); opt; opt = strtok_r (NULL, ",", &saveptr))
+        {
+          char *value = strchr (opt, '=');
+
+          if (value == NULL)
+            {
+              /* Flag options, including `volatile`.  */
+              ret = syscall_fsconfig (fsfd, FSCONFIG_SET_FLAG, opt, NULL, 0);
+              if (UNLIKELY (ret < 0))
+                return 1;
+              continue;
+            }
+
+          *value++ = '\0';
+
+          if (strcmp (opt, "lowerdir") == 0)
+            {
+              char *dir_saveptr = NULL;
+              char *dir;
+
+              /* Escaped separators need the option string syntax.  */
+              if (strchr (value, '\\'))
+                return 1;
+
+              for (dir = strtok_r (value, ":", &dir_saveptr); dir; dir = strtok_r (NULL, ":", &dir_saveptr))
+                {
+                  cleanup_close int dirfd = -1;
+                  proc_fd_path_t proc_path;
+
+                  dirfd = open (dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+                  if (UNLIKELY (dirfd < 0))
+                    return 1;
+
+                  /* The path is resolved by the kernel at fsconfig time, so
+                     the fd can be closed right after the call.  */
+                  get_proc_self_fd_path (proc_path, dirfd);
+                  ret = syscall_fsconfig (fsfd, FSCONFIG_SET_STRING, "lowerdir+", proc_path, 0);
+                  if (UNLIKELY (ret < 0))
+                    return 1;
+                }
+              continue;
+            }
+
+          ret = syscall_fsconfig (fsfd, FSCONFIG_SET_STRING, opt, value, 0);
+          if (UNLIKELY (ret < 0))
+            return 1;
+        }
+    }
+
+  if (labeltype)
+    {
+      ret = syscall_fsconfig (fsfd, FSCONFIG_SET_STRING, labeltype, label, 0);
+      if (UNLIKELY (ret < 0))
+        return 1;
+    }
+
+  ret = syscall_fsconfig (fsfd, FSCONFIG_CMD_CREATE, NULL, NULL, 0);
+  if (UNLIKELY (ret < 0))
+    return 1;
+
+  mfd = syscall_fsmount (fsfd, FSMOUNT_CLOEXEC, 0);
+  if (UNLIKELY (mfd < 0))
+    return 1;
+
+  ret = fs_move_mount_to (mfd, targetfd, NULL);
+  if (UNLIKELY (ret < 0))
+    return 1;
+
+  return 0;
+#else
+  (void) targetfd;
+  (void) data;
+  (void) labeltype;
+  (void) label;
+  return 1;
+#endif
+}
+
 static int do_mount (libcrun_container_t *container, const char *source, int targetfd,
                      const char *target, const char *fstype, unsigned long mountflags,
                      const void *data, int label_how, libcrun_error_t *err);
 
+static int
+compare_strings (const void *a, const void *b)
+{
+  return strcmp (*(const char *const *) a, *(const char *const *) b);
+}
+
 static bool
 has_mount_for (libcrun_container_t *container, const char *destination)
 {
-  size_t i;
   runtime_spec_schema_config_schema *def = container->container_def;
+  struct private_data_s *priv = get_private_data (container);
+  size_t i;
 
-  for (i = 0; i < def->mounts_len; i++)
+  if (def->mounts_len == 0)
+    return false;
+
+  /* Build the sorted destination index on the first lookup, so repeated
+     queries cost a binary search instead of a scan over all the mounts.  */
+  if (priv->mounts_by_dest == NULL || priv->n_mounts_by_dest != def->mounts_len)
     {
-      if (strcmp (def->mounts[i]->destination, destination) == 0)
-        return true;
+      free (priv->mounts_by_dest);
+      priv->mounts_by_dest = xmalloc (sizeof (char *) * def->mounts_len);
+      for (i = 0; i < def->mounts_len; i++)
+        priv->mounts_by_dest[i] = def->mounts[i]->destination;
+      qsort (priv->mounts_by_dest, def->mounts_len, sizeof (char *), compare_strings);
+      priv->n_mounts_by_dest = def->mounts_len;
     }
-  return false;
+
+  return bsearch (&destination, priv->mounts_by_dest, priv->n_mounts_by_dest, sizeof (char *), compare_strings) != NULL;
 }
 
 static int
@@ -1021,6 +1514,7 @@ do_masked_or_readonly_path (libcrun_container_t *container, const char *rel_path
   size_t rootfs_len = get_private_data (container)->rootfs_len;
   const char *rootfs = get_private_data (container)->rootfs;
   int rootfsfd = get_private_data (container)->rootfsfd;
+  struct crun_probe_error_s probe_err;
   cleanup_close int pathfd = -1;
   struct statfs sfs;
   int ret;
@@ -1029,13 +1523,14 @@ do_masked_or_readonly_path (libcrun_container_t *container, const char *rel_path
   if (rel_path[0] == '/')
     rel_path++;
 
-  pathfd = safe_openat (rootfsfd, rootfs, rootfs_len, rel_path, O_PATH | O_CLOEXEC, 0, err);
+  pathfd = safe_openat_probe (rootfsfd, rootfs, rootfs_len, rel_path, O_PATH | O_CLOEXEC, 0, &probe_err);
   if (UNLIKELY (pathfd < 0))
     {
-      if (errno != ENOENT && errno != EACCES)
-        return crun_make_error (err, errno, "open `%s`", rel_path);
+      int errno_ = crun_probe_error_get_errno (&probe_err);
+
+      if (errno_ != ENOENT && errno_ != EACCES)
+        return crun_error_from_probe (err, &probe_err, "open `%s`", rel_path);
 
-      crun_error_release (err);
       return 0;
     }
 
@@ -1103,6 +1598,8 @@ do_mount (libcrun_container_t *container, const char *source, int targetfd,
   proc_fd_path_t target_buffer;
   bool needs_remount = false;
   cleanup_close int fd = -1;
+  const char *context_type = NULL;
+  const void *data_no_label = data;
   const char *label = NULL;
   int ret = 0;
 
@@ -1125,7 +1622,7 @@ do_mount (libcrun_container_t *container, const char *source, int targetfd,
 
   if (label_how == LABEL_MOUNT)
     {
-      const char *context_type = get_selinux_context_type (container);
+      context_type = get_selinux_context_type (container);
 
       ret = add_selinux_mount_label (&data_with_label, data, label, context_type, err);
       if (ret < 0)
@@ -1154,7 +1651,12 @@ do_mount (libcrun_container_t *container, const char *source, int targetfd,
     {
       unsigned long flags = mountflags & ~(ALL_PROPAGATIONS_NO_REC | MS_RDONLY);
 
-      ret = mount (source, real_target, fstype, flags, data);
+      ret = -1;
+      if (fstype && strcmp (fstype, "overlay") == 0 && targetfd >= 0)
+        ret = do_overlay_mount_new_api (targetfd, data_no_label,
+                                        label_how == LABEL_MOUNT ? context_type : NULL, label);
+      if (ret != 0)
+        ret = mount (source, real_target, fstype, flags, data);
       if (UNLIKELY (ret < 0))
         {
           int saved_errno = errno;
@@ -1573,6 +2075,21 @@ struct device_s needed_devs[] = { { "/dev/null", "c", 1, 3, 0666, 0, 0 },
                                   { "/dev/urandom", "c", 1, 9, 0666, 0, 0 },
                                   {} };
 
+/* The same default devices with the mknodat arguments precomputed: every
+   entry is a direct child of /dev, so they can be created in a single loop
+   against the already open /dev descriptor.  */
+static const struct
+{
+  const char *name;
+  mode_t mode;
+  dev_t dev;
+} default_devs[] = { { "null", S_IFCHR | 0666, makedev (1, 3) },
+                     { "zero", S_IFCHR | 0666, makedev (1, 5) },
+                     { "full", S_IFCHR | 0666, makedev (1, 7) },
+                     { "tty", S_IFCHR | 0666, makedev (5, 0) },
+                     { "random", S_IFCHR | 0666, makedev (1, 8) },
+                     { "urandom", S_IFCHR | 0666, makedev (1, 9) } };
+
 /* Check if the specified path is a direct child of /dev.  If it is
  return a pointer to the basename.  */
 static const char *
@@ -1691,11 +2208,14 @@ libcrun_create_dev (libcrun_container_t *container, int devfd, int srcfd,
             dirfd = dup (rootfsfd);
           else
             {
-              dirfd = safe_openat (rootfsfd, rootfs, rootfs_len, dirname,
-                                   O_DIRECTORY | O_PATH | O_CLOEXEC, 0, err);
-              if (dirfd < 0 && ensure_parent_dir)
+              struct crun_probe_error_s probe_err;
+
+              dirfd = safe_openat_probe (rootfsfd, rootfs, rootfs_len, dirname,
+                                         O_DIRECTORY | O_PATH | O_CLOEXEC, 0, &probe_err);
+              if (dirfd < 0)
                 {
-                  crun_error_release (err);
+                  if (! ensure_parent_dir)
+                    return crun_error_from_probe (err, &probe_err, "open `%s`", dirname);
 
                   dirfd = crun_safe_create_and_open_ref_at (true, rootfsfd, rootfs,
                                                             rootfs_len, dirname, 0755, err);
@@ -1783,6 +2303,40 @@ create_missing_devs (libcrun_container_t *container, bool binds, libcrun_error_t
         return ret;
     }
 
+  if (! binds)
+    {
+      mode_t old_umask = umask (0);
+      bool fallback = false;
+
+      /* Fast path for the default devices: they are all direct children of
+         /dev, we run as root here so the nodes get the right ownership, and
+         with the umask cleared mknodat already applies the final mode.  */
+      for (i = 0; i < sizeof (default_devs) / sizeof (default_devs[0]); i++)
+        {
+          ret = mknodat (devfd, default_devs[i].name, default_devs[i].mode, default_devs[i].dev);
+          if (ret < 0 && errno != EEXIST)
+            {
+              if (errno == EPERM || errno == EACCES)
+                {
+                  /* mknod is not usable here, e.g. in a user namespace
+                     created outside this process: fall back to bind mounts
+                     for all the default devices.  */
+                  fallback = true;
+                  break;
+                }
+
+              umask (old_umask);
+              return crun_make_error (err, errno, "mknod `/dev/%s`", default_devs[i].name);
+            }
+        }
+      umask (old_umask);
+
+      if (fallback)
+        binds = true;
+      else
+        goto create_symlinks;
+    }
+
   for (it = needed_devs; it->path; it++)
     {
       /* make sure the parent directory exists only on the first iteration.  */
@@ -1791,6 +2345,8 @@ create_missing_devs (libcrun_container_t *container, bool binds, libcrun_error_t
         return ret;
     }
 
+create_symlinks:
+
   for (i = 0; symlinks[i].target; i++)
     {
     retry_symlink:
@@ -1838,6 +2394,208 @@ create_missing_devs (libcrun_container_t *container, bool binds, libcrun_error_t
   return 0;
 }
 
+#ifdef HAVE_NEW_MOUNT_API
+static int fsmount_with_options (const char *type, const char *data, const char *labeltype, const char *label);
+
+struct masked_readonly_path_s
+{
+  const char *rel_path;
+  int pathfd;
+  int mountfd;
+  bool readonly;
+};
+
+struct masked_readonly_plan_s
+{
+  struct masked_readonly_path_s *entries;
+  size_t len;
+};
+
+static void
+free_masked_readonly_plan (struct masked_readonly_plan_s *plan)
+{
+  size_t i;
+
+  for (i = 0; i < plan->len; i++)
+    {
+      if (plan->entries[i].pathfd >= 0)
+        TEMP_FAILURE_RETRY (close (plan->entries[i].pathfd));
+      if (plan->entries[i].mountfd >= 0)
+        TEMP_FAILURE_RETRY (close (plan->entries[i].mountfd));
+    }
+  free (plan->entries);
+}
+
+/* Batched implementation of the maskedPaths/readonlyPaths handling.  Resolve
+   every path in a single pass, prepare all the replacement trees while they
+   are still detached (masked directories clone a shared read-only tmpfs
+   template instead of creating one superblock each), set the readonly
+   attribute on the collected trees and only then attach them, so nothing is
+   visible in the container until the whole batch succeeded.  Return 1 when
+   the new mount API is not usable and the caller must fall back to the
+   per-path implementation.  */
+static int
+do_masked_and_readonly_paths_batched (libcrun_container_t *container, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  size_t rootfs_len = get_private_data (container)->rootfs_len;
+  const char *rootfs = get_private_data (container)->rootfs;
+  int rootfsfd = get_private_data (container)->rootfsfd;
+  __attribute__ ((cleanup (free_masked_readonly_plan))) struct masked_readonly_plan_s plan = {};
+  cleanup_close int tmpfs_template_fd = -1;
+  cleanup_free const char **rel_paths = NULL;
+  cleanup_free int *fds = NULL;
+  struct mount_attr_s attr = {
+    0,
+  };
+  size_t i, total;
+  int ret;
+
+  total = def->linux->masked_paths_len + def->linux->readonly_paths_len;
+  if (total == 0)
+    return 0;
+
+  plan.entries = xmalloc0 (sizeof (struct masked_readonly_path_s) * total);
+
+  /* Resolution pass: the batch resolver reuses a parent directory fd across
+     paths sharing a prefix, so clusters like the /proc masked paths cost one
+     walk plus one lookup each.  Missing or unreachable paths are skipped, as
+     in the per-path implementation.  */
+  rel_paths = xmalloc0 (sizeof (const char *) * total);
+  fds = xmalloc (sizeof (int) * total);
+  for (i = 0; i < total; i++)
+    {
+      bool readonly = i >= def->linux->masked_paths_len;
+      const char *rel_path = readonly ? def->linux->readonly_paths[i - def->linux->masked_paths_len]
+                                      : def->linux->masked_paths[i];
+
+      if (rel_path[0] == '/')
+        rel_path++;
+
+      rel_paths[i] = rel_path;
+    }
+
+  safe_openat_batch (rootfsfd, rootfs, rootfs_len, rel_paths, total, O_PATH | O_CLOEXEC, 0, fds);
+
+  for (i = 0; i < total; i++)
+    {
+      struct masked_readonly_path_s *entry = &plan.entries[plan.len];
+
+      if (fds[i] < 0)
+        {
+          if (-fds[i] != ENOENT && -fds[i] != EACCES)
+            {
+              size_t j;
+
+              for (j = i + 1; j < total; j++)
+                if (fds[j] >= 0)
+                  TEMP_FAILURE_RETRY (close (fds[j]));
+
+              return crun_make_error (err, -fds[i], "open `%s`", rel_paths[i]);
+            }
+
+          continue;
+        }
+
+      entry->rel_path = rel_paths[i];
+      entry->pathfd = fds[i];
+      entry->mountfd = -1;
+      entry->readonly = i >= def->linux->masked_paths_len;
+      plan.len++;
+    }
+
+  /* Preparation pass: build every replacement tree detached.  */
+  for (i = 0; i < plan.len; i++)
+    {
+      struct masked_readonly_path_s *entry = &plan.entries[i];
+      mode_t mode;
+
+      if (entry->readonly)
+        {
+          entry->mountfd = syscall_open_tree (entry->pathfd, "",
+                                              AT_EMPTY_PATH | AT_RECURSIVE | OPEN_TREE_CLOEXEC | OPEN_TREE_CLONE);
+          if (entry->mountfd < 0)
+            return 1;
+          continue;
+        }
+
+      ret = get_file_type_fd (entry->pathfd, &mode);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      if ((mode & S_IFMT) == S_IFDIR)
+        {
+          if (tmpfs_template_fd < 0)
+            {
+              const char *context_type = NULL;
+              const char *label = NULL;
+
+              if (def->linux && def->linux->mount_label)
+                {
+                  label = def->linux->mount_label;
+                  context_type = get_selinux_context_type (container);
+                }
+
+              tmpfs_template_fd = fsmount_with_options ("tmpfs", "size=0k", context_type, label);
+              if (tmpfs_template_fd < 0)
+                return 1;
+
+              attr.attr_set = MOUNT_ATTR_RDONLY;
+              ret = syscall_mount_setattr (tmpfs_template_fd, "", AT_EMPTY_PATH, &attr);
+              if (ret < 0)
+                return 1;
+            }
+
+          entry->mountfd = syscall_open_tree (tmpfs_template_fd, "",
+                                              AT_EMPTY_PATH | OPEN_TREE_CLOEXEC | OPEN_TREE_CLONE);
+          if (entry->mountfd < 0)
+            return 1;
+        }
+      else
+        {
+          entry->mountfd = get_bind_mount (-1, "/dev/null", false, true, err);
+          if (entry->mountfd < 0)
+            {
+              crun_error_release (err);
+              return 1;
+            }
+        }
+    }
+
+  /* Apply the readonly attribute on all the collected trees in one batch.
+     Unlike the bind+remount cycle, this only sets MOUNT_ATTR_RDONLY, so the
+     flags inherited from the source mount (the keep_flags handling in the
+     per-path implementation) are preserved automatically.  */
+  attr.attr_set = MOUNT_ATTR_RDONLY;
+  for (i = 0; i < plan.len; i++)
+    {
+      struct masked_readonly_path_s *entry = &plan.entries[i];
+
+      if (! entry->readonly || entry->mountfd < 0)
+        continue;
+
+      ret = syscall_mount_setattr (entry->mountfd, "", AT_EMPTY_PATH | AT_RECURSIVE, &attr);
+      if (ret < 0)
+        return 1;
+    }
+
+  /* Attach pass.  */
+  for (i = 0; i < plan.len; i++)
+    {
+      struct masked_readonly_path_s *entry = &plan.entries[i];
+
+      if (entry->mountfd < 0)
+        continue;
+
+      ret = fs_move_mount_to (entry->mountfd, entry->pathfd, NULL);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "move mount over `%s`", entry->rel_path);
+    }
+
+  return 0;
+}
+#endif
+
 static int
 do_masked_and_readonly_paths (libcrun_container_t *container, libcrun_error_t *err)
 {
@@ -1845,6 +2603,13 @@ do_masked_and_readonly_paths (libcrun_container_t *container, libcrun_error_t *e
   int ret;
   runtime_spec_schema_config_schema *def = container->container_def;
 
+#ifdef HAVE_NEW_MOUNT_API
+  ret = do_masked_and_readonly_paths_batched (container, err);
+  if (ret <= 0)
+    return ret;
+  /* The batched path could not run here, use the per-path fallback.  */
+#endif
+
   for (i = 0; i < def->linux->masked_paths_len; i++)
     {
       ret = do_masked_or_readonly_path (container, def->linux->masked_paths[i], false, false, err);
@@ -1919,18 +2684,36 @@ append_tmpfs_mode_if_missing (libcrun_container_t *container, runtime_spec_schem
   struct stat st;
   int ret;
 
-  if (*data != NULL && strstr (*data, "mode="))
-    return 0;
-
-  fd = safe_openat (rootfsfd, rootfs, rootfs_len, mount->destination, O_CLOEXEC | O_RDONLY, 0, err);
-  if (fd < 0)
+  if (*data != NULL)
     {
-      if (crun_error_get_errno (err) != ENOENT)
-        return fd;
+      /* Look for a `mode=` token; a substring search would also match e.g.
+         `rootmode=`.  */
+      const char *it = *data;
 
-      crun_error_release (err);
-      return 0;
+      for (;;)
+        {
+          if (get_mount_option_key (it) == MOUNT_OPTION_KEY_MODE)
+            return 0;
+
+          it = strchr (it, ',');
+          if (it == NULL)
+            break;
+          it++;
+        }
     }
+
+  {
+    struct crun_probe_error_s probe_err;
+
+    fd = safe_openat_probe (rootfsfd, rootfs, rootfs_len, mount->destination, O_CLOEXEC | O_RDONLY, 0, &probe_err);
+    if (fd < 0)
+      {
+        if (crun_probe_error_get_errno (&probe_err) != ENOENT)
+          return crun_error_from_probe (err, &probe_err, "open `%s`", mount->destination);
+
+        return 0;
+      }
+  }
   ret = fstat (fd, &st);
   if (ret < 0)
     return crun_make_error (err, errno, "fstat `%s`", mount->destination);
@@ -2007,46 +2790,280 @@ safe_create_symlink (int rootfsfd, const char *rootfs, size_t rootfs_len, const
   if (is_empty_string (destination))
     return crun_make_error (err, 0, "empty destination for symlink `%s`", target);
 
-  buffer = xstrdup (destination);
-  part = dirname (buffer);
+  buffer = xstrdup (destination);
+  part = dirname (buffer);
+
+  parent_dir_fd = crun_safe_create_and_open_ref_at (true, rootfsfd, rootfs, rootfs_len,
+                                                    part, 0755, err);
+  if (UNLIKELY (parent_dir_fd < 0))
+    return crun_make_error (err, errno, "symlink creation");
+
+  /* It is safe to reuse the buffer since it was created with xstrdup (destination).  */
+  strcpy (buffer, destination);
+  part = basename (buffer);
+
+  ret = symlinkat (target, parent_dir_fd, part);
+  if (UNLIKELY (ret < 0))
+    {
+      /* If it exists, check if it has the same content, if so just ignore the error.  */
+      if (errno == EEXIST)
+        {
+          cleanup_free char *link = NULL;
+          ssize_t len;
+
+          len = safe_readlinkat (parent_dir_fd, part, &link, 0, err);
+          if (UNLIKELY (len < 0))
+            return len;
+
+          if ((((size_t) len) == strlen (target)) && strncmp (link, target, len) == 0)
+            return 0;
+
+          return crun_make_error (err, 0, "symlink `%s` already exists with a different content", destination);
+        }
+      return crun_make_error (err, errno, "symlink creation `%s`", target);
+    }
+
+  return 0;
+}
+
+static const char *
+get_force_cgroup_v1_annotation (libcrun_container_t *container)
+{
+  return find_annotation (container, "run.oci.systemd.force_cgroup_v1");
+}
+
+/* One entry of the precomputed mount plan: the flags and data string for a
+   mount are resolved once, before the execution loop.  */
+struct mount_plan_entry_s
+{
+  char *data;
+  unsigned long flags;
+  unsigned long extra_flags;
+  uint64_t rec_clear;
+  uint64_t rec_set;
+  bool skip;
+};
+
+struct mount_plan_s
+{
+  struct mount_plan_entry_s *entries;
+  size_t len;
+};
+
+static void
+free_mount_plan (struct mount_plan_s *plan)
+{
+  size_t i;
+
+  if (plan->entries == NULL)
+    return;
+  for (i = 0; i < plan->len; i++)
+    free (plan->entries[i].data);
+  free (plan->entries);
+}
+
+#ifdef HAVE_NEW_MOUNT_API
+/* Superblock creation for these file systems has no ordering dependency on
+   other mounts, only the final move_mount has.  */
+static bool
+can_prepare_mount_in_worker (libcrun_container_t *container, runtime_spec_schema_defs_mount *mnt,
+                             struct mount_plan_entry_s *entry)
+{
+  const char *systemd_cgroup_v1 = get_force_cgroup_v1_annotation (container);
+
+  if (entry->skip || (entry->flags & MS_BIND) || (entry->extra_flags & (OPTION_TMPCOPYUP | OPTION_COPY_SYMLINK)))
+    return false;
+  if (mnt->type == NULL)
+    return false;
+  if (systemd_cgroup_v1 && strcmp (mnt->destination, systemd_cgroup_v1) == 0)
+    return false;
+
+  return strcmp (mnt->type, "tmpfs") == 0 || strcmp (mnt->type, "proc") == 0
+         || strcmp (mnt->type, "sysfs") == 0 || strcmp (mnt->type, "mqueue") == 0;
+}
+
+/* Like fsopen_mount, but configure the mount options before creating the
+   superblock.  */
+static int
+fsmount_with_options (const char *type, const char *data, const char *labeltype, const char *label)
+{
+  cleanup_close int fsfd = -1;
+  int ret;
+
+  fsfd = syscall_fsopen (type, FSOPEN_CLOEXEC);
+  if (UNLIKELY (fsfd < 0))
+    return fsfd;
+
+  if (data)
+    {
+      cleanup_free char *options = xstrdup (data);
+      char *saveptr = NULL;
+      char *opt;
+
+      for (opt = strtok_r (options, ",", &saveptr); opt; opt = strtok_r (NULL, ",", &saveptr))
+        {
+          char *value = strchr (opt, '=');
+
+          if (value)
+            {
+              *value++ = '\0';
+              ret = syscall_fsconfig (fsfd, FSCONFIG_SET_STRING, opt, value, 0);
+            }
+          else
+            ret = syscall_fsconfig (fsfd, FSCONFIG_SET_FLAG, opt, NULL, 0);
+          if (UNLIKELY (ret < 0))
+            return ret;
+        }
+    }
+
+  if (labeltype)
+    {
+      ret = syscall_fsconfig (fsfd, FSCONFIG_SET_STRING, labeltype, label, 0);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  ret = syscall_fsconfig (fsfd, FSCONFIG_CMD_CREATE, NULL, NULL, 0);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  return syscall_fsmount (fsfd, FSMOUNT_CLOEXEC, 0);
+}
+
+/* Prepare the superblocks for the independent new-mount-API file systems on a
+   small pool of forked workers, overlapping the kernel-side setup.  The
+   resulting fds are received into MOUNT_FDS and attached in destination order
+   by the regular execution loop.  Everything here is best effort: a mount
+   that could not be prepared simply falls back to the serial mount path.  */
+static void
+prepare_new_mounts_parallel (libcrun_container_t *container, struct libcrun_fd_map *mount_fds,
+                             struct mount_plan_s *plan)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  const char *context_type = NULL;
+  const char *label = NULL;
+  cleanup_free size_t *eligible = NULL;
+  cleanup_free pid_t *workers = NULL;
+  cleanup_free int *socks = NULL;
+  size_t i, w, n_eligible = 0;
+  long n_workers;
+
+  eligible = xmalloc (sizeof (size_t) * def->mounts_len);
+  for (i = 0; i < def->mounts_len; i++)
+    if (mount_fds->fds[i] < 0 && can_prepare_mount_in_worker (container, def->mounts[i], &plan->entries[i]))
+      eligible[n_eligible++] = i;
+
+  if (n_eligible < 2)
+    return;
+
+  if (def->linux && def->linux->mount_label)
+    {
+      label = def->linux->mount_label;
+      context_type = get_selinux_context_type (container);
+    }
+
+  n_workers = sysconf (_SC_NPROCESSORS_ONLN);
+  if (n_workers < 1)
+    n_workers = 1;
+  if (n_workers > 4)
+    n_workers = 4;
+  if ((size_t) n_workers > n_eligible)
+    n_workers = n_eligible;
+
+  workers = xmalloc (sizeof (pid_t) * n_workers);
+  socks = xmalloc (sizeof (int) * n_workers);
+
+  for (w = 0; w < (size_t) n_workers; w++)
+    {
+      int sv[2];
+      pid_t pid;
+
+      if (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+        break;
+
+      pid = fork ();
+      if (pid < 0)
+        {
+          TEMP_FAILURE_RETRY (close (sv[0]));
+          TEMP_FAILURE_RETRY (close (sv[1]));
+          break;
+        }
 
-  parent_dir_fd = crun_safe_create_and_open_ref_at (true, rootfsfd, rootfs, rootfs_len,
-                                                    part, 0755, err);
-  if (UNLIKELY (parent_dir_fd < 0))
-    return crun_make_error (err, errno, "symlink creation");
+      if (pid == 0)
+        {
+          TEMP_FAILURE_RETRY (close (sv[0]));
+          for (i = w; i < n_eligible; i += n_workers)
+            {
+              size_t idx = eligible[i];
+              libcrun_error_t tmp_err = NULL;
+              const char *type = def->mounts[idx]->type;
+              bool use_label = label && strcmp (type, "tmpfs") == 0;
+              int fd;
+
+              fd = fsmount_with_options (type, plan->entries[idx].data,
+                                         use_label ? context_type : NULL, label);
+              if (fd < 0)
+                continue;
+
+              if (send_fd_to_socket_with_payload (sv[1], fd, (char *) &idx, sizeof (idx), &tmp_err) < 0)
+                crun_error_release (&tmp_err);
+              TEMP_FAILURE_RETRY (close (fd));
+            }
+          _exit (EXIT_SUCCESS);
+        }
 
-  /* It is safe to reuse the buffer since it was created with xstrdup (destination).  */
-  strcpy (buffer, destination);
-  part = basename (buffer);
+      TEMP_FAILURE_RETRY (close (sv[1]));
+      workers[w] = pid;
+      socks[w] = sv[0];
+    }
 
-  ret = symlinkat (target, parent_dir_fd, part);
-  if (UNLIKELY (ret < 0))
+  for (i = 0; i < w; i++)
     {
-      /* If it exists, check if it has the same content, if so just ignore the error.  */
-      if (errno == EEXIST)
+      for (;;)
         {
-          cleanup_free char *link = NULL;
-          ssize_t len;
-
-          len = safe_readlinkat (parent_dir_fd, part, &link, 0, err);
-          if (UNLIKELY (len < 0))
-            return len;
+          libcrun_error_t tmp_err = NULL;
+          size_t idx = 0;
+          int fd;
 
-          if ((((size_t) len) == strlen (target)) && strncmp (link, target, len) == 0)
-            return 0;
+          fd = receive_fd_from_socket_with_payload (socks[i], (char *) &idx, sizeof (idx), &tmp_err);
+          if (fd < 0)
+            {
+              crun_error_release (&tmp_err);
+              break;
+            }
 
-          return crun_make_error (err, 0, "symlink `%s` already exists with a different content", destination);
+          if (idx < def->mounts_len && mount_fds->fds[idx] < 0)
+            mount_fds->fds[idx] = fd;
+          else
+            TEMP_FAILURE_RETRY (close (fd));
         }
-      return crun_make_error (err, errno, "symlink creation `%s`", target);
-    }
 
-  return 0;
+      TEMP_FAILURE_RETRY (close (socks[i]));
+      waitpid_ignore_stopped (workers[i], NULL, 0);
+    }
 }
+#endif
 
-static const char *
-get_force_cgroup_v1_annotation (libcrun_container_t *container)
+/* Mark as skipped every mount that is completely identical (destination,
+   type, source and options) to a later one: the later mount fully covers it.
+   Configurations assembled from many fragments end up with such duplicates.  */
+static bool
+is_duplicate_mount (runtime_spec_schema_defs_mount *a, runtime_spec_schema_defs_mount *b)
 {
-  return find_annotation (container, "run.oci.systemd.force_cgroup_v1");
+  size_t j;
+
+  if (strcmp (a->destination, b->destination) != 0)
+    return false;
+  if ((a->type == NULL) != (b->type == NULL) || (a->type && strcmp (a->type, b->type) != 0))
+    return false;
+  if ((a->source == NULL) != (b->source == NULL) || (a->source && strcmp (a->source, b->source) != 0))
+    return false;
+  if (a->options_len != b->options_len)
+    return false;
+  for (j = 0; j < a->options_len; j++)
+    if (strcmp (a->options[j], b->options[j]) != 0)
+      return false;
+  return true;
 }
 
 static int
@@ -2058,37 +3075,88 @@ do_mounts (libcrun_container_t *container, int rootfsfd, const char *rootfs, con
   size_t rootfs_len = get_private_data (container)->rootfs_len;
   const char *systemd_cgroup_v1 = get_force_cgroup_v1_annotation (container);
   cleanup_close_map struct libcrun_fd_map *mount_fds = NULL;
+  __attribute__ ((cleanup (free_mount_plan))) struct mount_plan_s plan = {};
 
   mount_fds = get_private_data (container)->mount_fds;
   get_private_data (container)->mount_fds = NULL;
 
+  if (def->mounts_len == 0)
+    return 0;
+
+  /* Planning pass: resolve flags and data once for every mount, and drop
+     exact duplicates before touching the filesystem.  */
+  plan.entries = xmalloc0 (sizeof (struct mount_plan_entry_s) * def->mounts_len);
+  plan.len = def->mounts_len;
+  for (i = 0; i < def->mounts_len; i++)
+    {
+      struct mount_plan_entry_s *entry = &plan.entries[i];
+      size_t j;
+
+      if (def->mounts[i]->options == NULL)
+        entry->flags = get_default_flags (container, def->mounts[i]->destination, &entry->data);
+      else
+        {
+          for (j = 0; j < def->mounts[i]->options_len; j++)
+            entry->flags |= get_mount_flags_or_option (def->mounts[i]->options[j], entry->flags, &entry->extra_flags,
+                                                       &entry->data, &entry->rec_clear, &entry->rec_set);
+        }
+
+      for (j = i + 1; j < def->mounts_len && ! entry->skip; j++)
+        entry->skip = is_duplicate_mount (def->mounts[i], def->mounts[j]);
+    }
+
+#ifdef HAVE_NEW_MOUNT_API
+  {
+    const char *parallel = find_annotation (container, "run.oci.mounts.parallel");
+
+    if (parallel && strcmp (parallel, "true") == 0)
+      {
+        if (mount_fds == NULL)
+          mount_fds = make_libcrun_fd_map (def->mounts_len);
+
+        /* The default tmpfs mode must be part of the superblock options when
+           the superblock is created ahead of time.  */
+        for (i = 0; i < def->mounts_len; i++)
+          if (def->mounts[i]->type && strcmp (def->mounts[i]->type, "tmpfs") == 0)
+            {
+              ret = append_tmpfs_mode_if_missing (container, def->mounts[i], &plan.entries[i].data, err);
+              if (UNLIKELY (ret < 0))
+                return ret;
+            }
+
+        prepare_new_mounts_parallel (container, mount_fds, &plan);
+      }
+  }
+#endif
+
   for (i = 0; i < def->mounts_len; i++)
     {
       const char *target = consume_slashes (def->mounts[i]->destination);
       cleanup_free char *data = NULL;
       char *type;
       char *source;
-      unsigned long flags = 0;
-      unsigned long extra_flags = 0;
+      unsigned long flags;
+      unsigned long extra_flags;
       mode_t src_mode = S_IFDIR;
       cleanup_close int copy_from_fd = -1;
       cleanup_close int targetfd = -1;
       bool mounted = false;
       bool is_sysfs_or_proc;
-      uint64_t rec_clear = 0;
-      uint64_t rec_set = 0;
+      uint64_t rec_clear;
+      uint64_t rec_set;
 
-      type = def->mounts[i]->type;
+      if (plan.entries[i].skip)
+        continue;
 
-      if (def->mounts[i]->options == NULL)
-        flags = get_default_flags (container, def->mounts[i]->destination, &data);
-      else
-        {
-          size_t j;
+      type = def->mounts[i]->type;
 
-          for (j = 0; j < def->mounts[i]->options_len; j++)
-            flags |= get_mount_flags_or_option (def->mounts[i]->options[j], flags, &extra_flags, &data, &rec_clear, &rec_set);
-        }
+      /* Take ownership of the precomputed data string.  */
+      data = plan.entries[i].data;
+      plan.entries[i].data = NULL;
+      flags = plan.entries[i].flags;
+      extra_flags = plan.entries[i].extra_flags;
+      rec_clear = plan.entries[i].rec_clear;
+      rec_set = plan.entries[i].rec_set;
 
       if (type == NULL && (flags & MS_BIND) == 0)
         return crun_make_error (err, 0, "invalid mount type for `%s`", def->mounts[i]->destination);
@@ -2609,6 +3677,14 @@ libcrun_set_mounts (struct container_entrypoint_s *entrypoint_args, libcrun_cont
 
   if (rootfs == NULL)
     rootfsfd = AT_FDCWD;
+  else if (container->context && container->context->rootfs_fd > 0)
+    {
+      /* The caller already holds a descriptor for the rootfs: duplicate it
+         instead of walking the path again, which can race with mount churn.  */
+      rootfsfd = rootfsfd_cleanup = fcntl (container->context->rootfs_fd, F_DUPFD_CLOEXEC, 0);
+      if (UNLIKELY (rootfsfd < 0))
+        return crun_make_error (err, errno, "duplicate the rootfs fd `%d`", container->context->rootfs_fd);
+    }
   else
     {
       rootfsfd = rootfsfd_cleanup = open (rootfs, O_PATH | O_CLOEXEC);
@@ -2986,6 +4062,15 @@ is_single_mapping (runtime_spec_schema_defs_id_mapping **mappings, size_t len,
   return 1;
 }
 
+/* Return true when an unprivileged process can write MAPPINGS to
+   /proc/PID/uid_map or gid_map itself: the kernel only accepts a single
+   range of size 1 that maps the caller's own host id.  */
+static bool
+can_write_mappings_in_process (runtime_spec_schema_defs_id_mapping **mappings, size_t len, uint32_t host_id)
+{
+  return len == 1 && mappings[0]->size == 1 && mappings[0]->host_id == host_id;
+}
+
 int
 libcrun_set_usernamespace (libcrun_container_t *container, pid_t pid, libcrun_error_t *err)
 {
@@ -2994,12 +4079,29 @@ libcrun_set_usernamespace (libcrun_container_t *container, pid_t pid, libcrun_er
   cleanup_free char *uid_map = NULL;
   cleanup_free char *gid_map = NULL;
   size_t uid_map_len = 0, gid_map_len = 0;
+  bool uid_map_in_process = false;
+  bool gid_map_in_process = false;
   int ret = 0;
   runtime_spec_schema_config_schema *def = container->container_def;
 
   if ((get_private_data (container)->unshare_flags & CLONE_NEWUSER) == 0)
     return 0;
 
+  if (container->host_uid)
+    {
+      /* Fast path: mappings the kernel accepts directly from us do not need
+         the newuidmap/newgidmap fork+exec round trips.  Writing gid_map in
+         process requires denying setgroups first, so only do it when no
+         additional groups are requested.  */
+      uid_map_in_process = def->linux->uid_mappings_len
+                           && can_write_mappings_in_process (def->linux->uid_mappings, def->linux->uid_mappings_len,
+                                                             container->host_uid);
+      gid_map_in_process = def->linux->gid_mappings_len
+                           && can_write_mappings_in_process (def->linux->gid_mappings, def->linux->gid_mappings_len,
+                                                             container->host_gid)
+                           && ! (def->process && def->process->user && def->process->user->additional_gids_len);
+    }
+
   if (def->linux->uid_mappings_len)
     uid_map = format_mount_mappings (def->linux->uid_mappings, def->linux->uid_mappings_len, &uid_map_len);
   else
@@ -3018,9 +4120,18 @@ libcrun_set_usernamespace (libcrun_container_t *container, pid_t pid, libcrun_er
         gid_map = format_mount_mapping (0, container->host_gid, container->host_gid + 1, &gid_map_len);
     }
 
-  if (container->host_uid)
+  if (gid_map_in_process)
+    {
+      ret = deny_setgroups (container, pid, err);
+      if (UNLIKELY (ret < 0))
+        {
+          crun_error_release (err);
+          gid_map_in_process = false;
+        }
+    }
+  if (container->host_uid && ! gid_map_in_process)
     ret = newgidmap (pid, gid_map, err);
-  if (container->host_uid == 0 || ret < 0)
+  if (container->host_uid == 0 || gid_map_in_process || ret < 0)
     {
       if (ret < 0)
         {
@@ -3049,9 +4160,9 @@ libcrun_set_usernamespace (libcrun_container_t *container, pid_t pid, libcrun_er
   if (UNLIKELY (ret < 0))
     return ret;
 
-  if (container->host_uid)
+  if (container->host_uid && ! uid_map_in_process)
     ret = newuidmap (pid, uid_map, err);
-  if (container->host_uid == 0 || ret < 0)
+  if (container->host_uid == 0 || uid_map_in_process || ret < 0)
     {
       if (ret < 0)
         {
@@ -3236,20 +4347,48 @@ libcrun_set_apparmor_profile (runtime_spec_schema_config_schema_process *proc, b
   return 0;
 }
 
+static void
+read_all_caps (struct all_caps_s *caps, runtime_spec_schema_config_schema_process_capabilities *capabilities)
+{
+  read_caps (caps->effective, capabilities->effective, capabilities->effective_len);
+  read_caps (caps->inheritable, capabilities->inheritable, capabilities->inheritable_len);
+  read_caps (caps->ambient, capabilities->ambient, capabilities->ambient_len);
+  read_caps (caps->bounding, capabilities->bounding, capabilities->bounding_len);
+  read_caps (caps->permitted, capabilities->permitted, capabilities->permitted_len);
+}
+
+void
+libcrun_precompute_caps (libcrun_container_t *container)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+
+  if (container->precomputed_caps != NULL)
+    return;
+
+  if (def == NULL || def->process == NULL || def->process->capabilities == NULL)
+    return;
+
+  container->precomputed_caps = libcrun_arena_alloc (&container->arena, sizeof (struct all_caps_s));
+  memset (container->precomputed_caps, 0, sizeof (struct all_caps_s));
+  read_all_caps (container->precomputed_caps, def->process->capabilities);
+}
+
 int
-libcrun_set_caps (runtime_spec_schema_config_schema_process_capabilities *capabilities, uid_t uid, gid_t gid,
-                  int no_new_privileges, libcrun_error_t *err)
+libcrun_set_caps (libcrun_container_t *container, runtime_spec_schema_config_schema_process_capabilities *capabilities,
+                  uid_t uid, gid_t gid, int no_new_privileges, libcrun_error_t *err)
 {
   struct all_caps_s caps = {};
 
+  /* Use the masks precomputed at spec load time when they describe the same
+     capabilities object; an exec can carry its own capabilities, which still
+     take the translation below.  */
+  if (container != NULL && container->precomputed_caps != NULL && container->container_def->process != NULL
+      && capabilities == container->container_def->process->capabilities)
+    return set_required_caps (container->precomputed_caps, uid, gid, no_new_privileges, err);
+
   if (capabilities)
-    {
-      read_caps (caps.effective, capabilities->effective, capabilities->effective_len);
-      read_caps (caps.inheritable, capabilities->inheritable, capabilities->inheritable_len);
-      read_caps (caps.ambient, capabilities->ambient, capabilities->ambient_len);
-      read_caps (caps.bounding, capabilities->bounding, capabilities->bounding_len);
-      read_caps (caps.permitted, capabilities->permitted, capabilities->permitted_len);
-    }
+    read_all_caps (&caps, capabilities);
+
   return set_required_caps (&caps, uid, gid, no_new_privileges, err);
 }
 
@@ -3714,6 +4853,28 @@ send_success_to_sync_socket (int sync_socket, libcrun_error_t *err)
   return 0;
 }
 
+/* Success report and PID coalesced into one packet: the intermediate
+   processes report the PID of the process they forked, and sending it with
+   the status costs the peer a single wakeup instead of two.  */
+struct sync_status_pid_s
+{
+  int success;
+  pid_t pid;
+};
+
+static inline int
+send_success_and_pid_to_sync_socket (int sync_socket, pid_t pid, libcrun_error_t *err)
+{
+  struct sync_status_pid_s msg = { 0, pid };
+  int ret;
+
+  ret = TEMP_FAILURE_RETRY (write (sync_socket, &msg, sizeof (msg)));
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "write to sync socket");
+
+  return 0;
+}
+
 static __attribute__ ((noreturn)) void
 send_error_to_sync_socket_and_die (int sync_socket_fd, bool has_terminal, libcrun_error_t *err)
 {
@@ -3751,6 +4912,33 @@ expect_success_from_sync_socket (int sync_fd, libcrun_error_t *err)
   return crun_make_error (err, 0, "read from sync socket");
 }
 
+static int
+expect_success_and_pid_from_sync_socket (int sync_fd, pid_t *pid, libcrun_error_t *err)
+{
+  cleanup_free char *err_str = NULL;
+  struct sync_status_pid_s msg = { 1, 0 };
+  int res;
+  int ret;
+
+  ret = TEMP_FAILURE_RETRY (read (sync_fd, &msg, sizeof (msg)));
+  if (UNLIKELY (ret < (int) sizeof (msg.success)))
+    return crun_make_error (err, errno, "read status from sync socket");
+
+  if (msg.success == 0)
+    {
+      if (UNLIKELY (ret != (int) sizeof (msg)))
+        return crun_make_error (err, 0, "read pid from sync socket");
+      *pid = msg.pid;
+      return 0;
+    }
+
+  res = msg.success;
+  if (read_error_from_sync_socket (sync_fd, &res, &err_str))
+    return crun_make_error (err, res, "%s", err_str);
+
+  return crun_make_error (err, 0, "read from sync socket");
+}
+
 static int
 join_namespaces (runtime_spec_schema_config_schema *def, int *namespaces_to_join, int n_namespaces_to_join,
                  int *namespaces_to_join_index, bool ignore_join_errors, libcrun_error_t *err)
@@ -3988,13 +5176,13 @@ get_idmapped_option (runtime_spec_schema_defs_mount *mnt, bool *recursive)
 
   for (i = 0; i < mnt->options_len; i++)
     {
-      if (has_prefix (mnt->options[i], "idmap"))
+      switch (get_mount_option_key (mnt->options[i]))
         {
+        case MOUNT_OPTION_KEY_IDMAP:
           *recursive = false;
           return mnt->options[i];
-        }
-      if (has_prefix (mnt->options[i], "ridmap"))
-        {
+
+        case MOUNT_OPTION_KEY_RIDMAP:
           *recursive = true;
           return mnt->options[i];
         }
@@ -4003,15 +5191,15 @@ get_idmapped_option (runtime_spec_schema_defs_mount *mnt, bool *recursive)
 }
 
 static int
-maybe_get_idmapped_mount (runtime_spec_schema_config_schema *def, runtime_spec_schema_defs_mount *mnt, pid_t pid, int *out_fd, libcrun_error_t *err)
+maybe_get_idmapped_mount (libcrun_container_t *container, runtime_spec_schema_config_schema *def, runtime_spec_schema_defs_mount *mnt, pid_t pid, int *out_fd, libcrun_error_t *err)
 {
   cleanup_close int newfs_fd = -1;
-  cleanup_pid pid_t created_pid = -1;
   struct mount_attr_s attr = {
     0,
   };
   bool recursive_bind_mount = false;
   cleanup_close int fd = -1;
+  int userns_fd = -1;
   const char *idmap_option;
   bool recursive = false;
   const char *options;
@@ -4044,16 +5232,18 @@ maybe_get_idmapped_mount (runtime_spec_schema_config_schema *def, runtime_spec_s
         }
     }
 
-  ret = maybe_create_userns_for_idmapped_mount (def, mnt, options, &created_pid, err);
+  ret = maybe_create_userns_for_idmapped_mount (container, def, mnt, options, &userns_fd, err);
   if (UNLIKELY (ret < 0))
     return ret;
-  if (created_pid > 0)
-    pid = created_pid;
 
-  sprintf (proc_path, "/proc/%d/ns/user", pid);
-  fd = open (proc_path, O_RDONLY | O_CLOEXEC);
-  if (UNLIKELY (fd < 0))
-    return crun_make_error (err, errno, "open `%s`", proc_path);
+  if (userns_fd < 0)
+    {
+      sprintf (proc_path, "/proc/%d/ns/user", pid);
+      fd = open (proc_path, O_RDONLY | O_CLOEXEC);
+      if (UNLIKELY (fd < 0))
+        return crun_make_error (err, errno, "open `%s`", proc_path);
+      userns_fd = fd;
+    }
 
   if (is_bind_mount (mnt, &recursive_bind_mount))
     {
@@ -4079,7 +5269,7 @@ maybe_get_idmapped_mount (runtime_spec_schema_config_schema *def, runtime_spec_s
     }
 
   attr.attr_set = MOUNT_ATTR_IDMAP;
-  attr.userns_fd = fd;
+  attr.userns_fd = userns_fd;
 
   ret = syscall_mount_setattr (newfs_fd, "", AT_EMPTY_PATH | (recursive ? AT_RECURSIVE : 0), &attr);
   if (UNLIKELY (ret < 0))
@@ -4206,7 +5396,7 @@ prepare_and_send_mount_mounts (libcrun_container_t *container, pid_t pid, int sy
 
       mount_fds->fds[i] = -1;
 
-      ret = maybe_get_idmapped_mount (def, def->mounts[i], pid, &(mount_fds->fds[i]), err);
+      ret = maybe_get_idmapped_mount (container, def, def->mounts[i], pid, &(mount_fds->fds[i]), err);
       if (UNLIKELY (ret < 0))
         return ret;
 
@@ -4472,11 +5662,7 @@ init_container (libcrun_container_t *container, int sync_socket_container, struc
       if (new_pid)
         {
           /* Report the new PID to the parent and exit immediately.  */
-          ret = send_success_to_sync_socket (sync_socket_container, err);
-          if (UNLIKELY (ret < 0))
-            kill (new_pid, SIGKILL);
-
-          ret = TEMP_FAILURE_RETRY (write (sync_socket_container, &new_pid, sizeof (new_pid)));
+          ret = send_success_and_pid_to_sync_socket (sync_socket_container, new_pid, err);
           if (UNLIKELY (ret < 0))
             kill (new_pid, SIGKILL);
 
@@ -4615,14 +5801,10 @@ init_container (libcrun_container_t *container, int sync_socket_container, struc
       /* Report back the new PID.  */
       if (pid_container)
         {
-          ret = send_success_to_sync_socket (sync_socket_container, err);
+          ret = send_success_and_pid_to_sync_socket (sync_socket_container, pid_container, err);
           if (UNLIKELY (ret < 0))
             return ret;
 
-          ret = TEMP_FAILURE_RETRY (write (sync_socket_container, &pid_container, sizeof (pid_container)));
-          if (UNLIKELY (ret < 0))
-            return crun_make_error (err, errno, "write to sync socket");
-
           _exit (EXIT_SUCCESS);
         }
 
@@ -4807,9 +5989,13 @@ libcrun_run_linux_container (libcrun_container_t *container, container_entrypoin
 
       pid = syscall_clone3 (&clone3_args);
       if (pid >= 0)
-        cgroup_dirfd->joined = true;
-
-      close_and_reset (cgroup_dirfd->dirfd);
+        {
+          /* Keep the dirfd open: the caller reuses it to write the cgroup
+             resources without resolving the cgroup path again.  */
+          cgroup_dirfd->joined = true;
+        }
+      else
+        close_and_reset (cgroup_dirfd->dirfd);
     }
   /* fallback to clone() for any error.  */
   if (pid < 0)
@@ -4839,14 +6025,10 @@ libcrun_run_linux_container (libcrun_container_t *container, container_entrypoin
         {
           pid_t new_pid = 0;
 
-          ret = expect_success_from_sync_socket (sync_socket_host, err);
+          ret = expect_success_and_pid_from_sync_socket (sync_socket_host, &new_pid, err);
           if (UNLIKELY (ret < 0))
             return ret;
 
-          ret = TEMP_FAILURE_RETRY (read (sync_socket_host, &new_pid, sizeof (new_pid)));
-          if (UNLIKELY (ret != sizeof (new_pid)))
-            return crun_make_error (err, errno, "read pid from sync socket");
-
           /* Cleanup the first process.  */
           ret = waitpid_ignore_stopped (pid, NULL, 0);
 
@@ -4879,14 +6061,10 @@ libcrun_run_linux_container (libcrun_container_t *container, container_entrypoin
         {
           pid_t grandchild = 0;
 
-          ret = expect_success_from_sync_socket (sync_socket_host, err);
+          ret = expect_success_and_pid_from_sync_socket (sync_socket_host, &grandchild, err);
           if (UNLIKELY (ret < 0))
             return ret;
 
-          ret = TEMP_FAILURE_RETRY (read (sync_socket_host, &grandchild, sizeof (grandchild)));
-          if (UNLIKELY (ret < 0))
-            return crun_make_error (err, errno, "read pid from sync socket");
-
           ret = send_success_to_sync_socket (sync_socket_host, err);
           if (UNLIKELY (ret < 0))
             return ret;
@@ -5012,13 +6190,24 @@ join_process_parent_helper (libcrun_context_t *context,
       ret = libcrun_set_scheduler (pid, process, err);
       if (UNLIKELY (ret < 0))
         return ret;
+
+      ret = libcrun_join_core_sched_cookie (pid, status->pid, container, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
     }
 
   ret = libcrun_apply_intelrdt (context->id, container, pid, LIBCRUN_INTELRDT_MOVE, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = libcrun_set_io_priority (pid, process, err);
+  /* An exec process without its own ioPriority inherits the one from the
+     container configuration, instead of silently running at the default
+     priority.  */
+  if ((process == NULL || process->io_priority == NULL) && container->container_def->process != NULL
+      && container->container_def->process->io_priority != NULL)
+    ret = libcrun_set_io_priority (pid, container->container_def->process, err);
+  else
+    ret = libcrun_set_io_priority (pid, process, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
@@ -5194,6 +6383,40 @@ exit:
   return ret;
 }
 
+pid_t
+libcrun_clone_detached (int *out_pidfd, libcrun_error_t *err)
+{
+  struct _clone3_args args;
+  int pidfd = -1;
+  pid_t pid;
+
+  *out_pidfd = -1;
+
+  memset (&args, 0, sizeof (args));
+  args.exit_signal = SIGCHLD;
+  args.flags = CLONE_PIDFD;
+  args.pidfd = (uint64_t) (uintptr_t) &pidfd;
+
+  pid = syscall_clone3 (&args);
+  if (pid < 0)
+    {
+      /* No clone3, fall back to a plain fork without the pidfd.  */
+      pid = fork ();
+      if (UNLIKELY (pid < 0))
+        return crun_make_error (err, errno, "fork");
+    }
+
+  if (pid == 0)
+    {
+      if (UNLIKELY (setsid () < 0))
+        libcrun_fail_with_error (errno, "setsid");
+      return 0;
+    }
+
+  *out_pidfd = pidfd;
+  return pid;
+}
+
 int
 libcrun_join_process (libcrun_context_t *context,
                       libcrun_container_t *container,
@@ -5260,6 +6483,12 @@ libcrun_join_process (libcrun_context_t *context,
       ret = libcrun_set_scheduler (pid, process, err);
       if (UNLIKELY (ret < 0))
         return ret;
+
+      /* The cookie is applied in the same step, before the process is
+         unblocked, so everything it execs inherits it for free.  */
+      ret = libcrun_join_core_sched_cookie (pid, pid_to_join, container, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
     }
 
   /* On errors, fall back to fork().  */
@@ -5380,13 +6609,14 @@ exit:
 }
 
 int
-libcrun_linux_container_update (libcrun_container_status_t *status, runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err)
+libcrun_linux_container_update (libcrun_container_status_t *status, const char *plan_file,
+                                runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err)
 {
   cleanup_cgroup_status struct libcrun_cgroup_status *cgroup_status = NULL;
 
   cgroup_status = libcrun_cgroup_make_status (status);
 
-  return libcrun_update_cgroup_resources (cgroup_status, resources, err);
+  return libcrun_update_cgroup_resources_with_plan (cgroup_status, resources, plan_file, err);
 }
 
 static int
@@ -5590,24 +6820,16 @@ int
 libcrun_kill_linux (libcrun_container_status_t *status, int signal, libcrun_error_t *err)
 {
   int ret;
-  cleanup_close int pidfd = -1;
-
-  pidfd = syscall_pidfd_open (status->pid, 0);
-  if (UNLIKELY (pidfd < 0))
-    {
-      /* If pidfd_open is not supported, fallback to kill.  */
-      if (errno == ENOSYS)
-        return libcrun_kill_linux_no_pidfd (status, true, signal, err);
-
-      return crun_make_error (err, errno, "open pidfd");
-    }
+  int pidfd;
 
-  ret = libcrun_check_pid_valid (status, err);
-  if (UNLIKELY (ret < 0))
-    return ret;
+  /* The pidfd cached on the status is already validated against the
+     recorded start time, so the signal is a single race-free syscall.  */
+  pidfd = libcrun_status_get_pidfd (status);
+  if (pidfd < 0)
+    return libcrun_kill_linux_no_pidfd (status, true, signal, err);
 
   /* The pid is not valid anymore, return an error.  */
-  if (ret == 0)
+  if (pidfd == 0)
     {
       errno = ESRCH;
       return crun_make_error (err, errno, "kill container");
@@ -5644,10 +6866,42 @@ libcrun_get_intelrdt_name (const char *ctr_name, libcrun_container_t *container,
   return def->linux->intel_rdt->clos_id;
 }
 
+/* Return 1 and fill *OUT when the container asked to share its resctrl
+   group with other containers using the same schemata.  */
+int
+libcrun_get_intelrdt_shared_name (libcrun_container_t *container, char **out, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  const char *annotation;
+  int ret;
+
+  if (def == NULL || def->linux == NULL || def->linux->intel_rdt == NULL)
+    return 0;
+
+  /* An explicit closID takes precedence.  */
+  if (def->linux->intel_rdt->clos_id != NULL)
+    return 0;
+
+  if (def->linux->intel_rdt->l3cache_schema == NULL && def->linux->intel_rdt->mem_bw_schema == NULL)
+    return 0;
+
+  annotation = find_annotation (container, "run.oci.intel-rdt.share");
+  if (annotation == NULL || strcmp (annotation, "true") != 0)
+    return 0;
+
+  ret = resctl_shared_group_name (out, def->linux->intel_rdt->l3cache_schema,
+                                  def->linux->intel_rdt->mem_bw_schema, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  return 1;
+}
+
 int
 libcrun_apply_intelrdt (const char *ctr_name, libcrun_container_t *container, pid_t pid, int actions, libcrun_error_t *err)
 {
   runtime_spec_schema_config_schema *def = NULL;
+  cleanup_free char *shared_name = NULL;
   bool explicit = false;
   bool created = false;
   const char *name;
@@ -5659,20 +6913,40 @@ libcrun_apply_intelrdt (const char *ctr_name, libcrun_container_t *container, pi
   if (def == NULL || def->linux == NULL || def->linux->intel_rdt == NULL)
     return 0;
 
-  name = libcrun_get_intelrdt_name (ctr_name, container, &explicit);
+  ret = libcrun_get_intelrdt_shared_name (container, &shared_name, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (shared_name)
+    name = shared_name;
+  else
+    name = libcrun_get_intelrdt_name (ctr_name, container, &explicit);
 
   if (actions & LIBCRUN_INTELRDT_CREATE)
     {
       ret = resctl_create (name, explicit, &created, def->linux->intel_rdt->l3cache_schema, def->linux->intel_rdt->mem_bw_schema, err);
       if (UNLIKELY (ret < 0))
         return ret;
+
+      /* Create the monitoring group next to the class of service, so the
+         per-container counters under mon_data can be read even when the
+         control group is shared.  */
+      ret = resctl_create_mon_group (name, ctr_name, err);
+      if (UNLIKELY (ret < 0))
+        goto fail;
     }
 
   if (actions & LIBCRUN_INTELRDT_UPDATE)
     {
-      ret = resctl_update (name, def->linux->intel_rdt->l3cache_schema, def->linux->intel_rdt->mem_bw_schema, err);
-      if (UNLIKELY (ret < 0))
-        goto fail;
+      /* A shared group that already existed was validated against the
+         requested schemata, so writing it again would only repeat the same
+         MSR updates.  */
+      if (shared_name == NULL || created)
+        {
+          ret = resctl_update (name, def->linux->intel_rdt->l3cache_schema, def->linux->intel_rdt->mem_bw_schema, err);
+          if (UNLIKELY (ret < 0))
+            goto fail;
+        }
     }
 
   if (actions & LIBCRUN_INTELRDT_MOVE)
@@ -5680,6 +6954,12 @@ libcrun_apply_intelrdt (const char *ctr_name, libcrun_container_t *container, pi
       ret = resctl_move_task_to (name, pid, err);
       if (UNLIKELY (ret < 0))
         goto fail;
+
+      /* A task can join the monitoring group only once it is part of the
+         control group.  */
+      ret = resctl_move_task_to_mon_group (name, ctr_name, pid, err);
+      if (UNLIKELY (ret < 0))
+        goto fail;
     }
 
   return 0;
@@ -5691,7 +6971,7 @@ fail:
       libcrun_error_t tmp_err = NULL;
       int tmp_ret;
 
-      tmp_ret = resctl_destroy (name, &tmp_err);
+      tmp_ret = resctl_destroy (name, ctr_name, &tmp_err);
       if (tmp_ret < 0)
         crun_error_release (&tmp_err);
     }
@@ -5699,9 +6979,9 @@ fail:
 }
 
 int
-libcrun_destroy_intelrdt (const char *name, libcrun_error_t *err)
+libcrun_destroy_intelrdt (const char *name, const char *ctr_name, libcrun_error_t *err)
 {
-  return resctl_destroy (name, err);
+  return resctl_destroy (name, ctr_name, err);
 }
 
 int
@@ -69,8 +69,13 @@ int libcrun_init_caps (libcrun_error_t *err);
 int libcrun_do_pivot_root (libcrun_container_t *container, bool no_pivot, const char *rootfs, libcrun_error_t *err);
 int libcrun_reopen_dev_null (libcrun_error_t *err);
 int libcrun_set_usernamespace (libcrun_container_t *container, pid_t pid, libcrun_error_t *err);
-int libcrun_set_caps (runtime_spec_schema_config_schema_process_capabilities *capabilities, uid_t uid, gid_t gid,
-                      int no_new_privileges, libcrun_error_t *err);
+int libcrun_set_caps (libcrun_container_t *container, runtime_spec_schema_config_schema_process_capabilities *capabilities,
+                      uid_t uid, gid_t gid, int no_new_privileges, libcrun_error_t *err);
+
+/* Translate the capabilities strings in the spec into bitmasks cached on the
+   container, so libcrun_set_caps in the child does no string processing.
+   Unknown capability names are warned about here instead of in the child.  */
+void libcrun_precompute_caps (libcrun_container_t *container);
 int libcrun_set_rlimits (runtime_spec_schema_config_schema_process_rlimits_element **rlimits, size_t len,
                          libcrun_error_t *err);
 int libcrun_set_selinux_label (runtime_spec_schema_config_schema_process *proc, bool now, libcrun_error_t *err);
@@ -80,10 +85,19 @@ int libcrun_set_domainname (libcrun_container_t *container, libcrun_error_t *err
 int libcrun_set_oom (libcrun_container_t *container, libcrun_error_t *err);
 int libcrun_set_sysctl (libcrun_container_t *container, libcrun_error_t *err);
 int libcrun_set_terminal (libcrun_container_t *container, libcrun_error_t *err);
+/* Create a detached child with a single clone3 call: the child is put in
+   its own session and the parent gets a pidfd for race-free supervision,
+   replacing the classic double fork whose intermediate process costs an
+   extra creation and exit synchronization.  The child is reparented to
+   init as soon as the caller exits.  Returns 0 in the child and the child
+   pid in the parent; *OUT_PIDFD is set in the parent when the kernel
+   supports CLONE_PIDFD, -1 otherwise.  */
+pid_t libcrun_clone_detached (int *out_pidfd, libcrun_error_t *err);
+
 int libcrun_join_process (libcrun_context_t *context, libcrun_container_t *container, pid_t pid_to_join,
                           libcrun_container_status_t *status, const char *cgroup, int detach,
                           runtime_spec_schema_config_schema_process *process, int *terminal_fd, libcrun_error_t *err);
-int libcrun_linux_container_update (libcrun_container_status_t *status,
+int libcrun_linux_container_update (libcrun_container_status_t *status, const char *plan_file,
                                     runtime_spec_schema_config_linux_resources *resources, libcrun_error_t *err);
 int libcrun_create_keyring (const char *name, const char *label, libcrun_error_t *err);
 int libcrun_container_pause_linux (libcrun_container_status_t *status, libcrun_error_t *err);
@@ -101,6 +115,7 @@ int libcrun_container_restore_linux (libcrun_container_status_t *status, libcrun
                                      libcrun_checkpoint_restore_t *cr_options, libcrun_error_t *err);
 
 int libcrun_find_namespace (const char *name);
+const char *libcrun_namespace_proc_file (const char *name);
 char *libcrun_get_external_descriptors (libcrun_container_t *container);
 int libcrun_container_setgroups (libcrun_container_t *container,
                                  runtime_spec_schema_config_schema_process *process,
@@ -137,9 +152,11 @@ container_has_intelrdt (libcrun_container_t *container)
 
 const char *libcrun_get_intelrdt_name (const char *ctr_name, libcrun_container_t *container, bool *explicit);
 
+int libcrun_get_intelrdt_shared_name (libcrun_container_t *container, char **out, libcrun_error_t *err);
+
 int libcrun_apply_intelrdt (const char *ctr_name, libcrun_container_t *container, pid_t pid, int actions, libcrun_error_t *err);
 
-int libcrun_destroy_intelrdt (const char *name, libcrun_error_t *err);
+int libcrun_destroy_intelrdt (const char *name, const char *ctr_name, libcrun_error_t *err);
 
 int libcrun_update_intel_rdt (const char *ctr_name, libcrun_container_t *container, const char *l3_cache_schema, const char *mem_bw_schema, libcrun_error_t *err);
 
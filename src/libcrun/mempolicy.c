@@ -0,0 +1,153 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "mempolicy.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* From <linux/mempolicy.h>, not available everywhere.  */
+#ifndef MPOL_DEFAULT
+#  define MPOL_DEFAULT 0
+#  define MPOL_PREFERRED 1
+#  define MPOL_BIND 2
+#  define MPOL_INTERLEAVE 3
+#  define MPOL_LOCAL 4
+#endif
+#ifndef MPOL_WEIGHTED_INTERLEAVE
+#  define MPOL_WEIGHTED_INTERLEAVE 6
+#endif
+
+#define MEMPOLICY_MAX_NODES 1024
+
+static int
+syscall_set_mempolicy (int mode, const unsigned long *nodemask, unsigned long maxnode)
+{
+#ifdef __NR_set_mempolicy
+  return syscall (__NR_set_mempolicy, mode, nodemask, maxnode);
+#else
+  (void) mode;
+  (void) nodemask;
+  (void) maxnode;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/* Parse a node list in the cpuset format, e.g. `0-2,4`, into MASK.  */
+static int
+parse_nodemask (const char *nodes, unsigned long *mask, libcrun_error_t *err)
+{
+  const char *it = nodes;
+
+  while (*it)
+    {
+      unsigned long first, last, i;
+      char *endptr = NULL;
+
+      first = strtoul (it, &endptr, 10);
+      if (endptr == it || first >= MEMPOLICY_MAX_NODES)
+        return crun_make_error (err, 0, "invalid NUMA node list `%s`", nodes);
+      last = first;
+      if (*endptr == '-')
+        {
+          it = endptr + 1;
+          last = strtoul (it, &endptr, 10);
+          if (endptr == it || last >= MEMPOLICY_MAX_NODES || last < first)
+            return crun_make_error (err, 0, "invalid NUMA node list `%s`", nodes);
+        }
+
+      for (i = first; i <= last; i++)
+        mask[i / (8 * sizeof (unsigned long))] |= 1UL << (i % (8 * sizeof (unsigned long)));
+
+      if (*endptr == '\0')
+        break;
+      if (*endptr != ',')
+        return crun_make_error (err, 0, "invalid NUMA node list `%s`", nodes);
+      it = endptr + 1;
+    }
+  return 0;
+}
+
+int
+libcrun_set_mempolicy (libcrun_container_t *container, libcrun_error_t *err)
+{
+  unsigned long nodemask[MEMPOLICY_MAX_NODES / (8 * sizeof (unsigned long))] = {
+    0,
+  };
+  cleanup_free char *copy = NULL;
+  const char *annotation;
+  const char *nodes;
+  size_t i;
+  int ret;
+
+  struct
+  {
+    const char *name;
+    int mode;
+    bool needs_nodes;
+  } modes[] = {
+    { "default", MPOL_DEFAULT, false },
+    { "local", MPOL_LOCAL, false },
+    { "bind", MPOL_BIND, true },
+    { "preferred", MPOL_PREFERRED, true },
+    { "interleave", MPOL_INTERLEAVE, true },
+    { "weighted-interleave", MPOL_WEIGHTED_INTERLEAVE, true },
+    { NULL, 0, false },
+  };
+
+  annotation = find_annotation (container, "run.oci.mempolicy");
+  if (annotation == NULL)
+    return 0;
+
+  copy = xstrdup (annotation);
+  nodes = strchr (copy, ':');
+  if (nodes)
+    {
+      *strchr (copy, ':') = '\0';
+      nodes++;
+    }
+
+  for (i = 0; modes[i].name; i++)
+    if (strcmp (copy, modes[i].name) == 0)
+      break;
+  if (modes[i].name == NULL)
+    return crun_make_error (err, 0, "invalid memory policy `%s`", copy);
+
+  if (modes[i].needs_nodes != (nodes != NULL && nodes[0] != '\0'))
+    return crun_make_error (err, 0, "memory policy `%s` %s a node list", copy,
+                            modes[i].needs_nodes ? "requires" : "does not take");
+
+  if (nodes)
+    {
+      ret = parse_nodemask (nodes, nodemask, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  ret = syscall_set_mempolicy (modes[i].mode, nodes ? nodemask : NULL, nodes ? MEMPOLICY_MAX_NODES : 0);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "set_mempolicy `%s`", annotation);
+
+  return 0;
+}
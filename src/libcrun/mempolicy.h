@@ -0,0 +1,29 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MEMPOLICY_H
+#define MEMPOLICY_H
+#include <config.h>
+#include "container.h"
+#include "error.h"
+
+/* Apply the NUMA memory policy requested with the run.oci.mempolicy
+   annotation to the calling process, so it is inherited across the exec of
+   the container payload.  Must run in the container process.  */
+int libcrun_set_mempolicy (libcrun_container_t *container, libcrun_error_t *err);
+
+#endif
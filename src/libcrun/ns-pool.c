@@ -0,0 +1,415 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Pre-warmed namespace sets.  A pool directory holds slots, each with a
+   user, ipc and uts namespace kept alive through nsfs bind mounts plus a
+   record of the id mappings written into the user namespace.  `crun
+   ns-pool` refills the pool ahead of time; a create with the
+   `run.oci.ns-pool` annotation claims a slot with an atomic rename and
+   joins the pre-created namespaces through the spec's namespace paths,
+   taking the unshare and mapping setup off the cold-start path.  Network
+   and pid namespaces are deliberately not pooled: the former because the
+   sandboxes are netns-less by design, the latter because an empty pid
+   namespace cannot outlive its first init.  */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "ns-pool.h"
+#include "utils.h"
+#include <sched.h>
+#include <inttypes.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+
+static const char *pooled_namespaces[] = { "user", "ipc", "uts", NULL };
+
+static char *
+format_id_mappings (runtime_spec_schema_defs_id_mapping **mappings, size_t mappings_len)
+{
+  /* 64 is more than enough room to print 3 uint32.  */
+  const size_t max_len_mapping = 64;
+  size_t written = 0;
+  char *ret;
+  size_t s;
+
+  ret = xmalloc (max_len_mapping * mappings_len + 1);
+  for (s = 0; s < mappings_len; s++)
+    written += snprintf (ret + written, max_len_mapping, "%" PRIu32 " %" PRIu32 " %" PRIu32 "\n",
+                         mappings[s]->container_id, mappings[s]->host_id, mappings[s]->size);
+  ret[written] = '\0';
+  return ret;
+}
+
+/* The mapping written into pooled user namespaces: the full range as root,
+   the single invoking id otherwise.  */
+static char *
+template_mapping (bool is_uid)
+{
+  char *ret;
+
+  if (geteuid () == 0)
+    return xstrdup ("0 0 65536\n");
+
+  xasprintf (&ret, "0 %d 1\n", is_uid ? (int) geteuid () : (int) getegid ());
+  return ret;
+}
+
+static int
+write_proc_file (pid_t pid, const char *name, const char *content, libcrun_error_t *err)
+{
+  cleanup_free char *path = NULL;
+
+  xasprintf (&path, "/proc/%d/%s", pid, name);
+  return write_file (path, content, strlen (content), err);
+}
+
+static int
+create_one_slot (const char *pool_dir, libcrun_error_t *err)
+{
+  cleanup_free char *uid_mapping = template_mapping (true);
+  cleanup_free char *gid_mapping = template_mapping (false);
+  cleanup_free char *tmp_dir = NULL;
+  cleanup_free char *slot_dir = NULL;
+  cleanup_close int ready_rd = -1;
+  cleanup_close int ready_wr = -1;
+  cleanup_close int done_rd = -1;
+  cleanup_close int done_wr = -1;
+  static int slot_seq;
+  int pipe_fds[2];
+  pid_t pid;
+  size_t i;
+  int ret;
+  char b;
+
+  xasprintf (&tmp_dir, "%s/.tmp-%d-%d", pool_dir, getpid (), slot_seq);
+  xasprintf (&slot_dir, "%s/slot-%d-%d", pool_dir, getpid (), slot_seq);
+  slot_seq++;
+
+  ret = mkdir (tmp_dir, 0700);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "mkdir `%s`", tmp_dir);
+
+  /* One pipe per direction: with a single shared pipe the child could read
+     back the very byte it wrote and exit before the parent bind-mounted the
+     namespaces, leaving the parent blocked forever.  */
+  ret = pipe2 (pipe_fds, O_CLOEXEC);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "pipe2");
+  ready_rd = pipe_fds[0];
+  ready_wr = pipe_fds[1];
+
+  ret = pipe2 (pipe_fds, O_CLOEXEC);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "pipe2");
+  done_rd = pipe_fds[0];
+  done_wr = pipe_fds[1];
+
+  pid = fork ();
+  if (UNLIKELY (pid < 0))
+    return crun_make_error (err, errno, "fork");
+  if (pid == 0)
+    {
+      close_and_reset (&ready_rd);
+      close_and_reset (&done_wr);
+
+      /* The namespaces are created here and kept alive by the bind mounts
+         the parent makes; this process only exists long enough for that.  */
+      ret = unshare (CLONE_NEWUSER | CLONE_NEWIPC | CLONE_NEWUTS);
+      if (ret < 0)
+        _exit (1);
+      b = '1';
+      if (TEMP_FAILURE_RETRY (write (ready_wr, &b, 1)) != 1)
+        _exit (1);
+      /* Wait for the parent to finish the mounts.  */
+      TEMP_FAILURE_RETRY (read (done_rd, &b, 1));
+      _exit (0);
+    }
+
+  close_and_reset (&ready_wr);
+  close_and_reset (&done_rd);
+
+  ret = TEMP_FAILURE_RETRY (read (ready_rd, &b, 1));
+  if (UNLIKELY (ret != 1))
+    {
+      ret = crun_make_error (err, 0, "create the template namespaces");
+      goto fail;
+    }
+
+  if (geteuid () != 0)
+    {
+      ret = write_proc_file (pid, "setgroups", "deny", err);
+      if (UNLIKELY (ret < 0))
+        goto fail;
+    }
+
+  ret = write_proc_file (pid, "uid_map", uid_mapping, err);
+  if (UNLIKELY (ret < 0))
+    goto fail;
+
+  ret = write_proc_file (pid, "gid_map", gid_mapping, err);
+  if (UNLIKELY (ret < 0))
+    goto fail;
+
+  /* Record what was written so a claim can check the spec asks for the
+     same mappings.  */
+  {
+    cleanup_free char *path = NULL;
+
+    xasprintf (&path, "%s/uid_map", tmp_dir);
+    ret = write_file (path, uid_mapping, strlen (uid_mapping), err);
+    if (UNLIKELY (ret < 0))
+      goto fail;
+
+    free (path);
+    path = NULL;
+    xasprintf (&path, "%s/gid_map", tmp_dir);
+    ret = write_file (path, gid_mapping, strlen (gid_mapping), err);
+    if (UNLIKELY (ret < 0))
+      goto fail;
+  }
+
+  for (i = 0; pooled_namespaces[i]; i++)
+    {
+      cleanup_free char *ns_path = NULL;
+      cleanup_free char *target = NULL;
+      cleanup_close int fd = -1;
+
+      xasprintf (&ns_path, "/proc/%d/ns/%s", pid, pooled_namespaces[i]);
+      xasprintf (&target, "%s/%s", tmp_dir, pooled_namespaces[i]);
+
+      fd = open (target, O_CREAT | O_WRONLY | O_CLOEXEC, 0600);
+      if (UNLIKELY (fd < 0))
+        {
+          ret = crun_make_error (err, errno, "create `%s`", target);
+          goto fail;
+        }
+
+      ret = mount (ns_path, target, NULL, MS_BIND, NULL);
+      if (UNLIKELY (ret < 0))
+        {
+          ret = crun_make_error (err, errno, "bind mount `%s`", ns_path);
+          goto fail;
+        }
+    }
+
+  /* Unblock the child, the mounts hold the namespaces now.  */
+  b = '1';
+  TEMP_FAILURE_RETRY (write (done_wr, &b, 1));
+  TEMP_FAILURE_RETRY (waitpid (pid, NULL, 0));
+  pid = 0;
+
+  ret = rename (tmp_dir, slot_dir);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "rename `%s`", tmp_dir);
+
+  return 0;
+
+fail:
+  if (pid > 0)
+    {
+      kill (pid, SIGKILL);
+      TEMP_FAILURE_RETRY (waitpid (pid, NULL, 0));
+    }
+  for (i = 0; pooled_namespaces[i]; i++)
+    {
+      cleanup_free char *target = NULL;
+
+      xasprintf (&target, "%s/%s", tmp_dir, pooled_namespaces[i]);
+      umount2 (target, MNT_DETACH);
+    }
+  return ret;
+}
+
+int
+libcrun_ns_pool_refill (const char *pool_dir, size_t size, libcrun_error_t *err)
+{
+  cleanup_dir DIR *dir = NULL;
+  size_t n_slots = 0;
+  struct dirent *de;
+  int ret;
+
+  ret = crun_ensure_directory (pool_dir, 0700, true, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  dir = opendir (pool_dir);
+  if (UNLIKELY (dir == NULL))
+    return crun_make_error (err, errno, "opendir `%s`", pool_dir);
+
+  for (de = readdir (dir); de; de = readdir (dir))
+    if (has_prefix (de->d_name, "slot-"))
+      n_slots++;
+
+  for (; n_slots < size; n_slots++)
+    {
+      ret = create_one_slot (pool_dir, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  return 0;
+}
+
+static int
+mappings_match (const char *slot_dir, const char *name, runtime_spec_schema_defs_id_mapping **mappings,
+                size_t mappings_len)
+{
+  cleanup_free char *expected = NULL;
+  cleanup_free char *recorded = NULL;
+  cleanup_free char *path = NULL;
+  libcrun_error_t tmp_err = NULL;
+  int ret;
+
+  xasprintf (&path, "%s/%s", slot_dir, name);
+  ret = read_all_file (path, &recorded, NULL, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return 0;
+    }
+
+  expected = format_id_mappings (mappings, mappings_len);
+  return strcmp (expected, recorded) == 0;
+}
+
+/* Point the namespace entry for TYPE at the claimed nsfs file, through a fd
+   kept open in this process so the slot directory can be removed right
+   away.  */
+static int
+adopt_namespace (runtime_spec_schema_config_schema *def, const char *slot_dir, const char *type,
+                 libcrun_error_t *err)
+{
+  cleanup_free char *ns_path = NULL;
+  size_t i;
+  int fd;
+
+  for (i = 0; i < def->linux->namespaces_len; i++)
+    {
+      runtime_spec_schema_defs_linux_namespace_reference *ns = def->linux->namespaces[i];
+
+      if (strcmp (ns->type, type) != 0 || ! is_empty_string (ns->path))
+        continue;
+
+      xasprintf (&ns_path, "%s/%s", slot_dir, type);
+      fd = open (ns_path, O_RDONLY | O_CLOEXEC);
+      if (UNLIKELY (fd < 0))
+        return crun_make_error (err, errno, "open `%s`", ns_path);
+
+      /* The descriptor is left open on purpose: it keeps the namespace
+         alive until the container init joins it, and O_CLOEXEC disposes of
+         it at exec time.  */
+      free (ns->path);
+      xasprintf (&ns->path, "/proc/self/fd/%d", fd);
+      return 0;
+    }
+
+  return 0;
+}
+
+int
+libcrun_ns_pool_adopt (libcrun_container_t *container, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_schema *def = container->container_def;
+  cleanup_free char *claim_dir = NULL;
+  cleanup_dir DIR *dir = NULL;
+  const char *pool_dir;
+  struct dirent *de;
+  bool claimed = false;
+  size_t i;
+  int ret;
+
+  pool_dir = find_annotation (container, "run.oci.ns-pool");
+  if (pool_dir == NULL)
+    return 0;
+
+  if (def == NULL || def->linux == NULL || def->linux->namespaces_len == 0)
+    return 0;
+
+  dir = opendir (pool_dir);
+  if (dir == NULL)
+    return 0; /* No pool yet, build everything from scratch.  */
+
+  xasprintf (&claim_dir, "%s/.claim-%d", pool_dir, getpid ());
+
+  for (de = readdir (dir); de; de = readdir (dir))
+    {
+      cleanup_free char *slot_path = NULL;
+
+      if (! has_prefix (de->d_name, "slot-"))
+        continue;
+
+      xasprintf (&slot_path, "%s/%s", pool_dir, de->d_name);
+
+      /* The rename is the claim: losing the race just moves to the next
+         slot.  */
+      if (rename (slot_path, claim_dir) < 0)
+        continue;
+
+      if (! mappings_match (claim_dir, "uid_map", def->linux->uid_mappings, def->linux->uid_mappings_len)
+          || ! mappings_match (claim_dir, "gid_map", def->linux->gid_mappings, def->linux->gid_mappings_len))
+        {
+          /* Template and spec disagree, put the slot back for a container
+             it fits.  */
+          rename (claim_dir, slot_path);
+          continue;
+        }
+
+      claimed = true;
+      break;
+    }
+
+  if (! claimed)
+    return 0;
+
+  for (i = 0; pooled_namespaces[i]; i++)
+    {
+      ret = adopt_namespace (def, claim_dir, pooled_namespaces[i], err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  /* The open descriptors keep the namespaces alive; drop the slot from the
+     pool directory right away, best effort.  */
+  for (i = 0; pooled_namespaces[i]; i++)
+    {
+      cleanup_free char *target = NULL;
+
+      xasprintf (&target, "%s/%s", claim_dir, pooled_namespaces[i]);
+      umount2 (target, MNT_DETACH);
+      unlink (target);
+    }
+  {
+    cleanup_free char *target = NULL;
+
+    xasprintf (&target, "%s/uid_map", claim_dir);
+    unlink (target);
+    free (target);
+    target = NULL;
+    xasprintf (&target, "%s/gid_map", claim_dir);
+    unlink (target);
+  }
+  rmdir (claim_dir);
+
+  return 1;
+}
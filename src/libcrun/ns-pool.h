@@ -0,0 +1,34 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NS_POOL_H
+#define NS_POOL_H
+#include <config.h>
+#include "container.h"
+#include "error.h"
+
+/* Create slots under POOL_DIR until it holds SIZE pre-warmed namespace
+   sets.  */
+int libcrun_ns_pool_refill (const char *pool_dir, size_t size, libcrun_error_t *err);
+
+/* If the container carries the `run.oci.ns-pool` annotation, try to claim a
+   matching slot and rewrite its pathless user/ipc/uts namespace entries to
+   join the pre-created namespaces.  Returns 1 when a slot was adopted, 0
+   when the container falls back to creating its own namespaces.  */
+int libcrun_ns_pool_adopt (libcrun_container_t *container, libcrun_error_t *err);
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "probe-cache.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define PROBE_CACHE_MAX_ENTRIES 16
+
+/* The cache file is a plain text file under the run directory:
+
+     boot BOOT_ID
+     NAME VALUE
+     ...
+
+   /run is a fresh tmpfs on every boot, but the file also records the boot id
+   from /proc/sys/kernel/random/boot_id, so a cache surviving the boot in a
+   non-standard setup (or copied around) is still detected as stale.  */
+
+static struct
+{
+  char *names[PROBE_CACHE_MAX_ENTRIES];
+  int values[PROBE_CACHE_MAX_ENTRIES];
+  size_t len;
+  bool loaded;
+} cache;
+
+static char *
+get_cache_path (void)
+{
+  const char *runtime_dir = getenv ("XDG_RUNTIME_DIR");
+  libcrun_error_t err = NULL;
+  char *root = NULL;
+  char *path = NULL;
+  int ret;
+
+  if (runtime_dir && runtime_dir[0] != '\0')
+    {
+      ret = append_paths (&root, &err, runtime_dir, "crun", NULL);
+      if (UNLIKELY (ret < 0))
+        {
+          crun_error_release (&err);
+          return NULL;
+        }
+    }
+  if (root == NULL)
+    root = xstrdup ("/run/crun");
+
+  ret = crun_ensure_directory (root, 0700, false, &err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&err);
+      free (root);
+      return NULL;
+    }
+
+  ret = append_paths (&path, &err, root, "probe-cache", NULL);
+  free (root);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&err);
+      return NULL;
+    }
+  return path;
+}
+
+static int
+read_boot_id (char *buf, size_t size)
+{
+  cleanup_close int fd = -1;
+  ssize_t ret;
+
+  fd = open ("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  ret = TEMP_FAILURE_RETRY (read (fd, buf, size - 1));
+  if (ret <= 0)
+    return -1;
+
+  buf[ret] = '\0';
+  buf[strcspn (buf, "\n")] = '\0';
+  return 0;
+}
+
+static void
+load_cache (void)
+{
+  cleanup_free char *content = NULL;
+  libcrun_error_t err = NULL;
+  cleanup_free char *path = NULL;
+  char boot_id[64];
+  char *line, *saveptr = NULL;
+  size_t len;
+  int ret;
+
+  cache.loaded = true;
+
+  path = get_cache_path ();
+  if (path == NULL)
+    return;
+
+  ret = read_all_file (path, &content, &len, &err);
+  if (ret < 0)
+    {
+      crun_error_release (&err);
+      return;
+    }
+
+  if (read_boot_id (boot_id, sizeof (boot_id)) < 0)
+    return;
+
+  line = strtok_r (content, "\n", &saveptr);
+  if (line == NULL || ! has_prefix (line, "boot ") || strcmp (line + 5, boot_id) != 0)
+    return;
+
+  while ((line = strtok_r (NULL, "\n", &saveptr)) && cache.len < PROBE_CACHE_MAX_ENTRIES)
+    {
+      char *space = strchr (line, ' ');
+
+      if (space == NULL)
+        continue;
+      *space = '\0';
+
+      cache.names[cache.len] = xstrdup (line);
+      cache.values[cache.len] = atoi (space + 1);
+      cache.len++;
+    }
+}
+
+static void
+save_cache (void)
+{
+  cleanup_free char *tmp_path = NULL;
+  cleanup_free char *path = NULL;
+  cleanup_close int fd = -1;
+  char boot_id[64];
+  FILE *f;
+  size_t i;
+
+  path = get_cache_path ();
+  if (path == NULL)
+    return;
+
+  if (read_boot_id (boot_id, sizeof (boot_id)) < 0)
+    return;
+
+  /* Write to a private temporary file and rename it in place, so concurrent
+     invocations never observe a partially written cache.  */
+  xasprintf (&tmp_path, "%s.%d", path, getpid ());
+  fd = open (tmp_path, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return;
+
+  f = fdopen (dup (fd), "w");
+  if (f == NULL)
+    {
+      unlink (tmp_path);
+      return;
+    }
+
+  fprintf (f, "boot %s\n", boot_id);
+  for (i = 0; i < cache.len; i++)
+    fprintf (f, "%s %d\n", cache.names[i], cache.values[i]);
+
+  if (fclose (f) != 0 || rename (tmp_path, path) < 0)
+    unlink (tmp_path);
+}
+
+int
+libcrun_probe_cache_get (const char *name, int *value)
+{
+  size_t i;
+
+  if (! cache.loaded)
+    load_cache ();
+
+  for (i = 0; i < cache.len; i++)
+    if (strcmp (cache.names[i], name) == 0)
+      {
+        *value = cache.values[i];
+        return 0;
+      }
+  return -1;
+}
+
+void
+libcrun_probe_cache_store (const char *name, int value)
+{
+  size_t i;
+
+  if (! cache.loaded)
+    load_cache ();
+
+  for (i = 0; i < cache.len; i++)
+    if (strcmp (cache.names[i], name) == 0)
+      {
+        if (cache.values[i] == value)
+          return;
+        cache.values[i] = value;
+        save_cache ();
+        return;
+      }
+
+  if (cache.len == PROBE_CACHE_MAX_ENTRIES)
+    return;
+
+  cache.names[cache.len] = xstrdup (name);
+  cache.values[cache.len] = value;
+  cache.len++;
+  save_cache ();
+}
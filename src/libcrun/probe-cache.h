@@ -0,0 +1,36 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROBE_CACHE_H
+#define PROBE_CACHE_H
+#include <config.h>
+
+/* Per-boot cache of environment probe results (cgroup mode, LSM
+   availability), stored under the run directory and keyed by the boot id so
+   a stale file from a previous boot is never trusted.  Probes cached here
+   must depend only on the booted kernel and host configuration, never on a
+   single container.  Both functions are best effort: a missing or unusable
+   cache only means the caller re-probes.  */
+
+/* Look NAME up in the cache.  Returns 0 and fills *VALUE on a hit, < 0 on a
+   miss.  */
+int libcrun_probe_cache_get (const char *name, int *value);
+
+/* Record NAME=VALUE and persist the cache for later invocations.  */
+void libcrun_probe_cache_store (const char *name, int value);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <config.h>
+#include "profile.h"
+#include "utils.h"
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#  include <linux/perf_event.h>
+#  include <sys/syscall.h>
+#endif
+
+#define MAX_STARTUP_MARKS 64
+#define MAX_CHILD_MARKS 16
+
+struct startup_mark_s
+{
+  const char *phase;
+  struct timespec ts;
+  long long syscalls;
+};
+
+struct child_mark_s
+{
+  pid_t pid;
+  char phase[64];
+  struct timespec ts;
+};
+
+bool profile_startup_enabled;
+
+static const char *profile_startup_path;
+static struct startup_mark_s startup_marks[MAX_STARTUP_MARKS];
+static size_t n_startup_marks;
+
+static FILE *trace_stream;
+static struct child_mark_s child_marks[MAX_CHILD_MARKS];
+static size_t n_child_marks;
+
+static int syscall_counter_fd = -1;
+
+int
+libcrun_profile_syscall_counter_open (bool count_children)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  struct perf_event_attr attr;
+  cleanup_free char *content = NULL;
+  libcrun_error_t tmp_err = NULL;
+  long long id;
+  int ret;
+
+  ret = read_all_file ("/sys/kernel/tracing/events/raw_syscalls/sys_enter/id", &content, NULL, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      ret = read_all_file ("/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id", &content, NULL, &tmp_err);
+      if (UNLIKELY (ret < 0))
+        {
+          crun_error_release (&tmp_err);
+          return -1;
+        }
+    }
+
+  id = strtoll (content, NULL, 10);
+  if (id <= 0)
+    return -1;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.type = PERF_TYPE_TRACEPOINT;
+  attr.size = sizeof (attr);
+  attr.config = id;
+  attr.inherit = count_children ? 1 : 0;
+  attr.exclude_hv = 1;
+
+  return syscall (__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+#else
+  (void) count_children;
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+long long
+libcrun_profile_syscall_counter_read (int fd)
+{
+  long long value = 0;
+
+  if (fd < 0)
+    return -1;
+
+  if (TEMP_FAILURE_RETRY (read (fd, &value, sizeof (value))) != sizeof (value))
+    return -1;
+
+  return value;
+}
+
+void
+libcrun_profile_startup_enable (const char *path)
+{
+  profile_startup_path = path;
+  profile_startup_enabled = true;
+  if (syscall_counter_fd < 0)
+    syscall_counter_fd = libcrun_profile_syscall_counter_open (false);
+  if (n_startup_marks == 0)
+    profile_startup_mark_now ("start");
+}
+
+void
+libcrun_profile_set_trace_stream (FILE *stream)
+{
+  trace_stream = stream;
+  profile_startup_enabled = true;
+  if (syscall_counter_fd < 0)
+    syscall_counter_fd = libcrun_profile_syscall_counter_open (false);
+  if (n_startup_marks == 0)
+    profile_startup_mark_now ("start");
+}
+
+bool
+libcrun_profile_trace_enabled (void)
+{
+  return trace_stream != NULL;
+}
+
+void
+profile_startup_mark_child (pid_t pid, const char *phase, const struct timespec *ts)
+{
+  struct child_mark_s *mark;
+
+  if (trace_stream == NULL || n_child_marks == MAX_CHILD_MARKS)
+    return;
+
+  mark = &child_marks[n_child_marks++];
+  mark->pid = pid;
+  snprintf (mark->phase, sizeof (mark->phase), "%s", phase);
+  mark->ts = *ts;
+}
+
+void
+profile_startup_mark_now (const char *phase)
+{
+  struct startup_mark_s *mark;
+
+  if (n_startup_marks == MAX_STARTUP_MARKS)
+    return;
+
+  mark = &startup_marks[n_startup_marks++];
+  mark->phase = phase;
+  clock_gettime (CLOCK_MONOTONIC, &mark->ts);
+  mark->syscalls = libcrun_profile_syscall_counter_read (syscall_counter_fd);
+}
+
+static long long
+timespec_diff_us (const struct timespec *from, const struct timespec *to)
+{
+  return (to->tv_sec - from->tv_sec) * 1000000LL + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+static void
+trace_put_json_string (FILE *out, const char *s)
+{
+  fputc ('"', out);
+  for (; *s; s++)
+    {
+      if (*s == '"' || *s == '\\')
+        fprintf (out, "\\%c", *s);
+      else if (*(const unsigned char *) s < 0x20)
+        fprintf (out, "\\u%04x", *s);
+      else
+        fputc (*s, out);
+    }
+  fputc ('"', out);
+}
+
+void
+libcrun_profile_trace_instant (const char *msg, bool warning)
+{
+  struct timespec now;
+
+  if (trace_stream == NULL || n_startup_marks == 0)
+    return;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  fprintf (trace_stream, "{\"name\":");
+  trace_put_json_string (trace_stream, msg);
+  fprintf (trace_stream, ",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld,\"pid\":%d,\"tid\":%d},\n",
+           warning ? "warning" : "error", timespec_diff_us (&startup_marks[0].ts, &now), getpid (), getpid ());
+}
+
+/* Write the startup marks as trace events.  Each mark lasts until the
+   following one on the same timeline; the events are left separated by a
+   trailing comma since the viewers accept an unterminated array and the
+   process can exit at any time.  */
+static void
+write_trace_events (const char *id)
+{
+  const struct timespec *base = &startup_marks[0].ts;
+  pid_t pid = getpid ();
+  size_t i, j;
+
+  fprintf (trace_stream, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"crun %s\"}},\n",
+           pid, id ? id : "");
+  for (i = 0; i < n_startup_marks; i++)
+    {
+      long long ts = timespec_diff_us (base, &startup_marks[i].ts);
+
+      fprintf (trace_stream, "{\"name\":");
+      trace_put_json_string (trace_stream, startup_marks[i].phase);
+      if (i + 1 < n_startup_marks)
+        {
+          fprintf (trace_stream, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d", ts,
+                   timespec_diff_us (&startup_marks[i].ts, &startup_marks[i + 1].ts), pid, pid);
+          if (startup_marks[i].syscalls >= 0 && startup_marks[i + 1].syscalls >= 0)
+            fprintf (trace_stream, ",\"args\":{\"syscalls\":%lld}",
+                     startup_marks[i + 1].syscalls - startup_marks[i].syscalls);
+          fprintf (trace_stream, "},\n");
+        }
+      else
+        fprintf (trace_stream, ",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld,\"pid\":%d,\"tid\":%d},\n", ts, pid, pid);
+    }
+
+  for (i = 0; i < n_child_marks; i++)
+    {
+      long long ts = timespec_diff_us (base, &child_marks[i].ts);
+
+      if (i == 0 || child_marks[i].pid != child_marks[i - 1].pid)
+        fprintf (trace_stream,
+                 "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"container init\"}},\n",
+                 child_marks[i].pid);
+
+      for (j = i + 1; j < n_child_marks; j++)
+        if (child_marks[j].pid == child_marks[i].pid)
+          break;
+
+      fprintf (trace_stream, "{\"name\":");
+      trace_put_json_string (trace_stream, child_marks[i].phase);
+      if (j < n_child_marks)
+        fprintf (trace_stream, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d},\n", ts,
+                 timespec_diff_us (&child_marks[i].ts, &child_marks[j].ts), child_marks[i].pid, child_marks[i].pid);
+      else
+        fprintf (trace_stream, ",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld,\"pid\":%d,\"tid\":%d},\n", ts,
+                 child_marks[i].pid, child_marks[i].pid);
+    }
+}
+
+void
+libcrun_profile_startup_write (const char *id)
+{
+  size_t i;
+
+  if (n_startup_marks == 0)
+    return;
+
+  if (trace_stream)
+    write_trace_events (id);
+
+  if (profile_startup_path)
+    {
+      cleanup_file FILE *out = NULL;
+
+      out = fopen (profile_startup_path, "ae");
+      if (out == NULL)
+        {
+          libcrun_warning ("cannot open `%s` to write the startup profile", profile_startup_path);
+          return;
+        }
+
+      fprintf (out, "{\"id\":\"%s\",\"phases\":[", id ? id : "");
+      for (i = 0; i < n_startup_marks; i++)
+        {
+          long long offset = timespec_diff_us (&startup_marks[0].ts, &startup_marks[i].ts);
+          long long duration = i + 1 < n_startup_marks
+                                   ? timespec_diff_us (&startup_marks[i].ts, &startup_marks[i + 1].ts)
+                                   : 0;
+
+          fprintf (out, "%s{\"name\":\"%s\",\"offset_us\":%lld,\"duration_us\":%lld",
+                   i ? "," : "", startup_marks[i].phase, offset, duration);
+          if (i + 1 < n_startup_marks && startup_marks[i].syscalls >= 0 && startup_marks[i + 1].syscalls >= 0)
+            fprintf (out, ",\"syscalls\":%lld", startup_marks[i + 1].syscalls - startup_marks[i].syscalls);
+          fputc ('}', out);
+        }
+      fprintf (out, "]}\n");
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <config.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+#include "error.h"
+
+/* Static USDT probes marking the container startup phases.  They are always
+   compiled in when <sys/sdt.h> is available and are nops (a single
+   instruction) until a tracer attaches.  */
+#ifdef HAVE_SYS_SDT_H
+#  include <sys/sdt.h>
+#  define crun_startup_probe(phase) DTRACE_PROBE1 (crun, startup_phase, phase)
+#else
+#  define crun_startup_probe(phase)
+#endif
+
+/* Record the phases of the container startup and write them as a JSON timing
+   record.  The marks are kept in a static table, so the instrumentation costs
+   one flag check when disabled and one clock_gettime when enabled.  */
+
+extern bool profile_startup_enabled;
+
+LIBCRUN_PUBLIC void libcrun_profile_startup_enable (const char *path);
+
+void profile_startup_mark_now (const char *phase);
+
+/* Write the collected marks as one JSON record appended to the configured
+   file.  Best effort: failures are reported as warnings.  */
+LIBCRUN_PUBLIC void libcrun_profile_startup_write (const char *id);
+
+/* Chrome trace-event backend used by `--log=trace:PATH`.  The startup marks
+   are written as duration events, log messages as instant events, so a
+   container start can be opened directly in a trace viewer.  Setting the
+   stream also enables the startup marks.  */
+void libcrun_profile_set_trace_stream (FILE *stream);
+
+bool libcrun_profile_trace_enabled (void);
+
+void libcrun_profile_trace_instant (const char *msg, bool warning);
+
+/* Record a startup mark forwarded by the container init process over the
+   sync socket.  TS is its CLOCK_MONOTONIC timestamp, so the child timeline
+   is aligned with the parent one.  */
+void profile_startup_mark_child (pid_t pid, const char *phase, const struct timespec *ts);
+
+/* Syscall-budget audit.  Open a perf counter on the raw_syscalls:sys_enter
+   tracepoint for the calling process; the startup profile samples it at every
+   mark and reports the per-phase deltas next to the timings.  Returns -1 when
+   the tracepoint is not accessible, in which case the counts are simply
+   omitted.  With COUNT_CHILDREN the counter is inherited and the counts of
+   the exited children are folded in.  */
+LIBCRUN_PUBLIC int libcrun_profile_syscall_counter_open (bool count_children);
+
+LIBCRUN_PUBLIC long long libcrun_profile_syscall_counter_read (int fd);
+
+#define libcrun_profile_startup_mark(phase) \
+  do                                        \
+    {                                       \
+      crun_startup_probe (phase);           \
+      if (profile_startup_enabled)          \
+        profile_startup_mark_now (phase);   \
+  } while (0)
+
+#endif
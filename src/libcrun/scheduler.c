@@ -23,6 +23,7 @@
 #include "utils.h"
 #include <sched.h>
 #include <linux/sched.h>
+#include <sys/prctl.h>
 #include <sys/sysmacros.h>
 #include <limits.h>
 #include <inttypes.h>
@@ -50,6 +51,20 @@
 #  define SCHED_FLAG_UTIL_CLAMP_MAX 0x40
 #endif
 
+#ifndef PR_SCHED_CORE
+#  define PR_SCHED_CORE 62
+#  define PR_SCHED_CORE_GET 0
+#  define PR_SCHED_CORE_CREATE 1
+#  define PR_SCHED_CORE_SHARE_TO 2
+#  define PR_SCHED_CORE_SHARE_FROM 3
+#endif
+#ifndef PR_SCHED_CORE_SCOPE_THREAD
+#  define PR_SCHED_CORE_SCOPE_THREAD 0
+#endif
+#ifndef PR_SCHED_CORE_SCOPE_THREAD_GROUP
+#  define PR_SCHED_CORE_SCOPE_THREAD_GROUP 1
+#endif
+
 struct sched_attr_s
 {
   uint32_t size;
@@ -162,3 +177,65 @@ libcrun_set_scheduler (pid_t pid, runtime_spec_schema_config_schema_process *pro
 
   return 0;
 }
+
+static bool
+core_sched_enabled (libcrun_container_t *container)
+{
+  const char *annotation;
+
+  if (container == NULL)
+    return false;
+
+  annotation = find_annotation (container, "run.oci.core-sched");
+  return annotation != NULL && strcmp (annotation, "true") == 0;
+}
+
+int
+libcrun_create_core_sched_cookie (pid_t pid, libcrun_container_t *container, libcrun_error_t *err)
+{
+  int ret;
+
+  if (! core_sched_enabled (container))
+    return 0;
+
+  /* The cookie is created on the whole thread group of the container init
+     process while it still waits on the sync socket, together with the
+     scheduler attributes, so every process it forks or execs inherits it
+     without any further syscall.  */
+  ret = prctl (PR_SCHED_CORE, PR_SCHED_CORE_CREATE, pid, PR_SCHED_CORE_SCOPE_THREAD_GROUP, 0);
+  if (UNLIKELY (ret < 0))
+    {
+      /* Without SMT there are no sibling hyperthreads to protect against.  */
+      if (errno == ENODEV)
+        return 0;
+      return crun_make_error (err, errno, "cannot create core scheduling cookie");
+    }
+
+  return 0;
+}
+
+int
+libcrun_join_core_sched_cookie (pid_t pid, pid_t pid_to_join, libcrun_container_t *container, libcrun_error_t *err)
+{
+  int ret;
+
+  if (! core_sched_enabled (container))
+    return 0;
+
+  /* Pull the container cookie onto the calling thread, then push it to the
+     thread group of the new process.  Tainting the runtime's own cookie
+     does not matter, it is about to exit anyway.  */
+  ret = prctl (PR_SCHED_CORE, PR_SCHED_CORE_SHARE_FROM, pid_to_join, PR_SCHED_CORE_SCOPE_THREAD, 0);
+  if (UNLIKELY (ret < 0))
+    {
+      if (errno == ENODEV)
+        return 0;
+      return crun_make_error (err, errno, "cannot read the core scheduling cookie from `%d`", pid_to_join);
+    }
+
+  ret = prctl (PR_SCHED_CORE, PR_SCHED_CORE_SHARE_TO, pid, PR_SCHED_CORE_SCOPE_THREAD_GROUP, 0);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "cannot share the core scheduling cookie with `%d`", pid);
+
+  return 0;
+}
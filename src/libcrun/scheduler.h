@@ -24,4 +24,12 @@
 
 int libcrun_set_scheduler (pid_t pid, runtime_spec_schema_config_schema_process *process, libcrun_error_t *err);
 
+/* Core scheduling (PR_SCHED_CORE), opt-in through the `run.oci.core-sched`
+   annotation: the container init process gets its own cookie so only its
+   descendants share SMT siblings, and exec'd processes join that cookie.  */
+int libcrun_create_core_sched_cookie (pid_t pid, libcrun_container_t *container, libcrun_error_t *err);
+
+int libcrun_join_core_sched_cookie (pid_t pid, pid_t pid_to_join, libcrun_container_t *container,
+                                    libcrun_error_t *err);
+
 #endif
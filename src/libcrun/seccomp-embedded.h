@@ -0,0 +1,26 @@
+/* Autogenerated by `make generate-embedded-seccomp`, do not edit by hand.
+ *
+ * Seccomp programs precompiled at build time, keyed by the portable profile
+ * checksum (the profile content and generation options only, no host
+ * specific inputs).  The table ends with a NULL sentinel; it is empty
+ * unless a profile was embedded with:
+ *
+ *   make generate-embedded-seccomp SECCOMP_PROFILES=/path/to/config.json
+ */
+#ifndef SECCOMP_EMBEDDED_H
+#define SECCOMP_EMBEDDED_H
+
+#include <stddef.h>
+
+struct embedded_seccomp_profile_s
+{
+  const char *checksum;
+  const unsigned char *bpf;
+  size_t len;
+};
+
+static const struct embedded_seccomp_profile_s embedded_seccomp_profiles[] = {
+  { NULL, NULL, 0 },
+};
+
+#endif
@@ -52,8 +52,9 @@
 #endif
 
 #ifdef HAVE_SECCOMP
-#  include <seccomp.h>
+#  include "dl-seccomp.h"
 #endif
+#include "seccomp-embedded.h"
 #include <linux/seccomp.h>
 #include <linux/filter.h>
 #include <sys/prctl.h>
@@ -375,8 +376,47 @@ seccomp_action_supports_errno (const char *action)
      0 if the checksum is not supported
    > 0 the checksum is supported and the value is in OUT.
  */
+/* When PORTABLE is set the checksum covers only the profile content and the
+   generation options, none of the host specific inputs: it is the key used
+   for programs precompiled at build time on a different machine.  */
+/* Optional syscall-frequency hints for the generated filter: the annotation
+   points to a file with one syscall name per line, hottest first ('#' starts
+   a comment).  The listed syscalls are given decreasing libseccomp
+   priorities, so the hottest ones are matched by the first comparisons of
+   the filter.  The ordering does not change which action a syscall gets.  */
+#define SECCOMP_PRIORITY_HINTS_ANNOTATION "run.oci.seccomp_priority_hints"
+
+static char *
+read_priority_hints (libcrun_container_t *container)
+{
+  libcrun_error_t tmp_err = NULL;
+  char *content = NULL;
+  const char *path;
+  int ret;
+
+  if (container == NULL)
+    return NULL;
+
+  path = find_annotation (container, SECCOMP_PRIORITY_HINTS_ANNOTATION);
+  if (path == NULL)
+    return NULL;
+
+  ret = read_all_file (path, &content, NULL, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      /* The hints only affect the filter layout, a missing file is not a
+         reason to fail the container.  */
+      libcrun_warning ("cannot read seccomp priority hints `%s`", path);
+      crun_error_release (&tmp_err);
+      free (content);
+      return NULL;
+    }
+
+  return content;
+}
+
 static int
-calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, unsigned int seccomp_gen_options, seccomp_checksum_t out, libcrun_error_t *err)
+calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, unsigned int seccomp_gen_options, const char *priority_hints, bool portable, seccomp_checksum_t out, libcrun_error_t *err)
 {
 #if HAVE_GCRYPT
   static atomic_bool initialized = false;
@@ -400,6 +440,15 @@ calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, u
       initialized = true;
     }
 
+#  ifdef HAVE_SECCOMP
+  if (! portable)
+    {
+      ret = libcrun_load_libseccomp (err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+#  endif
+
 #  define PROCESS_STRING(X)                      \
     do                                           \
       {                                          \
@@ -418,26 +467,33 @@ calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, u
   if (gcrypt_err)
     return crun_make_error (err, EINVAL, "internal libgcrypt error: %s", gcry_strerror (gcrypt_err));
 
-  PROCESS_STRING (PACKAGE_VERSION);
+  if (! portable)
+    {
+      PROCESS_STRING (PACKAGE_VERSION);
 
 #  ifdef HAVE_SECCOMP
-  {
-    const struct scmp_version *version = seccomp_version ();
+      {
+        const struct scmp_version *version = seccomp_version ();
 
-    PROCESS_DATA (version->major);
-    PROCESS_DATA (version->minor);
-    PROCESS_DATA (version->micro);
-  }
+        PROCESS_DATA (version->major);
+        PROCESS_DATA (version->minor);
+        PROCESS_DATA (version->micro);
+      }
 #  endif
 
-  memset (&utsbuf, 0, sizeof (utsbuf));
-  ret = uname (&utsbuf);
-  if (UNLIKELY (ret != 0))
-    return crun_make_error (err, errno, "uname");
+      memset (&utsbuf, 0, sizeof (utsbuf));
+      ret = uname (&utsbuf);
+      if (UNLIKELY (ret != 0))
+        return crun_make_error (err, errno, "uname");
+
+      PROCESS_STRING (utsbuf.release);
+      PROCESS_STRING (utsbuf.version);
+      PROCESS_STRING (utsbuf.machine);
 
-  PROCESS_STRING (utsbuf.release);
-  PROCESS_STRING (utsbuf.version);
-  PROCESS_STRING (utsbuf.machine);
+      /* The hints change the layout of the generated filter, so programs
+         compiled with different hints must not share a cache entry.  */
+      PROCESS_STRING (priority_hints);
+    }
 
   PROCESS_DATA (seccomp_gen_options);
 
@@ -479,6 +535,8 @@ calculate_seccomp_checksum (runtime_spec_schema_config_linux_seccomp *seccomp, u
 #else
   (void) seccomp;
   (void) seccomp_gen_options;
+  (void) priority_hints;
+  (void) portable;
   (void) out;
   (void) err;
   out[0] = 0;
@@ -503,6 +561,17 @@ open_rundir_dirfd (const char *state_root, libcrun_error_t *err)
   return dirfd;
 }
 
+/* The compiled BPF cache is shared across all state roots: compiling the same
+   profile is by far the most expensive part of create, so pay it once per
+   profile per boot instead of once per container.  Readers go through
+   open-by-checksum and writers insert with a hard link, so no locking is
+   needed.  */
+static int
+open_seccomp_cache_dirfd (libcrun_error_t *err)
+{
+  return open_rundir_dirfd (NULL, err);
+}
+
 struct cache_entry
 {
   seccomp_checksum_t checksum;
@@ -609,6 +678,7 @@ store_seccomp_cache (struct libcrun_seccomp_gen_ctx_s *ctx, libcrun_error_t *err
   libcrun_container_t *container = ctx->container;
   cleanup_free char *src_path = NULL;
   cleanup_free char *dest_path = NULL;
+  cleanup_close int cache_dirfd = -1;
   cleanup_close int dirfd = -1;
   int ret;
 
@@ -622,6 +692,10 @@ store_seccomp_cache (struct libcrun_seccomp_gen_ctx_s *ctx, libcrun_error_t *err
   if (UNLIKELY (dirfd < 0))
     return dirfd;
 
+  cache_dirfd = open_seccomp_cache_dirfd (err);
+  if (UNLIKELY (cache_dirfd < 0))
+    return cache_dirfd;
+
   /* relative path to dirfd.  */
   ret = append_paths (&src_path, err, container->context->id, "seccomp.bpf", NULL);
   if (UNLIKELY (ret < 0))
@@ -631,15 +705,46 @@ store_seccomp_cache (struct libcrun_seccomp_gen_ctx_s *ctx, libcrun_error_t *err
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = crun_ensure_directory_at (dirfd, SECCOMP_CACHE_DIR, 0700, true, err);
+  ret = crun_ensure_directory_at (cache_dirfd, SECCOMP_CACHE_DIR, 0700, true, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = evict_cache (dirfd, err);
+  ret = evict_cache (cache_dirfd, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = linkat (dirfd, src_path, dirfd, dest_path, 0);
+  ret = linkat (dirfd, src_path, cache_dirfd, dest_path, 0);
+  if (ret < 0 && errno == EXDEV)
+    {
+      /* A custom state root on a different file system.  Insert a copy with an
+         atomic rename so that concurrent readers never see a partial entry.  */
+      cleanup_free char *tmp_path = NULL;
+      cleanup_free char *buffer = NULL;
+      cleanup_close int srcfd = -1;
+      size_t len;
+
+      srcfd = TEMP_FAILURE_RETRY (openat (dirfd, src_path, O_CLOEXEC | O_RDONLY));
+      if (UNLIKELY (srcfd < 0))
+        return crun_make_error (err, errno, "open `%s`", src_path);
+
+      ret = read_all_fd (srcfd, src_path, &buffer, &len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      xasprintf (&tmp_path, "%s/.tmp-%d", SECCOMP_CACHE_DIR, getpid ());
+
+      ret = write_file_at_with_flags (cache_dirfd, O_CREAT | O_TRUNC, 0600, tmp_path, buffer, len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = renameat (cache_dirfd, tmp_path, cache_dirfd, dest_path);
+      if (UNLIKELY (ret < 0))
+        {
+          unlinkat (cache_dirfd, tmp_path, 0);
+          return crun_make_error (err, errno, "rename `%s` to `%s`", tmp_path, dest_path);
+        }
+      return 0;
+    }
   if (UNLIKELY (ret < 0 && errno != EEXIST))
     return crun_make_error (err, errno, "link `%s` to `%s`", src_path, dest_path);
   return 0;
@@ -660,6 +765,8 @@ find_in_cache (struct libcrun_seccomp_gen_ctx_s *ctx, int dirfd, const char *des
 {
   runtime_spec_schema_config_linux_seccomp *seccomp;
   cleanup_free char *cache_file_path = NULL;
+  cleanup_free char *priority_hints = NULL;
+  cleanup_close int cache_dirfd = -1;
   int ret;
 
   if (ctx->options & LIBCRUN_SECCOMP_SKIP_CACHE)
@@ -669,8 +776,10 @@ find_in_cache (struct libcrun_seccomp_gen_ctx_s *ctx, int dirfd, const char *des
   if (seccomp == NULL)
     return 0;
 
+  priority_hints = read_priority_hints (ctx->container);
+
   /* if the checksum could not be computed, returns early.  */
-  ret = calculate_seccomp_checksum (seccomp, ctx->options, ctx->checksum, err);
+  ret = calculate_seccomp_checksum (seccomp, ctx->options, priority_hints, false, ctx->checksum, err);
   if (UNLIKELY (ret <= 0))
     return ret;
 
@@ -678,7 +787,38 @@ find_in_cache (struct libcrun_seccomp_gen_ctx_s *ctx, int dirfd, const char *des
   if (UNLIKELY (ret < 0))
     return ret;
 
-  ret = TEMP_FAILURE_RETRY (linkat (dirfd, cache_file_path, dirfd, dest_path, 0));
+  cache_dirfd = open_seccomp_cache_dirfd (err);
+  if (UNLIKELY (cache_dirfd < 0))
+    return cache_dirfd;
+
+  ret = TEMP_FAILURE_RETRY (linkat (cache_dirfd, cache_file_path, dirfd, dest_path, 0));
+  if (ret < 0 && errno == EXDEV)
+    {
+      /* A custom state root on a different file system.  Copy the cached
+         program instead of linking it.  */
+      cleanup_free char *buffer = NULL;
+      cleanup_close int srcfd = -1;
+      size_t len;
+
+      srcfd = TEMP_FAILURE_RETRY (openat (cache_dirfd, cache_file_path, O_CLOEXEC | O_RDONLY));
+      if (UNLIKELY (srcfd < 0))
+        {
+          if (errno == ENOENT)
+            return 0;
+          return crun_make_error (err, errno, "open `%s`", cache_file_path);
+        }
+
+      ret = read_all_fd (srcfd, cache_file_path, &buffer, &len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      ret = write_file_at_with_flags (dirfd, O_CREAT | O_TRUNC, 0600, dest_path, buffer, len, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      *created = true;
+      return 0;
+    }
   if (UNLIKELY (ret < 0 && errno != ENOENT))
     return crun_make_error (err, errno, "linkat `%s` to `%s`", cache_file_path, dest_path);
 
@@ -687,6 +827,72 @@ find_in_cache (struct libcrun_seccomp_gen_ctx_s *ctx, int dirfd, const char *des
   return 0;
 }
 
+#ifdef HAVE_SECCOMP
+/* Copy a program precompiled at build time when one matches the profile.
+   Returns 1 when the program was written, 0 when there is no match and the
+   profile must be compiled, < 0 on errors.  */
+static int
+write_embedded_seccomp_profile (struct libcrun_seccomp_gen_ctx_s *gen_ctx, runtime_spec_schema_config_linux_seccomp *seccomp, libcrun_error_t *err)
+{
+  const struct embedded_seccomp_profile_s *e;
+  seccomp_checksum_t checksum;
+  int ret;
+
+  if (embedded_seccomp_profiles[0].checksum == NULL || gen_ctx->fd < 0)
+    return 0;
+
+  /* The embedded programs were compiled without any layout hints, compile
+     the profile when the user asked for a specific ordering.  */
+  {
+    cleanup_free char *priority_hints = read_priority_hints (gen_ctx->container);
+
+    if (priority_hints != NULL)
+      return 0;
+  }
+
+  ret = calculate_seccomp_checksum (seccomp, gen_ctx->options, NULL, true, checksum, err);
+  if (UNLIKELY (ret <= 0))
+    return ret;
+
+  for (e = embedded_seccomp_profiles; e->checksum; e++)
+    {
+      if (strcmp (e->checksum, checksum))
+        continue;
+
+      ret = safe_write (gen_ctx->fd, e->bpf, e->len);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "write seccomp.bpf");
+
+      /* Seed the run-directory cache so the next containers take the usual
+         cached path.  */
+      ret = store_seccomp_cache (gen_ctx, err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      return 1;
+    }
+
+  return 0;
+}
+#endif
+
+int
+libcrun_seccomp_compute_portable_checksum (libcrun_container_t *container, unsigned int options, seccomp_checksum_t out, libcrun_error_t *err)
+{
+  runtime_spec_schema_config_linux_seccomp *seccomp;
+
+  out[0] = '\0';
+
+  if (container == NULL || container->container_def == NULL || container->container_def->linux == NULL)
+    return 0;
+
+  seccomp = container->container_def->linux->seccomp;
+  if (seccomp == NULL)
+    return 0;
+
+  return calculate_seccomp_checksum (seccomp, options, NULL, true, out, err);
+}
+
 int
 libcrun_generate_seccomp (struct libcrun_seccomp_gen_ctx_s *gen_ctx, libcrun_error_t *err)
 {
@@ -696,6 +902,7 @@ libcrun_generate_seccomp (struct libcrun_seccomp_gen_ctx_s *gen_ctx, libcrun_err
   size_t i;
   cleanup_seccomp scmp_filter_ctx ctx = NULL;
   int action, default_action, default_errno_value = EPERM;
+  bool native_arch_configured = false;
   const char *def_action = NULL;
 
   /* The bpf filter was loaded from the cache, nothing to do here.  */
@@ -709,6 +916,17 @@ libcrun_generate_seccomp (struct libcrun_seccomp_gen_ctx_s *gen_ctx, libcrun_err
   if (seccomp == NULL)
     return 0;
 
+  /* A program precompiled into the binary covers the well-known default
+     profile without ever loading libseccomp, notably for the first
+     container after boot when the run-directory cache is still cold.  */
+  ret = write_embedded_seccomp_profile (gen_ctx, seccomp, err);
+  if (ret != 0)
+    return ret < 0 ? ret : 0;
+
+  ret = libcrun_load_libseccomp (err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
   /* seccomp not available.  */
   if (prctl (PR_GET_SECCOMP, 0, 0, 0, 0) < 0)
     return crun_make_error (err, errno, "prctl");
@@ -750,14 +968,29 @@ libcrun_generate_seccomp (struct libcrun_seccomp_gen_ctx_s *gen_ctx, libcrun_err
       arch_token = seccomp_arch_resolve_name (lowercase_arch);
       if (arch_token == 0)
         return crun_make_error (err, 0, "seccomp unknown architecture `%s`", arch);
+
+      if (arch_token == seccomp_arch_native ())
+        native_arch_configured = true;
 #  else
       arch_token = SCMP_ARCH_NATIVE;
+      native_arch_configured = true;
 #  endif
       ret = seccomp_arch_add (ctx, arch_token);
       if (ret < 0 && ret != -EEXIST)
         return crun_make_error (err, -ret, "seccomp adding architecture");
     }
 
+  /* seccomp_init puts the native architecture in the filter on its own.
+     When the profile enumerates its architectures and the native one is not
+     among them, drop it so the generated program does not carry rule chains
+     for an architecture the profile does not cover.  */
+  if (seccomp->architectures_len > 0 && ! native_arch_configured)
+    {
+      ret = seccomp_arch_remove (ctx, SCMP_ARCH_NATIVE);
+      if (ret < 0 && ret != -EEXIST)
+        return crun_make_error (err, -ret, "seccomp removing native architecture");
+    }
+
   for (i = 0; i < seccomp->syscalls_len; i++)
     {
       size_t j;
@@ -852,6 +1085,48 @@ libcrun_generate_seccomp (struct libcrun_seccomp_gen_ctx_s *gen_ctx, libcrun_err
         }
     }
 
+  {
+    cleanup_free char *priority_hints = read_priority_hints (gen_ctx->container);
+
+    if (priority_hints != NULL)
+      {
+        char *saveptr = NULL;
+        char *line;
+        int prio = 255;
+
+        for (line = strtok_r (priority_hints, "\n", &saveptr); line; line = strtok_r (NULL, "\n", &saveptr))
+          {
+            int syscall;
+
+            while (*line == ' ' || *line == '\t')
+              line++;
+            if (*line == '\0' || *line == '#')
+              continue;
+            line[strcspn (line, " \t\r")] = '\0';
+
+            syscall = seccomp_syscall_resolve_name (line);
+            if (syscall == __NR_SCMP_ERROR)
+              continue;
+
+            /* The priority only affects where the syscall lands in the
+               generated program, ignore failures.  */
+            (void) seccomp_syscall_priority (ctx, syscall, (uint8_t) prio);
+            if (prio > 1)
+              prio--;
+          }
+      }
+#  ifdef HAVE_SCMP_FLTATR_CTL_OPTIMIZE
+    else
+      {
+        /* Without a profile of the hot syscalls, have libseccomp emit a
+           binary search over the syscall numbers instead of the default
+           sequential scan.  Older libseccomp rejects the attribute, keep
+           the sequential layout there.  */
+        (void) seccomp_attr_set (ctx, SCMP_FLTATR_CTL_OPTIMIZE, 2);
+      }
+#  endif
+  }
+
   if (gen_ctx->fd >= 0)
     {
       ret = seccomp_export_bpf (ctx, gen_ctx->fd);
@@ -56,6 +56,11 @@ libcrun_seccomp_gen_ctx_init (struct libcrun_seccomp_gen_ctx_s *ctx, libcrun_con
 }
 
 int libcrun_generate_seccomp (struct libcrun_seccomp_gen_ctx_s *gen_ctx, libcrun_error_t *err);
+/* Checksum over the profile content and generation options only, with no
+   host specific input: the key for programs precompiled at build time.
+   Returns 1 and fills OUT on success, 0 when there is no profile or no
+   checksum support.  */
+int libcrun_seccomp_compute_portable_checksum (libcrun_container_t *container, unsigned int options, seccomp_checksum_t out, libcrun_error_t *err);
 int libcrun_copy_seccomp (struct libcrun_seccomp_gen_ctx_s *gen_ctx, const char *b64_bpf, libcrun_error_t *err);
 int libcrun_apply_seccomp (int infd, int listener_receiver_fd, const char *receiver_fd_payload,
                            size_t receiver_fd_payload_len, char **flags, size_t flags_len, libcrun_error_t *err);
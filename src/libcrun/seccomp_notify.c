@@ -21,6 +21,7 @@
 #if HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
 #  include <seccomp.h>
 #  include <sys/ioctl.h>
+#  include <sys/epoll.h>
 #  include <linux/seccomp.h>
 #  include <sys/sysmacros.h>
 #endif
@@ -157,32 +158,41 @@ libcrun_load_seccomp_notify_plugins (struct seccomp_notify_context_s **out, cons
 #endif
 }
 
-LIBCRUN_PUBLIC int
-libcrun_seccomp_notify_plugins (struct seccomp_notify_context_s *ctx, int seccomp_fd, libcrun_error_t *err)
-{
 #if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+/* Receive and handle a single request from SECCOMP_FD using the provided
+   buffers.  PROCESSED reports whether a request was actually read, so that
+   callers can drain the fd until it is empty.  */
+static int
+seccomp_notify_plugins_handle_one (struct seccomp_notify_context_s *ctx, struct seccomp_notif_sizes *sizes,
+                                   struct seccomp_notif *sreq, struct seccomp_notif_resp *sresp, int seccomp_fd,
+                                   bool *processed, libcrun_error_t *err)
+{
   size_t i;
   int ret;
 
-  memset (ctx->sreq, 0, ctx->sizes.seccomp_notif);
-  memset (ctx->sresp, 0, ctx->sizes.seccomp_notif_resp);
+  *processed = false;
 
-  ret = ioctl (seccomp_fd, SECCOMP_IOCTL_NOTIF_RECV, ctx->sreq);
+  memset (sreq, 0, sizes->seccomp_notif);
+  memset (sresp, 0, sizes->seccomp_notif_resp);
+
+  ret = ioctl (seccomp_fd, SECCOMP_IOCTL_NOTIF_RECV, sreq);
   if (UNLIKELY (ret < 0))
     {
-      if (errno == ENOENT)
+      /* EAGAIN means a non-blocking fd has no request pending.  */
+      if (errno == ENOENT || errno == EAGAIN)
         return 0;
       return crun_make_error (err, errno, "ioctl");
     }
 
+  *processed = true;
+
   for (i = 0; i < ctx->n_plugins; i++)
     {
       if (ctx->plugins[i].handle_request_cb)
         {
           int handled = 0;
-          int ret;
 
-          ret = ctx->plugins[i].handle_request_cb (ctx->plugins[i].opaque, &ctx->sizes, ctx->sreq, ctx->sresp,
+          ret = ctx->plugins[i].handle_request_cb (ctx->plugins[i].opaque, sizes, sreq, sresp,
                                                    seccomp_fd, &handled);
           if (UNLIKELY (ret != 0))
             return crun_make_error (err, -ret, "error handling seccomp notify request");
@@ -200,7 +210,7 @@ libcrun_seccomp_notify_plugins (struct seccomp_notify_context_s *ctx, int seccom
               return 0;
 
             case RUN_OCI_SECCOMP_NOTIFY_HANDLE_SEND_RESPONSE_AND_CONTINUE:
-              ctx->sresp->flags |= SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+              sresp->flags |= SECCOMP_USER_NOTIF_FLAG_CONTINUE;
               goto send_resp;
 
             default:
@@ -210,12 +220,12 @@ libcrun_seccomp_notify_plugins (struct seccomp_notify_context_s *ctx, int seccom
     }
 
   /* No plugin could handle the request.  */
-  ctx->sresp->error = -ENOTSUP;
-  ctx->sresp->flags = 0;
+  sresp->error = -ENOTSUP;
+  sresp->flags = 0;
 
 send_resp:
-  ctx->sresp->id = ctx->sreq->id;
-  ret = ioctl (seccomp_fd, SECCOMP_IOCTL_NOTIF_SEND, ctx->sresp);
+  sresp->id = sreq->id;
+  ret = ioctl (seccomp_fd, SECCOMP_IOCTL_NOTIF_SEND, sresp);
   if (UNLIKELY (ret < 0))
     {
       if (errno == ENOENT)
@@ -223,6 +233,16 @@ send_resp:
       return crun_make_error (err, errno, "ioctl");
     }
   return 0;
+}
+#endif
+
+LIBCRUN_PUBLIC int
+libcrun_seccomp_notify_plugins (struct seccomp_notify_context_s *ctx, int seccomp_fd, libcrun_error_t *err)
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  bool processed;
+
+  return seccomp_notify_plugins_handle_one (ctx, &ctx->sizes, ctx->sreq, ctx->sresp, seccomp_fd, &processed, err);
 #else
   (void) ctx;
   (void) seccomp_fd;
@@ -263,3 +283,234 @@ libcrun_free_seccomp_notify_plugins (struct seccomp_notify_context_s *ctx, libcr
   return crun_make_error (err, ENOTSUP, "seccomp notify support not available");
 #endif
 }
+
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+struct seccomp_notify_mux_entry_s
+{
+  int fd;
+  struct seccomp_notify_context_s *ctx;
+};
+#endif
+
+struct seccomp_notify_mux_s
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  int epollfd;
+  struct seccomp_notify_mux_entry_s *entries;
+  size_t n_entries;
+  size_t entries_cap;
+
+  /* Buffers shared by every registered container: the loop handles one
+     request at a time, so a single allocation sized by the kernel reported
+     sizes serves all of the listener fds.  */
+  struct seccomp_notif_sizes sizes;
+  struct seccomp_notif *sreq;
+  struct seccomp_notif_resp *sresp;
+#else
+  int unused;
+#endif
+};
+
+void
+cleanup_seccomp_notify_muxp (void *p)
+{
+  struct seccomp_notify_mux_s **pp = p;
+  if (*pp)
+    {
+      libcrun_error_t tmp_err = NULL;
+      libcrun_free_seccomp_notify_mux (*pp, &tmp_err);
+      crun_error_release (&tmp_err);
+      *pp = NULL;
+    }
+}
+
+LIBCRUN_PUBLIC int
+libcrun_seccomp_notify_mux_create (struct seccomp_notify_mux_s **out, libcrun_error_t *err)
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  cleanup_free struct seccomp_notify_mux_s *mux = xmalloc0 (sizeof *mux);
+
+  if (seccomp_syscall (SECCOMP_GET_NOTIF_SIZES, 0, &mux->sizes) < 0)
+    return crun_make_error (err, errno, "seccomp GET_NOTIF_SIZES");
+
+  mux->epollfd = epoll_create1 (EPOLL_CLOEXEC);
+  if (UNLIKELY (mux->epollfd < 0))
+    return crun_make_error (err, errno, "epoll_create1");
+
+  mux->sreq = xmalloc (mux->sizes.seccomp_notif);
+  mux->sresp = xmalloc (mux->sizes.seccomp_notif_resp);
+
+  *out = mux;
+  mux = NULL;
+  return 0;
+#else
+  (void) out;
+  (void) err;
+  return crun_make_error (err, ENOTSUP, "seccomp notify support not available");
+#endif
+}
+
+LIBCRUN_PUBLIC int
+libcrun_seccomp_notify_mux_add (struct seccomp_notify_mux_s *mux, struct seccomp_notify_context_s *ctx,
+                                int seccomp_fd, libcrun_error_t *err)
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  struct seccomp_notify_mux_entry_s *entry;
+  struct epoll_event ev = {};
+  int ret;
+
+  if (mux->n_entries == mux->entries_cap)
+    {
+      mux->entries_cap = mux->entries_cap ? mux->entries_cap * 2 : 16;
+      mux->entries = xrealloc (mux->entries, sizeof (*mux->entries) * mux->entries_cap);
+    }
+
+  entry = &mux->entries[mux->n_entries];
+  entry->fd = seccomp_fd;
+  entry->ctx = ctx;
+
+  /* The process loop drains each fd until empty: without O_NONBLOCK the
+     second RECV would block the whole multiplexer.  */
+  ret = fcntl (seccomp_fd, F_GETFL, 0);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "fcntl seccomp fd");
+  ret = fcntl (seccomp_fd, F_SETFL, ret | O_NONBLOCK);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "fcntl seccomp fd");
+
+  ev.events = EPOLLIN;
+  ev.data.fd = seccomp_fd;
+  ret = epoll_ctl (mux->epollfd, EPOLL_CTL_ADD, seccomp_fd, &ev);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "epoll_ctl add seccomp fd");
+
+  mux->n_entries++;
+  return 0;
+#else
+  (void) mux;
+  (void) ctx;
+  (void) seccomp_fd;
+  (void) err;
+  return crun_make_error (err, ENOTSUP, "seccomp notify support not available");
+#endif
+}
+
+LIBCRUN_PUBLIC int
+libcrun_seccomp_notify_mux_remove (struct seccomp_notify_mux_s *mux, int seccomp_fd, libcrun_error_t *err)
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  size_t i;
+
+  for (i = 0; i < mux->n_entries; i++)
+    if (mux->entries[i].fd == seccomp_fd)
+      {
+        (void) epoll_ctl (mux->epollfd, EPOLL_CTL_DEL, seccomp_fd, NULL);
+        memmove (&mux->entries[i], &mux->entries[i + 1], sizeof (*mux->entries) * (mux->n_entries - i - 1));
+        mux->n_entries--;
+        return 0;
+      }
+
+  return crun_make_error (err, ENOENT, "seccomp fd not registered");
+#else
+  (void) mux;
+  (void) seccomp_fd;
+  (void) err;
+  return crun_make_error (err, ENOTSUP, "seccomp notify support not available");
+#endif
+}
+
+LIBCRUN_PUBLIC int
+libcrun_seccomp_notify_mux_get_fd (struct seccomp_notify_mux_s *mux)
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  return mux->epollfd;
+#else
+  (void) mux;
+  return -1;
+#endif
+}
+
+LIBCRUN_PUBLIC int
+libcrun_seccomp_notify_mux_process (struct seccomp_notify_mux_s *mux, int timeout, libcrun_error_t *err)
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  struct epoll_event events[16];
+  int handled = 0;
+  int nr_events;
+  int i, ret;
+
+  nr_events = TEMP_FAILURE_RETRY (epoll_wait (mux->epollfd, events, 16, timeout));
+  if (UNLIKELY (nr_events < 0))
+    return crun_make_error (err, errno, "epoll_wait");
+
+  for (i = 0; i < nr_events; i++)
+    {
+      struct seccomp_notify_mux_entry_s *entry = NULL;
+      bool processed;
+      size_t j;
+
+      /* Events carry the fd, not a pointer into the entries array, since the
+         array is compacted on removal.  */
+      for (j = 0; j < mux->n_entries; j++)
+        if (mux->entries[j].fd == events[i].data.fd)
+          {
+            entry = &mux->entries[j];
+            break;
+          }
+      if (entry == NULL)
+        continue;
+
+      if (events[i].events & (EPOLLHUP | EPOLLERR))
+        {
+          /* The container is gone, drop the listener.  */
+          libcrun_error_t tmp_err = NULL;
+
+          if (libcrun_seccomp_notify_mux_remove (mux, entry->fd, &tmp_err) < 0)
+            crun_error_release (&tmp_err);
+          continue;
+        }
+
+      /* Drain the fd completely so that a burst of notifications costs a
+         single epoll wakeup.  */
+      do
+        {
+          ret = seccomp_notify_plugins_handle_one (entry->ctx, &mux->sizes, mux->sreq, mux->sresp,
+                                                   entry->fd, &processed, err);
+          if (UNLIKELY (ret < 0))
+            return ret;
+          if (processed)
+            handled++;
+        }
+      while (processed);
+    }
+
+  return handled;
+#else
+  (void) mux;
+  (void) timeout;
+  (void) err;
+  return crun_make_error (err, ENOTSUP, "seccomp notify support not available");
+#endif
+}
+
+LIBCRUN_PUBLIC int
+libcrun_free_seccomp_notify_mux (struct seccomp_notify_mux_s *mux, libcrun_error_t *err)
+{
+#if HAVE_DLOPEN && HAVE_SECCOMP_GET_NOTIF_SIZES && HAVE_SECCOMP
+  if (mux == NULL)
+    return crun_make_error (err, EINVAL, "invalid seccomp notify mux");
+
+  if (mux->epollfd >= 0)
+    TEMP_FAILURE_RETRY (close (mux->epollfd));
+  free (mux->entries);
+  free (mux->sreq);
+  free (mux->sresp);
+  free (mux);
+
+  return 0;
+#else
+  (void) mux;
+  (void) err;
+  return crun_make_error (err, ENOTSUP, "seccomp notify support not available");
+#endif
+}
@@ -38,4 +38,29 @@ LIBCRUN_PUBLIC int libcrun_free_seccomp_notify_plugins (struct seccomp_notify_co
 #define cleanup_seccomp_notify_context __attribute__ ((cleanup (cleanup_seccomp_notify_pluginsp)))
 void cleanup_seccomp_notify_pluginsp (void *p);
 
+/* Multiplexer for supervising many containers from a single loop.  Each
+   container keeps its own plugin context, but every listener fd is
+   registered on one epoll instance and all of them share a single pair of
+   request/response buffers; a ready fd is drained completely per wakeup.
+   libcrun_seccomp_notify_mux_get_fd returns the epoll fd so the mux can be
+   nested into the caller's own event loop, and mux_process performs one
+   epoll_wait with the given timeout and returns the number of requests that
+   were handled.  Listener fds whose container exited are dropped
+   automatically.  */
+struct seccomp_notify_mux_s;
+
+LIBCRUN_PUBLIC int libcrun_seccomp_notify_mux_create (struct seccomp_notify_mux_s **out, libcrun_error_t *err);
+LIBCRUN_PUBLIC int libcrun_seccomp_notify_mux_add (struct seccomp_notify_mux_s *mux,
+                                                   struct seccomp_notify_context_s *ctx, int seccomp_fd,
+                                                   libcrun_error_t *err);
+LIBCRUN_PUBLIC int libcrun_seccomp_notify_mux_remove (struct seccomp_notify_mux_s *mux, int seccomp_fd,
+                                                      libcrun_error_t *err);
+LIBCRUN_PUBLIC int libcrun_seccomp_notify_mux_get_fd (struct seccomp_notify_mux_s *mux);
+LIBCRUN_PUBLIC int libcrun_seccomp_notify_mux_process (struct seccomp_notify_mux_s *mux, int timeout,
+                                                       libcrun_error_t *err);
+LIBCRUN_PUBLIC int libcrun_free_seccomp_notify_mux (struct seccomp_notify_mux_s *mux, libcrun_error_t *err);
+
+#define cleanup_seccomp_notify_mux __attribute__ ((cleanup (cleanup_seccomp_notify_muxp)))
+void cleanup_seccomp_notify_muxp (void *p);
+
 #endif
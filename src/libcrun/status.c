@@ -28,9 +28,42 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <signal.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #define YAJL_STR(x) ((const unsigned char *) (x))
 
+static int
+syscall_pidfd_open (pid_t pid, unsigned int flags)
+{
+#if defined __NR_pidfd_open
+  return (int) syscall (__NR_pidfd_open, pid, flags);
+#else
+  (void) pid;
+  (void) flags;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+static int
+syscall_pidfd_getfd (int pidfd, int targetfd, unsigned int flags)
+{
+#if defined __NR_pidfd_getfd
+  return (int) syscall (__NR_pidfd_getfd, pidfd, targetfd, flags);
+#else
+  (void) pidfd;
+  (void) targetfd;
+  (void) flags;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
 struct pid_stat
 {
   char state;
@@ -104,6 +137,701 @@ get_state_directory_status_file (const char *state_root, const char *id)
   return path;
 }
 
+/* The state directory fd is kept open across state transitions so that a
+   process driving a container through created->running->stopped opens the
+   directory only once.  The cache is keyed by the directory path, so it
+   stays correct when the same process touches different containers.  */
+static int cached_state_dir_fd = -1;
+static char *cached_state_dir_path;
+
+static int
+get_state_directory_fd (const char *state_root, const char *id)
+{
+  cleanup_free char *dir = libcrun_get_state_directory (state_root, id);
+  int fd;
+
+  if (dir == NULL)
+    return -1;
+
+  if (cached_state_dir_path != NULL && strcmp (cached_state_dir_path, dir) == 0)
+    return cached_state_dir_fd;
+
+  fd = open (dir, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  if (cached_state_dir_fd >= 0)
+    close (cached_state_dir_fd);
+  free (cached_state_dir_path);
+  cached_state_dir_fd = fd;
+  cached_state_dir_path = dir;
+  dir = NULL;
+  return cached_state_dir_fd;
+}
+
+/* Drop the cached fd when the directory it refers to is deleted: in a
+   long-lived process a delete+recreate of the same id must not keep writing
+   into the unlinked directory.  */
+static void
+invalidate_state_directory_fd (const char *state_root, const char *id)
+{
+  cleanup_free char *dir = NULL;
+
+  if (cached_state_dir_path == NULL)
+    return;
+
+  dir = libcrun_get_state_directory (state_root, id);
+  if (dir == NULL || strcmp (cached_state_dir_path, dir) != 0)
+    return;
+
+  close_and_reset (&cached_state_dir_fd);
+  free (cached_state_dir_path);
+  cached_state_dir_path = NULL;
+}
+
+/* How many status writes can be batched between two fsyncs of the state
+   directory in relaxed-durability mode.  */
+#define STATUS_SYNC_BATCH 16
+
+/* Make the new directory entry durable.  With CRUN_STATUS_RELAXED_SYNC set
+   the fsync is batched across state transitions: on a journaled file system
+   the rename already orders the entry against the file data, so losing the
+   very last transitions on a crash only reverts to a state the container
+   really was in.  */
+static void
+sync_state_directory (int dirfd)
+{
+  static int pending_writes = 0;
+  const char *relaxed = getenv ("CRUN_STATUS_RELAXED_SYNC");
+
+  if (relaxed != NULL && relaxed[0] != '\0' && ++pending_writes < STATUS_SYNC_BATCH)
+    return;
+
+  pending_writes = 0;
+  fsync (dirfd);
+}
+
+/* Append-only index of the containers under the state root.  Every status
+   write appends an `A <pid> <created> <id>` record and every delete a
+   `D <id>` record, so enumerating the containers is one sequential read of a
+   single file instead of a directory walk with a stat for every entry.  The
+   index is best effort: it is removed on any write failure and rebuilt from
+   a full walk on the next status write, and readers fall back to the walk
+   whenever it is missing or malformed.  Writers (append, rebuild and
+   compaction) are serialized with flock on a separate lock file; readers do
+   not take the lock.  */
+/* The dot prefix keeps the index files out of the container walks.  */
+#define INDEX_FILENAME ".index"
+#define INDEX_LOCK_FILENAME ".index.lock"
+#define INDEX_COMPACT_THRESHOLD (16 * 1024)
+
+struct index_entry_s
+{
+  char *id;
+  char *created;
+  pid_t pid;
+  bool alive;
+};
+
+static char *
+get_run_directory_file (const char *state_root, const char *name)
+{
+  cleanup_free char *root = get_run_directory (state_root);
+  libcrun_error_t tmp_err = NULL;
+  char *path = NULL;
+  int ret;
+
+  ret = append_paths (&path, &tmp_err, root, name, NULL);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (&tmp_err);
+      return NULL;
+    }
+
+  return path;
+}
+
+static int
+open_index_lock (const char *state_root)
+{
+  cleanup_free char *lock_file = get_run_directory_file (state_root, INDEX_LOCK_FILENAME);
+  cleanup_close int fd = -1;
+  int ret;
+
+  if (lock_file == NULL)
+    return -1;
+
+  fd = open (lock_file, O_CREAT | O_WRONLY | O_CLOEXEC, 0700);
+  if (fd < 0)
+    return -1;
+
+  ret = TEMP_FAILURE_RETRY (flock (fd, LOCK_EX));
+  if (ret < 0)
+    return -1;
+
+  return get_and_reset (&fd);
+}
+
+static void
+free_index_entries (struct index_entry_s *entries, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      free (entries[i].id);
+      free (entries[i].created);
+    }
+  free (entries);
+}
+
+/* Parse the index CONTENT.  Returns 0 on success and -1 when the content is
+   malformed; a final line without the terminating newline is ignored, it can
+   be a concurrent append in flight.  */
+static int
+parse_index (char *content, struct index_entry_s **out, size_t *out_len)
+{
+  struct index_entry_s *entries = NULL;
+  size_t len = 0, allocated = 0;
+  char *line, *saveptr = NULL;
+  char *last_newline;
+
+  *out = NULL;
+  *out_len = 0;
+
+  last_newline = strrchr (content, '\n');
+  if (last_newline == NULL)
+    return content[0] == '\0' ? 0 : -1;
+  *(last_newline + 1) = '\0';
+
+  for (line = strtok_r (content, "\n", &saveptr); line; line = strtok_r (NULL, "\n", &saveptr))
+    {
+      char op = line[0];
+      const char *created = NULL;
+      const char *id;
+      pid_t pid = 0;
+      size_t i;
+
+      if ((op != 'A' && op != 'D') || line[1] != ' ')
+        goto malformed;
+
+      if (op == 'A')
+        {
+          char *endptr = NULL;
+          char *space;
+
+          errno = 0;
+          pid = strtol (line + 2, &endptr, 10);
+          if (errno != 0 || endptr == line + 2 || *endptr != ' ')
+            goto malformed;
+
+          created = endptr + 1;
+          space = strchr (created, ' ');
+          if (space == NULL || space == created)
+            goto malformed;
+          *space = '\0';
+          id = space + 1;
+        }
+      else
+        id = line + 2;
+
+      if (*id == '\0')
+        goto malformed;
+
+      for (i = 0; i < len; i++)
+        if (strcmp (entries[i].id, id) == 0)
+          break;
+
+      if (i == len)
+        {
+          if (len == allocated)
+            {
+              allocated = allocated ? allocated * 2 : 16;
+              entries = xrealloc (entries, sizeof (struct index_entry_s) * allocated);
+            }
+          entries[len].id = xstrdup (id);
+          entries[len].created = NULL;
+          len++;
+        }
+
+      entries[i].alive = op == 'A';
+      entries[i].pid = pid;
+      if (op == 'A')
+        {
+          free (entries[i].created);
+          entries[i].created = xstrdup (created);
+        }
+    }
+
+  *out = entries;
+  *out_len = len;
+  return 0;
+
+malformed:
+  free_index_entries (entries, len);
+  return -1;
+}
+
+/* Rebuild the index from a directory walk.  Must be called with the index
+   lock held.  */
+static void
+rebuild_index (const char *state_root)
+{
+  cleanup_free char *run_dir = get_run_directory (state_root);
+  cleanup_free char *index_file = get_run_directory_file (state_root, INDEX_FILENAME);
+  cleanup_free char *index_tmp = NULL;
+  cleanup_close int fd = -1;
+  cleanup_dir DIR *dir = NULL;
+  struct dirent *next;
+
+  if (run_dir == NULL || index_file == NULL)
+    return;
+
+  dir = opendir (run_dir);
+  if (dir == NULL)
+    return;
+
+  xasprintf (&index_tmp, "%s.tmp", index_file);
+  fd = open (index_tmp, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0700);
+  if (fd < 0)
+    return;
+
+  for (next = readdir (dir); next; next = readdir (dir))
+    {
+      libcrun_container_status_t status = {};
+      libcrun_error_t tmp_err = NULL;
+      cleanup_free char *line = NULL;
+      int ret;
+
+      if (next->d_name[0] == '.')
+        continue;
+
+      if (libcrun_read_container_status (&status, state_root, next->d_name, &tmp_err) < 0)
+        {
+          crun_error_release (&tmp_err);
+          continue;
+        }
+
+      xasprintf (&line, "A %d %s %s\n", status.pid, status.created ? status.created : "-", next->d_name);
+      ret = safe_write (fd, line, (ssize_t) strlen (line));
+      libcrun_free_container_status (&status);
+      if (ret < 0)
+        goto fail;
+    }
+
+  close_and_reset (&fd);
+  if (rename (index_tmp, index_file) < 0)
+    goto fail;
+
+  return;
+
+fail:
+  unlink (index_tmp);
+  unlink (index_file);
+}
+
+static void
+update_index_on_write (const char *state_root, const char *id, libcrun_container_status_t *status)
+{
+  cleanup_free char *index_file = get_run_directory_file (state_root, INDEX_FILENAME);
+  cleanup_free char *line = NULL;
+  cleanup_close int lock_fd = -1;
+  cleanup_close int fd = -1;
+
+  if (index_file == NULL)
+    return;
+
+  lock_fd = open_index_lock (state_root);
+  if (lock_fd < 0)
+    return;
+
+  fd = open (index_file, O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (fd < 0)
+    {
+      /* The status file is already in place, so the walk picks it up.  */
+      if (errno == ENOENT)
+        rebuild_index (state_root);
+      return;
+    }
+
+  xasprintf (&line, "A %d %s %s\n", status->pid, status->created ? status->created : "-", id);
+  if (safe_write (fd, line, (ssize_t) strlen (line)) < 0)
+    unlink (index_file);
+}
+
+static void
+update_index_on_delete (const char *state_root, const char *id)
+{
+  cleanup_free char *index_file = get_run_directory_file (state_root, INDEX_FILENAME);
+  cleanup_free char *line = NULL;
+  cleanup_close int lock_fd = -1;
+  cleanup_close int fd = -1;
+  struct stat st;
+
+  if (index_file == NULL)
+    return;
+
+  lock_fd = open_index_lock (state_root);
+  if (lock_fd < 0)
+    return;
+
+  fd = open (index_file, O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  xasprintf (&line, "D %s\n", id);
+  if (safe_write (fd, line, (ssize_t) strlen (line)) < 0)
+    {
+      unlink (index_file);
+      return;
+    }
+
+  /* Periodically drop the accumulated dead records.  */
+  if (fstat (fd, &st) == 0 && st.st_size > INDEX_COMPACT_THRESHOLD)
+    {
+      struct index_entry_s *entries = NULL;
+      cleanup_free char *content = NULL;
+      cleanup_free char *index_tmp = NULL;
+      libcrun_error_t tmp_err = NULL;
+      cleanup_close int tmp_fd = -1;
+      size_t i, len = 0;
+
+      if (read_all_file (index_file, &content, NULL, &tmp_err) < 0)
+        {
+          crun_error_release (&tmp_err);
+          return;
+        }
+
+      if (parse_index (content, &entries, &len) < 0)
+        {
+          unlink (index_file);
+          return;
+        }
+
+      xasprintf (&index_tmp, "%s.tmp", index_file);
+      tmp_fd = open (index_tmp, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0700);
+      if (tmp_fd < 0)
+        {
+          free_index_entries (entries, len);
+          return;
+        }
+
+      for (i = 0; i < len; i++)
+        {
+          cleanup_free char *entry_line = NULL;
+
+          if (! entries[i].alive)
+            continue;
+
+          xasprintf (&entry_line, "A %d %s %s\n", entries[i].pid,
+                     entries[i].created ? entries[i].created : "-", entries[i].id);
+          if (safe_write (tmp_fd, entry_line, (ssize_t) strlen (entry_line)) < 0)
+            {
+              free_index_entries (entries, len);
+              unlink (index_tmp);
+              unlink (index_file);
+              return;
+            }
+        }
+      free_index_entries (entries, len);
+
+      close_and_reset (&tmp_fd);
+      if (rename (index_tmp, index_file) < 0)
+        {
+          unlink (index_tmp);
+          unlink (index_file);
+        }
+    }
+}
+
+/* Returns 1 when the list was produced from the index, 0 when the caller
+   must fall back to the directory walk.  */
+static int
+get_containers_list_from_index (libcrun_container_list_t **list_out, const char *state_root)
+{
+  cleanup_free char *index_file = get_run_directory_file (state_root, INDEX_FILENAME);
+  cleanup_container_list libcrun_container_list_t *tmp = NULL;
+  cleanup_free char *run_dir = get_run_directory (state_root);
+  struct index_entry_s *entries = NULL;
+  cleanup_free char *content = NULL;
+  libcrun_error_t tmp_err = NULL;
+  cleanup_close int run_dirfd = -1;
+  bool stale = false;
+  size_t i, len = 0;
+
+  if (index_file == NULL || run_dir == NULL)
+    return 0;
+
+  run_dirfd = open (run_dir, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+  if (run_dirfd < 0)
+    return 0;
+
+  if (read_all_file (index_file, &content, NULL, &tmp_err) < 0)
+    {
+      crun_error_release (&tmp_err);
+      return 0;
+    }
+
+  if (parse_index (content, &entries, &len) < 0)
+    return 0;
+
+  for (i = 0; i < len; i++)
+    {
+      libcrun_container_list_t *next_container;
+
+      if (! entries[i].alive)
+        continue;
+
+      /* The directory walk this index replaces inherently listed only
+         containers that still exist: a crash between removing the state
+         directory and appending the delete record must not leave a
+         permanent ghost, so check every entry against the filesystem.  */
+      if (faccessat (run_dirfd, entries[i].id, F_OK, 0) < 0)
+        {
+          stale = true;
+          continue;
+        }
+
+      next_container = xmalloc (sizeof (libcrun_container_list_t));
+      next_container->name = xstrdup (entries[i].id);
+      next_container->next = tmp;
+      tmp = next_container;
+    }
+  free_index_entries (entries, len);
+
+  /* Writers only append, so a ghost entry would stay forever: rebuild.  */
+  if (stale)
+    {
+      cleanup_close int lock_fd = open_index_lock (state_root);
+
+      if (lock_fd >= 0)
+        rebuild_index (state_root);
+    }
+
+  *list_out = tmp;
+  tmp = NULL;
+  return 1;
+}
+
+/* Compact binary mirror of the status file.  It is written atomically next
+   to the JSON status on every state transition and read with a single mmap,
+   so hot paths like `list` and `kill` skip the JSON parser entirely.  The
+   JSON file stays authoritative: any inconsistency, unknown version or
+   older mtime makes readers silently fall back to it.  */
+#define STATUS_BIN_FILENAME "status.bin"
+#define STATUS_BIN_MAGIC 0x54535243 /* "CRST" */
+#define STATUS_BIN_VERSION 1
+
+enum
+{
+  STATUS_BIN_STR_BUNDLE = 0,
+  STATUS_BIN_STR_ROOTFS,
+  STATUS_BIN_STR_CGROUP_PATH,
+  STATUS_BIN_STR_SCOPE,
+  STATUS_BIN_STR_INTELRDT,
+  STATUS_BIN_STR_CREATED,
+  STATUS_BIN_STR_EXTERNAL_DESCRIPTORS,
+  STATUS_BIN_STR_OWNER,
+
+  STATUS_BIN_STR_MAX,
+};
+
+struct status_bin_string_s
+{
+  /* Offset from the beginning of the file, 0 when the string is not set.
+     The string is stored NUL terminated; LEN does not include the NUL.  */
+  uint32_t offset;
+  uint32_t len;
+};
+
+struct status_bin_header_s
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t total_size;
+  int32_t pid;
+  int32_t systemd_cgroup;
+  int32_t detached;
+  uint64_t process_start_time;
+  struct status_bin_string_s strings[STATUS_BIN_STR_MAX];
+};
+
+static char *
+get_state_directory_status_bin_file (const char *state_root, const char *id)
+{
+  cleanup_free char *root = get_run_directory (state_root);
+  libcrun_error_t *err = NULL;
+  char *path = NULL;
+  int ret;
+
+  ret = append_paths (&path, err, root, id, STATUS_BIN_FILENAME, NULL);
+  if (UNLIKELY (ret < 0))
+    {
+      crun_error_release (err);
+      return NULL;
+    }
+
+  return path;
+}
+
+/* Best effort: failures only mean readers take the JSON path.  */
+static void
+write_container_status_bin (const char *state_root, const char *id, libcrun_container_status_t *status)
+{
+  cleanup_free char *file = get_state_directory_status_bin_file (state_root, id);
+  cleanup_free char *file_tmp = NULL;
+  cleanup_free char *buffer = NULL;
+  cleanup_close int fd = -1;
+  struct status_bin_header_s *header;
+  const char *strings[STATUS_BIN_STR_MAX];
+  size_t total_size = sizeof (struct status_bin_header_s);
+  size_t offset;
+  size_t i;
+
+  if (file == NULL)
+    return;
+
+  strings[STATUS_BIN_STR_BUNDLE] = status->bundle;
+  strings[STATUS_BIN_STR_ROOTFS] = status->rootfs;
+  strings[STATUS_BIN_STR_CGROUP_PATH] = status->cgroup_path ? status->cgroup_path : "";
+  strings[STATUS_BIN_STR_SCOPE] = status->scope ? status->scope : "";
+  strings[STATUS_BIN_STR_INTELRDT] = status->intelrdt ? status->intelrdt : "";
+  strings[STATUS_BIN_STR_CREATED] = status->created;
+  strings[STATUS_BIN_STR_EXTERNAL_DESCRIPTORS] = status->external_descriptors;
+  strings[STATUS_BIN_STR_OWNER] = status->owner;
+
+  for (i = 0; i < STATUS_BIN_STR_MAX; i++)
+    if (strings[i])
+      total_size += strlen (strings[i]) + 1;
+
+  buffer = xmalloc0 (total_size);
+  header = (struct status_bin_header_s *) buffer;
+  header->magic = STATUS_BIN_MAGIC;
+  header->version = STATUS_BIN_VERSION;
+  header->total_size = total_size;
+  header->pid = status->pid;
+  header->systemd_cgroup = status->systemd_cgroup;
+  header->detached = status->detached;
+  header->process_start_time = status->process_start_time;
+
+  offset = sizeof (struct status_bin_header_s);
+  for (i = 0; i < STATUS_BIN_STR_MAX; i++)
+    {
+      size_t len;
+
+      if (strings[i] == NULL)
+        continue;
+
+      len = strlen (strings[i]);
+      header->strings[i].offset = offset;
+      header->strings[i].len = len;
+      memcpy (buffer + offset, strings[i], len + 1);
+      offset += len + 1;
+    }
+
+  xasprintf (&file_tmp, "%s.tmp", file);
+  fd = open (file_tmp, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0700);
+  if (UNLIKELY (fd < 0))
+    goto fail;
+
+  if (UNLIKELY (safe_write (fd, buffer, (ssize_t) total_size) < 0))
+    goto fail;
+
+  close_and_reset (&fd);
+
+  if (UNLIKELY (rename (file_tmp, file) < 0))
+    goto fail;
+
+  return;
+
+fail:
+  /* Do not leave a stale record behind.  */
+  unlink (file_tmp);
+  unlink (file);
+}
+
+/* Returns 1 when the status was loaded from the binary record, 0 when the
+   caller must fall back to the JSON file.  */
+static int
+read_container_status_bin (libcrun_container_status_t *status, const char *file_bin, const char *file_json)
+{
+  cleanup_close int fd = -1;
+  const struct status_bin_header_s *header;
+  struct stat st_bin, st_json;
+  const char *strings[STATUS_BIN_STR_MAX];
+  char *mapped = MAP_FAILED;
+  int ret = 0;
+  size_t i;
+
+  fd = open (file_bin, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+
+  if (fstat (fd, &st_bin) < 0 || stat (file_json, &st_json) < 0)
+    return 0;
+
+  /* The JSON file is authoritative: ignore a record older than it.  */
+  if (st_bin.st_mtim.tv_sec < st_json.st_mtim.tv_sec
+      || (st_bin.st_mtim.tv_sec == st_json.st_mtim.tv_sec && st_bin.st_mtim.tv_nsec < st_json.st_mtim.tv_nsec))
+    return 0;
+
+  if ((size_t) st_bin.st_size < sizeof (struct status_bin_header_s))
+    return 0;
+
+  mapped = mmap (NULL, st_bin.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapped == MAP_FAILED)
+    return 0;
+
+  header = (const struct status_bin_header_s *) mapped;
+  if (header->magic != STATUS_BIN_MAGIC || header->version != STATUS_BIN_VERSION
+      || header->total_size != (size_t) st_bin.st_size)
+    goto out;
+
+  for (i = 0; i < STATUS_BIN_STR_MAX; i++)
+    {
+      uint32_t off = header->strings[i].offset;
+      uint32_t len = header->strings[i].len;
+
+      if (off == 0)
+        {
+          strings[i] = NULL;
+          continue;
+        }
+
+      if (off < sizeof (struct status_bin_header_s) || (uint64_t) off + len >= header->total_size
+          || mapped[off + len] != '\0')
+        goto out;
+
+      strings[i] = mapped + off;
+    }
+
+  /* The mandatory fields must be present.  */
+  if (strings[STATUS_BIN_STR_BUNDLE] == NULL || strings[STATUS_BIN_STR_ROOTFS] == NULL
+      || strings[STATUS_BIN_STR_CGROUP_PATH] == NULL || strings[STATUS_BIN_STR_CREATED] == NULL)
+    goto out;
+
+  status->pid = header->pid;
+  status->systemd_cgroup = header->systemd_cgroup;
+  status->detached = header->detached;
+  status->process_start_time = header->process_start_time;
+  status->bundle = xstrdup (strings[STATUS_BIN_STR_BUNDLE]);
+  status->rootfs = xstrdup (strings[STATUS_BIN_STR_ROOTFS]);
+  status->cgroup_path = xstrdup (strings[STATUS_BIN_STR_CGROUP_PATH]);
+  status->scope = strings[STATUS_BIN_STR_SCOPE] ? xstrdup (strings[STATUS_BIN_STR_SCOPE]) : NULL;
+  status->intelrdt = strings[STATUS_BIN_STR_INTELRDT] ? xstrdup (strings[STATUS_BIN_STR_INTELRDT]) : NULL;
+  status->created = xstrdup (strings[STATUS_BIN_STR_CREATED]);
+  status->external_descriptors = strings[STATUS_BIN_STR_EXTERNAL_DESCRIPTORS]
+                                     ? xstrdup (strings[STATUS_BIN_STR_EXTERNAL_DESCRIPTORS])
+                                     : NULL;
+  status->owner = strings[STATUS_BIN_STR_OWNER] ? xstrdup (strings[STATUS_BIN_STR_OWNER]) : NULL;
+
+  ret = 1;
+
+out:
+  munmap (mapped, st_bin.st_size);
+  return ret;
+}
+
 static int
 read_pid_stat (pid_t pid, struct pid_stat *st, libcrun_error_t *err)
 {
@@ -175,6 +903,7 @@ libcrun_write_container_status (const char *state_root, const char *id, libcrun_
   cleanup_free char *file = get_state_directory_status_file (state_root, id);
   cleanup_free char *file_tmp = NULL;
   size_t len;
+  int state_dirfd;
   cleanup_close int fd_write = -1;
   const unsigned char *buf = NULL;
   struct pid_stat st;
@@ -187,10 +916,20 @@ libcrun_write_container_status (const char *state_root, const char *id, libcrun_
 
   status->process_start_time = st.starttime;
 
-  xasprintf (&file_tmp, "%s.tmp", file);
-  fd_write = open (file_tmp, O_CREAT | O_WRONLY | O_CLOEXEC, 0700);
-  if (UNLIKELY (fd_write < 0))
-    return crun_make_error (err, errno, "cannot open status file");
+  state_dirfd = get_state_directory_fd (state_root, id);
+#ifdef O_TMPFILE
+  if (state_dirfd >= 0)
+    fd_write = openat (state_dirfd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, 0700);
+#endif
+  if (fd_write < 0)
+    {
+      /* O_TMPFILE not supported by the kernel or the file system, go through
+         a visible temporary name.  */
+      xasprintf (&file_tmp, "%s.tmp", file);
+      fd_write = open (file_tmp, O_CREAT | O_WRONLY | O_CLOEXEC, 0700);
+      if (UNLIKELY (fd_write < 0))
+        return crun_make_error (err, errno, "cannot open status file");
+    }
 
   gen = yajl_gen_alloc (NULL);
   if (gen == NULL)
@@ -319,14 +1058,44 @@ libcrun_write_container_status (const char *state_root, const char *id, libcrun_
       goto exit;
     }
 
-  close_and_reset (&fd_write);
+  if (file_tmp == NULL)
+    {
+      proc_fd_path_t fd_path;
+
+      get_proc_self_fd_path (fd_path, fd_write);
+      if (linkat (AT_FDCWD, fd_path, state_dirfd, "status", AT_SYMLINK_FOLLOW) < 0)
+        {
+          /* linkat cannot replace an existing entry, so go through a linked
+             temporary name and rename it over, still without ever exposing a
+             partially written file.  */
+          unlinkat (state_dirfd, "status.tmp", 0);
+          if (UNLIKELY (linkat (AT_FDCWD, fd_path, state_dirfd, "status.tmp", AT_SYMLINK_FOLLOW) < 0)
+              || UNLIKELY (renameat (state_dirfd, "status.tmp", state_dirfd, "status") < 0))
+            {
+              ret = crun_make_error (err, errno, "cannot link status file");
+              goto exit;
+            }
+        }
 
-  if (UNLIKELY (rename (file_tmp, file) < 0))
+      close_and_reset (&fd_write);
+    }
+  else
     {
-      ret = crun_make_error (err, errno, "cannot rename status file");
-      goto exit;
+      close_and_reset (&fd_write);
+
+      if (UNLIKELY (rename (file_tmp, file) < 0))
+        {
+          ret = crun_make_error (err, errno, "cannot rename status file");
+          goto exit;
+        }
     }
 
+  if (state_dirfd >= 0)
+    sync_state_directory (state_dirfd);
+
+  write_container_status_bin (state_root, id, status);
+  update_index_on_write (state_root, id, status);
+
 exit:
   if (gen)
     yajl_gen_free (gen);
@@ -350,6 +1119,13 @@ libcrun_read_container_status (libcrun_container_status_t *status, const char *s
   cleanup_free char *file = get_state_directory_status_file (state_root, id);
   yajl_val tree, tmp;
 
+  {
+    cleanup_free char *file_bin = get_state_directory_status_bin_file (state_root, id);
+
+    if (file_bin != NULL && read_container_status_bin (status, file_bin, file))
+      return 0;
+  }
+
   ret = read_all_file (file, &buffer, NULL, err);
   if (UNLIKELY (ret < 0))
     return ret;
@@ -538,6 +1314,9 @@ libcrun_container_delete_status (const char *state_root, const char *id, libcrun
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, errno, "cannot rm state directory `%s/%s`", dir, id);
 
+  invalidate_state_directory_fd (state_root, id);
+  update_index_on_delete (state_root, id);
+
   return 0;
 }
 
@@ -554,6 +1333,8 @@ libcrun_free_container_status (libcrun_container_status_t *status)
   free (status->scope);
   free (status->intelrdt);
   free (status->owner);
+  if (status->pidfd > 0)
+    close_and_reset (&status->pidfd);
 }
 
 int
@@ -565,6 +1346,10 @@ libcrun_get_containers_list (libcrun_container_list_t **ret, const char *state_r
   cleanup_dir DIR *dir = NULL;
 
   *ret = NULL;
+
+  if (get_containers_list_from_index (ret, state_root))
+    return 0;
+
   dir = opendir (path);
   if (UNLIKELY (dir == NULL))
     return crun_make_error (err, errno, "cannot opendir `%s`", path);
@@ -605,6 +1390,104 @@ libcrun_get_containers_list (libcrun_container_list_t **ret, const char *state_r
   return 0;
 }
 
+/* Fill ARRAY with one entry per container under STATE_ROOT, status
+   included.  The statuses live in one contiguous allocation, so callers
+   iterating or sorting them touch consecutive memory instead of chasing a
+   malloc-per-node list.  Before anything is parsed, a first pass opens
+   every status file and starts its read with posix_fadvise: the
+   independent filesystem lookups and reads all run concurrently in the
+   kernel, and the parse loop is then served from the caches instead of
+   paying one synchronous lookup per container.  Entries whose status
+   cannot be read, e.g. a container deleted mid-walk, keep status_loaded
+   set to false.  */
+int
+libcrun_get_containers_array (libcrun_containers_array_t *array, const char *state_root, libcrun_error_t *err)
+{
+  cleanup_free char *path = get_run_directory (state_root);
+  cleanup_dir DIR *dir = NULL;
+  struct dirent *next;
+  size_t cap = 0, i;
+  int dfd;
+
+  array->entries = NULL;
+  array->len = 0;
+
+  dir = opendir (path);
+  if (UNLIKELY (dir == NULL))
+    return crun_make_error (err, errno, "cannot opendir `%s`", path);
+
+  dfd = dirfd (dir);
+
+  for (next = readdir (dir); next; next = readdir (dir))
+    {
+      cleanup_free char *status_rel = NULL;
+      cleanup_free char *bin_rel = NULL;
+      libcrun_container_array_entry_t *entry;
+      cleanup_close int fd = -1;
+      int bin_fd;
+
+      if (next->d_name[0] == '.')
+        continue;
+
+      xasprintf (&status_rel, "%s/status", next->d_name);
+      fd = openat (dfd, status_rel, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+      if (fd < 0)
+        continue;
+      (void) posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+
+      /* The binary fast path reads its own file, warm it up as well.  */
+      xasprintf (&bin_rel, "%s/status.bin", next->d_name);
+      bin_fd = openat (dfd, bin_rel, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+      if (bin_fd >= 0)
+        {
+          (void) posix_fadvise (bin_fd, 0, 0, POSIX_FADV_WILLNEED);
+          close (bin_fd);
+        }
+
+      if (array->len == cap)
+        {
+          cap = cap ? cap * 2 : 16;
+          array->entries = xrealloc (array->entries, cap * sizeof (libcrun_container_array_entry_t));
+        }
+      entry = &array->entries[array->len++];
+      memset (entry, 0, sizeof (*entry));
+      entry->name = xstrdup (next->d_name);
+    }
+
+  for (i = 0; i < array->len; i++)
+    {
+      libcrun_error_t tmp_err = NULL;
+
+      if (libcrun_read_container_status (&array->entries[i].status, state_root, array->entries[i].name, &tmp_err) < 0)
+        {
+          crun_error_release (&tmp_err);
+          continue;
+        }
+      array->entries[i].status_loaded = true;
+    }
+
+  return 0;
+}
+
+void
+libcrun_free_containers_array (libcrun_containers_array_t *array)
+{
+  size_t i;
+
+  if (array == NULL || array->entries == NULL)
+    return;
+
+  for (i = 0; i < array->len; i++)
+    {
+      free (array->entries[i].name);
+      if (array->entries[i].status_loaded)
+        libcrun_free_container_status (&array->entries[i].status);
+    }
+  free (array->entries);
+  array->entries = NULL;
+  array->len = 0;
+}
+
 void
 libcrun_free_containers_list (libcrun_container_list_t *list)
 {
@@ -644,11 +1527,73 @@ libcrun_check_pid_valid (libcrun_container_status_t *status, libcrun_error_t *er
   return 1; /* running, created, or paused */
 }
 
+int
+libcrun_status_get_pidfd (libcrun_container_status_t *status)
+{
+  libcrun_error_t tmp_err = NULL;
+  int pidfd;
+  int ret;
+
+  if (status->pidfd != 0)
+    return status->pidfd;
+
+  pidfd = syscall_pidfd_open (status->pid, 0);
+  if (pidfd < 0)
+    {
+      if (errno == ESRCH)
+        return 0;
+      status->pidfd = -1;
+      return -1;
+    }
+  /* An fd of 0 would be ambiguous with the never-opened state.  */
+  if (pidfd == 0)
+    {
+      status->pidfd = fcntl (pidfd, F_DUPFD_CLOEXEC, 3);
+      TEMP_FAILURE_RETRY (close (pidfd));
+      if (status->pidfd < 0)
+        {
+          status->pidfd = -1;
+          return -1;
+        }
+    }
+  else
+    status->pidfd = pidfd;
+
+  /* The pidfd pins the process from now on, but the pid could have been
+     recycled before it was opened: validate the start time once.  */
+  ret = libcrun_check_pid_valid (status, &tmp_err);
+  if (ret <= 0)
+    {
+      if (ret < 0)
+        crun_error_release (&tmp_err);
+      close_and_reset (&status->pidfd);
+      return ret == 0 ? 0 : -1;
+    }
+
+  return status->pidfd;
+}
+
 int
 libcrun_is_container_running (libcrun_container_status_t *status, libcrun_error_t *err)
 {
   int ret;
 
+  ret = libcrun_status_get_pidfd (status);
+  if (ret == 0)
+    return 0; /* stopped */
+  if (ret > 0)
+    {
+      struct pollfd pfd = { .fd = ret, .events = POLLIN };
+
+      /* The pidfd becomes readable once the process exited, so liveness is
+         a single poll without going through /proc again.  */
+      ret = poll (&pfd, 1, 0);
+      if (UNLIKELY (ret < 0))
+        return crun_make_error (err, errno, "poll pidfd");
+
+      return ret == 0 ? 1 : 0;
+    }
+
   ret = kill (status->pid, 0);
   if (UNLIKELY (ret < 0) && errno != ESRCH)
     return crun_make_error (err, errno, "kill");
@@ -724,3 +1669,106 @@ libcrun_status_has_read_exec_fifo (const char *state_root, const char *id, libcr
 
   return crun_path_exists (fifo_path, err);
 }
+
+#define EXEC_EVENTFD_FILENAME "exec.eventfd"
+
+int
+libcrun_status_create_exec_eventfd (const char *state_root, const char *id, libcrun_error_t *err)
+{
+  cleanup_free char *state_dir = libcrun_get_state_directory (state_root, id);
+  cleanup_free char *eventfd_path = NULL;
+  cleanup_close int fd = -1;
+  char buffer[16];
+  int ret;
+
+  ret = append_paths (&eventfd_path, err, state_dir, EXEC_EVENTFD_FILENAME, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  fd = eventfd (0, EFD_CLOEXEC);
+  if (UNLIKELY (fd < 0))
+    return crun_make_error (err, errno, "eventfd");
+
+  /* The container process inherits the eventfd at the same number, record it
+     so that start can grab it with pidfd_getfd.  */
+  ret = snprintf (buffer, sizeof (buffer), "%d", fd);
+  if (UNLIKELY (ret >= (int) sizeof (buffer)))
+    return crun_make_error (err, 0, "internal error: static buffer too small");
+
+  ret = write_file (eventfd_path, buffer, strlen (buffer), err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  return get_and_reset (&fd);
+}
+
+int
+libcrun_status_write_exec_eventfd (libcrun_container_status_t *status, const char *state_root, const char *id,
+                                   libcrun_error_t *err)
+{
+  cleanup_free char *state_dir = libcrun_get_state_directory (state_root, id);
+  cleanup_free char *eventfd_path = NULL;
+  cleanup_free char *fifo_path = NULL;
+  cleanup_free char *content = NULL;
+  libcrun_error_t tmp_err = NULL;
+  cleanup_close int fd = -1;
+  proc_fd_path_t fd_path;
+  char link_target[64];
+  uint64_t value = 1;
+  int remote_fd;
+  int pidfd;
+  int ret;
+
+  ret = append_paths (&eventfd_path, err, state_dir, EXEC_EVENTFD_FILENAME, NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = read_all_file (eventfd_path, &content, NULL, &tmp_err);
+  if (UNLIKELY (ret < 0))
+    {
+      /* Not recorded, e.g. the container was created by an older crun.  */
+      crun_error_release (&tmp_err);
+      return 0;
+    }
+
+  errno = 0;
+  remote_fd = strtol (content, NULL, 10);
+  if (errno != 0 || remote_fd < 0)
+    return 0;
+
+  pidfd = libcrun_status_get_pidfd (status);
+  if (pidfd <= 0)
+    return 0;
+
+  fd = syscall_pidfd_getfd (pidfd, remote_fd, 0);
+  if (fd < 0)
+    return 0;
+
+  /* Make sure the grabbed descriptor really is the handshake eventfd and not
+     something that reused its number.  */
+  get_proc_self_fd_path (fd_path, fd);
+  ret = TEMP_FAILURE_RETRY (readlink (fd_path, link_target, sizeof (link_target) - 1));
+  if (UNLIKELY (ret < 0))
+    return 0;
+  link_target[ret] = '\0';
+  if (strcmp (link_target, "anon_inode:[eventfd]") != 0)
+    return 0;
+
+  ret = TEMP_FAILURE_RETRY (write (fd, &value, sizeof (value)));
+  if (UNLIKELY (ret != sizeof (value)))
+    return 0;
+
+  unlink (eventfd_path);
+
+  /* The fifo is what signals that the container was not yet started, remove
+     it like libcrun_status_write_exec_fifo does.  */
+  ret = append_paths (&fifo_path, err, state_dir, "exec.fifo", NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = unlink (fifo_path);
+  if (UNLIKELY (ret < 0 && errno != ENOENT))
+    return crun_make_error (err, errno, "unlink `%s`", fifo_path);
+
+  return 1;
+}
@@ -45,6 +45,10 @@ struct libcrun_container_status_s
   int detached;
   char *external_descriptors;
   char *owner;
+  /* Validated pidfd for PID, cached by libcrun_status_get_pidfd: 0 when not
+     yet opened, negative when pidfds cannot be used for this container.  It
+     is not serialized with the rest of the status.  */
+  int pidfd;
 };
 typedef struct libcrun_container_status_s libcrun_container_status_t;
 
@@ -53,6 +57,30 @@ LIBCRUN_PUBLIC int libcrun_write_container_status (const char *state_root, const
                                                    libcrun_container_status_t *status, libcrun_error_t *err);
 LIBCRUN_PUBLIC int libcrun_read_container_status (libcrun_container_status_t *status, const char *state_root,
                                                   const char *id, libcrun_error_t *err);
+/* One container and its status, stored contiguously with its siblings.  */
+struct libcrun_container_array_entry_s
+{
+  char *name;
+  libcrun_container_status_t status;
+  /* False when the status file could not be read, e.g. the container was
+     deleted while the state root was walked.  */
+  bool status_loaded;
+};
+typedef struct libcrun_container_array_entry_s libcrun_container_array_entry_t;
+
+struct libcrun_containers_array_s
+{
+  libcrun_container_array_entry_t *entries;
+  size_t len;
+};
+typedef struct libcrun_containers_array_s libcrun_containers_array_t;
+
+/* Load every container under STATE_ROOT with its status into one contiguous
+   array, prefetching all the status files before the first one is parsed.  */
+LIBCRUN_PUBLIC int libcrun_get_containers_array (libcrun_containers_array_t *array, const char *state_root,
+                                                 libcrun_error_t *err);
+LIBCRUN_PUBLIC void libcrun_free_containers_array (libcrun_containers_array_t *array);
+
 LIBCRUN_PUBLIC void libcrun_free_containers_list (libcrun_container_list_t *list);
 LIBCRUN_PUBLIC int libcrun_is_container_running (libcrun_container_status_t *status, libcrun_error_t *err);
 LIBCRUN_PUBLIC char *libcrun_get_state_directory (const char *state_root, const char *id);
@@ -64,8 +92,25 @@ int libcrun_status_check_directories (const char *state_root, const char *id, li
 int libcrun_status_create_exec_fifo (const char *state_root, const char *id, libcrun_error_t *err);
 int libcrun_status_write_exec_fifo (const char *state_root, const char *id, libcrun_error_t *err);
 int libcrun_status_has_read_exec_fifo (const char *state_root, const char *id, libcrun_error_t *err);
+
+/* Eventfd based variant of the start handshake.  create opens an eventfd
+   that the container process inherits and records its number in the state
+   directory; start grabs it with pidfd_getfd and signals it with a single
+   write.  libcrun_status_write_exec_eventfd returns 1 when the container was
+   signaled, 0 when the caller must fall back to the exec fifo.  */
+int libcrun_status_create_exec_eventfd (const char *state_root, const char *id, libcrun_error_t *err);
+int libcrun_status_write_exec_eventfd (libcrun_container_status_t *status, const char *state_root, const char *id,
+                                       libcrun_error_t *err);
 int libcrun_check_pid_valid (libcrun_container_status_t *status, libcrun_error_t *err);
 
+/* Open a pidfd for the container process and validate it once against the
+   recorded start time, caching it on STATUS.  Every operation done through
+   the returned fd is race free against pid reuse.  Returns the fd (> 0), 0
+   when the process is known to be gone, or -1 without setting ERR when
+   pidfds are not usable and the caller must fall back to the /proc based
+   checks.  */
+int libcrun_status_get_pidfd (libcrun_container_status_t *status);
+
 static inline void
 libcrun_free_container_listp (void *p)
 {
@@ -76,5 +121,6 @@ libcrun_free_container_listp (void *p)
 
 #define cleanup_container_status __attribute__ ((cleanup (libcrun_free_container_status)))
 #define cleanup_container_list __attribute__ ((cleanup (libcrun_free_container_listp)))
+#define cleanup_containers_array __attribute__ ((cleanup (libcrun_free_containers_array)))
 
 #endif
@@ -19,6 +19,8 @@
 #define _GNU_SOURCE
 #include <config.h>
 #include "utils.h"
+#include "json-scan.h"
+#include "probe-cache.h"
 #include <stdarg.h>
 #include <unistd.h>
 #include <string.h>
@@ -53,6 +55,12 @@
 #ifndef CLOSE_RANGE_CLOEXEC
 #  define CLOSE_RANGE_CLOEXEC (1U << 2)
 #endif
+#ifndef RESOLVE_NO_SYMLINKS
+#  define RESOLVE_NO_SYMLINKS 0x04
+#endif
+#ifndef RESOLVE_BENEATH
+#  define RESOLVE_BENEATH 0x08
+#endif
 #ifndef RESOLVE_IN_ROOT
 #  define RESOLVE_IN_ROOT 0x10
 #endif
@@ -162,20 +170,6 @@ write_file (const char *name, const void *data, size_t len, libcrun_error_t *err
   return write_file_with_flags (name, O_CREAT | O_TRUNC, data, len, err);
 }
 
-int
-detach_process ()
-{
-  pid_t pid;
-  if (setsid () < 0)
-    return -1;
-  pid = fork ();
-  if (pid < 0)
-    return -1;
-  if (pid != 0)
-    _exit (EXIT_SUCCESS);
-  return 0;
-}
-
 int
 get_file_type_fd (int fd, mode_t *mode)
 {
@@ -425,6 +419,121 @@ safe_openat (int dirfd, const char *rootfs, size_t rootfs_len, const char *path,
   return safe_openat_fallback (dirfd, rootfs, rootfs_len, path, flags, mode, err);
 }
 
+int
+safe_openat_probe (int dirfd, const char *rootfs, size_t rootfs_len, const char *path, int flags, int mode,
+                   struct crun_probe_error_s *probe_err)
+{
+  static bool openat2_supported = true;
+  int ret;
+
+  if (openat2_supported)
+    {
+    repeat:
+      ret = syscall_openat2 (dirfd, path, flags, mode, RESOLVE_IN_ROOT);
+      if (UNLIKELY (ret < 0))
+        {
+          if (errno == EINTR || errno == EAGAIN)
+            goto repeat;
+          if (errno == ENOSYS)
+            openat2_supported = false;
+          if (errno != ENOSYS && errno != EINVAL && errno != EPERM)
+            return crun_probe_error (probe_err, errno, "openat2");
+        }
+      else
+        return ret;
+    }
+
+  /* Legacy kernels without a working openat2: reuse the allocating fallback,
+     it is already the slow path.  */
+  {
+    libcrun_error_t tmp_err = NULL;
+
+    ret = safe_openat_fallback (dirfd, rootfs, rootfs_len, path, flags, mode, &tmp_err);
+    if (UNLIKELY (ret < 0))
+      {
+        ret = crun_probe_error (probe_err, crun_error_get_errno (&tmp_err), "open under rootfs");
+        crun_error_release (&tmp_err);
+      }
+    return ret;
+  }
+}
+
+void
+safe_openat_batch (int dirfd, const char *rootfs, size_t rootfs_len, const char **paths, size_t n_paths,
+                   int flags, int mode, int *fds)
+{
+  cleanup_free char *cached_prefix = NULL;
+  cleanup_close int cached_prefix_fd = -1;
+  size_t i;
+
+  for (i = 0; i < n_paths; i++)
+    {
+      cleanup_free char *prefix = NULL;
+      const char *path = paths[i];
+      const char *base;
+      int ret;
+
+      path = consume_slashes (path);
+
+      /* Paths without a parent directory, or containing "..", take the full
+         walk directly: there is no prefix worth caching for the former, and
+         the latter can escape a RESOLVE_BENEATH lookup.  */
+      base = strrchr (path, '/');
+      if (base == NULL || base[1] == '\0' || strstr (path, "..") != NULL)
+        goto fallback;
+
+      prefix = xmalloc (base - path + 1);
+      memcpy (prefix, path, base - path);
+      prefix[base - path] = '\0';
+      base++;
+
+      if (cached_prefix == NULL || strcmp (cached_prefix, prefix) != 0)
+        {
+          libcrun_error_t tmp_err = NULL;
+
+          ret = safe_openat (dirfd, rootfs, rootfs_len, prefix, O_PATH | O_DIRECTORY | O_CLOEXEC, 0, &tmp_err);
+          if (ret < 0)
+            {
+              crun_error_release (&tmp_err);
+              goto fallback;
+            }
+
+          close_and_replace (&cached_prefix_fd, ret);
+          free (cached_prefix);
+          cached_prefix = prefix;
+          prefix = NULL;
+        }
+
+    repeat:
+      ret = syscall_openat2 (cached_prefix_fd, base, flags, mode, RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS);
+      if (ret < 0)
+        {
+          if (errno == EINTR || errno == EAGAIN)
+            goto repeat;
+          /* The last component could be a symlink that a RESOLVE_IN_ROOT
+             walk would have followed, so retry from the rootfs.  */
+          goto fallback;
+        }
+
+      fds[i] = ret;
+      continue;
+
+    fallback:
+      {
+        libcrun_error_t tmp_err = NULL;
+
+        ret = safe_openat (dirfd, rootfs, rootfs_len, paths[i], flags, mode, &tmp_err);
+        if (ret < 0)
+          {
+            fds[i] = -crun_error_get_errno (&tmp_err);
+            crun_error_release (&tmp_err);
+            continue;
+          }
+        fds[i] = ret;
+      }
+    }
+}
+
 ssize_t
 safe_readlinkat (int dfd, const char *name, char **buffer, ssize_t hint, libcrun_error_t *err)
 {
@@ -757,6 +866,13 @@ libcrun_initialize_selinux (libcrun_error_t *err)
   if (selinux_enabled >= 0)
     return selinux_enabled;
 
+  /* Whether SELinux is enabled is a property of the booted kernel.  */
+  if (libcrun_probe_cache_get ("selinux", &ret) == 0 && (ret == 0 || ret == 1))
+    {
+      selinux_enabled = ret;
+      return selinux_enabled;
+    }
+
   fd = open ("/proc/mounts", O_RDONLY | O_CLOEXEC);
   if (UNLIKELY (fd < 0))
     return crun_make_error (err, errno, "open `/proc/mounts`");
@@ -766,6 +882,7 @@ libcrun_initialize_selinux (libcrun_error_t *err)
     return ret;
 
   selinux_enabled = strstr (out, "selinux") ? 1 : 0;
+  libcrun_probe_cache_store ("selinux", selinux_enabled);
 
   return selinux_enabled;
 }
@@ -780,6 +897,12 @@ libcrun_initialize_apparmor (libcrun_error_t *err)
   if (apparmor_enabled >= 0)
     return apparmor_enabled;
 
+  if (libcrun_probe_cache_get ("apparmor", &size) == 0 && (size == 0 || size == 1))
+    {
+      apparmor_enabled = size;
+      return apparmor_enabled;
+    }
+
   if (crun_dir_p_at (AT_FDCWD, "/sys/kernel/security/apparmor", true, err))
     {
       fd = open ("/sys/module/apparmor/parameters/enabled", O_RDONLY | O_CLOEXEC);
@@ -789,6 +912,7 @@ libcrun_initialize_apparmor (libcrun_error_t *err)
       size = TEMP_FAILURE_RETRY (read (fd, &buf, 2));
 
       apparmor_enabled = size > 0 && buf[0] == 'Y' ? 1 : 0;
+      libcrun_probe_cache_store ("apparmor", apparmor_enabled);
     }
 
   return apparmor_enabled;
@@ -802,6 +926,17 @@ libcrun_is_selinux_enabled (libcrun_error_t *err)
   return selinux_enabled;
 }
 
+/* Nodes typically run with a handful of label configurations, so the
+   assembled mount option string is memoized for the last (data, label,
+   context type) combination seen.  */
+static struct mount_label_cache_s
+{
+  char *data;
+  char *label;
+  char *context_type;
+  char *result;
+} mount_label_cache;
+
 int
 add_selinux_mount_label (char **retlabel, const char *data, const char *label, const char *context_type, libcrun_error_t *err)
 {
@@ -813,10 +948,27 @@ add_selinux_mount_label (char **retlabel, const char *data, const char *label, c
 
   if (label && ret)
     {
+      if (mount_label_cache.result != NULL && strcmp (mount_label_cache.label, label) == 0
+          && strcmp (mount_label_cache.context_type, context_type) == 0
+          && strcmp (mount_label_cache.data, data && *data ? data : "") == 0)
+        {
+          *retlabel = xstrdup (mount_label_cache.result);
+          return 0;
+        }
+
       if (data && *data)
         xasprintf (retlabel, "%s,%s=\"%s\"", data, context_type, label);
       else
         xasprintf (retlabel, "%s=\"%s\"", context_type, label);
+
+      free (mount_label_cache.data);
+      free (mount_label_cache.label);
+      free (mount_label_cache.context_type);
+      free (mount_label_cache.result);
+      mount_label_cache.data = xstrdup (data && *data ? data : "");
+      mount_label_cache.label = xstrdup (label);
+      mount_label_cache.context_type = xstrdup (context_type);
+      mount_label_cache.result = xstrdup (*retlabel);
       return 0;
     }
   *retlabel = xstrdup (data);
@@ -826,6 +978,11 @@ add_selinux_mount_label (char **retlabel, const char *data, const char *label, c
 static int
 set_security_attr (const char *lsm, const char *fname, const char *data, libcrun_error_t *err)
 {
+  /* Whether the scoped /proc/thread-self/attr/<lsm> interface exists is a
+     property of the running kernel, so probe it only once per lsm.  Only
+     one lsm is ever passed in practice, a single slot is enough.  */
+  static char scoped_lsm[32];
+  static int scoped_lsm_result = -1;
   int ret;
   struct statfs sfs;
 
@@ -840,10 +997,28 @@ set_security_attr (const char *lsm, const char *fname, const char *data, libcrun
   // Check for newer scoped interface in /proc/thread-self/attr/<lsm>
   if (lsm != NULL)
     {
-      lsm_dirfd = openat (attr_dirfd, lsm, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+      if (scoped_lsm_result >= 0 && strcmp (scoped_lsm, lsm) == 0)
+        {
+          if (scoped_lsm_result)
+            {
+              lsm_dirfd = openat (attr_dirfd, lsm, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+              if (UNLIKELY (lsm_dirfd < 0))
+                return crun_make_error (err, errno, "open `/proc/thread-self/attr/%s`", lsm);
+            }
+        }
+      else
+        {
+          lsm_dirfd = openat (attr_dirfd, lsm, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
 
-      if (UNLIKELY (lsm_dirfd < 0 && errno != ENOENT))
-        return crun_make_error (err, errno, "open `/proc/thread-self/attr/%s`", lsm);
+          if (UNLIKELY (lsm_dirfd < 0 && errno != ENOENT))
+            return crun_make_error (err, errno, "open `/proc/thread-self/attr/%s`", lsm);
+
+          if (strlen (lsm) < sizeof (scoped_lsm))
+            {
+              strcpy (scoped_lsm, lsm);
+              scoped_lsm_result = lsm_dirfd >= 0 ? 1 : 0;
+            }
+        }
     }
 
   // Use scoped interface if available, fall back to unscoped
@@ -908,11 +1083,22 @@ set_apparmor_profile (const char *profile, bool now, libcrun_error_t *err)
 
   if (ret)
     {
-      cleanup_free char *buf = NULL;
+      /* The same couple of profiles is applied over and over on a node,
+         keep the last formatted command around.  */
+      static char *cached_profile;
+      static char *cached_buf;
+      static bool cached_now;
 
-      xasprintf (&buf, "%s %s", now ? "changeprofile" : "exec", profile);
+      if (cached_buf == NULL || cached_now != now || strcmp (cached_profile, profile) != 0)
+        {
+          free (cached_profile);
+          free (cached_buf);
+          cached_profile = xstrdup (profile);
+          cached_now = now;
+          xasprintf (&cached_buf, "%s %s", now ? "changeprofile" : "exec", profile);
+        }
 
-      return set_security_attr ("apparmor", now ? "current" : "exec", buf, err);
+      return set_security_attr ("apparmor", now ? "current" : "exec", cached_buf, err);
     }
   return 0;
 }
@@ -1179,7 +1365,9 @@ create_socket_pair (int *pair, libcrun_error_t *err)
 int
 create_signalfd (sigset_t *mask, libcrun_error_t *err)
 {
-  int ret = signalfd (-1, mask, 0);
+  /* Non blocking so that epoll driven consumers can drain every queued
+     signal in one go before acting on them.  */
+  int ret = signalfd (-1, mask, SFD_NONBLOCK);
   if (UNLIKELY (ret < 0))
     return crun_make_error (err, errno, "signalfd");
   return ret;
@@ -1219,17 +1407,101 @@ epoll_helper (int *fds, int *levelfds, libcrun_error_t *err)
   return ret;
 }
 
+/* Relay NREAD bytes sitting in the pipe RELAY_PIPE to DST.  Used by
+   copy_from_fd_to_fd after splicing data in from the source.  */
+static int
+drain_relay_pipe (int *relay_pipe, int dst, ssize_t nread, libcrun_error_t *err)
+{
+  char buf[512];
+  ssize_t remaining = nread;
+
+  while (remaining > 0)
+    {
+      ssize_t n = splice (relay_pipe[0], NULL, dst, NULL, remaining, SPLICE_F_MOVE);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && (errno == EINVAL || errno == EAGAIN))
+        {
+          /* The destination does not support splice.  The data is already in
+             the pipe, so move it with a plain read+write.  */
+          ssize_t to_copy = remaining > (ssize_t) sizeof (buf) ? (ssize_t) sizeof (buf) : remaining;
+
+          n = TEMP_FAILURE_RETRY (read (relay_pipe[0], buf, to_copy));
+          if (UNLIKELY (n <= 0))
+            return crun_make_error (err, n < 0 ? errno : 0, "read from relay pipe");
+          n = safe_write (dst, buf, n);
+          if (UNLIKELY (n < 0))
+            return crun_make_error (err, errno, "write");
+          remaining -= n;
+          continue;
+        }
+      if (UNLIKELY (n <= 0))
+        return crun_make_error (err, n < 0 ? errno : 0, "splice to destination");
+      remaining -= n;
+    }
+  return 0;
+}
+
 int
 copy_from_fd_to_fd (int src, int dst, int consume, libcrun_error_t *err)
 {
+  /* Reused across invocations: the relay moves data without ever copying it
+     to user space, halving the per-chunk cost for log heavy containers.  */
+  static int relay_pipe[2] = { -1, -1 };
+  static bool splice_unsupported = false;
+  static size_t relay_chunk = 0;
   int ret;
   ssize_t nread;
   size_t pagesize = get_page_size ();
+
+  if (! splice_unsupported && relay_pipe[0] < 0)
+    {
+      if (pipe2 (relay_pipe, O_CLOEXEC) < 0)
+        splice_unsupported = true;
+      else
+        {
+          relay_chunk = pagesize;
+#ifdef F_SETPIPE_SZ
+          /* Grow the relay so that a single splice can move a large burst;
+             build containers easily emit tens of MB/s of logs and the default
+             pipe size means one syscall pair per 16 pages.  Best effort, the
+             fcntl fails under a low pipe-max-size sysctl.  */
+          ret = fcntl (relay_pipe[1], F_SETPIPE_SZ, 1 << 20);
+          if (ret > 0)
+            relay_chunk = ret;
+#endif
+        }
+    }
+
   do
     {
       cleanup_free char *buffer = NULL;
       ssize_t remaining;
 
+      if (! splice_unsupported)
+        {
+          nread = splice (src, NULL, relay_pipe[1], NULL, relay_chunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+          if (nread < 0 && errno == EINTR)
+            continue;
+          if (nread < 0 && errno == EAGAIN)
+            return 0;
+          if (nread < 0 && errno == EIO)
+            return 0;
+          if (nread < 0)
+            /* e.g. the source does not support splice.  Do not try again.  */
+            splice_unsupported = true;
+          else
+            {
+              if (nread > 0)
+                {
+                  ret = drain_relay_pipe (relay_pipe, dst, nread, err);
+                  if (UNLIKELY (ret < 0))
+                    return ret;
+                }
+              continue;
+            }
+        }
+
 #ifdef HAVE_COPY_FILE_RANGE
       nread = copy_file_range (src, NULL, dst, NULL, pagesize, 0);
       if (nread < 0 && (errno == EINVAL || errno == EXDEV))
@@ -1688,21 +1960,38 @@ restore_sig_mask_and_exit:
   return ret;
 }
 
+/* Whether close_range works with the given flags: 0 = unknown, 1 = yes,
+   -1 = no.  Probed once, the answer cannot change for the process
+   lifetime, so later calls do not retry a syscall known to fail.  */
+static int close_range_usable;
+static int close_range_cloexec_usable;
+
 int
 mark_or_close_fds_ge_than (int n, bool close_now, libcrun_error_t *err)
 {
+  int *supported = close_now ? &close_range_usable : &close_range_cloexec_usable;
   cleanup_close int cfd = -1;
   cleanup_dir DIR *dir = NULL;
+  cleanup_free int *fds = NULL;
+  size_t n_fds = 0, fds_cap = 0;
   int ret;
   int fd;
+  size_t i;
   struct statfs sfs;
   struct dirent *next;
 
-  ret = syscall_close_range (n, UINT_MAX, close_now ? 0 : CLOSE_RANGE_CLOEXEC);
-  if (ret == 0)
-    return 0;
-  if (ret < 0 && errno != EINVAL && errno != ENOSYS && errno != EPERM)
-    return crun_make_error (err, errno, "close_range from `%d`", n);
+  if (*supported >= 0)
+    {
+      ret = syscall_close_range (n, UINT_MAX, close_now ? 0 : CLOSE_RANGE_CLOEXEC);
+      if (ret == 0)
+        {
+          *supported = 1;
+          return 0;
+        }
+      if (ret < 0 && errno != EINVAL && errno != ENOSYS && errno != EPERM)
+        return crun_make_error (err, errno, "close_range from `%d`", n);
+      *supported = -1;
+    }
 
   cfd = open ("/proc/self/fd", O_DIRECTORY | O_RDONLY | O_CLOEXEC);
   if (UNLIKELY (cfd < 0))
@@ -1722,6 +2011,8 @@ mark_or_close_fds_ge_than (int n, bool close_now, libcrun_error_t *err)
   /* Now it is owned by dir.  */
   cfd = -1;
 
+  /* Collect first: closing descriptors while the directory is being read
+     can make readdir skip entries.  */
   fd = dirfd (dir);
   for (next = readdir (dir); next; next = readdir (dir))
     {
@@ -1734,17 +2025,33 @@ mark_or_close_fds_ge_than (int n, bool close_now, libcrun_error_t *err)
       if (val < n || val == fd)
         continue;
 
+      if (n_fds == fds_cap)
+        {
+          fds_cap = fds_cap ? fds_cap * 2 : 64;
+          fds = xrealloc (fds, fds_cap * sizeof (int));
+        }
+      fds[n_fds++] = val;
+    }
+
+  if (n_fds == 0)
+    return 0;
+
+  /* A single fixup pass over the collected descriptors.  Reaching this
+     point means the close_range probe above already failed for the
+     requested flavor, so go descriptor by descriptor.  */
+  for (i = 0; i < n_fds; i++)
+    {
       if (close_now)
         {
-          ret = close (val);
+          ret = close (fds[i]);
           if (UNLIKELY (ret < 0))
-            return crun_make_error (err, errno, "close(fd=%d)", val);
+            return crun_make_error (err, errno, "close(fd=%d)", fds[i]);
         }
       else
         {
-          ret = fcntl (val, F_SETFD, FD_CLOEXEC);
+          ret = fcntl (fds[i], F_SETFD, FD_CLOEXEC);
           if (UNLIKELY (ret < 0))
-            return crun_make_error (err, errno, "cannot set CLOEXEC fd for `/proc/self/fd/%s`", name);
+            return crun_make_error (err, errno, "cannot set CLOEXEC fd for `/proc/self/fd/%d`", fds[i]);
         }
     }
   return 0;
@@ -1785,6 +2092,12 @@ parse_json_file (yajl_val *out, const char *jsondata, struct parser_context *ctx
 
   *err = NULL;
 
+  /* The vectorized scanner produces the same tree; yajl is the fallback
+     for anything it rejects and provides the error message.  */
+  *out = libcrun_json_parse_tree (jsondata, strlen (jsondata));
+  if (*out != NULL)
+    return 0;
+
   *out = yajl_tree_parse (jsondata, errbuf, sizeof (errbuf));
   if (*out == NULL)
     return crun_make_error (err, 0, "cannot parse the data: `%s`", errbuf);
@@ -2401,6 +2714,80 @@ libcrun_mmap (struct libcrun_mmap_s **ret, void *addr, size_t length,
   return 0;
 }
 
+/* Chunks are chained with the most recently mapped one first; allocations are
+   carved off the head chunk with a bump pointer.  */
+struct libcrun_arena_s
+{
+  struct libcrun_arena_s *next;
+  size_t size;
+  size_t used;
+};
+
+#define ARENA_MIN_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN(x) (((x) + 15) & ~(size_t) 15)
+
+void *
+libcrun_arena_alloc (struct libcrun_arena_s **arena, size_t size)
+{
+  struct libcrun_arena_s *chunk = *arena;
+  void *ret;
+
+  size = ARENA_ALIGN (size);
+
+  if (chunk == NULL || chunk->size - chunk->used < size)
+    {
+      size_t header = ARENA_ALIGN (sizeof (struct libcrun_arena_s));
+      size_t chunk_size = ARENA_MIN_CHUNK_SIZE;
+      size_t pagesize = get_page_size ();
+
+      if (size + header > chunk_size)
+        chunk_size = (size + header + pagesize - 1) & ~(pagesize - 1);
+
+      chunk = mmap (NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (UNLIKELY (chunk == MAP_FAILED))
+        OOM ();
+
+      chunk->next = *arena;
+      chunk->size = chunk_size;
+      chunk->used = header;
+      *arena = chunk;
+    }
+
+  ret = (char *) chunk + chunk->used;
+  chunk->used += size;
+  return ret;
+}
+
+char *
+libcrun_arena_strdup (struct libcrun_arena_s **arena, const char *str)
+{
+  size_t len;
+  char *ret;
+
+  if (str == NULL)
+    return NULL;
+
+  len = strlen (str) + 1;
+  ret = libcrun_arena_alloc (arena, len);
+  memcpy (ret, str, len);
+  return ret;
+}
+
+void
+libcrun_arena_free (struct libcrun_arena_s **arena)
+{
+  struct libcrun_arena_s *it = *arena;
+
+  while (it)
+    {
+      struct libcrun_arena_s *next = it->next;
+
+      munmap (it, it->size);
+      it = next;
+    }
+  *arena = NULL;
+}
+
 int
 libcrun_munmap (struct libcrun_mmap_s *mmap, libcrun_error_t *err)
 {
@@ -128,6 +128,19 @@ int libcrun_mmap (struct libcrun_mmap_s **ret, void *addr, size_t length,
 
 int libcrun_munmap (struct libcrun_mmap_s *mmap, libcrun_error_t *err);
 
+/* A bump allocator backed by anonymous mappings, meant for the many small
+   allocations performed while setting up a container.  Allocations cannot be
+   freed individually: the whole arena is released at once, so objects must not
+   outlive it.  An arena is an empty (NULL) pointer until the first
+   allocation.  */
+struct libcrun_arena_s;
+
+void *libcrun_arena_alloc (struct libcrun_arena_s **arena, size_t size);
+
+char *libcrun_arena_strdup (struct libcrun_arena_s **arena, const char *str);
+
+void libcrun_arena_free (struct libcrun_arena_s **arena);
+
 static inline void
 cleanup_mmapp (void *p)
 {
@@ -283,8 +296,6 @@ int crun_dir_p (const char *path, bool nofollow, libcrun_error_t *err);
 
 int crun_dir_p_at (int dirfd, const char *path, bool nofollow, libcrun_error_t *err);
 
-int detach_process ();
-
 int create_file_if_missing_at (int dirfd, const char *file, libcrun_error_t *err);
 
 int check_running_in_user_namespace (libcrun_error_t *err);
@@ -373,6 +384,21 @@ char *get_user_name (uid_t uid);
 int safe_openat (int dirfd, const char *rootfs, size_t rootfs_len, const char *path, int flags, int mode,
                  libcrun_error_t *err);
 
+/* Variant of safe_openat for probing chains where the failure is usually
+   consumed: it reports errors through the caller owned PROBE_ERR without
+   allocating.  */
+int safe_openat_probe (int dirfd, const char *rootfs, size_t rootfs_len, const char *path, int flags, int mode,
+                       struct crun_probe_error_s *probe_err);
+
+/* Resolve N_PATHS rootfs-relative PATHS in one pass.  Consecutive paths
+   sharing a parent directory reuse a cached O_PATH descriptor for it and only
+   resolve the last component, falling back to a full safe_openat walk
+   whenever the shortcut cannot prove equivalence, so the results match
+   calling safe_openat in a loop.  On return FDS[i] holds either an open file
+   descriptor or the negative errno from resolving PATHS[i].  */
+void safe_openat_batch (int dirfd, const char *rootfs, size_t rootfs_len, const char **paths, size_t n_paths,
+                        int flags, int mode, int *fds);
+
 ssize_t safe_write (int fd, const void *buf, ssize_t count);
 
 int append_paths (char **out, libcrun_error_t *err, ...) __attribute__ ((sentinel));
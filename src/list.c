@@ -97,7 +97,8 @@ crun_command_list (struct crun_global_arguments *global_args, int argc, char **a
   libcrun_context_t crun_context = {
     0,
   };
-  libcrun_container_list_t *list = NULL, *it;
+  cleanup_containers_array libcrun_containers_array_t array = {};
+  size_t i;
 
   list_options.format = LIST_TABLE;
 
@@ -111,13 +112,13 @@ crun_command_list (struct crun_global_arguments *global_args, int argc, char **a
   if (list_options.format == LIST_JSON)
     return libcrun_write_json_containers_list (&crun_context, stdout, err);
 
-  ret = libcrun_get_containers_list (&list, crun_context.state_root, err);
+  ret = libcrun_get_containers_array (&array, crun_context.state_root, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  for (it = list; it; it = it->next)
+  for (i = 0; i < array.len; i++)
     {
-      int l = strlen (it->name);
+      int l = strlen (array.entries[i].name);
       if (l > max_length)
         max_length = l;
     }
@@ -127,26 +128,23 @@ crun_command_list (struct crun_global_arguments *global_args, int argc, char **a
   if (! list_options.quiet)
     printf ("%-*s%-10s%-8s %-39s %-30s %s\n", max_length, "NAME", "PID", "STATUS", "BUNDLE PATH", "CREATED", "OWNER");
 
-  for (it = list; it; it = it->next)
+  for (i = 0; i < array.len; i++)
     {
-      libcrun_container_status_t status;
+      libcrun_container_array_entry_t *entry = &array.entries[i];
+
+      if (! entry->status_loaded)
+        continue;
 
-      ret = libcrun_read_container_status (&status, crun_context.state_root, it->name, err);
-      if (UNLIKELY (ret < 0))
-        {
-          libcrun_error_write_warning_and_release (stderr, &err);
-          continue;
-        }
       if (list_options.quiet)
-        printf ("%s\n", it->name);
+        printf ("%s\n", entry->name);
       else
         {
           int running = 0;
-          int pid = status.pid;
+          int pid = entry->status.pid;
           const char *container_status = NULL;
 
-          ret = libcrun_get_container_state_string (it->name, &status, crun_context.state_root, &container_status,
-                                                    &running, err);
+          ret = libcrun_get_container_state_string (entry->name, &entry->status, crun_context.state_root,
+                                                    &container_status, &running, err);
           if (UNLIKELY (ret < 0))
             {
               libcrun_error_write_warning_and_release (stderr, &err);
@@ -156,12 +154,10 @@ crun_command_list (struct crun_global_arguments *global_args, int argc, char **a
           if (! running)
             pid = 0;
 
-          printf ("%-*s%-10d%-8s %-39s %-30s %s\n", max_length, it->name, pid, container_status, status.bundle, status.created, status.owner);
+          printf ("%-*s%-10d%-8s %-39s %-30s %s\n", max_length, entry->name, pid, container_status,
+                  entry->status.bundle, entry->status.created, entry->status.owner);
         }
-
-      libcrun_free_container_status (&status);
     }
 
-  libcrun_free_containers_list (list);
-  return ret >= 0 ? 0 : ret;
+  return 0;
 }
@@ -0,0 +1,81 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <errno.h>
+
+#include "crun.h"
+#include "ns_pool.h"
+#include "libcrun/ns-pool.h"
+#include "libcrun/utils.h"
+
+static char doc[] = "OCI runtime";
+
+struct ns_pool_options_s
+{
+  size_t size;
+};
+
+static struct ns_pool_options_s ns_pool_options = { 3 };
+
+enum
+{
+  OPTION_SIZE = 1000,
+};
+
+static struct argp_option options[]
+    = { { "size", OPTION_SIZE, "N", 0, "number of pre-warmed slots to keep (default 3)", 0 },
+        {
+            0,
+        } };
+
+static char args_doc[] = "ns-pool [OPTION]... DIR";
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state arg_unused)
+{
+  switch (key)
+    {
+    case OPTION_SIZE:
+      ns_pool_options.size = strtoul (arg, NULL, 10);
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+int
+crun_command_ns_pool (struct crun_global_arguments *global_args arg_unused, int argc, char **argv,
+                      libcrun_error_t *err)
+{
+  int first_arg = 0;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &ns_pool_options);
+  crun_assert_n_args (argc - first_arg, 1, 1);
+
+  return libcrun_ns_pool_refill (argv[first_arg], ns_pool_options.size, err);
+}
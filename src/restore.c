@@ -44,6 +44,7 @@ enum
   OPTION_CONSOLE_SOCKET,
   OPTION_FILE_LOCKS,
   OPTION_MANAGE_CGROUPS_MODE,
+  OPTION_LAZY_PAGES,
 };
 
 static char doc[] = "OCI runtime";
@@ -67,6 +68,7 @@ static struct argp_option options[]
           "path to a socket that will receive the master end of the tty", 0 },
         { "file-locks", OPTION_FILE_LOCKS, 0, 0, "allow file locks", 0 },
         { "manage-cgroups-mode", OPTION_MANAGE_CGROUPS_MODE, "MODE", 0, "cgroups mode: 'soft' (default), 'ignore', 'full' and 'strict'", 0 },
+        { "lazy-pages", OPTION_LAZY_PAGES, 0, 0, "restore with the memory pages faulted in on demand from a page server", 0 },
         {
             0,
         } };
@@ -125,6 +127,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
       cr_options.manage_cgroups_mode = crun_parse_manage_cgroups_mode (argp_mandatory_argument (arg, state));
       break;
 
+    case OPTION_LAZY_PAGES:
+      cr_options.lazy_pages = true;
+      break;
+
     default:
       return ARGP_ERR_UNKNOWN;
     }
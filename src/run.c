@@ -26,6 +26,7 @@
 
 #include "crun.h"
 #include "libcrun/container.h"
+#include "libcrun/profile.h"
 #include "libcrun/utils.h"
 
 static char doc[] = "OCI runtime";
@@ -37,11 +38,16 @@ enum
   OPTION_NO_SUBREAPER,
   OPTION_NO_NEW_KEYRING,
   OPTION_PRESERVE_FDS,
-  OPTION_NO_PIVOT
+  OPTION_NO_PIVOT,
+  OPTION_PROFILE_STARTUP,
+  OPTION_ROOTFS_FD,
+  OPTION_BUNDLE_FD
 };
 
 static const char *bundle = NULL;
 
+static const char *profile_startup = NULL;
+
 static libcrun_context_t crun_context;
 
 static struct argp_option options[]
@@ -55,6 +61,9 @@ static struct argp_option options[]
         { "no-subreaper", OPTION_NO_SUBREAPER, 0, 0, "do not create a subreaper process", 0 },
         { "no-new-keyring", OPTION_NO_NEW_KEYRING, 0, 0, "keep the same session key", 0 },
         { "no-pivot", OPTION_NO_PIVOT, 0, 0, "do not use pivot_root", 0 },
+        { "profile-startup", OPTION_PROFILE_STARTUP, "FILE", 0, "append a JSON record with the startup phase timings to FILE", 0 },
+        { "bundle-fd", OPTION_BUNDLE_FD, "FD", 0, "pre-opened directory fd for the bundle", 0 },
+        { "rootfs-fd", OPTION_ROOTFS_FD, "FD", 0, "pre-opened O_PATH fd for the rootfs", 0 },
         {
             0,
         } };
@@ -103,6 +112,18 @@ parse_opt (int key, char *arg, struct argp_state *state)
       crun_context.no_pivot = true;
       break;
 
+    case OPTION_PROFILE_STARTUP:
+      profile_startup = argp_mandatory_argument (arg, state);
+      break;
+
+    case OPTION_BUNDLE_FD:
+      crun_context.bundle_fd = strtoll (argp_mandatory_argument (arg, state), NULL, 10);
+      break;
+
+    case OPTION_ROOTFS_FD:
+      crun_context.rootfs_fd = strtoll (argp_mandatory_argument (arg, state), NULL, 10);
+      break;
+
     case ARGP_KEY_NO_ARGS:
       libcrun_fail_with_error (0, "please specify a ID for the container");
 
@@ -144,7 +165,15 @@ crun_command_run (struct crun_global_arguments *global_args, int argc, char **ar
     }
 
   /* Make sure the bundle is an absolute path.  */
-  if (bundle == NULL)
+  if (crun_context.bundle_fd > 0)
+    {
+      /* A pre-opened bundle skips the path resolution entirely; the absolute
+         path recorded in the status comes from the fd.  */
+      if (fchdir (crun_context.bundle_fd) < 0)
+        libcrun_fail_with_error (errno, "fchdir to the bundle fd `%d` failed", crun_context.bundle_fd);
+      bundle = bundle_cleanup = getcwd (NULL, 0);
+    }
+  else if (bundle == NULL)
     bundle = bundle_cleanup = getcwd (NULL, 0);
   else
     {
@@ -175,5 +204,8 @@ crun_command_run (struct crun_global_arguments *global_args, int argc, char **ar
       crun_context.preserve_fds += crun_context.listen_fds;
     }
 
+  if (profile_startup)
+    libcrun_profile_startup_enable (profile_startup);
+
   return libcrun_container_run (&crun_context, container, 0, err);
 }
@@ -36,20 +36,27 @@ enum
   OPTION_PID_FILE,
   OPTION_NO_SUBREAPER,
   OPTION_NO_NEW_KEYRING,
-  OPTION_PRESERVE_FDS
+  OPTION_PRESERVE_FDS,
+  OPTION_COMPACT,
+  OPTION_ALL
 };
 
 struct state_options_s
 {
+  bool compact;
+  bool all;
 };
 
 static struct state_options_s state_options;
 
-static struct argp_option options[] = { {
-    0,
-} };
+static struct argp_option options[]
+    = { { "compact", OPTION_COMPACT, 0, 0, "print a single-line state document without the annotations", 0 },
+        { "all", OPTION_ALL, 0, 0, "print the state of every known container as a JSON array", 0 },
+        {
+            0,
+        } };
 
-static char args_doc[] = "state CONTAINER";
+static char args_doc[] = "state [CONTAINER...]";
 
 static error_t
 parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
@@ -57,7 +64,17 @@ parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
   switch (key)
     {
     case ARGP_KEY_NO_ARGS:
-      libcrun_fail_with_error (0, "please specify a ID for the container");
+      if (! state_options.all)
+        libcrun_fail_with_error (0, "please specify a ID for the container");
+      break;
+
+    case OPTION_COMPACT:
+      state_options.compact = true;
+      break;
+
+    case OPTION_ALL:
+      state_options.all = true;
+      break;
 
     default:
       return ARGP_ERR_UNKNOWN;
@@ -77,11 +94,28 @@ crun_command_state (struct crun_global_arguments *global_args, int argc, char **
   };
 
   argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &state_options);
-  crun_assert_n_args (argc - first_arg, 1, 1);
+  crun_assert_n_args (argc - first_arg, state_options.all ? 0 : 1, state_options.all ? 0 : -1);
 
   ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
+  /* With --all or more than one container, the states are gathered in a
+     single pass and printed as one JSON array.  */
+  if (state_options.all || argc - first_arg > 1)
+    return libcrun_get_states (&crun_context, (const char *const *) (argv + first_arg), argc - first_arg, stdout, err);
+
+  if (state_options.compact)
+    {
+      char buf[8192];
+
+      ret = libcrun_container_state_buf (&crun_context, argv[first_arg], buf, sizeof (buf), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+
+      printf ("%s\n", buf);
+      return 0;
+    }
+
   return libcrun_container_state (&crun_context, argv[first_arg], stdout, err);
 }
@@ -0,0 +1,116 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <argp.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "crun.h"
+#include "libcrun/container.h"
+#include "libcrun/utils.h"
+#include "libcrun/cgroup.h"
+#include "libcrun/intelrdt.h"
+
+static char doc[] = "OCI runtime";
+
+enum
+{
+  OPTION_ALL = 1000,
+};
+
+static bool opt_all;
+
+static struct argp_option options[] = { { "all", OPTION_ALL, 0, 0, "sample every container in one batch and print a JSON document", 0 },
+                                        {
+                                            0,
+                                        } };
+
+static char args_doc[] = "stats [CONTAINER]";
+
+static error_t
+parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
+{
+  switch (key)
+    {
+    case OPTION_ALL:
+      opt_all = true;
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+int
+crun_command_stats (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
+{
+  struct libcrun_intelrdt_stats_s rdt_stats;
+  struct libcrun_cgroup_stats_s stats;
+  int first_arg;
+  int ret;
+  libcrun_context_t crun_context = {
+    0,
+  };
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, NULL);
+  crun_assert_n_args (argc - first_arg, opt_all ? 0 : 1, opt_all ? 0 : 1);
+
+  ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (opt_all)
+    return libcrun_write_json_containers_stats (&crun_context, stdout, err);
+
+  ret = libcrun_container_stats (&crun_context, argv[first_arg], &stats, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  printf ("cpu.usage_usec %" PRIu64 "\n", stats.cpu_usage_usec);
+  printf ("cpu.user_usec %" PRIu64 "\n", stats.cpu_user_usec);
+  printf ("cpu.system_usec %" PRIu64 "\n", stats.cpu_system_usec);
+  printf ("memory.anon %" PRIu64 "\n", stats.memory_anon);
+  printf ("memory.file %" PRIu64 "\n", stats.memory_file);
+  printf ("memory.kernel_stack %" PRIu64 "\n", stats.memory_kernel_stack);
+  printf ("memory.pgfault %" PRIu64 "\n", stats.memory_pgfault);
+  printf ("memory.pgmajfault %" PRIu64 "\n", stats.memory_pgmajfault);
+  printf ("io.rbytes %" PRIu64 "\n", stats.io_rbytes);
+  printf ("io.wbytes %" PRIu64 "\n", stats.io_wbytes);
+  printf ("io.rios %" PRIu64 "\n", stats.io_rios);
+  printf ("io.wios %" PRIu64 "\n", stats.io_wios);
+  printf ("pids.current %" PRIu64 "\n", stats.pids_current);
+
+  ret = libcrun_container_rdt_stats (&crun_context, argv[first_arg], &rdt_stats, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  if (rdt_stats.llc_occupancy_present)
+    printf ("intel_rdt.llc_occupancy %" PRIu64 "\n", rdt_stats.llc_occupancy);
+  if (rdt_stats.mbm_total_bytes_present)
+    printf ("intel_rdt.mbm_total_bytes %" PRIu64 "\n", rdt_stats.mbm_total_bytes);
+
+  return 0;
+}
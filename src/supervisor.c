@@ -0,0 +1,576 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <argp.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "crun.h"
+#include "supervisor.h"
+#include "libcrun/utils.h"
+
+/* Shared supervisor for detached containers: instead of one long lived monitor
+   process per container, a single process multiplexes the supervision of many
+   containers over one epoll loop, the same set of event sources that
+   wait_for_process() handles for an attached container.
+
+   A client registers a container with one message on the unix socket:
+
+     ID \0 FLAGS \0 \0
+
+   with the file descriptors attached via SCM_RIGHTS in this order: a pidfd
+   for the container init process (always present), then, if bit 0x1 of the
+   decimal FLAGS field is set, the terminal master and, if bit 0x2 is set,
+   the sd_notify socket.  The reply is "ok" and the connection then carries
+   NUL terminated events:
+
+     ready \0           the container sent READY=1 on its notify socket
+     exited STATUS \0   the init process exited with STATUS
+
+   after "exited" the container is forgotten and the connection is closed.
+   The init processes are not our children: the exit is detected through the
+   pidfd becoming readable and the status read from procfs while the zombie
+   is still around; STATUS is -1 when the real parent won the race.  If the
+   client disconnects first, supervision continues and the exit is only
+   logged.  Terminal output is drained and discarded so a full pty buffer
+   never wedges an unattended container.  */
+
+static char doc[] = "OCI runtime";
+
+#define SUPERVISOR_MAX_REQUEST_LEN 4096
+#define SUPERVISOR_MAX_REQUEST_FDS 3
+
+#define SUPERVISOR_FLAG_TERMINAL 0x1
+#define SUPERVISOR_FLAG_NOTIFY 0x2
+
+struct supervised_container_s
+{
+  struct supervised_container_s *next;
+  char *id;
+  int client_fd;
+  int pidfd;
+  int terminal_fd;
+  int notify_fd;
+};
+
+struct supervisor_options_s
+{
+  const char *listen_path;
+};
+
+static struct supervisor_options_s supervisor_options;
+
+static struct supervised_container_s *containers;
+
+/* Connections that were accepted but whose registration message has not
+   arrived yet.  A client that connects and stays silent must not be able to
+   wedge the event loop, so the message is read only when it is ready.  */
+struct pending_conn_s
+{
+  struct pending_conn_s *next;
+  int fd;
+};
+
+static struct pending_conn_s *pending_conns;
+
+enum
+{
+  OPTION_LISTEN = 1000,
+};
+
+static struct argp_option options[] = { { "listen", OPTION_LISTEN, "SOCKET", 0, "listen on the specified socket", 0 },
+                                        {
+                                            0,
+                                        } };
+
+static char args_doc[] = "supervisor --listen SOCKET";
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state arg_unused)
+{
+  switch (key)
+    {
+    case OPTION_LISTEN:
+      supervisor_options.listen_path = arg;
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+
+  return 0;
+}
+
+static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
+
+static int
+send_event (struct supervised_container_s *c, const char *fmt, ...)
+{
+  char buf[64];
+  va_list args;
+  size_t len;
+
+  if (c->client_fd < 0)
+    return 0;
+
+  va_start (args, fmt);
+  len = vsnprintf (buf, sizeof (buf) - 1, fmt, args);
+  va_end (args);
+
+  /* MSG_NOSIGNAL: a client that went away must not kill the supervisor.  */
+  return TEMP_FAILURE_RETRY (send (c->client_fd, buf, len + 1, MSG_NOSIGNAL));
+}
+
+/* Remove FD from the epoll set and close it.  The removal must be explicit:
+   SCM_RIGHTS duplicates of these open file descriptions can exist in other
+   processes, so closing our fd alone would leave them in the epoll set.  */
+static void
+remove_and_close (int epollfd, int *fd)
+{
+  if (*fd < 0)
+    return;
+  epoll_ctl (epollfd, EPOLL_CTL_DEL, *fd, NULL);
+  close_and_reset (fd);
+}
+
+static void
+forget_container (int epollfd, struct supervised_container_s *c)
+{
+  struct supervised_container_s **it;
+
+  for (it = &containers; *it; it = &(*it)->next)
+    if (*it == c)
+      {
+        *it = c->next;
+        break;
+      }
+
+  remove_and_close (epollfd, &c->terminal_fd);
+  remove_and_close (epollfd, &c->notify_fd);
+  remove_and_close (epollfd, &c->pidfd);
+  remove_and_close (epollfd, &c->client_fd);
+  free (c->id);
+  free (c);
+}
+
+/* If FD is a connection waiting for its registration message, drop it from
+   the pending list and return true.  */
+static bool
+take_pending_conn (int fd)
+{
+  struct pending_conn_s **it;
+
+  for (it = &pending_conns; *it; it = &(*it)->next)
+    if ((*it)->fd == fd)
+      {
+        struct pending_conn_s *p = *it;
+
+        *it = p->next;
+        free (p);
+        return true;
+      }
+  return false;
+}
+
+/* Find the container owning FD, and through WHICH which of its sources it is.  */
+static struct supervised_container_s *
+find_container (int fd, int **which)
+{
+  struct supervised_container_s *c;
+
+  for (c = containers; c; c = c->next)
+    {
+      if (c->pidfd == fd)
+        *which = &c->pidfd;
+      else if (c->terminal_fd == fd)
+        *which = &c->terminal_fd;
+      else if (c->notify_fd == fd)
+        *which = &c->notify_fd;
+      else if (c->client_fd == fd)
+        *which = &c->client_fd;
+      else
+        continue;
+      return c;
+    }
+  return NULL;
+}
+
+static int
+add_to_epoll (int epollfd, int fd, libcrun_error_t *err)
+{
+  struct epoll_event ev = {};
+  int ret;
+
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  ret = epoll_ctl (epollfd, EPOLL_CTL_ADD, fd, &ev);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "epoll_ctl add `%d`", fd);
+  return 0;
+}
+
+/* Accept one registration from CONN_FD and start supervising its container.
+   On success the connection fd is owned by the new entry.  */
+static int
+register_container (int epollfd, int conn_fd, libcrun_error_t *err)
+{
+  char fd_buffer[CMSG_SPACE (SUPERVISOR_MAX_REQUEST_FDS * sizeof (int))];
+  int fds[SUPERVISOR_MAX_REQUEST_FDS] = { -1, -1, -1 };
+  char buf[SUPERVISOR_MAX_REQUEST_LEN];
+  struct supervised_container_s *c;
+  struct msghdr msg = {};
+  struct cmsghdr *cmsg;
+  struct iovec iov;
+  size_t n_fds = 0;
+  int next_fd = 0;
+  ssize_t ret;
+  int flags;
+  size_t i;
+
+  iov.iov_base = buf;
+  iov.iov_len = sizeof (buf) - 1;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = fd_buffer;
+  msg.msg_controllen = sizeof (fd_buffer);
+
+  /* The connection is non-blocking and the caller waited for readability,
+     so a silent client can never stall the event loop here.  */
+  ret = TEMP_FAILURE_RETRY (recvmsg (conn_fd, &msg, MSG_DONTWAIT));
+  if (UNLIKELY (ret < 0))
+    {
+      close (conn_fd);
+      return crun_make_error (err, errno, "recvmsg");
+    }
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+          n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+          if (n_fds > SUPERVISOR_MAX_REQUEST_FDS)
+            {
+              memcpy (fds, CMSG_DATA (cmsg), SUPERVISOR_MAX_REQUEST_FDS * sizeof (int));
+              goto invalid;
+            }
+          memcpy (fds, CMSG_DATA (cmsg), n_fds * sizeof (int));
+        }
+    }
+
+  /* The registration must fit in a single message: ID, FLAGS, empty field.  */
+  if (ret < 2 || buf[ret - 1] != '\0' || buf[ret - 2] != '\0')
+    goto invalid;
+  if (strlen (buf) + 1 >= (size_t) ret)
+    goto invalid;
+  flags = atoi (buf + strlen (buf) + 1);
+
+  if (n_fds < 1)
+    goto invalid;
+  if (n_fds != 1u + ! ! (flags & SUPERVISOR_FLAG_TERMINAL) + ! ! (flags & SUPERVISOR_FLAG_NOTIFY))
+    goto invalid;
+
+  c = xmalloc0 (sizeof (*c));
+  c->id = xstrdup (buf);
+  c->client_fd = conn_fd;
+  c->pidfd = fds[next_fd++];
+  c->terminal_fd = (flags & SUPERVISOR_FLAG_TERMINAL) ? fds[next_fd++] : -1;
+  c->notify_fd = (flags & SUPERVISOR_FLAG_NOTIFY) ? fds[next_fd++] : -1;
+  c->next = containers;
+  containers = c;
+
+  if (c->terminal_fd >= 0)
+    fcntl (c->terminal_fd, F_SETFL, fcntl (c->terminal_fd, F_GETFL) | O_NONBLOCK);
+
+  ret = add_to_epoll (epollfd, c->pidfd, err);
+  if (ret == 0 && c->terminal_fd >= 0)
+    ret = add_to_epoll (epollfd, c->terminal_fd, err);
+  if (ret == 0 && c->notify_fd >= 0)
+    ret = add_to_epoll (epollfd, c->notify_fd, err);
+  if (ret == 0)
+    ret = add_to_epoll (epollfd, c->client_fd, err);
+  if (UNLIKELY (ret < 0))
+    {
+      forget_container (epollfd, c);
+      return ret;
+    }
+
+  send_event (c, "ok");
+  return 0;
+
+invalid:
+  for (i = 0; i < SUPERVISOR_MAX_REQUEST_FDS; i++)
+    if (fds[i] >= 0)
+      close (fds[i]);
+  close (conn_fd);
+  return crun_make_error (err, 0, "invalid registration request");
+}
+
+/* Read the exit status of the process behind PIDFD without being its parent:
+   while the zombie has not been reaped, the last field of /proc/PID/stat is
+   its status in waitpid form.  Returns a negative value when the status
+   cannot be determined, e.g. the real parent already reaped it.  */
+static int
+read_exit_status_from_proc (int pidfd)
+{
+  char path[64];
+  char buf[8192];
+  char *it;
+  ssize_t n;
+  int status;
+  int pid;
+  cleanup_close int fd = -1;
+
+  snprintf (path, sizeof (path), "/proc/self/fdinfo/%d", pidfd);
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  n = TEMP_FAILURE_RETRY (read (fd, buf, sizeof (buf) - 1));
+  if (n <= 0)
+    return -1;
+  buf[n] = '\0';
+
+  it = strstr (buf, "Pid:");
+  if (it == NULL)
+    return -1;
+  pid = atoi (it + sizeof ("Pid:") - 1);
+  if (pid <= 0)
+    return -1;
+
+  close_and_reset (&fd);
+  snprintf (path, sizeof (path), "/proc/%d/stat", pid);
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  n = TEMP_FAILURE_RETRY (read (fd, buf, sizeof (buf) - 1));
+  if (n <= 0)
+    return -1;
+  buf[n] = '\0';
+
+  /* Skip past the parenthesized comm, then take the last field.  */
+  it = strrchr (buf, ')');
+  if (it == NULL)
+    return -1;
+  it = strrchr (it, ' ');
+  if (it == NULL)
+    return -1;
+  status = atoi (it + 1);
+
+  if (WIFEXITED (status))
+    return WEXITSTATUS (status);
+  if (WIFSIGNALED (status))
+    return 128 + WTERMSIG (status);
+  return -1;
+}
+
+/* The init process of C exited: collect its exit status, report it and forget
+   the container.  A failure here only loses the status of one container, it
+   must never take the supervisor down.  */
+static void
+handle_container_exit (int epollfd, struct supervised_container_s *c)
+{
+  int exit_status = -1;
+  siginfo_t info;
+  int ret;
+
+  info.si_pid = 0;
+  ret = TEMP_FAILURE_RETRY (waitid (P_PIDFD, c->pidfd, &info, WEXITED | WNOHANG));
+  if (ret == 0)
+    {
+      /* A child that has not exited yet: spurious wakeup.  */
+      if (info.si_pid == 0)
+        return;
+      exit_status = info.si_code == CLD_EXITED ? (info.si_status & 0xff) : 128 + info.si_status;
+    }
+  else if (errno == ECHILD)
+    {
+      /* The init is not our child, so the pidfd readability is the only exit
+         signal and the status has to come from procfs.  */
+      exit_status = read_exit_status_from_proc (c->pidfd);
+    }
+
+  if (exit_status < 0)
+    libcrun_warning ("cannot read the exit status for container `%s`", c->id);
+
+  ret = send_event (c, "exited %d", exit_status);
+  if (ret < 0)
+    libcrun_warning ("container `%s` exited with status %d but the client is gone", c->id, exit_status);
+
+  forget_container (epollfd, c);
+}
+
+/* Drain and discard pending terminal output so the pty buffer cannot fill up
+   and block the container.  Returns 1 when the slave side was closed.  */
+static int
+drain_terminal (struct supervised_container_s *c)
+{
+  char buf[8192];
+  ssize_t ret;
+
+  while (1)
+    {
+      ret = TEMP_FAILURE_RETRY (read (c->terminal_fd, buf, sizeof (buf)));
+      if (ret < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : 1;
+      if (ret == 0)
+        return 1;
+    }
+}
+
+/* Drain the notify socket datagrams and report READY=1 to the client.  */
+static void
+drain_notify_socket (struct supervised_container_s *c)
+{
+  char buf[256];
+  ssize_t ret;
+
+  while (1)
+    {
+      ret = recv (c->notify_fd, buf, sizeof (buf) - 1, MSG_DONTWAIT);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return;
+        }
+      buf[ret] = '\0';
+      if (strstr (buf, "READY=1"))
+        send_event (c, "ready");
+    }
+}
+
+int
+crun_command_supervisor (struct crun_global_arguments *global_args arg_unused, int argc, char **argv, libcrun_error_t *err)
+{
+  cleanup_close int listen_fd = -1;
+  cleanup_close int epollfd = -1;
+  int first_arg = 0;
+  int ret;
+
+  argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &supervisor_options);
+
+  if (supervisor_options.listen_path == NULL)
+    libcrun_fail_with_error (0, "please specify a socket with --listen");
+
+  /* Remove a stale socket left by a previous instance.  */
+  unlink (supervisor_options.listen_path);
+
+  listen_fd = open_unix_domain_socket (supervisor_options.listen_path, 0, err);
+  if (UNLIKELY (listen_fd < 0))
+    return listen_fd;
+
+  epollfd = epoll_create1 (EPOLL_CLOEXEC);
+  if (UNLIKELY (epollfd < 0))
+    return crun_make_error (err, errno, "epoll_create1");
+
+  ret = add_to_epoll (epollfd, listen_fd, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  while (1)
+    {
+      struct epoll_event events[10];
+      int i, nr_events;
+
+      nr_events = TEMP_FAILURE_RETRY (epoll_wait (epollfd, events, 10, -1));
+      if (UNLIKELY (nr_events < 0))
+        return crun_make_error (err, errno, "epoll_wait");
+
+      for (i = 0; i < nr_events; i++)
+        {
+          struct supervised_container_s *c;
+          int fd = events[i].data.fd;
+          int *which;
+
+          if (fd == listen_fd)
+            {
+              struct pending_conn_s *p;
+              int conn_fd;
+
+              conn_fd = TEMP_FAILURE_RETRY (accept4 (listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK));
+              if (UNLIKELY (conn_fd < 0))
+                return crun_make_error (err, errno, "accept");
+
+              /* Wait for the registration message instead of reading it here,
+                 so a silent client cannot wedge the loop.  */
+              ret = add_to_epoll (epollfd, conn_fd, err);
+              if (UNLIKELY (ret < 0))
+                {
+                  libcrun_warning ("%s", (*err)->msg);
+                  crun_error_release (err);
+                  close (conn_fd);
+                  continue;
+                }
+
+              p = xmalloc0 (sizeof (*p));
+              p->fd = conn_fd;
+              p->next = pending_conns;
+              pending_conns = p;
+              continue;
+            }
+
+          if (take_pending_conn (fd))
+            {
+              epoll_ctl (epollfd, EPOLL_CTL_DEL, fd, NULL);
+              ret = register_container (epollfd, fd, err);
+              if (UNLIKELY (ret < 0))
+                {
+                  /* A malformed registration must not take the loop down.  */
+                  libcrun_warning ("%s", (*err)->msg);
+                  crun_error_release (err);
+                }
+              continue;
+            }
+
+          c = find_container (fd, &which);
+          if (c == NULL)
+            continue;
+
+          if (which == &c->pidfd)
+            handle_container_exit (epollfd, c);
+          else if (which == &c->terminal_fd)
+            {
+              if (drain_terminal (c))
+                remove_and_close (epollfd, &c->terminal_fd);
+            }
+          else if (which == &c->notify_fd)
+            drain_notify_socket (c);
+          else if (which == &c->client_fd)
+            {
+              char buf[64];
+              ssize_t n;
+
+              /* Only hangups are expected: the client does not talk after
+                 the registration.  Keep supervising without it.  */
+              n = TEMP_FAILURE_RETRY (recv (c->client_fd, buf, sizeof (buf), MSG_DONTWAIT));
+              if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                remove_and_close (epollfd, &c->client_fd);
+            }
+        }
+    }
+
+  return 0;
+}
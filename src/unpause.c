@@ -42,7 +42,7 @@ static struct argp_option options[] = { {
     0,
 } };
 
-static char args_doc[] = "resume CONTAINER";
+static char args_doc[] = "resume CONTAINER [CONTAINER...]";
 
 static error_t
 parse_opt (int key, char *arg arg_unused, struct argp_state *state arg_unused)
@@ -71,11 +71,12 @@ crun_command_unpause (struct crun_global_arguments *global_args, int argc, char
   };
 
   argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &unpause_options);
-  crun_assert_n_args (argc - first_arg, 1, 2);
+  crun_assert_n_args (argc - first_arg, 1, -1);
 
   ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
-  return libcrun_container_unpause (&crun_context, argv[first_arg], err);
+  return libcrun_container_batch_pause_unpause (&crun_context, (const char *const *) (argv + first_arg),
+                                                argc - first_arg, false, err);
 }
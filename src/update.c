@@ -59,8 +59,11 @@ enum
   /* not in the resources block.  */
   L3_CACHE_SCHEMA,
   MEM_BW_SCHEMA,
+  MEMORY_RECLAIM,
 
   LAST_VALUE,
+
+  OPTION_BATCH,
 };
 
 struct description_s
@@ -106,6 +109,8 @@ set_value (int id, const char *value)
 
 static char *l3_cache_schema;
 static char *mem_bw_schema;
+static char *memory_reclaim;
+static bool batch;
 
 static struct argp_option options[]
     = { { "resources", 'r', "FILE", 0, "path to the file containing the resources to update", 0 },
@@ -120,11 +125,13 @@ static struct argp_option options[]
         { "kernel-memory", KERNEL_MEMORY, "VALUE", 0, "Kernel memory limit", 0 },
         { "kernel-memory-tcp", KERNEL_MEMORY_TCP, "VALUE", 0, "Kernel memory limit for tcp buffer", 0 },
         { "memory", MEMORY, "VALUE", 0, "Memory limit", 0 },
+        { "memory-reclaim", MEMORY_RECLAIM, "VALUE", 0, "Ask the kernel to reclaim the specified amount of memory from the container", 0 },
         { "memory-reservation", MEMORY_RESERVATION, "VALUE", 0, "Memory reservation or soft_limit", 0 },
         { "memory-swap", MEMORY_SWAP, "VALUE", 0, "Total memory usage", 0 },
         { "pids-limit", PIDS_LIMIT, "VALUE", 0, "Maximum number of pids allowed in the container", 0 },
         { "l3-cache-schema", L3_CACHE_SCHEMA, "VALUE", 0, "The string of Intel RDT/CAT L3 cache schema", 0 },
         { "mem-bw-schema", MEM_BW_SCHEMA, "VALUE", 0, "The string of Intel RDT/MBA memory bandwidth schema", 0 },
+        { "batch", OPTION_BATCH, 0, 0, "read a stream of `ID JSON` updates from stdin, one per line", 0 },
         {
             0,
         } };
@@ -141,6 +148,8 @@ parse_opt (int key, char *arg, struct argp_state *state)
       break;
 
     case ARGP_KEY_NO_ARGS:
+      if (batch)
+        break;
       libcrun_fail_with_error (0, "please specify a ID for the container");
 
     case BLKIO_WEIGHT:
@@ -168,6 +177,14 @@ parse_opt (int key, char *arg, struct argp_state *state)
       mem_bw_schema = argp_mandatory_argument (arg, state);
       break;
 
+    case MEMORY_RECLAIM:
+      memory_reclaim = argp_mandatory_argument (arg, state);
+      break;
+
+    case OPTION_BATCH:
+      batch = true;
+      break;
+
     default:
       return ARGP_ERR_UNKNOWN;
     }
@@ -177,18 +194,63 @@ parse_opt (int key, char *arg, struct argp_state *state)
 
 static struct argp run_argp = { options, parse_opt, args_doc, doc, NULL, NULL, NULL };
 
+/* Apply a stream of `ID JSON` updates, one per line, from stdin.  The whole
+   batch runs in a single process so a node-wide reconcile does not pay a
+   runtime invocation per container.  */
+static int
+update_from_stream (libcrun_error_t *err)
+{
+  cleanup_free char *line = NULL;
+  size_t line_size = 0;
+  ssize_t len;
+  int ret;
+
+  while ((len = getline (&line, &line_size, stdin)) >= 0)
+    {
+      char *content;
+      char *id = line;
+
+      if (len > 0 && line[len - 1] == '\n')
+        line[len - 1] = '\0';
+      if (id[0] == '\0')
+        continue;
+
+      content = strchr (id, ' ');
+      if (content == NULL)
+        return crun_make_error (err, 0, "invalid update line `%s`: expected `ID JSON`", line);
+      *content++ = '\0';
+
+      ret = libcrun_container_update (&crun_context, id, content, strlen (content), err);
+      if (UNLIKELY (ret < 0))
+        return ret;
+    }
+
+  if (ferror (stdin))
+    return crun_make_error (err, errno, "read from stdin");
+
+  return 0;
+}
+
 int
 crun_command_update (struct crun_global_arguments *global_args, int argc, char **argv, libcrun_error_t *err)
 {
   int first_arg = 0, ret;
 
   argp_parse (&run_argp, argc, argv, ARGP_IN_ORDER, &first_arg, &crun_context);
-  crun_assert_n_args (argc - first_arg, 1, 1);
+  crun_assert_n_args (argc - first_arg, batch ? 0 : 1, batch ? 0 : 1);
 
   ret = init_libcrun_context (&crun_context, argv[first_arg], global_args, err);
   if (UNLIKELY (ret < 0))
     return ret;
 
+  if (batch)
+    {
+      if (resources || values_len > 0 || l3_cache_schema || mem_bw_schema || memory_reclaim)
+        return crun_make_error (err, EINVAL, "--batch cannot be used with other update options");
+
+      return update_from_stream (err);
+    }
+
   if (resources == NULL)
     {
       ret = libcrun_container_update_from_values (&crun_context, argv[first_arg], values, values_len, err);
@@ -215,5 +277,12 @@ crun_command_update (struct crun_global_arguments *global_args, int argc, char *
         return ret;
     }
 
+  if (memory_reclaim)
+    {
+      ret = libcrun_container_reclaim_memory (&crun_context, argv[first_arg], memory_reclaim, err);
+      if (ret < 0)
+        return ret;
+    }
+
   return 0;
 }
@@ -0,0 +1,409 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmark for the container lifecycle: drives create+start+delete
+   through the libcrun entry points against a minimal bundle and reports
+   per-phase latency percentiles.  Run it via `make bench`.
+
+   Environment:
+     CRUN_BENCH_BUNDLE          use an existing bundle instead of generating one
+     CRUN_BENCH_INIT            init binary copied into the generated rootfs
+                                (default: tests/init)
+     CRUN_BENCH_ITERATIONS      number of iterations (default: 50)
+     CRUN_BENCH_PRESERVE_FDS    open this many dummy descriptors and run the
+                                lifecycle with --preserve-fds set to it, to
+                                stress the fd preparation before exec
+     CRUN_BENCH_SYSCALL_BUDGET  fail if the median per-iteration syscall
+                                count exceeds this value
+
+   Per-phase syscall counts are collected through a perf counter on the
+   raw_syscalls:sys_enter tracepoint when it is accessible; the counter is
+   inherited, so the counts of the exited children are folded into the phase
+   where they were reaped.  */
+
+#include <config.h>
+
+#include <libcrun/container.h>
+#include <libcrun/custom-handler.h>
+#include <libcrun/error.h>
+#include <libcrun/profile.h>
+#include <libcrun/utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+static const char *bench_config = "{\n"
+                                  "    \"ociVersion\": \"1.0.0\",\n"
+                                  "    \"process\": {\n"
+                                  "        \"user\": {\"uid\": 0, \"gid\": 0},\n"
+                                  "        \"terminal\": false,\n"
+                                  "        \"args\": [\"/init\", \"pause\"],\n"
+                                  "        \"env\": [\"PATH=/bin\", \"TERM=xterm\"],\n"
+                                  "        \"cwd\": \"/\",\n"
+                                  "        \"noNewPrivileges\": true\n"
+                                  "    },\n"
+                                  "    \"root\": {\"path\": \"rootfs\", \"readonly\": true},\n"
+                                  "    \"mounts\": [\n"
+                                  "        {\"destination\": \"/proc\", \"type\": \"proc\"},\n"
+                                  "        {\"destination\": \"/dev\", \"type\": \"tmpfs\", \"source\": \"tmpfs\",\n"
+                                  "         \"options\": [\"nosuid\", \"strictatime\", \"mode=755\", \"size=65536k\"]}\n"
+                                  "    ],\n"
+                                  "    \"linux\": {\n"
+                                  "        \"rootfsPropagation\": \"rprivate\",\n"
+                                  "        \"namespaces\": [{\"type\": \"mount\"}, {\"type\": \"pid\"}]\n"
+                                  "    }\n"
+                                  "}\n";
+
+enum bench_phase
+{
+  PHASE_LOAD = 0,
+  PHASE_CREATE,
+  PHASE_START,
+  PHASE_DELETE,
+
+  PHASE_MAX,
+};
+
+static const char *phase_names[PHASE_MAX] = { "load", "create", "start", "delete" };
+
+static int64_t
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int
+compare_int64 (const void *a, const void *b)
+{
+  int64_t va = *(const int64_t *) a;
+  int64_t vb = *(const int64_t *) b;
+
+  return va < vb ? -1 : va > vb;
+}
+
+static int64_t
+percentile (int64_t *sorted, size_t len, int p)
+{
+  size_t idx = (len * p) / 100;
+
+  return sorted[idx >= len ? len - 1 : idx];
+}
+
+static int
+copy_init (const char *init_path, const char *dest, libcrun_error_t *err)
+{
+  cleanup_free char *content = NULL;
+  size_t len;
+  int ret;
+
+  ret = read_all_file (init_path, &content, &len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = write_file_with_flags (dest, O_CREAT | O_TRUNC, content, len, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  return chmod (dest, 0755);
+}
+
+static int
+make_bundle (char **out, libcrun_error_t *err)
+{
+  char template[] = "/tmp/crun-bench-XXXXXX";
+  const char *init_path;
+  cleanup_free char *rootfs = NULL;
+  cleanup_free char *init_dest = NULL;
+  cleanup_free char *config = NULL;
+  char *bundle;
+  int ret;
+
+  bundle = mkdtemp (template);
+  if (bundle == NULL)
+    return crun_make_error (err, errno, "mkdtemp");
+
+  ret = append_paths (&rootfs, err, bundle, "rootfs", NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = crun_ensure_directory (rootfs, 0755, true, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  init_path = getenv ("CRUN_BENCH_INIT");
+  if (init_path == NULL)
+    init_path = "tests/init";
+
+  ret = append_paths (&init_dest, err, rootfs, "init", NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = copy_init (init_path, init_dest, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = append_paths (&config, err, bundle, "config.json", NULL);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  ret = write_file (config, bench_config, strlen (bench_config), err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+
+  *out = xstrdup (bundle);
+  return 0;
+}
+
+static int
+run_iteration (const char *bundle, const char *id, int preserve_fds, int64_t *samples, int sc_fd,
+               int64_t *sc_samples, libcrun_error_t *err)
+{
+  cleanup_container libcrun_container_t *container = NULL;
+  libcrun_context_t context = {
+    0,
+  };
+  int64_t t0, t1;
+  long long sc0, sc1;
+  int ret;
+
+  context.id = id;
+  context.bundle = bundle;
+  context.fifo_exec_wait_fd = -1;
+  context.detach = true;
+  context.preserve_fds = preserve_fds;
+  context.handler_manager = libcrun_get_handler_manager ();
+
+  ret = chdir (bundle);
+  if (UNLIKELY (ret < 0))
+    return crun_make_error (err, errno, "chdir `%s`", bundle);
+
+  t0 = now_ns ();
+  sc0 = libcrun_profile_syscall_counter_read (sc_fd);
+  container = libcrun_container_load_from_file ("config.json", err);
+  if (container == NULL)
+    return crun_make_error (err, 0, "cannot load config.json");
+  t1 = now_ns ();
+  sc1 = libcrun_profile_syscall_counter_read (sc_fd);
+  samples[PHASE_LOAD] = t1 - t0;
+  sc_samples[PHASE_LOAD] = sc1 - sc0;
+
+  t0 = t1;
+  sc0 = sc1;
+  ret = libcrun_container_create (&context, container, 0, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  t1 = now_ns ();
+  sc1 = libcrun_profile_syscall_counter_read (sc_fd);
+  samples[PHASE_CREATE] = t1 - t0;
+  sc_samples[PHASE_CREATE] = sc1 - sc0;
+
+  t0 = t1;
+  sc0 = sc1;
+  ret = libcrun_container_start (&context, id, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  t1 = now_ns ();
+  sc1 = libcrun_profile_syscall_counter_read (sc_fd);
+  samples[PHASE_START] = t1 - t0;
+  sc_samples[PHASE_START] = sc1 - sc0;
+
+  t0 = t1;
+  sc0 = sc1;
+  ret = libcrun_container_delete (&context, NULL, id, true, err);
+  if (UNLIKELY (ret < 0))
+    return ret;
+  t1 = now_ns ();
+  sc1 = libcrun_profile_syscall_counter_read (sc_fd);
+  samples[PHASE_DELETE] = t1 - t0;
+  sc_samples[PHASE_DELETE] = sc1 - sc0;
+
+  return 0;
+}
+
+int
+main (int argc arg_unused, char **argv arg_unused)
+{
+  cleanup_free char *bundle_generated = NULL;
+  cleanup_free int64_t *samples = NULL;
+  cleanup_free int64_t *sc_samples = NULL;
+  libcrun_error_t err = NULL;
+  const char *bundle;
+  size_t iterations = 50;
+  const char *it_env;
+  const char *fds_env;
+  const char *budget_env;
+  int preserve_fds = 0;
+  cleanup_close int sc_fd = -1;
+  size_t done = 0;
+  size_t i, phase;
+  int ret;
+
+  it_env = getenv ("CRUN_BENCH_ITERATIONS");
+  if (it_env != NULL)
+    iterations = strtoul (it_env, NULL, 10);
+  if (iterations == 0)
+    iterations = 1;
+
+  bundle = getenv ("CRUN_BENCH_BUNDLE");
+  if (bundle == NULL)
+    {
+      ret = make_bundle (&bundle_generated, &err);
+      if (UNLIKELY (ret < 0))
+        goto fail;
+      bundle = bundle_generated;
+    }
+
+  fds_env = getenv ("CRUN_BENCH_PRESERVE_FDS");
+  if (fds_env != NULL)
+    preserve_fds = atoi (fds_env);
+  if (preserve_fds > 0)
+    {
+      int null_fd;
+      int j;
+
+      /* The descriptors are deliberately inheritable, like the sets the
+         engines pass with --preserve-fds: the runtime must leave the window
+         [3, 3 + preserve_fds) alone and sanitize everything above it.  */
+      null_fd = open ("/dev/null", O_RDWR);
+      if (null_fd < 0)
+        {
+          fprintf (stderr, "bench: open `/dev/null`: %m\n");
+          return 1;
+        }
+      for (j = 0; j < preserve_fds; j++)
+        if (dup (null_fd) < 0)
+          {
+            fprintf (stderr, "bench: dup: %m\n");
+            return 1;
+          }
+    }
+
+  budget_env = getenv ("CRUN_BENCH_SYSCALL_BUDGET");
+
+  sc_fd = libcrun_profile_syscall_counter_open (true);
+  if (sc_fd < 0 && budget_env != NULL)
+    {
+      fprintf (stderr, "bench: cannot open the syscall counter but a budget was requested\n");
+      return 1;
+    }
+
+  samples = xmalloc0 (iterations * PHASE_MAX * sizeof (int64_t));
+  sc_samples = xmalloc0 (iterations * PHASE_MAX * sizeof (int64_t));
+
+  for (i = 0; i < iterations; i++)
+    {
+      char id[64];
+
+      snprintf (id, sizeof (id), "crun-bench-%d-%zu", getpid (), i);
+
+      ret = run_iteration (bundle, id, preserve_fds, samples + done * PHASE_MAX, sc_fd,
+                           sc_samples + done * PHASE_MAX, &err);
+      if (UNLIKELY (ret < 0))
+        {
+          libcrun_context_t context = {
+            0,
+          };
+          libcrun_error_t tmp_err = NULL;
+
+          /* Best effort cleanup, then give up.  */
+          context.id = id;
+          context.fifo_exec_wait_fd = -1;
+          libcrun_container_delete (&context, NULL, id, true, &tmp_err);
+          crun_error_release (&tmp_err);
+          goto fail;
+        }
+      done++;
+    }
+
+  printf ("%-8s %10s %10s %10s %10s (us, %zu iterations)\n", "phase", "min", "p50", "p99", "max", done);
+  for (phase = 0; phase < PHASE_MAX; phase++)
+    {
+      cleanup_free int64_t *sorted = xmalloc (done * sizeof (int64_t));
+
+      for (i = 0; i < done; i++)
+        sorted[i] = samples[i * PHASE_MAX + phase];
+      qsort (sorted, done, sizeof (int64_t), compare_int64);
+
+      printf ("%-8s %10.1f %10.1f %10.1f %10.1f\n", phase_names[phase],
+              sorted[0] / 1000.0,
+              percentile (sorted, done, 50) / 1000.0,
+              percentile (sorted, done, 99) / 1000.0,
+              sorted[done - 1] / 1000.0);
+    }
+
+  if (sc_fd >= 0)
+    {
+      cleanup_free int64_t *totals = xmalloc (done * sizeof (int64_t));
+      int64_t p50_total;
+
+      printf ("\n%-8s %10s %10s %10s %10s (syscalls, including reaped children)\n", "phase", "min", "p50", "p99",
+              "max");
+      for (phase = 0; phase < PHASE_MAX; phase++)
+        {
+          cleanup_free int64_t *sorted = xmalloc (done * sizeof (int64_t));
+
+          for (i = 0; i < done; i++)
+            sorted[i] = sc_samples[i * PHASE_MAX + phase];
+          qsort (sorted, done, sizeof (int64_t), compare_int64);
+
+          printf ("%-8s %10" PRId64 " %10" PRId64 " %10" PRId64 " %10" PRId64 "\n", phase_names[phase],
+                  sorted[0],
+                  percentile (sorted, done, 50),
+                  percentile (sorted, done, 99),
+                  sorted[done - 1]);
+        }
+
+      for (i = 0; i < done; i++)
+        {
+          totals[i] = 0;
+          for (phase = 0; phase < PHASE_MAX; phase++)
+            totals[i] += sc_samples[i * PHASE_MAX + phase];
+        }
+      qsort (totals, done, sizeof (int64_t), compare_int64);
+      p50_total = percentile (totals, done, 50);
+
+      printf ("\ntotal syscalls per iteration: p50 %" PRId64 "\n", p50_total);
+
+      if (budget_env != NULL && p50_total > (int64_t) strtoll (budget_env, NULL, 10))
+        {
+          fprintf (stderr, "bench: syscall budget exceeded: p50 %" PRId64 " > %s\n", p50_total, budget_env);
+          return 1;
+        }
+    }
+
+  return 0;
+
+fail:
+  if (err)
+    {
+      fprintf (stderr, "bench: %s\n", err->msg);
+      crun_error_release (&err);
+    }
+  return 1;
+}
@@ -0,0 +1,176 @@
+/*
+ * crun - OCI runtime written in C
+ *
+ * Copyright (C) 2017, 2018, 2019 Giuseppe Scrivano <giuseppe@scrivano.org>
+ * crun is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * crun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with crun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libcrun/json-scan.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef int (*test) ();
+
+static yajl_val
+parse (const char *input)
+{
+  return libcrun_json_parse_tree (input, strlen (input));
+}
+
+static int
+test_json_scan_document ()
+{
+  const char *doc = "{\"ociVersion\": \"1.0.0\", \"process\": {\"terminal\": true, "
+                    "\"args\": [\"sh\", \"-c\", \"exit 0\"], \"oomScoreAdj\": -500}, "
+                    "\"empty\": [], \"missing\": null}";
+  const char *version_path[] = { "ociVersion", NULL };
+  const char *args_path[] = { "process", "args", NULL };
+  const char *oom_path[] = { "process", "oomScoreAdj", NULL };
+  yajl_val tree, v;
+
+  tree = parse (doc);
+  if (tree == NULL)
+    return -1;
+
+  v = yajl_tree_get (tree, version_path, yajl_t_string);
+  if (v == NULL || strcmp (YAJL_GET_STRING (v), "1.0.0") != 0)
+    goto fail;
+
+  v = yajl_tree_get (tree, args_path, yajl_t_array);
+  if (v == NULL || YAJL_GET_ARRAY (v)->len != 3)
+    goto fail;
+  if (strcmp (YAJL_GET_STRING (YAJL_GET_ARRAY (v)->values[2]), "exit 0") != 0)
+    goto fail;
+
+  v = yajl_tree_get (tree, oom_path, yajl_t_number);
+  if (v == NULL || YAJL_GET_INTEGER (v) != -500)
+    goto fail;
+
+  yajl_tree_free (tree);
+  return 0;
+
+fail:
+  yajl_tree_free (tree);
+  return -1;
+}
+
+static int
+test_json_scan_valid_numbers ()
+{
+  const char *valid[] = { "0", "-0", "123", "-17", "0.5", "1.25", "1e3", "1E+3", "2e-2", "-12.75e2", NULL };
+  size_t i;
+
+  for (i = 0; valid[i]; i++)
+    {
+      yajl_val tree = parse (valid[i]);
+      if (tree == NULL)
+        return -1;
+      if (! YAJL_IS_NUMBER (tree))
+        {
+          yajl_tree_free (tree);
+          return -1;
+        }
+      yajl_tree_free (tree);
+    }
+
+  return 0;
+}
+
+static int
+test_json_scan_invalid_numbers ()
+{
+  /* RFC 8259 rejects all of these; the scanner must too, so the yajl
+     fallback gets to judge them instead of a lax parse succeeding.  */
+  const char *invalid[] = { "01", "-01", "1.", "1.e3", ".5", "-.5", "1e", "1e+", "-", "+1", NULL };
+  size_t i;
+
+  for (i = 0; invalid[i]; i++)
+    {
+      yajl_val tree = parse (invalid[i]);
+      if (tree != NULL)
+        {
+          yajl_tree_free (tree);
+          return -1;
+        }
+    }
+
+  return 0;
+}
+
+static int
+test_json_scan_invalid_documents ()
+{
+  const char *invalid[] = { "", "{", "[1,]", "{\"a\":}", "{\"a\":1,}", "nul", "\"unterminated", "{} {}", "[01]", NULL };
+  size_t i;
+
+  for (i = 0; invalid[i]; i++)
+    {
+      yajl_val tree = parse (invalid[i]);
+      if (tree != NULL)
+        {
+          yajl_tree_free (tree);
+          return -1;
+        }
+    }
+
+  return 0;
+}
+
+static int
+test_json_scan_string_escapes ()
+{
+  yajl_val tree = parse ("\"a\\\"b\\\\c\\n\\u0041\"");
+
+  if (tree == NULL)
+    return -1;
+  if (! YAJL_IS_STRING (tree) || strcmp (YAJL_GET_STRING (tree), "a\"b\\c\nA") != 0)
+    {
+      yajl_tree_free (tree);
+      return -1;
+    }
+
+  yajl_tree_free (tree);
+  return 0;
+}
+
+static void
+run_and_print_test_result (const char *name, int id, test t)
+{
+  int ret = t ();
+  if (ret == 0)
+    printf ("ok %d - %s\n", id, name);
+  else if (ret == 77)
+    printf ("ok %d - %s #SKIP\n", id, name);
+  else
+    printf ("not ok %d - %s\n", id, name);
+}
+
+#define RUN_TEST(T)                            \
+  do                                           \
+    {                                          \
+      run_and_print_test_result (#T, id++, T); \
+  } while (0)
+
+int
+main ()
+{
+  int id = 1;
+  printf ("1..5\n");
+  RUN_TEST (test_json_scan_document);
+  RUN_TEST (test_json_scan_valid_numbers);
+  RUN_TEST (test_json_scan_invalid_numbers);
+  RUN_TEST (test_json_scan_invalid_documents);
+  RUN_TEST (test_json_scan_string_escapes);
+  return 0;
+}